@@ -3,18 +3,175 @@
 #include <fstream>
 #include <sstream>
 #include <cstdlib>
+#include <cstdio>
+#include <cstring>
 
 #include <TROOT.h>
 #include <TSystem.h>
 #if defined(WIN32)
 #else
 #include <TUnixSystem.h>
+#include <pthread.h>
+#include <unistd.h>
 #endif
 
 using namespace std;
 
 // ----------------------------------------------------------------------
-anaFullTest::anaFullTest(): fNrocs(16), fTrimVcal(40) {
+// -- text parsing and the worker pool, no ROOT (and no Form()) in here as it runs in several threads
+
+// parsed contents of one full test directory
+struct fullTestData {
+  string moduleName, dir;
+  map<string, vector<vector<int> > > dacs;  // per DAC: all values found, per ROC
+  map<string, vector<double> > logValues;   // per log tag: values per ROC
+};
+
+// shared state of the worker pool
+struct fullTestJobs {
+  vector<fullTestData> *data;
+  size_t next;
+  int nrocs, trimVcal;
+  vector<string> dacs, tags;
+#if defined(WIN32)
+#else
+  pthread_mutex_t mutex;
+#endif
+};
+
+// ----------------------------------------------------------------------
+static bool readWholeFile(const string &name, vector<char> &content) {
+  FILE *f = fopen(name.c_str(), "rb");
+  if (!f) return false;
+  content.clear();
+  char buffer[65536];
+  size_t n;
+  while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+    content.insert(content.end(), buffer, buffer + n);
+  }
+  fclose(f);
+  // -- lines are NUL-terminated in place
+  content.push_back('\0');
+  for (size_t i = 0; i < content.size(); ++i) {
+    if (content[i] == '\n' || content[i] == '\r') content[i] = '\0';
+  }
+  return true;
+}
+
+// ----------------------------------------------------------------------
+static vector<double> splitValues(const char *line, int nrocs) {
+  vector<double> result;
+  double x(0.);
+  char *end;
+  for (int iroc = 0; iroc < nrocs; ++iroc) {
+    double y = strtod(line, &end);
+    if (end != line) x = y;
+    line = end;
+    result.push_back(x);
+  }
+  return result;
+}
+
+// ----------------------------------------------------------------------
+static void parseDacFile(vector<char> &content, const vector<string> &dacs, map<string, vector<int> > &vals) {
+  const char *end = &content[0] + content.size();
+  for (const char *line = &content[0]; line < end; line += strlen(line) + 1) {
+    if (line[0] == '#' || line[0] == '/' || line[0] == '\0') continue;
+    size_t len = strlen(line);
+    for (unsigned int idac = 0; idac < dacs.size(); ++idac) {
+      const char *s1 = strstr(line, dacs[idac].c_str());
+      if (!s1) continue;
+      size_t pos = (s1 - line) + dacs[idac].length() + 1;
+      vals[dacs[idac]].push_back(pos < len ? atoi(line + pos) : 0);
+    }
+  }
+}
+
+// ----------------------------------------------------------------------
+static bool parseLogFile(const string &name, const vector<string> &tags, int nrocs, map<string, vector<double> > &vals) {
+  // -- log files are large, stop reading as soon as all tags are found
+  FILE *f = fopen(name.c_str(), "r");
+  if (!f) return false;
+  char line[65536];
+  size_t nfound(0);
+  while (nfound < tags.size() && fgets(line, sizeof(line), f)) {
+    size_t len = strcspn(line, "\r\n");
+    line[len] = '\0';
+    for (unsigned int itag = 0; itag < tags.size(); ++itag) {
+      if (vals.count(tags[itag])) continue;
+      const char *s1 = strstr(line, tags[itag].c_str());
+      if (!s1) continue;
+      size_t pos = (s1 - line) + tags[itag].length() + 1;
+      vals[tags[itag]] = splitValues(pos < len ? line + pos : "", nrocs);
+      ++nfound;
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+// ----------------------------------------------------------------------
+static void readFullTest(const fullTestJobs &jobs, fullTestData &data) {
+  vector<char> content;
+  char name[1000];
+  for (unsigned int idac = 0; idac < jobs.dacs.size(); ++idac) {
+    data.dacs[jobs.dacs[idac]].resize(jobs.nrocs);
+  }
+  for (int iroc = 0; iroc < jobs.nrocs; ++iroc) {
+    snprintf(name, sizeof(name), "%s/dacParameters%d_C%d.dat", data.dir.c_str(), jobs.trimVcal, iroc);
+    if (!readWholeFile(name, content)) continue;
+    map<string, vector<int> > vals;
+    parseDacFile(content, jobs.dacs, vals);
+    for (map<string, vector<int> >::iterator it = vals.begin(); it != vals.end(); ++it) {
+      data.dacs[it->first][iroc] = it->second;
+    }
+  }
+
+  snprintf(name, sizeof(name), "%s/pxar.log", data.dir.c_str());
+  parseLogFile(name, jobs.tags, jobs.nrocs, data.logValues);
+}
+
+#if defined(WIN32)
+#else
+// ----------------------------------------------------------------------
+static void* fullTestWorker(void *arg) {
+  fullTestJobs *jobs = static_cast<fullTestJobs*>(arg);
+  while (1) {
+    pthread_mutex_lock(&jobs->mutex);
+    size_t idx = jobs->next++;
+    pthread_mutex_unlock(&jobs->mutex);
+    if (idx >= jobs->data->size()) break;
+    readFullTest(*jobs, jobs->data->at(idx));
+  }
+  return 0;
+}
+#endif
+
+// ----------------------------------------------------------------------
+static void readFullTests(fullTestJobs &jobs, int nthreads) {
+  jobs.next = 0;
+#if defined(WIN32)
+  for (unsigned int i = 0; i < jobs.data->size(); ++i) readFullTest(jobs, jobs.data->at(i));
+#else
+  if (nthreads < 1) nthreads = static_cast<int>(sysconf(_SC_NPROCESSORS_ONLN));
+  if (nthreads > static_cast<int>(jobs.data->size())) nthreads = static_cast<int>(jobs.data->size());
+  if (nthreads < 1) nthreads = 1;
+
+  pthread_mutex_init(&jobs.mutex, 0);
+  vector<pthread_t> threads(nthreads);
+  int nstarted(0);
+  for (int i = 0; i < nthreads; ++i) {
+    if (0 == pthread_create(&threads[nstarted], 0, fullTestWorker, &jobs)) ++nstarted;
+  }
+  // -- no threads available: do the work here
+  if (0 == nstarted) fullTestWorker(&jobs);
+  for (int i = 0; i < nstarted; ++i) pthread_join(threads[i], 0);
+  pthread_mutex_destroy(&jobs.mutex);
+#endif
+}
+
+// ----------------------------------------------------------------------
+anaFullTest::anaFullTest(): fNrocs(16), fTrimVcal(40), fNthreads(0) {
   cout << "anaFullTest ctor" << endl;
   c0 = (TCanvas*)gROOT->FindObject("c0"); 
   if (!c0) c0 = new TCanvas("c0","--c0--",0,0,656,700);
@@ -114,12 +271,14 @@ void anaFullTest::bookModuleSummary(string modulename) {
 
 // ----------------------------------------------------------------------
 void anaFullTest::validateFullTests() {
+  vector<string> mnames, mpatterns;
   // -- PSI module
-  addFullTests("D14-0001", "-003");
+  mnames.push_back("D14-0001"); mpatterns.push_back("-003");
   // -- ETH modules 
-  addFullTests("D14-0006", "-000");
-  addFullTests("D14-0008", "-000");
-  addFullTests("D14-0009", "-000");
+  mnames.push_back("D14-0006"); mpatterns.push_back("-000");
+  mnames.push_back("D14-0008"); mpatterns.push_back("-000");
+  mnames.push_back("D14-0009"); mpatterns.push_back("-000");
+  addFullTests(mnames, mpatterns);
 
   TH1D *hVana = new TH1D("hVana", Form("Vana %s", fDiffMetric == 0?"difference":"RMS"), 50, 0., 5.);
   TH1D *hCaldel = new TH1D("hCaldel", Form("CalDel %s", fDiffMetric == 0?"difference":"RMS"), 50, 0., 5.);
@@ -216,44 +375,81 @@ void anaFullTest::validateFullTests() {
 
 // ----------------------------------------------------------------------
 void anaFullTest::addFullTests(string mname, string mpattern) {
-  vector<string> dirs = glob(mname+mpattern); 
-  cout << dirs.size() << endl;
-  for (unsigned int idirs = 0; idirs < dirs.size(); ++idirs) {
-    cout << dirs[idirs] << endl;
+  addFullTests(vector<string>(1, mname), vector<string>(1, mpattern));
+}
+
+
+// ----------------------------------------------------------------------
+void anaFullTest::addFullTests(vector<string> mnames, vector<string> mpatterns) {
+
+  vector<fullTestData> data;
+  for (unsigned int imod = 0; imod < mnames.size() && imod < mpatterns.size(); ++imod) {
+    vector<string> dirs = glob(mnames[imod]+mpatterns[imod]); 
+    cout << dirs.size() << endl;
+    for (unsigned int idirs = 0; idirs < dirs.size(); ++idirs) {
+      cout << dirs[idirs] << endl;
+      fullTestData d;
+      d.moduleName = mnames[imod];
+      d.dir = dirs[idirs];
+      data.push_back(d);
+    }
+    bookModuleSummary(mnames[imod]); 
   }
 
-  bookModuleSummary(mname); 
-
-  for (unsigned int idirs = 0; idirs < dirs.size(); ++idirs) {
-    readDacFile(dirs[idirs], "vana", fModSummaries[mname]->vana);
-    readDacFile(dirs[idirs], "caldel", fModSummaries[mname]->caldel);
-    readDacFile(dirs[idirs], "vthrcomp", fModSummaries[mname]->vthrcomp);
-    readDacFile(dirs[idirs], "vtrim", fModSummaries[mname]->vtrim);
-    readDacFile(dirs[idirs], "phscale", fModSummaries[mname]->phscale);
-    readDacFile(dirs[idirs], "phoffset", fModSummaries[mname]->phoffset);
-
-   
-//     readLogFile(dirs[idirs], "number of dead pixels (per ROC):", fModSummaries[mname]->ndeadpixels);
-//     readLogFile(dirs[idirs], "number of dead bumps (per ROC):", fModSummaries[mname]->ndeadbumps);
-//     readLogFile(dirs[idirs], "separation cut       (per ROC):", fModSummaries[mname]->deadsep);    
-    readLogFile(dirs[idirs], "vcal mean:", fModSummaries[mname]->trimthrpos);
-    readLogFile(dirs[idirs], "vcal RMS:", fModSummaries[mname]->trimthrrms);
-    readLogFile(dirs[idirs], "p1 mean:", fModSummaries[mname]->p1pos);
-    readLogFile(dirs[idirs], "p1 RMS:", fModSummaries[mname]->p1rms);
-      
-    /*
-      vcal mean:
-      vcal RMS: 
-      bits mean:
-      bits RMS: 
-
-      VthrComp mean:
-      VthrComp RMS:
-      Vcal mean:
-      Vcal RMS:
-     */
+  fullTestJobs jobs;
+  jobs.data = &data;
+  jobs.nrocs = fNrocs;
+  jobs.trimVcal = fTrimVcal;
+  jobs.dacs = fDacs;
+  jobs.tags.push_back("vcal mean:");
+  jobs.tags.push_back("vcal RMS:");
+  jobs.tags.push_back("p1 mean:");
+  jobs.tags.push_back("p1 RMS:");
+  readFullTests(jobs, fNthreads);
+
+  // -- merge into the module summaries, in directory order
+  for (unsigned int i = 0; i < data.size(); ++i) {
+    moduleSummary *ms = fModSummaries[data[i].moduleName];
+    for (map<string, vector<vector<int> > >::iterator it = data[i].dacs.begin(); it != data[i].dacs.end(); ++it) {
+      vector<TH1D*> *hists = dacHists(ms, it->first);
+      if (!hists) continue;
+      for (unsigned int iroc = 0; iroc < it->second.size() && iroc < hists->size(); ++iroc) {
+	for (unsigned int j = 0; j < it->second[iroc].size(); ++j) {
+	  (*hists)[iroc]->Fill(it->second[iroc][j]); 
+	}
+      }
+    }
+
+    TH1D *logHists[] = {ms->trimthrpos, ms->trimthrrms, ms->p1pos, ms->p1rms};
+    for (unsigned int itag = 0; itag < jobs.tags.size(); ++itag) {
+      vector<double> &x = data[i].logValues[jobs.tags[itag]];
+      for (unsigned int j = 0; j < x.size(); ++j) {
+	logHists[itag]->Fill(x[j]); 
+      }
+    }
   }
 
+  for (unsigned int imod = 0; imod < mnames.size() && imod < mpatterns.size(); ++imod) {
+    summarizeModule(mnames[imod]);
+  }
+}
+
+
+// ----------------------------------------------------------------------
+vector<TH1D*>* anaFullTest::dacHists(moduleSummary *ms, string dac) {
+  if (dac == "vana") return &ms->vana; 
+  if (dac == "caldel") return &ms->caldel; 
+  if (dac == "vthrcomp") return &ms->vthrcomp; 
+  if (dac == "vtrim") return &ms->vtrim; 
+  if (dac == "phscale") return &ms->phscale; 
+  if (dac == "phoffset") return &ms->phoffset; 
+  return 0; 
+}
+
+
+// ----------------------------------------------------------------------
+void anaFullTest::summarizeModule(string mname) {
+
   for (int iroc = 0; iroc < fNrocs; ++iroc) {
     fModSummaries[mname]->rmsVana->Fill(diff(fModSummaries[mname]->vana[iroc])); 
     fModSummaries[mname]->rmsCaldel->Fill(diff(fModSummaries[mname]->caldel[iroc])); 
@@ -299,81 +495,40 @@ void anaFullTest::addFullTests(string mname, string mpattern) {
 // ----------------------------------------------------------------------
 void anaFullTest::readLogFile(std::string dir, std::string tag, std::vector<TH1D*> hists) {
 
-  ifstream IN; 
-
-  char buffer[1000];
-  string sline; 
-  string::size_type s1;
-  vector<double> x;
-  IN.open(Form("%s/pxar.log", dir.c_str())); 
-  while (IN.getline(buffer, 1000, '\n')) {
-    sline = buffer; 
-    s1 = sline.find(tag.c_str()); 
-    if (string::npos == s1) continue;
-    sline = sline.substr(s1+tag.length()+1);
-    break;
-  }
+  map<string, vector<double> > vals;
+  parseLogFile(Form("%s/pxar.log", dir.c_str()), vector<string>(1, tag), fNrocs, vals); 
 
-  x = splitIntoRocs(sline);
-  for (unsigned int i = 0; i < x.size(); ++i) {
-    //     cout << "Filling into " << hist->GetName() << " x = " << x[i] << endl;
+  vector<double> &x = vals[tag];
+  for (unsigned int i = 0; i < x.size() && i < hists.size(); ++i) {
     hists[i]->Fill(x[i]); 
   }
-
-  IN.close(); 
 }
 
 // ----------------------------------------------------------------------
 void anaFullTest::readLogFile(std::string dir, std::string tag, TH1D* hist) {
 
-  ifstream IN; 
-
-  char buffer[1000];
-  string sline; 
-  string::size_type s1;
-  vector<double> x;
-  IN.open(Form("%s/pxar.log", dir.c_str())); 
-  while (IN.getline(buffer, 1000, '\n')) {
-    sline = buffer; 
-    s1 = sline.find(tag.c_str()); 
-    if (string::npos == s1) continue;
-    sline = sline.substr(s1+tag.length()+1);
-    break;
-  }
-  x = splitIntoRocs(sline);
+  map<string, vector<double> > vals;
+  parseLogFile(Form("%s/pxar.log", dir.c_str()), vector<string>(1, tag), fNrocs, vals); 
+
+  vector<double> &x = vals[tag];
   for (unsigned int i = 0; i < x.size(); ++i) {
-    //     cout << "Filling into " << hist->GetName() << " x = " << x[i] << endl;
     hist->Fill(x[i]); 
   }
-
-  IN.close(); 
 }
 
 
 
 // ----------------------------------------------------------------------
 void anaFullTest::readDacFile(string dir, string dac, vector<TH1D*> vals) {
-  ifstream IN; 
 
-  char buffer[1000];
-  string sline; 
-  string::size_type s1;
-  int val(0); 
+  vector<char> content;
   for (int i = 0; i < fNrocs; ++i) {
-    IN.open(Form("%s/dacParameters%d_C%d.dat", dir.c_str(), fTrimVcal, i)); 
-    while (IN.getline(buffer, 1000, '\n')) {
-      if (buffer[0] == '#') {continue;}
-      if (buffer[0] == '/') {continue;}
-      if (buffer[0] == '\n') {continue;}
-      sline = buffer; 
-      s1 = sline.find(dac.c_str()); 
-      if (string::npos != s1) {
-	sline = sline.substr(s1+dac.length()+1); 
-	val = atoi(sline.c_str()); 
-	vals[i]->Fill(val); 
-      }
+    if (!readWholeFile(Form("%s/dacParameters%d_C%d.dat", dir.c_str(), fTrimVcal, i), content)) continue;
+    map<string, vector<int> > x;
+    parseDacFile(content, vector<string>(1, dac), x); 
+    for (unsigned int j = 0; j < x[dac].size(); ++j) {
+      vals[i]->Fill(x[dac][j]); 
     }
-    IN.close(); 
   }
 
 }
@@ -417,14 +572,8 @@ double anaFullTest::diff(TH1D *h) {
 
 // ----------------------------------------------------------------------
 std::vector<double> anaFullTest::splitIntoRocs(std::string line) {
-  istringstream istring(line);
-  vector<double> result; 
-  double x(0.); 
   cout << "splitting: " << line << endl;
-  for (int iroc = 0; iroc < fNrocs; ++iroc) {
-    istring >> x;
-    result.push_back(x); 
-  }
+  vector<double> result = splitValues(line.c_str(), fNrocs); 
 
   for (unsigned int i = 0; i < result.size(); ++i) {
     cout << result[i] << " "; 
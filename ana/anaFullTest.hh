@@ -3,6 +3,8 @@
 
 #include <iostream>
 #include <map>
+#include <string>
+#include <vector>
 
 #include "TString.h"
 #include "TObject.h"
@@ -37,12 +39,16 @@ class DLLEXPORT anaFullTest {
   virtual ~anaFullTest(); 
 
   void addFullTests(std::string mname = "D14-0006", std::string mpattern = "-000");
+  // -- all directories of all modules are read in parallel, summaries are merged at the end
+  void addFullTests(std::vector<std::string> mnames, std::vector<std::string> mpatterns);
+  void setNthreads(int n) {fNthreads = n;}
   void validateFullTests();
   void readDacFile(std::string dir, std::string dac, std::vector<TH1D*> hists);
   void readLogFile(std::string dir, std::string tag, std::vector<TH1D*> hists);
   void readLogFile(std::string dir, std::string tag, TH1D* hist);
 
   void bookModuleSummary(std::string modulename); 
+  void summarizeModule(std::string modulename); 
 
   std::vector<double> splitIntoRocs(std::string line); 
   std::vector<std::string> glob(std::string basename);
@@ -53,6 +59,9 @@ private:
   TCanvas *c0;
   int fNrocs, fTrimVcal; 
   int fDiffMetric; // 0: maxbin - minbin (~ difference), 1: RMS, 2: ??
+  int fNthreads;   // 0: number of cores
+
+  std::vector<TH1D*>* dacHists(moduleSummary *ms, std::string dac); 
 
   std::vector<std::string>    fDacs; 
   std::map<std::string, moduleSummary*> fModSummaries;
@@ -4,6 +4,7 @@
 
 #include "api.h"
 #include "hal.h"
+#include "eventring.h"
 #include "log.h"
 #include "timer.h"
 #include "helper.h"
@@ -19,7 +20,13 @@ using namespace pxar;
 pxarCore::pxarCore(std::string usbId, std::string logLevel) : 
   _daq_running(false), 
   _daq_buffersize(DTB_SOURCE_BUFFER_SIZE),
-  _daq_startstop_warning(false)
+  _daq_startstop_warning(false),
+  _loop_regulated(false),
+  _loop_period(0),
+  _loop_period_min(0),
+  _loop_fill_target(50),
+  _loop_backoff(false),
+  _event_ring(NULL)
 {
 
   LOG(logQUIET) << "Instanciating API for " << PACKAGE_STRING;
@@ -36,6 +43,7 @@ pxarCore::pxarCore(std::string usbId, std::string logLevel) :
 }
 
 pxarCore::~pxarCore() {
+  delete _event_ring;
   delete _dut;
   delete _hal;
 }
@@ -203,6 +211,10 @@ bool pxarCore::initDUT(std::vector<uint8_t> hubids,
   LOG(logDEBUGAPI) << "We have " << rocDACs.size() << " DAC configs and " << rocPixels.size() << " pixel configs, with " << rocDACs.at(0).size() << " and " << rocPixels.at(0).size() << " entries for the first ROC, respectively.";
 
   // First initialized the API's DUT instance with the information supplied.
+  // Any previous configuration is dropped, the last programmed device state is
+  // kept so programDUT can restrict itself to the changes:
+  _dut->roc.clear();
+  _dut->tbm.clear();
 
   // Initialize TBMs:
   LOG(logDEBUGAPI) << "Received settings for " << tbmDACs.size() << " TBM cores.";
@@ -397,13 +409,16 @@ bool pxarCore::initDUT(std::vector<uint8_t> hubids,
   return programDUT();
 }
 
-bool pxarCore::programDUT() {
+bool pxarCore::programDUT(bool force) {
 
   if(!_dut->_initialized) {
     LOG(logERROR) << "DUT not initialized, unable to program it.";
     return false;
   }
 
+  // If the devices are already programmed, try to only send the changes:
+  if(!force && _dut->_programmed && updateDUT()) { return true; }
+
   // First thing to do: startup DUT power if not yet done
   _hal->Pon();
 
@@ -435,12 +450,106 @@ bool pxarCore::programDUT() {
   // Also clear all calibrate signals:
   SetCalibrateBits(false);
 
+  // Remember the device state for later reprogramming:
+  _dut->_roc_state = _dut->roc;
+  _dut->_tbm_state = _dut->tbm;
+  _dut->_hubid_state = _dut->hubId;
+
   // The DUT is programmed, everything all right:
   _dut->_programmed = true;
 
   return true;
 }
 
+bool pxarCore::updateDUT() {
+
+  // Check if the DUT layout is still the same as the one programmed:
+  if(_dut->roc.size() != _dut->_roc_state.size() || _dut->tbm.size() != _dut->_tbm_state.size()) {
+    LOG(logDEBUGAPI) << "Number of devices changed, full DUT programming required.";
+    return false;
+  }
+  if(_dut->hubId != _dut->_hubid_state) {
+    LOG(logDEBUGAPI) << "HUB id changed, full DUT programming required.";
+    return false;
+  }
+  for(size_t i = 0; i < _dut->tbm.size(); i++) {
+    tbmConfig & tbm = _dut->tbm.at(i);
+    tbmConfig & old = _dut->_tbm_state.at(i);
+    if(tbm.type != old.type || tbm.hubid != old.hubid || tbm.core != old.core
+       || tbm.enable != old.enable || tbm.tokenchains != old.tokenchains
+       || tbm.NoTokenPass() != old.NoTokenPass()) {
+      LOG(logDEBUGAPI) << "TBM Core " << tbm.corename() << " setup changed, full DUT programming required.";
+      return false;
+    }
+  }
+  for(size_t i = 0; i < _dut->roc.size(); i++) {
+    rocConfig & roc = _dut->roc.at(i);
+    rocConfig & old = _dut->_roc_state.at(i);
+    if(roc.type != old.type || roc.i2c_address != old.i2c_address || roc.enable() != old.enable()) {
+      LOG(logDEBUGAPI) << "ROC@I2C " << static_cast<int>(roc.i2c_address) << " setup changed, full DUT programming required.";
+      return false;
+    }
+  }
+
+  LOG(logDEBUGAPI) << "DUT layout unchanged, only programming register changes.";
+
+  // Send all TBM registers which differ from the programmed state:
+  for(size_t i = 0; i < _dut->tbm.size(); i++) {
+    tbmConfig & tbm = _dut->tbm.at(i);
+    if(!tbm.enable) continue;
+
+    std::map<uint8_t,uint8_t> changed;
+    for(std::map<uint8_t,uint8_t>::iterator reg = tbm.dacs.begin(); reg != tbm.dacs.end(); ++reg) {
+      std::map<uint8_t,uint8_t>::iterator old = _dut->_tbm_state.at(i).dacs.find(reg->first);
+      if(old == _dut->_tbm_state.at(i).dacs.end() || old->second != reg->second) { changed.insert(*reg); }
+    }
+    if(changed.empty()) continue;
+
+    LOG(logDEBUGAPI) << "Updating " << changed.size() << " registers of TBM Core " << tbm.corename();
+    _hal->tbmSetRegs(tbm.hubid,tbm.core,changed);
+  }
+
+  // Send all ROC DACs which differ from the programmed state:
+  for(size_t i = 0; i < _dut->roc.size(); i++) {
+    rocConfig & roc = _dut->roc.at(i);
+    if(!roc.enable()) continue;
+
+    std::map<uint8_t,uint8_t> changed;
+    for(std::map<uint8_t,uint8_t>::iterator dac = roc.dacs.begin(); dac != roc.dacs.end(); ++dac) {
+      std::map<uint8_t,uint8_t>::iterator old = _dut->_roc_state.at(i).dacs.find(dac->first);
+      if(old == _dut->_roc_state.at(i).dacs.end() || old->second != dac->second) { changed.insert(*dac); }
+    }
+    if(changed.empty()) continue;
+
+    LOG(logDEBUGAPI) << "Updating " << changed.size() << " DACs of ROC@I2C " << static_cast<int>(roc.i2c_address);
+    _hal->rocSetDACs(roc.i2c_address,changed);
+  }
+
+  // Bring the pixel matrix back to its defined state - these are single commands per ROC:
+  MaskAndTrim(false);
+  for (std::vector<rocConfig>::iterator rocit = _dut->roc.begin(); rocit != _dut->roc.end(); ++rocit) {
+    _hal->AllColumnsSetEnable(rocit->i2c_address,true);
+  }
+  SetCalibrateBits(false);
+
+  // Remember the device state:
+  _dut->_roc_state = _dut->roc;
+  _dut->_tbm_state = _dut->tbm;
+
+  return true;
+}
+
+void pxarCore::updateRocState(size_t rocId, uint8_t dacRegister, uint8_t dacValue) {
+  // A different layout requires full programming anyway:
+  if(rocId >= _dut->_roc_state.size() || _dut->_roc_state.at(rocId).i2c_address != _dut->roc.at(rocId).i2c_address) return;
+  _dut->_roc_state.at(rocId).dacs[dacRegister] = dacValue;
+}
+
+void pxarCore::updateTbmState(size_t tbmId, uint8_t tbmRegister, uint8_t regValue) {
+  if(tbmId >= _dut->_tbm_state.size()) return;
+  _dut->_tbm_state.at(tbmId).dacs[tbmRegister] = regValue;
+}
+
 // API status function, checks HAL and DUT statuses
 bool pxarCore::status() {
   if(_hal->status() && _dut->status()) return true;
@@ -477,6 +586,24 @@ bool pxarCore::verifyRegister(std::string name, uint8_t &id, uint8_t &value, uin
   return true;
 }
 
+// Check value range of a resolved register
+bool pxarCore::verifyRegister(const registerHandle & reg, uint8_t &value) {
+
+  if(!reg.valid()) {
+    LOG(logERROR) << "Invalid register handle.";
+    return false;
+  }
+
+  if(value > reg.max()) {
+    LOG(logWARNING) << "Register range overflow, set register \"" 
+		    << reg.name() << "\" (" << static_cast<int>(reg.id()) << ") to " 
+		    << static_cast<int>(reg.max()) << " (was: " << static_cast<int>(value) << ")";
+    value = reg.max();
+  }
+
+  return true;
+}
+
 // Return the device code for the given name, return 0x0 if invalid:
 uint8_t pxarCore::stringToDeviceCode(std::string name) {
 
@@ -545,6 +672,57 @@ double pxarCore::getTBvd() {
   return _hal->getTBvd();
 }
 
+std::vector< std::pair<uint8_t, double> > pxarCore::getTBiaVsDAC(std::string dacName, uint8_t dacStep, uint8_t dacMin, uint8_t dacMax, uint8_t rocID, double tolerance) {
+  return getCurrentVsDAC(dac(dacName), dacStep, dacMin, dacMax, rocID, tolerance, true);
+}
+
+std::vector< std::pair<uint8_t, double> > pxarCore::getTBiaVsDAC(const dacHandle & dac, uint8_t dacStep, uint8_t dacMin, uint8_t dacMax, uint8_t rocID, double tolerance) {
+  return getCurrentVsDAC(dac, dacStep, dacMin, dacMax, rocID, tolerance, true);
+}
+
+std::vector< std::pair<uint8_t, double> > pxarCore::getTBidVsDAC(std::string dacName, uint8_t dacStep, uint8_t dacMin, uint8_t dacMax, uint8_t rocID, double tolerance) {
+  return getCurrentVsDAC(dac(dacName), dacStep, dacMin, dacMax, rocID, tolerance, false);
+}
+
+std::vector< std::pair<uint8_t, double> > pxarCore::getTBidVsDAC(const dacHandle & dac, uint8_t dacStep, uint8_t dacMin, uint8_t dacMax, uint8_t rocID, double tolerance) {
+  return getCurrentVsDAC(dac, dacStep, dacMin, dacMax, rocID, tolerance, false);
+}
+
+std::vector< std::pair<uint8_t, double> > pxarCore::getCurrentVsDAC(const dacHandle & dac, uint8_t dacStep, uint8_t dacMin, uint8_t dacMax, uint8_t rocID, double tolerance, bool analog) {
+
+  std::vector< std::pair<uint8_t, double> > result;
+  if(!status()) { return result; }
+
+  // Check DAC range
+  if(dacMin > dacMax) {
+    // Swapping the range:
+    LOG(logWARNING) << "Swapping upper and lower bound.";
+    uint8_t temp = dacMin;
+    dacMin = dacMax;
+    dacMax = temp;
+  }
+
+  // Check the range of the resolved register:
+  if(!verifyRegister(dac, dacMax)) { return result; }
+  uint8_t dacRegister = dac.id();
+
+  if(rocID >= _dut->roc.size()) {
+    LOG(logERROR) << "ROC " << static_cast<int>(rocID) << " does not exist in the DUT!";
+    return result;
+  }
+  uint8_t roci2c = _dut->roc.at(rocID).i2c_address;
+
+  // Sample every 1ms, require three consecutive samples to agree and give up after 0.5s:
+  result = _hal->rocCurrentVsDac(roci2c, dacRegister, dacStep, dacMin, dacMax, analog, tolerance, 3, 500, 1000);
+
+  // Reset the original value for the scanned DAC:
+  uint8_t oldDacValue = _dut->getDAC(rocID,dac);
+  LOG(logDEBUGAPI) << "Reset DAC \"" << dac.name() << "\" to original value " << static_cast<int>(oldDacValue);
+  _hal->rocSetDAC(roci2c,dacRegister,oldDacValue);
+
+  return result;
+}
+
 
 void pxarCore::HVoff() {
   _hal->HVoff();
@@ -648,13 +826,43 @@ statistics pxarCore::getStatistics() {
   
 // TEST functions
 
+dacHandle pxarCore::dac(std::string dacName) {
+
+  // Get the register number from dictionary:
+  uint8_t dacRegister;
+  uint8_t dacValue = 0;
+  if(!verifyRegister(dacName, dacRegister, dacValue, ROC_REG)) return dacHandle();
+
+  // Get singleton DAC dictionary object:
+  RegisterDictionary * _dict = RegisterDictionary::getInstance();
+  return dacHandle(dacName, dacRegister, _dict->getSize(dacRegister, ROC_REG));
+}
+
+tbmRegHandle pxarCore::tbmReg(std::string regName) {
+
+  // Get the register number from dictionary:
+  uint8_t _register;
+  uint8_t regValue = 0;
+  if(!verifyRegister(regName, _register, regValue, TBM_REG)) return tbmRegHandle();
+
+  // Get singleton DAC dictionary object:
+  RegisterDictionary * _dict = RegisterDictionary::getInstance();
+  return tbmRegHandle(regName, _register, _dict->getSize(_register, TBM_REG));
+}
+
 bool pxarCore::setDAC(std::string dacName, uint8_t dacValue, uint8_t rocID) {
+  dacHandle handle = dac(dacName);
+  if(!handle.valid()) return false;
+  return setDAC(handle, dacValue, rocID);
+}
+
+bool pxarCore::setDAC(const dacHandle & dac, uint8_t dacValue, uint8_t rocID) {
   
   if(!status()) {return false;}
 
-  // Get the register number and check the range from dictionary:
-  uint8_t dacRegister;
-  if(!verifyRegister(dacName, dacRegister, dacValue, ROC_REG)) return false;
+  // Check the range of the resolved register:
+  if(!verifyRegister(dac, dacValue)) return false;
+  uint8_t dacRegister = dac.id();
 
   std::pair<std::map<uint8_t,uint8_t>::iterator,bool> ret;
   std::vector<rocConfig>::iterator rocit;
@@ -669,14 +877,15 @@ bool pxarCore::setDAC(std::string dacName, uint8_t dacValue, uint8_t rocID) {
       // Update the DUT DAC Value:
       ret = rocit->dacs.insert(std::make_pair(dacRegister,dacValue));
       if(ret.second == true) {
-	LOG(logWARNING) << "DAC \"" << dacName << "\" was not initialized. Created with value " << static_cast<int>(dacValue);
+	LOG(logWARNING) << "DAC \"" << dac.name() << "\" was not initialized. Created with value " << static_cast<int>(dacValue);
       }
       else {
 	rocit->dacs[dacRegister] = dacValue;
-	LOG(logDEBUGAPI) << "DAC \"" << dacName << "\" updated with value " << static_cast<int>(dacValue);
+	LOG(logDEBUGAPI) << "DAC \"" << dac.name() << "\" updated with value " << static_cast<int>(dacValue);
       }
 
       _hal->rocSetDAC(rocit->i2c_address,dacRegister,dacValue);
+      updateRocState(rocit - _dut->roc.begin(),dacRegister,dacValue);
       break;
     }
   }
@@ -691,14 +900,23 @@ bool pxarCore::setDAC(std::string dacName, uint8_t dacValue, uint8_t rocID) {
 }
 
 bool pxarCore::setDAC(std::string dacName, uint8_t dacValue) {
+  dacHandle handle = dac(dacName);
+  if(!handle.valid()) return false;
+  return setDAC(handle, dacValue);
+}
+
+bool pxarCore::setDAC(const dacHandle & dac, uint8_t dacValue) {
   
   if(!status()) {return false;}
 
-  // Get the register number and check the range from dictionary:
-  uint8_t dacRegister;
-  if(!verifyRegister(dacName, dacRegister, dacValue, ROC_REG)) return false;
+  // Check the range of the resolved register:
+  if(!verifyRegister(dac, dacValue)) return false;
+  uint8_t dacRegister = dac.id();
 
   std::pair<std::map<uint8_t,uint8_t>::iterator,bool> ret;
+  // Collect the I2C addresses of all ROCs to be programmed:
+  std::vector<uint8_t> rocs;
+
   // Set the DAC for all active ROCs:
   for (std::vector<rocConfig>::iterator rocit = _dut->roc.begin(); rocit != _dut->roc.end(); ++rocit) {
 
@@ -708,19 +926,73 @@ bool pxarCore::setDAC(std::string dacName, uint8_t dacValue) {
     // Update the DUT DAC Value:
     ret = rocit->dacs.insert(std::make_pair(dacRegister,dacValue));
     if(ret.second == true) {
-      LOG(logWARNING) << "DAC \"" << dacName << "\" was not initialized. Created with value " << static_cast<int>(dacValue);
+      LOG(logWARNING) << "DAC \"" << dac.name() << "\" was not initialized. Created with value " << static_cast<int>(dacValue);
     }
     else {
       rocit->dacs[dacRegister] = dacValue;
-      LOG(logDEBUGAPI) << "DAC \"" << dacName << "\" updated with value " << static_cast<int>(dacValue);
+      LOG(logDEBUGAPI) << "DAC \"" << dac.name() << "\" updated with value " << static_cast<int>(dacValue);
     }
 
-    _hal->rocSetDAC(rocit->i2c_address,dacRegister,dacValue);
+    rocs.push_back(rocit->i2c_address);
+    updateRocState(rocit - _dut->roc.begin(),dacRegister,dacValue);
   }
 
+  // Program the DAC on all ROCs with one single transfer:
+  if(!rocs.empty()) { _hal->rocSetDAC(rocs,dacRegister,dacValue); }
+
   return true;
 }
 
+bool pxarCore::setDACs(std::map<uint8_t, std::map<std::string, uint8_t> > rocDacs) {
+
+  if(!status()) {return false;}
+
+  bool success = true;
+  std::pair<std::map<uint8_t,uint8_t>::iterator,bool> ret;
+  // Collect the registers to be programmed per ROC I2C address:
+  std::map<uint8_t, std::map<uint8_t, uint8_t> > registers;
+
+  for(std::map<uint8_t, std::map<std::string, uint8_t> >::iterator it = rocDacs.begin(); it != rocDacs.end(); ++it) {
+
+    // We might not have this ROC:
+    if(it->first >= _dut->roc.size()) {
+      LOG(logERROR) << "ROC " << static_cast<int>(it->first) << " does not exist in the DUT!";
+      success = false;
+      continue;
+    }
+    rocConfig & roc = _dut->roc.at(it->first);
+
+    for(std::map<std::string, uint8_t>::iterator dac = it->second.begin(); dac != it->second.end(); ++dac) {
+
+      // Get the register number and check the range from dictionary:
+      uint8_t dacRegister;
+      uint8_t dacValue = dac->second;
+      if(!verifyRegister(dac->first, dacRegister, dacValue, ROC_REG)) {
+	success = false;
+	continue;
+      }
+
+      // Update the DUT DAC Value:
+      ret = roc.dacs.insert(std::make_pair(dacRegister,dacValue));
+      if(ret.second == true) {
+	LOG(logWARNING) << "DAC \"" << dac->first << "\" was not initialized. Created with value " << static_cast<int>(dacValue);
+      }
+      else {
+	roc.dacs[dacRegister] = dacValue;
+	LOG(logDEBUGAPI) << "DAC \"" << dac->first << "\" updated with value " << static_cast<int>(dacValue);
+      }
+
+      registers[roc.i2c_address][dacRegister] = dacValue;
+      updateRocState(it->first,dacRegister,dacValue);
+    }
+  }
+
+  // Program all registers with one single transfer:
+  if(!registers.empty()) { _hal->rocSetDACs(registers); }
+
+  return success;
+}
+
 uint8_t pxarCore::getDACRange(std::string dacName) {
   
   // Get the register number and check the range from dictionary:
@@ -736,12 +1008,18 @@ uint8_t pxarCore::getDACRange(std::string dacName) {
 }
 
 bool pxarCore::setTbmReg(std::string regName, uint8_t regValue, uint8_t tbmid) {
+  tbmRegHandle handle = tbmReg(regName);
+  if(!handle.valid()) return false;
+  return setTbmReg(handle, regValue, tbmid);
+}
+
+bool pxarCore::setTbmReg(const tbmRegHandle & reg, uint8_t regValue, uint8_t tbmid) {
 
   if(!status()) {return 0;}
   
-  // Get the register number and check the range from dictionary:
-  uint8_t _register;
-  if(!verifyRegister(regName, _register, regValue, TBM_REG)) return false;
+  // Check the range of the resolved register:
+  if(!verifyRegister(reg, regValue)) return false;
+  uint8_t _register = reg.id();
 
   std::pair<std::map<uint8_t,uint8_t>::iterator,bool> ret;
   if(_dut->tbm.size() > static_cast<size_t>(tbmid)) {
@@ -750,14 +1028,15 @@ bool pxarCore::setTbmReg(std::string regName, uint8_t regValue, uint8_t tbmid) {
     // Update the DUT register Value:
     ret = _dut->tbm.at(tbmid).dacs.insert(std::make_pair(_register,regValue));
     if(ret.second == true) {
-      LOG(logWARNING) << "Register \"" << regName << "\" (" << std::hex << static_cast<int>(_register) << std::dec << ") was not initialized. Created with value " << static_cast<int>(regValue);
+      LOG(logWARNING) << "Register \"" << reg.name() << "\" (" << std::hex << static_cast<int>(_register) << std::dec << ") was not initialized. Created with value " << static_cast<int>(regValue);
     }
     else {
       _dut->tbm.at(tbmid).dacs[_register] = regValue;
-      LOG(logDEBUGAPI) << "Register \"" << regName << "\" (" << std::hex << static_cast<int>(_register) << std::dec << ") updated with value " << static_cast<int>(regValue);
+      LOG(logDEBUGAPI) << "Register \"" << reg.name() << "\" (" << std::hex << static_cast<int>(_register) << std::dec << ") updated with value " << static_cast<int>(regValue);
     }
     
     _hal->tbmSetReg(_dut->tbm.at(tbmid).hubid,_dut->tbm.at(tbmid).core | _register,regValue);
+    updateTbmState(tbmid,_register,regValue);
     
     // update HAL no token pass setting:
     _hal->tbmSetNoTokenPass(tbmid,_dut->tbm.at(tbmid).tokenchains.size(),_dut->tbm.at(tbmid).NoTokenPass());
@@ -770,20 +1049,113 @@ bool pxarCore::setTbmReg(std::string regName, uint8_t regValue, uint8_t tbmid) {
 }
 
 bool pxarCore::setTbmReg(std::string regName, uint8_t regValue) {
+  tbmRegHandle handle = tbmReg(regName);
+  if(!handle.valid()) return false;
+  return setTbmReg(handle, regValue);
+}
+
+bool pxarCore::setTbmReg(const tbmRegHandle & reg, uint8_t regValue) {
 
   for(size_t tbms = 0; tbms < _dut->tbm.size(); ++tbms) {
-    if(!setTbmReg(regName, regValue, tbms)) return false;
+    if(!setTbmReg(reg, regValue, tbms)) return false;
   }
   return true;
 }
 
+dutSnapshot pxarCore::getSnapshot() {
+
+  dutSnapshot snapshot;
+  if(!_dut->_initialized) {
+    LOG(logERROR) << "DUT not initialized, unable to take a snapshot.";
+    return snapshot;
+  }
+
+  snapshot.roc = _dut->roc;
+  snapshot.tbm = _dut->tbm;
+  LOG(logDEBUGAPI) << "Took snapshot of " << snapshot.roc.size() << " ROC and " << snapshot.tbm.size() << " TBM configurations.";
+  return snapshot;
+}
+
+bool pxarCore::restoreSnapshot(const dutSnapshot & snapshot, bool force) {
+
+  if(!status()) {return false;}
+
+  // Check if the snapshot matches the current DUT layout:
+  if(snapshot.roc.size() != _dut->roc.size() || snapshot.tbm.size() != _dut->tbm.size()) {
+    LOG(logERROR) << "Snapshot with " << snapshot.roc.size() << " ROCs and " << snapshot.tbm.size() 
+		  << " TBMs does not match the DUT, not restoring.";
+    return false;
+  }
+  for(size_t i = 0; i < snapshot.roc.size(); i++) {
+    if(snapshot.roc.at(i).i2c_address != _dut->roc.at(i).i2c_address) {
+      LOG(logERROR) << "Snapshot ROC I2C addresses do not match the DUT, not restoring.";
+      return false;
+    }
+  }
+
+  // Restore all TBM registers which differ from the current setting:
+  for(size_t i = 0; i < snapshot.tbm.size(); i++) {
+    tbmConfig & tbm = _dut->tbm.at(i);
+
+    std::map<uint8_t,uint8_t> changed;
+    for(std::map<uint8_t,uint8_t>::const_iterator reg = snapshot.tbm.at(i).dacs.begin(); reg != snapshot.tbm.at(i).dacs.end(); ++reg) {
+      std::map<uint8_t,uint8_t>::iterator cur = tbm.dacs.find(reg->first);
+      if(force || cur == tbm.dacs.end() || cur->second != reg->second) { changed.insert(*reg); }
+    }
+
+    tbm.dacs = snapshot.tbm.at(i).dacs;
+    tbm.enable = snapshot.tbm.at(i).enable;
+    if(changed.empty()) continue;
+
+    LOG(logDEBUGAPI) << "Restoring " << changed.size() << " registers of TBM Core " << tbm.corename();
+    _hal->tbmSetRegs(tbm.hubid,tbm.core,changed);
+    _hal->tbmSetNoTokenPass(i,tbm.tokenchains.size(),tbm.NoTokenPass());
+    for(std::map<uint8_t,uint8_t>::iterator reg = changed.begin(); reg != changed.end(); ++reg) { updateTbmState(i,reg->first,reg->second); }
+  }
+
+  // Restore all ROC DACs which differ from the current setting:
+  for(size_t i = 0; i < snapshot.roc.size(); i++) {
+    rocConfig & roc = _dut->roc.at(i);
+
+    std::map<uint8_t,uint8_t> changed;
+    for(std::map<uint8_t,uint8_t>::const_iterator dac = snapshot.roc.at(i).dacs.begin(); dac != snapshot.roc.at(i).dacs.end(); ++dac) {
+      std::map<uint8_t,uint8_t>::iterator cur = roc.dacs.find(dac->first);
+      if(force || cur == roc.dacs.end() || cur->second != dac->second) { changed.insert(*dac); }
+    }
+
+    // Trim & mask bits as well as enable flags are programmed with the next test:
+    roc.dacs = snapshot.roc.at(i).dacs;
+    roc.pixels = snapshot.roc.at(i).pixels;
+    roc.setEnable(snapshot.roc.at(i).enable());
+    if(changed.empty()) continue;
+
+    LOG(logDEBUGAPI) << "Restoring " << changed.size() << " DACs of ROC@I2C " << static_cast<int>(roc.i2c_address);
+    _hal->rocSetDACs(roc.i2c_address,changed);
+    for(std::map<uint8_t,uint8_t>::iterator dac = changed.begin(); dac != changed.end(); ++dac) { updateRocState(i,dac->first,dac->second); }
+  }
+
+  return true;
+}
+
 std::vector< std::pair<uint8_t, std::vector<pixel> > > pxarCore::getPulseheightVsDAC(std::string dacName, uint8_t dacMin, uint8_t dacMax, uint16_t flags, uint16_t nTriggers) {
 
   // No step size provided - scanning all DACs with step size 1:
   return getPulseheightVsDAC(dacName, 1, dacMin, dacMax, flags, nTriggers);
 }
 
+std::vector< std::pair<uint8_t, std::vector<pixel> > > pxarCore::getPulseheightVsDAC(const dacHandle & dac, uint8_t dacMin, uint8_t dacMax, uint16_t flags, uint16_t nTriggers) {
+
+  // No step size provided - scanning all DACs with step size 1:
+  return getPulseheightVsDAC(dac, 1, dacMin, dacMax, flags, nTriggers);
+}
+
 std::vector< std::pair<uint8_t, std::vector<pixel> > > pxarCore::getPulseheightVsDAC(std::string dacName, uint8_t dacStep, uint8_t dacMin, uint8_t dacMax, uint16_t flags, uint16_t nTriggers) {
+  dacHandle handle = dac(dacName);
+  if(!handle.valid()) return std::vector< std::pair<uint8_t, std::vector<pixel> > >();
+  return getPulseheightVsDAC(handle, dacStep, dacMin, dacMax, flags, nTriggers);
+}
+
+std::vector< std::pair<uint8_t, std::vector<pixel> > > pxarCore::getPulseheightVsDAC(const dacHandle & dac, uint8_t dacStep, uint8_t dacMin, uint8_t dacMax, uint16_t flags, uint16_t nTriggers) {
 
   if(!status()) {return std::vector< std::pair<uint8_t, std::vector<pixel> > >();}
 
@@ -796,11 +1168,11 @@ std::vector< std::pair<uint8_t, std::vector<pixel> > > pxarCore::getPulseheightV
     dacMax = temp;
   }
 
-  // Get the register number and check the range from dictionary:
-  uint8_t dacRegister;
-  if(!verifyRegister(dacName, dacRegister, dacMax, ROC_REG)) {
+  // Check the range of the resolved register:
+  if(!verifyRegister(dac, dacMax)) {
     return std::vector< std::pair<uint8_t, std::vector<pixel> > >();
   }
+  uint8_t dacRegister = dac.id();
 
   // Setup the correct _hal calls for this test
   HalMemFnPixelSerial   pixelfn      = &hal::SingleRocOnePixelDacScan;
@@ -827,8 +1199,8 @@ std::vector< std::pair<uint8_t, std::vector<pixel> > > pxarCore::getPulseheightV
   // Reset the original value for the scanned DAC:
   std::vector<rocConfig> enabledRocs = _dut->getEnabledRocs();
   for (std::vector<rocConfig>::iterator rocit = enabledRocs.begin(); rocit != enabledRocs.end(); ++rocit){
-    uint8_t oldDacValue = _dut->getDAC(static_cast<size_t>(rocit - enabledRocs.begin()),dacName);
-    LOG(logDEBUGAPI) << "Reset DAC \"" << dacName << "\" to original value " << static_cast<int>(oldDacValue);
+    uint8_t oldDacValue = _dut->getDAC(static_cast<size_t>(rocit - enabledRocs.begin()),dac);
+    LOG(logDEBUGAPI) << "Reset DAC \"" << dac.name() << "\" to original value " << static_cast<int>(oldDacValue);
     _hal->rocSetDAC(static_cast<uint8_t>(rocit - enabledRocs.begin()),dacRegister,oldDacValue);
   }
 
@@ -841,7 +1213,19 @@ std::vector< std::pair<uint8_t, std::vector<pixel> > > pxarCore::getEfficiencyVs
   return getEfficiencyVsDAC(dacName, 1, dacMin, dacMax, flags, nTriggers);
 }
 
+std::vector< std::pair<uint8_t, std::vector<pixel> > > pxarCore::getEfficiencyVsDAC(const dacHandle & dac, uint8_t dacMin, uint8_t dacMax, uint16_t flags, uint16_t nTriggers) {
+
+  // No step size provided - scanning all DACs with step size 1:
+  return getEfficiencyVsDAC(dac, 1, dacMin, dacMax, flags, nTriggers);
+}
+
 std::vector< std::pair<uint8_t, std::vector<pixel> > > pxarCore::getEfficiencyVsDAC(std::string dacName, uint8_t dacStep, uint8_t dacMin, uint8_t dacMax, uint16_t flags, uint16_t nTriggers) {
+  dacHandle handle = dac(dacName);
+  if(!handle.valid()) return std::vector< std::pair<uint8_t, std::vector<pixel> > >();
+  return getEfficiencyVsDAC(handle, dacStep, dacMin, dacMax, flags, nTriggers);
+}
+
+std::vector< std::pair<uint8_t, std::vector<pixel> > > pxarCore::getEfficiencyVsDAC(const dacHandle & dac, uint8_t dacStep, uint8_t dacMin, uint8_t dacMax, uint16_t flags, uint16_t nTriggers) {
 
   if(!status()) {return std::vector< std::pair<uint8_t, std::vector<pixel> > >();}
 
@@ -854,11 +1238,11 @@ std::vector< std::pair<uint8_t, std::vector<pixel> > > pxarCore::getEfficiencyVs
     dacMax = temp;
   }
 
-  // Get the register number and check the range from dictionary:
-  uint8_t dacRegister;
-  if(!verifyRegister(dacName, dacRegister, dacMax, ROC_REG)) {
+  // Check the range of the resolved register:
+  if(!verifyRegister(dac, dacMax)) {
     return std::vector< std::pair<uint8_t, std::vector<pixel> > >();
   }
+  uint8_t dacRegister = dac.id();
 
   // Setup the correct _hal calls for this test
   HalMemFnPixelSerial   pixelfn      = &hal::SingleRocOnePixelDacScan;
@@ -883,8 +1267,8 @@ std::vector< std::pair<uint8_t, std::vector<pixel> > > pxarCore::getEfficiencyVs
   // Reset the original value for the scanned DAC:
   std::vector<rocConfig> enabledRocs = _dut->getEnabledRocs();
   for (std::vector<rocConfig>::iterator rocit = enabledRocs.begin(); rocit != enabledRocs.end(); ++rocit){
-    uint8_t oldDacValue = _dut->getDAC(static_cast<size_t>(rocit - enabledRocs.begin()),dacName);
-    LOG(logDEBUGAPI) << "Reset DAC \"" << dacName << "\" to original value " << static_cast<int>(oldDacValue);
+    uint8_t oldDacValue = _dut->getDAC(static_cast<size_t>(rocit - enabledRocs.begin()),dac);
+    LOG(logDEBUGAPI) << "Reset DAC \"" << dac.name() << "\" to original value " << static_cast<int>(oldDacValue);
     _hal->rocSetDAC(static_cast<uint8_t>(rocit - enabledRocs.begin()),dacRegister,oldDacValue);
   }
 
@@ -1126,6 +1510,180 @@ std::vector< std::pair<uint8_t, std::pair<uint8_t, std::vector<pixel> > > > pxar
   return result;
 }
 
+std::vector< std::pair<uint8_t, std::pair<uint8_t, std::pair<uint8_t, std::vector<pixel> > > > > pxarCore::getPulseheightVsDACDACDAC(std::string dac1name, uint8_t dac1min, uint8_t dac1max, std::string dac2name, uint8_t dac2min, uint8_t dac2max, std::string dac3name, uint8_t dac3min, uint8_t dac3max, uint16_t flags, uint16_t nTriggers) {
+
+  // No step size provided - scanning all DACs with step size 1:
+  return getPulseheightVsDACDACDAC(dac1name, 1, dac1min, dac1max, dac2name, 1, dac2min, dac2max, dac3name, 1, dac3min, dac3max, flags, nTriggers);
+}
+
+std::vector< std::pair<uint8_t, std::pair<uint8_t, std::pair<uint8_t, std::vector<pixel> > > > > pxarCore::getPulseheightVsDACDACDAC(std::string dac1name, uint8_t dac1step, uint8_t dac1min, uint8_t dac1max, std::string dac2name, uint8_t dac2step, uint8_t dac2min, uint8_t dac2max, std::string dac3name, uint8_t dac3step, uint8_t dac3min, uint8_t dac3max, uint16_t flags, uint16_t nTriggers) {
+  return runDacDacDacScan(dac1name, dac1step, dac1min, dac1max, dac2name, dac2step, dac2min, dac2max, dac3name, dac3step, dac3min, dac3max, flags, nTriggers, false);
+}
+
+std::vector< std::pair<uint8_t, std::pair<uint8_t, std::pair<uint8_t, std::vector<pixel> > > > > pxarCore::getEfficiencyVsDACDACDAC(std::string dac1name, uint8_t dac1min, uint8_t dac1max, std::string dac2name, uint8_t dac2min, uint8_t dac2max, std::string dac3name, uint8_t dac3min, uint8_t dac3max, uint16_t flags, uint16_t nTriggers) {
+
+  // No step size provided - scanning all DACs with step size 1:
+  return getEfficiencyVsDACDACDAC(dac1name, 1, dac1min, dac1max, dac2name, 1, dac2min, dac2max, dac3name, 1, dac3min, dac3max, flags, nTriggers);
+}
+
+std::vector< std::pair<uint8_t, std::pair<uint8_t, std::pair<uint8_t, std::vector<pixel> > > > > pxarCore::getEfficiencyVsDACDACDAC(std::string dac1name, uint8_t dac1step, uint8_t dac1min, uint8_t dac1max, std::string dac2name, uint8_t dac2step, uint8_t dac2min, uint8_t dac2max, std::string dac3name, uint8_t dac3step, uint8_t dac3min, uint8_t dac3max, uint16_t flags, uint16_t nTriggers) {
+  return runDacDacDacScan(dac1name, dac1step, dac1min, dac1max, dac2name, dac2step, dac2min, dac2max, dac3name, dac3step, dac3min, dac3max, flags, nTriggers, true);
+}
+
+std::vector< std::pair<uint8_t, std::pair<uint8_t, std::pair<uint8_t, std::vector<pixel> > > > > pxarCore::runDacDacDacScan(std::string dac1name, uint8_t dac1step, uint8_t dac1min, uint8_t dac1max, std::string dac2name, uint8_t dac2step, uint8_t dac2min, uint8_t dac2max, std::string dac3name, uint8_t dac3step, uint8_t dac3min, uint8_t dac3max, uint16_t flags, uint16_t nTriggers, bool efficiency) {
+
+  if(!status()) {return std::vector< std::pair<uint8_t, std::pair<uint8_t, std::pair<uint8_t, std::vector<pixel> > > > >();}
+
+  // Check DAC ranges
+  if(dac1min > dac1max) {
+    // Swapping the range:
+    LOG(logWARNING) << "Swapping upper and lower bound.";
+    std::swap(dac1min, dac1max);
+  }
+  if(dac2min > dac2max) {
+    // Swapping the range:
+    LOG(logWARNING) << "Swapping upper and lower bound.";
+    std::swap(dac2min, dac2max);
+  }
+  if(dac3min > dac3max) {
+    // Swapping the range:
+    LOG(logWARNING) << "Swapping upper and lower bound.";
+    std::swap(dac3min, dac3max);
+  }
+  if(dac1step == 0 || dac2step == 0 || dac3step == 0) {
+    LOG(logERROR) << "DAC step size must not be zero.";
+    return std::vector< std::pair<uint8_t, std::pair<uint8_t, std::pair<uint8_t, std::vector<pixel> > > > >();
+  }
+
+  // Get the register number and check the range from dictionary:
+  uint8_t dac1register, dac2register, dac3register;
+  if(!verifyRegister(dac1name, dac1register, dac1max, ROC_REG)
+     || !verifyRegister(dac2name, dac2register, dac2max, ROC_REG)
+     || !verifyRegister(dac3name, dac3register, dac3max, ROC_REG)) {
+    return std::vector< std::pair<uint8_t, std::pair<uint8_t, std::pair<uint8_t, std::vector<pixel> > > > >();
+  }
+
+  // Setup the correct _hal calls for this test
+  HalMemFnPixelSerial   pixelfn      = &hal::SingleRocOnePixelDacDacDacScan;
+  HalMemFnPixelParallel multipixelfn = &hal::MultiRocOnePixelDacDacDacScan;
+  HalMemFnRocSerial     rocfn        = &hal::SingleRocAllPixelsDacDacDacScan;
+  HalMemFnRocParallel   multirocfn   = &hal::MultiRocAllPixelsDacDacDacScan;
+
+  // Load the test parameters into vector, the first ten as for the DAC-DAC scans:
+  std::vector<int32_t> param;
+  param.push_back(static_cast<int32_t>(dac1register));
+  param.push_back(static_cast<int32_t>(dac1min));
+  param.push_back(static_cast<int32_t>(dac1max));
+  param.push_back(static_cast<int32_t>(dac2register));
+  param.push_back(static_cast<int32_t>(dac2min));
+  param.push_back(static_cast<int32_t>(dac2max));
+  param.push_back(static_cast<int32_t>(flags));
+  param.push_back(static_cast<int32_t>(nTriggers));
+  param.push_back(static_cast<int32_t>(dac1step));
+  param.push_back(static_cast<int32_t>(dac2step));
+  param.push_back(static_cast<int32_t>(dac3register));
+  param.push_back(static_cast<int32_t>(dac3min));
+  param.push_back(static_cast<int32_t>(dac3max));
+  param.push_back(static_cast<int32_t>(dac3step));
+
+  // check if the flags indicate that the user explicitly asks for serial execution of test:
+  std::vector<Event*> data = expandLoop(pixelfn, multipixelfn, rocfn, multirocfn, param, flags);
+  // repack data into the expected return format
+  std::vector< std::pair<uint8_t, std::pair<uint8_t, std::pair<uint8_t, std::vector<pixel> > > > > result = repackDacDacDacScanData(data,dac1step,dac1min,dac1max,dac2step,dac2min,dac2max,dac3step,dac3min,dac3max,nTriggers,efficiency);
+
+  // Reset the original value for the scanned DACs:
+  std::vector<rocConfig> enabledRocs = _dut->getEnabledRocs();
+  for (std::vector<rocConfig>::iterator rocit = enabledRocs.begin(); rocit != enabledRocs.end(); ++rocit){
+    size_t idx = static_cast<size_t>(rocit - enabledRocs.begin());
+    LOG(logDEBUGAPI) << "Reset DACs \"" << dac1name << "\", \"" << dac2name << "\" and \"" << dac3name << "\" to original values";
+    _hal->rocSetDAC(static_cast<uint8_t>(idx),dac1register,_dut->getDAC(idx,dac1name));
+    _hal->rocSetDAC(static_cast<uint8_t>(idx),dac2register,_dut->getDAC(idx,dac2name));
+    _hal->rocSetDAC(static_cast<uint8_t>(idx),dac3register,_dut->getDAC(idx,dac3name));
+  }
+
+  return result;
+}
+
+std::vector< std::pair<uint8_t, std::vector<pixel> > > pxarCore::getPulseheightVsDACList(std::string dacName, std::vector<uint8_t> dacValues, uint16_t flags, uint16_t nTriggers) {
+  return runDacListScan(dacName, dacValues, "", std::vector<uint8_t>(), flags, nTriggers, false);
+}
+
+std::vector< std::pair<uint8_t, std::vector<pixel> > > pxarCore::getPulseheightVsDACList(std::string dacName, std::vector<uint8_t> dacValues, std::string switchName, std::vector<uint8_t> switchValues, uint16_t flags, uint16_t nTriggers) {
+  return runDacListScan(dacName, dacValues, switchName, switchValues, flags, nTriggers, false);
+}
+
+std::vector< std::pair<uint8_t, std::vector<pixel> > > pxarCore::getEfficiencyVsDACList(std::string dacName, std::vector<uint8_t> dacValues, uint16_t flags, uint16_t nTriggers) {
+  return runDacListScan(dacName, dacValues, "", std::vector<uint8_t>(), flags, nTriggers, true);
+}
+
+std::vector< std::pair<uint8_t, std::vector<pixel> > > pxarCore::getEfficiencyVsDACList(std::string dacName, std::vector<uint8_t> dacValues, std::string switchName, std::vector<uint8_t> switchValues, uint16_t flags, uint16_t nTriggers) {
+  return runDacListScan(dacName, dacValues, switchName, switchValues, flags, nTriggers, true);
+}
+
+std::vector< std::pair<uint8_t, std::vector<pixel> > > pxarCore::runDacListScan(std::string dacName, std::vector<uint8_t> dacValues, std::string switchName, std::vector<uint8_t> switchValues, uint16_t flags, uint16_t nTriggers, bool efficiency) {
+
+  if(!status()) {return std::vector< std::pair<uint8_t, std::vector<pixel> > >();}
+
+  // The list entries are packed like the steps of a regular DAC scan, which limits their number:
+  if(dacValues.empty() || dacValues.size() > 256) {
+    LOG(logERROR) << "DAC list has to contain between 1 and 256 values, got " << dacValues.size() << ".";
+    return std::vector< std::pair<uint8_t, std::vector<pixel> > >();
+  }
+  bool doSwitch = !switchName.empty();
+  if(doSwitch && switchValues.size() != dacValues.size()) {
+    LOG(logERROR) << "DAC list and list of \"" << switchName << "\" values differ in length.";
+    return std::vector< std::pair<uint8_t, std::vector<pixel> > >();
+  }
+
+  // Get the register numbers and check all values against their range from dictionary:
+  uint8_t dacRegister, switchRegister = 0;
+  for(std::vector<uint8_t>::iterator dac = dacValues.begin(); dac != dacValues.end(); ++dac) {
+    if(!verifyRegister(dacName, dacRegister, *dac, ROC_REG)) { return std::vector< std::pair<uint8_t, std::vector<pixel> > >(); }
+  }
+  if(doSwitch) {
+    for(std::vector<uint8_t>::iterator sw = switchValues.begin(); sw != switchValues.end(); ++sw) {
+      if(!verifyRegister(switchName, switchRegister, *sw, ROC_REG)) { return std::vector< std::pair<uint8_t, std::vector<pixel> > >(); }
+    }
+  }
+
+  // Setup the correct _hal calls for this test
+  HalMemFnPixelSerial   pixelfn      = &hal::SingleRocOnePixelDacListScan;
+  HalMemFnPixelParallel multipixelfn = &hal::MultiRocOnePixelDacListScan;
+  HalMemFnRocSerial     rocfn        = &hal::SingleRocAllPixelsDacListScan;
+  HalMemFnRocParallel   multirocfn   = &hal::MultiRocAllPixelsDacListScan;
+
+  // Load the test parameters into vector, followed by the list of DAC and switched register values:
+  std::vector<int32_t> param;
+  param.push_back(static_cast<int32_t>(dacRegister));
+  param.push_back(doSwitch ? static_cast<int32_t>(switchRegister) : -1);
+  param.push_back(static_cast<int32_t>(flags));
+  param.push_back(static_cast<int32_t>(nTriggers));
+  for(size_t i = 0; i < dacValues.size(); i++) {
+    param.push_back(static_cast<int32_t>(dacValues.at(i)));
+    param.push_back(doSwitch ? static_cast<int32_t>(switchValues.at(i)) : 0);
+  }
+
+  // check if the flags indicate that the user explicitly asks for serial execution of test:
+  std::vector<Event*> data = expandLoop(pixelfn, multipixelfn, rocfn, multirocfn, param, flags);
+  // repack data into the expected return format, using the list index as DAC value:
+  std::vector< std::pair<uint8_t, std::vector<pixel> > > result = repackDacScanData(data,1,0,static_cast<uint8_t>(dacValues.size()-1),nTriggers,flags,efficiency);
+  for(size_t i = 0; i < result.size(); i++) { result.at(i).first = dacValues.at(i); }
+
+  // Reset the original values for the scanned registers:
+  std::vector<rocConfig> enabledRocs = _dut->getEnabledRocs();
+  for (std::vector<rocConfig>::iterator rocit = enabledRocs.begin(); rocit != enabledRocs.end(); ++rocit){
+    size_t idx = static_cast<size_t>(rocit - enabledRocs.begin());
+    LOG(logDEBUGAPI) << "Reset DAC \"" << dacName << "\" to original value " << static_cast<int>(_dut->getDAC(idx,dacName));
+    _hal->rocSetDAC(static_cast<uint8_t>(idx),dacRegister,_dut->getDAC(idx,dacName));
+    if(doSwitch) {
+      LOG(logDEBUGAPI) << "Reset DAC \"" << switchName << "\" to original value " << static_cast<int>(_dut->getDAC(idx,switchName));
+      _hal->rocSetDAC(static_cast<uint8_t>(idx),switchRegister,_dut->getDAC(idx,switchName));
+    }
+  }
+
+  return result;
+}
+
 std::vector<pixel> pxarCore::getPulseheightMap(uint16_t flags, uint16_t nTriggers) {
 
   if(!status()) {return std::vector<pixel>();}
@@ -1228,6 +1786,142 @@ std::vector<pixel> pxarCore::getThresholdMap(std::string dacName, uint8_t dacSte
   return result;
 }
 
+std::vector< std::pair<uint8_t, std::vector<pixel> > > pxarCore::getThresholdMaps(std::string dacName, uint8_t dacStep, uint8_t dacMin, uint8_t dacMax, std::vector<uint8_t> thresholds, uint16_t flags, uint16_t nTriggers) {
+
+  if(!status()) {return std::vector< std::pair<uint8_t, std::vector<pixel> > >();}
+
+  // Scan the maximum DAC range for threshold:
+  uint8_t dacRegister;
+  if(!verifyRegister(dacName, dacRegister, dacMax, ROC_REG)) {
+    return std::vector< std::pair<uint8_t, std::vector<pixel> > >();
+  }
+
+  // Check the threshold percentage levels provided:
+  if(thresholds.empty()) {
+    LOG(logCRITICAL) << "No threshold levels requested!";
+    return std::vector< std::pair<uint8_t, std::vector<pixel> > >();
+  }
+  for(std::vector<uint8_t>::iterator level = thresholds.begin(); level != thresholds.end(); ++level) {
+    if(*level == 0 || *level > 100) {
+      LOG(logCRITICAL) << "Threshold level of " << static_cast<int>(*level) << "% is not possible!";
+      return std::vector< std::pair<uint8_t, std::vector<pixel> > >();
+    }
+  }
+
+  // Setup the correct _hal calls for this test, a threshold map is a 1D dac scan:
+  HalMemFnPixelSerial   pixelfn      = &hal::SingleRocOnePixelDacScan;
+  HalMemFnPixelParallel multipixelfn = &hal::MultiRocOnePixelDacScan;
+  HalMemFnRocSerial     rocfn        = &hal::SingleRocAllPixelsDacScan;
+  HalMemFnRocParallel   multirocfn   = &hal::MultiRocAllPixelsDacScan;
+
+  // Load the test parameters into vector
+  std::vector<int32_t> param;
+  param.push_back(static_cast<int32_t>(dacRegister));  
+  param.push_back(static_cast<int32_t>(dacMin));
+  param.push_back(static_cast<int32_t>(dacMax));
+  param.push_back(static_cast<int32_t>(flags));
+  param.push_back(static_cast<int32_t>(nTriggers));
+  param.push_back(static_cast<int32_t>(dacStep));
+
+  // check if the flags indicate that the user explicitly asks for serial execution of test:
+  std::vector<Event*> data = expandLoop(pixelfn, multipixelfn, rocfn, multirocfn, param, flags);
+
+  // Repacking of all data segments, one map per threshold level:
+  std::vector< std::pair<uint8_t, std::vector<pixel> > > result = repackThresholdMapsData(data, dacStep, dacMin, dacMax, thresholds, nTriggers, flags);
+
+  return result;
+}
+
+std::vector< std::pair<uint8_t, std::vector<uint16_t> > > pxarCore::getReadbackVsDAC(std::string dacName, uint8_t dacMin, uint8_t dacMax, uint8_t readback) {
+  // No step size provided - scanning all DACs with step size 1:
+  return getReadbackVsDAC(dacName, 1, dacMin, dacMax, readback);
+}
+
+std::vector< std::pair<uint8_t, std::vector<uint16_t> > > pxarCore::getReadbackVsDAC(std::string dacName, uint8_t dacStep, uint8_t dacMin, uint8_t dacMax, uint8_t readback) {
+
+  std::vector< std::pair<uint8_t, std::vector<uint16_t> > > result;
+  if(!status()) { return result; }
+
+  if(daqStatus()) {
+    LOG(logERROR) << "DAQ is already running! Stop DAQ to run a readback scan.";
+    return result;
+  }
+
+  // Check DAC range
+  if(dacMin > dacMax) {
+    // Swapping the range:
+    LOG(logWARNING) << "Swapping upper and lower bound.";
+    uint8_t temp = dacMin;
+    dacMin = dacMax;
+    dacMax = temp;
+  }
+  if(dacStep == 0) { dacStep = 1; }
+
+  // Get the register number and check the range from dictionary:
+  uint8_t dacRegister;
+  if(!verifyRegister(dacName, dacRegister, dacMax, ROC_REG)) { return result; }
+
+  // Select the requested readback register on all ROCs:
+  if(!setDAC("readback", readback)) { return result; }
+
+  std::vector<uint8_t> rocs_i2c = _dut->getEnabledRocI2Caddr();
+  size_t nrocs = rocs_i2c.size();
+
+  // One complete readback word takes 16 triggers, send twice as many to make
+  // sure at least one full word is recorded after the DAC has been changed:
+  uint32_t nTriggers = 32;
+  uint16_t period = _dut->pg_sum;
+
+  LOG(logDEBUGAPI) << "Scanning DAC \"" << dacName << "\" from " << static_cast<int>(dacMin)
+		   << " to " << static_cast<int>(dacMax) << ", reading back register "
+		   << static_cast<int>(readback) << " of " << nrocs << " ROCs.";
+
+  // Start one single DAQ session for the full scan, leaving the DUT masked:
+  _hal->daqClear();
+  _hal->daqStart(_dut->sig_delays[SIG_DESER160PHASE],_daq_buffersize);
+
+  for(size_t dac = dacMin; dac <= dacMax; dac += dacStep) {
+    // Program the DAC on all ROCs at once and trigger:
+    _hal->rocSetDAC(rocs_i2c,dacRegister,static_cast<uint8_t>(dac));
+    _hal->daqTrigger(nTriggers,period);
+
+    // Drain the event buffer, only the readback words are of interest:
+    try {
+      std::vector<Event*> events = _hal->daqAllEvents();
+      for(std::vector<Event*>::iterator it = events.begin(); it != events.end(); ++it) { delete *it; }
+    }
+    catch(DataNoEvent &) {}
+
+    // Store the last complete readback value of every ROC:
+    std::vector<std::vector<uint16_t> > values = _hal->daqReadback();
+    std::vector<uint16_t> rocvalues;
+    for(size_t roc = 0; roc < nrocs; roc++) {
+      if(roc < values.size() && !values.at(roc).empty()) {
+	rocvalues.push_back(values.at(roc).back() & 0xff);
+      }
+      else {
+	LOG(logWARNING) << "No readback value found for ROC " << roc << " at "
+			<< dacName << " = " << dac;
+	rocvalues.push_back(READBACK_MISSING);
+      }
+    }
+    result.push_back(std::make_pair(static_cast<uint8_t>(dac),rocvalues));
+  }
+
+  _hal->daqStop();
+  _hal->daqClear();
+
+  // Reset the original value for the scanned DAC:
+  std::vector<rocConfig> enabledRocs = _dut->getEnabledRocs();
+  for (std::vector<rocConfig>::iterator rocit = enabledRocs.begin(); rocit != enabledRocs.end(); ++rocit){
+    uint8_t oldDacValue = _dut->getDAC(static_cast<size_t>(rocit - enabledRocs.begin()),dacName);
+    LOG(logDEBUGAPI) << "Reset DAC \"" << dacName << "\" to original value " << static_cast<int>(oldDacValue);
+    _hal->rocSetDAC(rocit->i2c_address,dacRegister,oldDacValue);
+  }
+
+  return result;
+}
+
 std::vector<std::vector<uint16_t> > pxarCore::daqGetReadback() {
 
   std::vector<std::vector<uint16_t> > values;
@@ -1394,6 +2088,15 @@ bool pxarCore::daqStatus(uint8_t & perFull) {
     return false;
   }
 
+  // Slow down a regulated trigger loop once if the buffer fills up too quickly
+  // before it is read out, halfway between the fill target and the safety margin:
+  if(_loop_regulated && !_loop_backoff && perFull > (_loop_fill_target + 90)/2) {
+    _loop_period = static_cast<uint16_t>(std::min(2*static_cast<uint32_t>(_loop_period), static_cast<uint32_t>(0xffff)));
+    _loop_backoff = true;
+    _hal->daqTriggerLoop(_loop_period);
+    LOG(logDEBUGAPI) << "Buffer filling up, loop period increased to " << _loop_period << " clk";
+  }
+
   LOG(logDEBUGAPI) << "Everything alright, buffer size " << filled_buffer
 		   << "/" << _daq_buffersize;
   return true;
@@ -1431,13 +2134,56 @@ uint16_t pxarCore::daqTriggerLoop(uint16_t period) {
   }
   _hal->daqTriggerLoop(period);
   LOG(logDEBUGAPI) << "Loop period set to " << period << " clk";
+  _loop_regulated = false;
+  _loop_period = period;
   return period;
 }
 
+uint16_t pxarCore::daqTriggerLoopRegulated(uint16_t period, uint8_t fillTarget) {
+
+  if(fillTarget < 1 || fillTarget > 80) {
+    LOG(logERROR) << "Buffer fill target of " << static_cast<int>(fillTarget) << "% out of range (1-80%)";
+    return 0;
+  }
+
+  period = daqTriggerLoop(period);
+  if(period == 0) { return 0; }
+
+  _loop_regulated = true;
+  _loop_period_min = period;
+  _loop_fill_target = fillTarget;
+  _loop_backoff = false;
+  LOG(logDEBUGAPI) << "Loop period regulated for " << static_cast<int>(fillTarget) << "% buffer fill";
+  return period;
+}
+
+void pxarCore::regulateTriggerLoop() {
+
+  if(!_loop_regulated || !_daq_running) { return; }
+  _loop_backoff = false;
+
+  // The buffer is read out completely, so the fill level is what has been
+  // accumulated since the last readout. It scales with the trigger rate,
+  // i.e. inversely with the loop period:
+  double fill = 100.0*_hal->daqBufferStatus()/_daq_buffersize;
+  double period = static_cast<double>(_loop_period)*std::max(fill,1.0)/_loop_fill_target;
+
+  // Only apply half of the correction (on a log scale) to damp oscillations:
+  period = sqrt(period*_loop_period);
+  period = std::max(std::min(period, 65535.0), static_cast<double>(_loop_period_min));
+
+  // Only reprogram the pattern generator for significant changes:
+  if(fabs(period - _loop_period) < 0.02*_loop_period) { return; }
+  _loop_period = static_cast<uint16_t>(period);
+  _hal->daqTriggerLoop(_loop_period);
+  LOG(logDEBUGAPI) << "Buffer fill " << fill << "%, loop period adjusted to " << _loop_period << " clk";
+}
+
 void pxarCore::daqTriggerLoopHalt() {
 
   // Just halt the pattern generator loop:
   _hal->daqTriggerLoopHalt();
+  _loop_regulated = false;
 }
 
 std::vector<uint16_t> pxarCore::daqGetBuffer() {
@@ -1445,7 +2191,9 @@ std::vector<uint16_t> pxarCore::daqGetBuffer() {
   // Reading out all data from the DTB and returning the raw blob.
   // The HAL function throws pxar::DataNoEvent if nothing to be 
   // returned
+  regulateTriggerLoop();
   std::vector<uint16_t> buffer = _hal->daqBuffer();
+  if(_event_ring) { _event_ring->publish(buffer); }
   return buffer;
 }
 
@@ -1456,10 +2204,12 @@ std::vector<rawEvent> pxarCore::daqGetRawEventBuffer() {
   // The HAL function throws pxar::DataNoEvent if nothing to be 
   // returned
   std::vector<rawEvent> data = std::vector<rawEvent>();
+  regulateTriggerLoop();
   std::vector<rawEvent*> buffer = _hal->daqAllRawEvents();
 
   // Dereference all vector entries and give data back:
   for(std::vector<rawEvent*>::iterator it = buffer.begin(); it != buffer.end(); ++it) {
+    if(_event_ring) { _event_ring->publish(**it); }
     data.push_back(**it);
     delete *it;
   }
@@ -1473,21 +2223,41 @@ std::vector<Event> pxarCore::daqGetEventBuffer() {
   // The HAL function throws pxar::DataNoEvent if nothing to be 
   // returned
   std::vector<Event> data = std::vector<Event>();
+  regulateTriggerLoop();
   std::vector<Event*> buffer = _hal->daqAllEvents();
 
   // Dereference all vector entries and give data back:
   for(std::vector<Event*>::iterator it = buffer.begin(); it != buffer.end(); ++it) {
+    if(_event_ring) { _event_ring->publish(**it); }
     data.push_back(**it);
     delete *it;
   }
   return data;
 }
 
+std::vector<packedEvent> pxarCore::daqGetPackedEventBuffer() {
+
+  // Reading out all data from the DTB and returning the decoded Event buffer
+  // in compact format. The HAL packs the decoder output directly, no full
+  // Event is built. The HAL function throws pxar::DataNoEvent if nothing
+  // to be returned
+  regulateTriggerLoop();
+  std::vector<packedEvent> data = _hal->daqAllPackedEvents();
+
+  if(_event_ring) {
+    for(std::vector<packedEvent>::const_iterator it = data.begin(); it != data.end(); ++it) {
+      _event_ring->publish(*it);
+    }
+  }
+  return data;
+}
+
 Event pxarCore::daqGetEvent() {
 
   // Return the next decoded Event from the FIFO buffer.
   // The HAL function throws pxar::DataNoEvent if no event is available
   Event * evt = _hal->daqEvent();
+  if(_event_ring) { _event_ring->publish(*evt); }
   Event ret = *evt;
   delete evt;
   return ret;
@@ -1498,11 +2268,47 @@ rawEvent pxarCore::daqGetRawEvent() {
   // Return the next raw data record from the FIFO buffer:
   // The HAL function throws pxar::DataNoEvent if no event is available
   rawEvent * evt = _hal->daqRawEvent();
+  if(_event_ring) { _event_ring->publish(*evt); }
   rawEvent ret = *evt;
   delete evt;
   return ret;
 }
 
+bool pxarCore::daqPublish(std::string name, uint32_t nslots, uint32_t slotsize) {
+
+  daqPublishStop();
+  _event_ring = new eventRing();
+  if(!_event_ring->create(name, nslots, slotsize)) {
+    delete _event_ring;
+    _event_ring = NULL;
+    return false;
+  }
+  return true;
+}
+
+void pxarCore::daqPublishStop() {
+
+  if(!_event_ring) return;
+  LOG(logINFO) << "Stopped publishing DAQ data after " << _event_ring->published() << " records.";
+  delete _event_ring;
+  _event_ring = NULL;
+}
+
+bool pxarCore::daqSetConfig(const daqConfig & config) {
+
+  if(!_hal->status()) {return false;}
+
+  if(_daq_running) {
+    LOG(logERROR) << "DAQ running, cannot change the DAQ configuration.";
+    return false;
+  }
+
+  LOG(logDEBUGAPI) << "DAQ configuration: huge pages " << (config.hugePages ? "on" : "off")
+		   << ", memory locking " << (config.lockMemory ? "on" : "off")
+		   << ", reader CPU " << config.readerCpu << ", decoder CPU " << config.decoderCpu;
+  return _hal->daqSetConfig(config.hugePages, config.lockMemory, config.readerCpu, config.decoderCpu);
+}
+
 bool pxarCore::daqStop() {
   return daqStop(true);
 }
@@ -1516,6 +2322,7 @@ bool pxarCore::daqStop(const bool init) {
   }
 
   _daq_running = false;
+  _loop_regulated = false;
   
   // Stop all active DAQ channels:
   _hal->daqStop();
@@ -1906,6 +2713,42 @@ std::vector< std::pair<uint8_t, std::vector<pixel> > > pxarCore::repackDacScanDa
 
 std::vector<pixel> pxarCore::repackThresholdMapData (std::vector<Event*> data, uint8_t dacStep, uint8_t dacMin, uint8_t dacMax, uint8_t thresholdlevel, uint16_t nTriggers, uint16_t flags) {
 
+  // Measure time:
+  timer t;
+
+  // First, pack the data as it would be a regular Dac Scan:
+  std::vector<std::pair<uint8_t,std::vector<pixel> > > packed_dac = repackDacScanData(data, dacStep, dacMin, dacMax, nTriggers, flags, true);
+
+  // Then search for the threshold crossing of every pixel:
+  std::vector<pixel> result = findThresholds(packed_dac, dacMin, dacMax, thresholdlevel, nTriggers, flags);
+
+  LOG(logDEBUGAPI) << "Correctly repacked&analyzed ThresholdMap data for delivery.";
+  LOG(logDEBUGAPI) << "Repacking took " << t << "ms.";
+  return result;
+}
+
+std::vector< std::pair<uint8_t, std::vector<pixel> > > pxarCore::repackThresholdMapsData (std::vector<Event*> data, uint8_t dacStep, uint8_t dacMin, uint8_t dacMax, std::vector<uint8_t> thresholdlevels, uint16_t nTriggers, uint16_t flags) {
+
+  std::vector< std::pair<uint8_t, std::vector<pixel> > > result;
+
+  // Measure time:
+  timer t;
+
+  // Pack the data only once as it would be a regular Dac Scan:
+  std::vector<std::pair<uint8_t,std::vector<pixel> > > packed_dac = repackDacScanData(data, dacStep, dacMin, dacMax, nTriggers, flags, true);
+
+  // Extract all requested threshold levels from the same efficiency data:
+  for(std::vector<uint8_t>::iterator level = thresholdlevels.begin(); level != thresholdlevels.end(); ++level) {
+    result.push_back(std::make_pair(*level, findThresholds(packed_dac, dacMin, dacMax, *level, nTriggers, flags)));
+  }
+
+  LOG(logDEBUGAPI) << "Correctly repacked&analyzed ThresholdMap data for " << result.size() << " threshold levels.";
+  LOG(logDEBUGAPI) << "Repacking took " << t << "ms.";
+  return result;
+}
+
+std::vector<pixel> pxarCore::findThresholds (const std::vector< std::pair<uint8_t, std::vector<pixel> > > & packed_dac, uint8_t dacMin, uint8_t dacMax, uint8_t thresholdlevel, uint16_t nTriggers, uint16_t flags) {
+
   std::vector<pixel> result;
   // Vector of pixels for which a threshold has already been found
   std::vector<pixel> found;
@@ -1916,70 +2759,70 @@ std::vector<pixel> pxarCore::repackThresholdMapData (std::vector<Event*> data, u
   LOG(logDEBUGAPI) << "Scanning for threshold level " << threshold << ", " 
 		   << ((flags&FLAG_RISING_EDGE) == 0 ? "falling":"rising") << " edge";
 
-  // Measure time:
-  timer t;
-
-  // First, pack the data as it would be a regular Dac Scan:
-  std::vector<std::pair<uint8_t,std::vector<pixel> > > packed_dac = repackDacScanData(data, dacStep, dacMin, dacMax, nTriggers, flags, true);
+  // No data to analyze:
+  if(packed_dac.empty()) { return result; }
 
   // Efficiency map:
   std::map<pixel,uint8_t> oldvalue;
 
   // Then loop over all pixels and DAC settings, start from the back if we are looking for falling edge.
   // This ensures that we end up having the correct edge, even if the efficiency suddenly changes from 0 to max.
-  std::vector<std::pair<uint8_t,std::vector<pixel> > >::iterator it_start;
-  std::vector<std::pair<uint8_t,std::vector<pixel> > >::iterator it_end;
+  std::vector<std::pair<uint8_t,std::vector<pixel> > >::const_iterator it_start;
+  std::vector<std::pair<uint8_t,std::vector<pixel> > >::const_iterator it_end;
   int increase_op;
   if((flags&FLAG_RISING_EDGE) != 0) { it_start = packed_dac.begin(); it_end = packed_dac.end(); increase_op = 1; }
   else { it_start = packed_dac.end()-1; it_end = packed_dac.begin()-1; increase_op = -1;  }
 
-  for(std::vector<std::pair<uint8_t,std::vector<pixel> > >::iterator it = it_start; it != it_end; it += increase_op) {
+  for(std::vector<std::pair<uint8_t,std::vector<pixel> > >::const_iterator it = it_start; it != it_end; it += increase_op) {
     // For every DAC value, loop over all pixels:
-    for(std::vector<pixel>::iterator pixit = it->second.begin(); pixit != it->second.end(); ++pixit) {
+    for(std::vector<pixel>::const_iterator pixit = it->second.begin(); pixit != it->second.end(); ++pixit) {
+      // Work on a copy, the packed data might be evaluated for several threshold levels:
+      pixel hit = *pixit;
+
       // Check if for this pixel a threshold has been found already and we can skip the rest:
       std::vector<pixel>::iterator px_found = std::find_if(found.begin(),
 							   found.end(),
-							   findPixelXY(pixit->column(), pixit->row(), pixit->roc()));
+							   findPixelXY(hit.column(), hit.row(), hit.roc()));
       if(px_found != found.end()) continue;
 
       // Check if we have that particular pixel already in the result vector:
       std::vector<pixel>::iterator px = std::find_if(result.begin(),
 						     result.end(),
-						     findPixelXY(pixit->column(), pixit->row(), pixit->roc()));
+						     findPixelXY(hit.column(), hit.row(), hit.roc()));
   
       // Pixel is known:
       if(px != result.end()) {
 	// Calculate efficiency deltas and slope:
 	uint8_t delta_old = abs(oldvalue[*px] - threshold);
-	uint8_t delta_new = abs(static_cast<uint8_t>(pixit->value()) - threshold);
-	bool positive_slope = (static_cast<uint8_t>(pixit->value()) - oldvalue[*px] > 0 ? true : false);
+	uint8_t delta_new = abs(static_cast<uint8_t>(hit.value()) - threshold);
+	bool positive_slope = (static_cast<uint8_t>(hit.value()) - oldvalue[*px] > 0 ? true : false);
 
 	// Check which value is closer to the threshold. Only if the slope is positive AND
 	// the new delta between value and threshold is *larger* then the old delta, we 
 	// found the threshold. If slope is negative, we just have a ripple in the DAC's 
 	// distribution:
 	if(positive_slope && !(delta_new < delta_old)) {        
-	  found.push_back(*pixit);    
+	  found.push_back(hit);    
 	  continue; 
 	}
 
 	// No threshold found yet, update the DAC threshold value for the pixel:
 	px->setValue(it->first);
 	// Update the oldvalue map:
-	oldvalue[*px] = static_cast<uint8_t>(pixit->value());
+	oldvalue[*px] = static_cast<uint8_t>(hit.value());
       }
       // Pixel is new, just adding it:
       else {
         // If the pixel is above threshold at first appearance, the respective
 	// DAC value is set as its threshold:
-	if(pixit->value() >= threshold) { found.push_back(*pixit); }
+	if(hit.value() >= threshold) { found.push_back(hit); }
 
 	// Store the pixel with original efficiency
-	oldvalue.insert(std::make_pair(*pixit,pixit->value()));
+	oldvalue.insert(std::make_pair(hit,hit.value()));
 
 	// Push pixel to result vector with current DAC as value field:
-	pixit->setValue(it->first);
-	result.push_back(*pixit);
+	hit.setValue(it->first);
+	result.push_back(hit);
       }
     }
   }
@@ -2002,8 +2845,6 @@ std::vector<pixel> pxarCore::repackThresholdMapData (std::vector<Event*> data, u
   // Sort the output map by ROC->col->row - just because we are so nice:
   if((flags&FLAG_NOSORT) == 0) { std::sort(result.begin(),result.end()); }
 
-  LOG(logDEBUGAPI) << "Correctly repacked&analyzed ThresholdMap data for delivery.";
-  LOG(logDEBUGAPI) << "Repacking took " << t << "ms.";
   return result;
 }
 
@@ -2183,6 +3024,57 @@ std::vector< std::pair<uint8_t, std::pair<uint8_t, std::vector<pixel> > > > pxar
   return result;
 }
 
+std::vector< std::pair<uint8_t, std::pair<uint8_t, std::pair<uint8_t, std::vector<pixel> > > > > pxarCore::repackDacDacDacScanData (std::vector<Event*> data, uint8_t dac1step, uint8_t dac1min, uint8_t dac1max, uint8_t dac2step, uint8_t dac2min, uint8_t dac2max, uint8_t dac3step, uint8_t dac3min, uint8_t dac3max, uint16_t nTriggers, bool efficiency) {
+  std::vector< std::pair<uint8_t, std::pair<uint8_t, std::pair<uint8_t, std::vector<pixel> > > > > result;
+
+  // Measure time:
+  timer t;
+
+  // First reduce triggers, we have #nTriggers Events which belong together:
+  std::vector<Event*> packed = condenseTriggers(data, nTriggers, efficiency);
+
+  size_t ndac2 = (dac2max-dac2min)/dac2step+1;
+  size_t ndac3 = (dac3max-dac3min)/dac3step+1;
+  size_t ndacs = static_cast<size_t>((dac1max-dac1min)/dac1step+1)*ndac2*ndac3;
+
+  if(packed.size() % ndacs != 0) {
+    LOG(logCRITICAL) << "Data size not as expected! " << packed.size() << " data blocks do not fit to " << ndacs << " DAC values!";
+    for(std::vector<Event*>::iterator it = packed.begin(); it != packed.end(); ++it) { delete *it; }
+    return result;
+  }
+
+  LOG(logDEBUGAPI) << "Packing DAC range [" << static_cast<int>(dac1min) << " - " << static_cast<int>(dac1max)
+		   << ", step size " << static_cast<int>(dac1step) << "]x["
+		   << static_cast<int>(dac2min) << " - " << static_cast<int>(dac2max)
+		   << ", step size " << static_cast<int>(dac2step) << "]x["
+		   << static_cast<int>(dac3min) << " - " << static_cast<int>(dac3max)
+		   << ", step size " << static_cast<int>(dac3step)
+		   << "], data has " << packed.size() << " entries.";
+
+  // Prepare the result vector, DAC3 running fastest:
+  result.reserve(ndacs);
+  for(size_t dac1 = dac1min; dac1 <= dac1max; dac1 += dac1step) {
+    for(size_t dac2 = dac2min; dac2 <= dac2max; dac2 += dac2step) {
+      for(size_t dac3 = dac3min; dac3 <= dac3max; dac3 += dac3step) {
+	result.push_back(std::make_pair(dac1,std::make_pair(dac2,std::make_pair(dac3,std::vector<pixel>()))));
+      }
+    }
+  }
+
+  // The data comes in the same order, repeated for every pixel:
+  for(size_t i = 0; i < packed.size(); i++) {
+    std::vector<pixel> & pixels = result.at(i%ndacs).second.second.second;
+    pixels.insert(pixels.end(), packed.at(i)->pixels.begin(), packed.at(i)->pixels.end());
+  }
+
+  // Cleanup temporary data:
+  for(std::vector<Event*>::iterator it = packed.begin(); it != packed.end(); ++it) { delete *it; }
+
+  LOG(logDEBUGAPI) << "Correctly repacked DacDacDacScan data for delivery.";
+  LOG(logDEBUGAPI) << "Repacking took " << t << "ms.";
+  return result;
+}
+
 // Update mask and trim bits for the full DUT in NIOS structs:
 void pxarCore::MaskAndTrimNIOS() {
 
@@ -82,6 +82,11 @@ typedef unsigned char uint8_t;
  */
 #define FLAG_FORCE_UNMASKED   0x0100
 
+/** Value returned by pxarCore::getReadbackVsDAC() for a ROC for which no readback
+ *  value could be decoded at a DAC setting.
+ */
+#define READBACK_MISSING 0xffff
+
 
 /** Define a macro for calls to member functions through pointers 
  *  to member functions (used in the loop expansion routines).
@@ -99,6 +104,126 @@ namespace pxar {
    */
   class hal;
 
+  /** Forward declaration, not including the header file!
+   */
+  class eventRing;
+
+  /** Register handle, resolved once from the register name by pxarCore::dac()
+   *  or pxarCore::tbmReg() and carrying the register id and its maximum value
+   *
+   *  Passing a handle instead of the name to the register and scan functions
+   *  saves the name conversion and dictionary lookup on every call, e.g.
+   *
+   *    pxar::dacHandle vana = api->dac("vana");
+   *    for(uint8_t v = 0; v < 100; v++) { api->setDAC(vana, v, roc); }
+   *
+   *  Default constructed handles and handles of unknown names are invalid
+   *  and rejected by all functions.
+   */
+  class DLLEXPORT registerHandle {
+  public:
+    registerHandle() : _name(), _id(0), _max(0), _valid(false) {};
+
+    /** Register name as requested
+     */
+    const std::string & name() const { return _name; };
+
+    /** Register id as programmed to the device
+     */
+    uint8_t id() const { return _id; };
+
+    /** Largest valid value of the register
+     */
+    uint8_t max() const { return _max; };
+
+    bool valid() const { return _valid; };
+
+  protected:
+    registerHandle(std::string name, uint8_t id, uint8_t max) : _name(name), _id(id), _max(max), _valid(true) {};
+
+  private:
+    std::string _name;
+    uint8_t _id;
+    uint8_t _max;
+    bool _valid;
+  };
+
+  /** Handle of a ROC DAC register, see pxarCore::dac()
+   */
+  class DLLEXPORT dacHandle : public registerHandle {
+    friend class pxarCore;
+  public:
+    dacHandle() : registerHandle() {};
+  private:
+    dacHandle(std::string name, uint8_t id, uint8_t max) : registerHandle(name, id, max) {};
+  };
+
+  /** Handle of a TBM register, see pxarCore::tbmReg()
+   */
+  class DLLEXPORT tbmRegHandle : public registerHandle {
+    friend class pxarCore;
+  public:
+    tbmRegHandle() : registerHandle() {};
+  private:
+    tbmRegHandle(std::string name, uint8_t id, uint8_t max) : registerHandle(name, id, max) {};
+  };
+
+  /** Memory and thread settings of the DAQ readout chain, see
+   *  pxarCore::daqSetConfig()
+   */
+  struct DLLEXPORT daqConfig {
+    daqConfig() : hugePages(false), lockMemory(false), readerCpu(-1), decoderCpu(-1) {};
+
+    /** Back the USB reader ring buffer with transparent huge pages
+     */
+    bool hugePages;
+
+    /** Lock the USB reader ring buffer and the DTB data source buffers in
+     *  RAM so they can never be paged out
+     */
+    bool lockMemory;
+
+    /** CPU core the USB reader thread is pinned to, -1 for no pinning
+     */
+    int readerCpu;
+
+    /** CPU core the thread running the DAQ (decoding and consuming the
+     *  data via the daqGet* functions) is pinned to from daqStart() until
+     *  the data of the session is discarded, -1 for no pinning
+     */
+    int decoderCpu;
+  };
+
+  /** Class to store a snapshot of the full DUT device configuration
+   *
+   *  A snapshot is taken via pxarCore::getSnapshot() and holds the ROC DACs,
+   *  TBM registers, pixel trim & mask bits and the enable flags of all ROCs
+   *  and pixels. It can be handed back to pxarCore::restoreSnapshot() which
+   *  only programs the registers differing from the current DUT state.
+   */
+  class DLLEXPORT dutSnapshot {
+    
+    /** Only the API class is allowed to fill and read snapshots
+     */
+    friend class pxarCore;
+
+  public:
+  dutSnapshot() : roc(), tbm() {}
+
+    /** Returns true if the snapshot does not hold any device configuration
+     */
+    bool empty() const { return (roc.empty() && tbm.empty()); }
+
+  private:
+    /** Copy of all ROC configurations
+     */
+    std::vector< rocConfig > roc;
+
+    /** Copy of all TBM configurations
+     */
+    std::vector< tbmConfig > tbm;
+  };
+
 
   /** Define typedefs to allow easy passing of member function
    *  addresses from the HAL class, used e.g. in loop expansion routines.
@@ -303,8 +428,13 @@ namespace pxar {
      *
      *  A DUT flag is set which prevents test functions to be executed if 
      *  not programmed.
+     *
+     *  If the devices are already programmed and the DUT layout did not change,
+     *  only the TBM and ROC registers which differ from the last programmed
+     *  state are sent. Setting "force" requests a full reprogramming of all
+     *  devices, e.g. for recovery after communication problems.
      */
-    bool programDUT(); 
+    bool programDUT(bool force = false); 
   
 
     // DTB functions
@@ -333,6 +463,28 @@ namespace pxar {
      */
     double getTBvd();
 
+    /** Function to scan a DAC of a single ROC and read the analog DUT supply
+     *  current on the testboard for every DAC setting.
+     *
+     *  After every DAC change the current is sampled repeatedly until three
+     *  consecutive samples agree within the given tolerance (in Ampere), i.e.
+     *  the measurement only waits as long as the supply actually needs to
+     *  settle. The DAC is reset to its original value after the scan.
+     *
+     *  Returns a vector of pairs containing the DAC value and the current in
+     *  SI units of Ampere.
+     */
+    std::vector< std::pair<uint8_t, double> > getTBiaVsDAC(std::string dacName, uint8_t dacStep, uint8_t dacMin, uint8_t dacMax, uint8_t rocID, double tolerance = 0.0002);
+    std::vector< std::pair<uint8_t, double> > getTBiaVsDAC(const dacHandle & dac, uint8_t dacStep, uint8_t dacMin, uint8_t dacMax, uint8_t rocID, double tolerance = 0.0002);
+
+    /** Function to scan a DAC of a single ROC and read the digital DUT supply
+     *  current on the testboard for every DAC setting.
+     *
+     *  Behaves as getTBiaVsDAC.
+     */
+    std::vector< std::pair<uint8_t, double> > getTBidVsDAC(std::string dacName, uint8_t dacStep, uint8_t dacMin, uint8_t dacMax, uint8_t rocID, double tolerance = 0.0002);
+    std::vector< std::pair<uint8_t, double> > getTBidVsDAC(const dacHandle & dac, uint8_t dacStep, uint8_t dacMin, uint8_t dacMax, uint8_t rocID, double tolerance = 0.0002);
+
     /** turn off HV
      */
     void HVoff();
@@ -362,6 +514,18 @@ namespace pxar {
  
     // TEST functions
 
+    /** Resolve a DAC name to a handle which can be passed to setDAC(),
+     *  getDACRange(), dut::getDAC() and the DAC scans instead of the name.
+     *  Returns an invalid handle for unknown DAC names.
+     */
+    dacHandle dac(std::string dacName);
+
+    /** Resolve a TBM register name to a handle which can be passed to
+     *  setTbmReg() instead of the name. Returns an invalid handle for unknown
+     *  register names.
+     */
+    tbmRegHandle tbmReg(std::string regName);
+
     /** Set a DAC value on the DUT for one specific ROC
      *
      *  The "rocID" parameter can be used to select a specific ROC to program.
@@ -371,6 +535,7 @@ namespace pxar {
      *  struct and program the actual device.
      */
     bool setDAC(std::string dacName, uint8_t dacValue, uint8_t rocI2C);
+    bool setDAC(const dacHandle & dac, uint8_t dacValue, uint8_t rocID);
 
     /** Set a DAC value on the DUT for all enabled ROC
      *
@@ -378,10 +543,23 @@ namespace pxar {
      *  struct and program the actual device.
      */
     bool setDAC(std::string dacName, uint8_t dacValue);
+    bool setDAC(const dacHandle & dac, uint8_t dacValue);
+
+    /** Set several DAC values on several ROCs of the DUT at once
+     *
+     *  The DACs are provided as map of ROC ID (counting all ROCs up from 0) to
+     *  a map of DAC names and values. All registers are programmed with one
+     *  single transfer to the testboard.
+     *
+     *  This function will both update the bookkeeping values in the pxar::dut
+     *  struct and program the actual device.
+     */
+    bool setDACs(std::map<uint8_t, std::map<std::string, uint8_t> > rocDacs);
 
     /** Get the valid range of a given DAC
      */
     uint8_t getDACRange(std::string dacName);
+    uint8_t getDACRange(const dacHandle & dac) { return dac.max(); };
 
     /** Set a register value on a specific TBM of the DUT
      *
@@ -394,6 +572,7 @@ namespace pxar {
      *  with even IDs (0,2,...) and TBM Beta cores with odd IDs (1,3,...).
      */
     bool setTbmReg(std::string regName, uint8_t regValue, uint8_t tbmid);
+    bool setTbmReg(const tbmRegHandle & reg, uint8_t regValue, uint8_t tbmid);
 
     /** Set a register value on all TBMs of the DUT
      *
@@ -405,6 +584,29 @@ namespace pxar {
      *  with even IDs (0,2,...) and TBM Beta cores with odd IDs (1,3,...).
      */
     bool setTbmReg(std::string regName, uint8_t regValue);
+    bool setTbmReg(const tbmRegHandle & reg, uint8_t regValue);
+
+    /** Method to take a snapshot of the current DUT configuration
+     *
+     *  The returned pxar::dutSnapshot contains all ROC DACs, TBM registers,
+     *  pixel trim & mask bits and enable flags. It can be used to checkpoint
+     *  the DUT before temporarily changing settings.
+     */
+    dutSnapshot getSnapshot();
+
+    /** Method to restore the DUT configuration from a snapshot
+     *
+     *  Only the ROC DACs and TBM registers which differ from the current DUT
+     *  configuration are programmed into the devices. Pixel trim & mask bits
+     *  and enable flags are restored in the DUT and programmed with the next
+     *  test as usual. The snapshot has to be taken from the same DUT layout,
+     *  otherwise "false" is returned and nothing is changed.
+     *
+     *  With "force" set, all ROC DACs and TBM registers of the snapshot are
+     *  programmed, e.g. after the devices could not be reached and may have
+     *  lost their settings.
+     */
+    bool restoreSnapshot(const dutSnapshot & snapshot, bool force = false);
 
     /** Method to scan a DAC range and measure the pulse height
      *
@@ -415,6 +617,7 @@ namespace pxar {
      *  If the readout of the DTB is corrupt, a pxar::DataMissingEvent is thrown.
      */
     std::vector< std::pair<uint8_t, std::vector<pixel> > > getPulseheightVsDAC(std::string dacName, uint8_t dacMin, uint8_t dacMax, uint16_t flags, uint16_t nTriggers);
+    std::vector< std::pair<uint8_t, std::vector<pixel> > > getPulseheightVsDAC(const dacHandle & dac, uint8_t dacMin, uint8_t dacMax, uint16_t flags, uint16_t nTriggers);
 
     /** Method to scan a DAC range and measure the pulse height
      *
@@ -428,6 +631,7 @@ namespace pxar {
      *
      */
     std::vector< std::pair<uint8_t, std::vector<pixel> > > getPulseheightVsDAC(std::string dacName, uint8_t dacStep, uint8_t dacMin, uint8_t dacMax, uint16_t flags, uint16_t nTrigger);
+    std::vector< std::pair<uint8_t, std::vector<pixel> > > getPulseheightVsDAC(const dacHandle & dac, uint8_t dacStep, uint8_t dacMin, uint8_t dacMax, uint16_t flags, uint16_t nTrigger);
 
     /** Method to scan a DAC range and measure the efficiency
      *
@@ -438,6 +642,7 @@ namespace pxar {
      *  If the readout of the DTB is corrupt, a pxar::DataMissingEvent is thrown.
      */
     std::vector< std::pair<uint8_t, std::vector<pixel> > > getEfficiencyVsDAC(std::string dacName, uint8_t dacMin, uint8_t dacMax, uint16_t flags, uint16_t nTriggers);
+    std::vector< std::pair<uint8_t, std::vector<pixel> > > getEfficiencyVsDAC(const dacHandle & dac, uint8_t dacMin, uint8_t dacMax, uint16_t flags, uint16_t nTriggers);
 
     /** Method to scan a DAC range and measure the efficiency
      *
@@ -450,6 +655,7 @@ namespace pxar {
      *  If the readout of the DTB is corrupt, a pxar::DataMissingEvent is thrown.
      */
     std::vector< std::pair<uint8_t, std::vector<pixel> > > getEfficiencyVsDAC(std::string dacName, uint8_t dacStep, uint8_t dacMin, uint8_t dacMax, uint16_t flags, uint16_t nTriggers);
+    std::vector< std::pair<uint8_t, std::vector<pixel> > > getEfficiencyVsDAC(const dacHandle & dac, uint8_t dacStep, uint8_t dacMin, uint8_t dacMax, uint16_t flags, uint16_t nTriggers);
 
     /** Method to scan a DAC range and measure the pixel threshold
      *
@@ -557,6 +763,105 @@ namespace pxar {
      */
     std::vector< std::pair<uint8_t, std::pair<uint8_t, std::vector<pixel> > > > getEfficiencyVsDACDAC(std::string dac1name, uint8_t dac1step, uint8_t dac1min, uint8_t dac1max, std::string dac2name, uint8_t dac2step, uint8_t dac2min, uint8_t dac2max, uint16_t flags, uint16_t nTriggers);
 
+    /** Method to scan a 3D DAC-Range (DAC1 vs. DAC2 vs. DAC3) and measure the
+     *  pulse height
+     *
+     *  Returns a vector containing pairs of DAC1 values with pairs of DAC2
+     *  values and pairs of DAC3 values with a pxar::pixel vector. The value of
+     *  the pxar::pixel struct is the averaged pulse height over "nTriggers"
+     *  triggers. DAC2 and DAC3 are scanned by the trigger loop on the
+     *  testboard, DAC1 is stepped in between without restarting the DAQ.
+     *
+     *  If the readout of the DTB is corrupt, a pxar::DataMissingEvent is thrown.
+     *
+     */
+    std::vector< std::pair<uint8_t, std::pair<uint8_t, std::pair<uint8_t, std::vector<pixel> > > > > getPulseheightVsDACDACDAC(std::string dac1name, uint8_t dac1min, uint8_t dac1max, std::string dac2name, uint8_t dac2min, uint8_t dac2max, std::string dac3name, uint8_t dac3min, uint8_t dac3max, uint16_t flags, uint16_t nTriggers);
+
+    /** Method to scan a 3D DAC-Range (DAC1 vs. DAC2 vs. DAC3) and measure the
+     *  pulse height
+     *
+     *  Same as above, the dacStep parameters can be used to set the increment
+     *  of the DAC scan independently for all three scanning dimensions.
+     *
+     *  If the readout of the DTB is corrupt, a pxar::DataMissingEvent is thrown.
+     *
+     */
+    std::vector< std::pair<uint8_t, std::pair<uint8_t, std::pair<uint8_t, std::vector<pixel> > > > > getPulseheightVsDACDACDAC(std::string dac1name, uint8_t dac1step, uint8_t dac1min, uint8_t dac1max, std::string dac2name, uint8_t dac2step, uint8_t dac2min, uint8_t dac2max, std::string dac3name, uint8_t dac3step, uint8_t dac3min, uint8_t dac3max, uint16_t flags, uint16_t nTriggers);
+
+    /** Method to scan a 3D DAC-Range (DAC1 vs. DAC2 vs. DAC3) and measure the
+     *  efficiency
+     *
+     *  Returns a vector containing pairs of DAC1 values with pairs of DAC2
+     *  values and pairs of DAC3 values with a pxar::pixel vector. The value of
+     *  the pxar::pixel struct is the number of hits in that pixel.
+     *  Efficiency == 1 for nhits == nTriggers. DAC2 and DAC3 are scanned by
+     *  the trigger loop on the testboard, DAC1 is stepped in between without
+     *  restarting the DAQ.
+     *
+     *  If the readout of the DTB is corrupt, a pxar::DataMissingEvent is thrown.
+     *
+     */
+    std::vector< std::pair<uint8_t, std::pair<uint8_t, std::pair<uint8_t, std::vector<pixel> > > > > getEfficiencyVsDACDACDAC(std::string dac1name, uint8_t dac1min, uint8_t dac1max, std::string dac2name, uint8_t dac2min, uint8_t dac2max, std::string dac3name, uint8_t dac3min, uint8_t dac3max, uint16_t flags, uint16_t nTriggers);
+
+    /** Method to scan a 3D DAC-Range (DAC1 vs. DAC2 vs. DAC3) and measure the
+     *  efficiency
+     *
+     *  Same as above, the dacStep parameters can be used to set the increment
+     *  of the DAC scan independently for all three scanning dimensions.
+     *
+     *  If the readout of the DTB is corrupt, a pxar::DataMissingEvent is thrown.
+     *
+     */
+    std::vector< std::pair<uint8_t, std::pair<uint8_t, std::pair<uint8_t, std::vector<pixel> > > > > getEfficiencyVsDACDACDAC(std::string dac1name, uint8_t dac1step, uint8_t dac1min, uint8_t dac1max, std::string dac2name, uint8_t dac2step, uint8_t dac2min, uint8_t dac2max, std::string dac3name, uint8_t dac3step, uint8_t dac3min, uint8_t dac3max, uint16_t flags, uint16_t nTriggers);
+
+    /** Method to scan a DAC over a list of arbitrary values and measure the
+     *  pulse height
+     *
+     *  Returns a vector containing pairs of DAC values with a pxar::pixel
+     *  vector, one entry per element of "dacValues" and in the same order. The
+     *  value of the pxar::pixel struct is the averaged pulse height over
+     *  "nTriggers" triggers. All values are scanned in one DAQ session.
+     *
+     *  If the readout of the DTB is corrupt, a pxar::DataMissingEvent is thrown.
+     *
+     */
+    std::vector< std::pair<uint8_t, std::vector<pixel> > > getPulseheightVsDACList(std::string dacName, std::vector<uint8_t> dacValues, uint16_t flags, uint16_t nTriggers);
+
+    /** Method to scan a DAC over a list of arbitrary values and measure the
+     *  pulse height, switching a second register along with the list
+     *
+     *  Before measuring entry i of "dacValues", the register "switchName" is
+     *  set to entry i of "switchValues" (both lists have to be of the same
+     *  length), e.g. to scan Vcal in low and high range by switching CtrlReg.
+     *  The register is only reprogrammed when its value changes.
+     *
+     *  If the readout of the DTB is corrupt, a pxar::DataMissingEvent is thrown.
+     *
+     */
+    std::vector< std::pair<uint8_t, std::vector<pixel> > > getPulseheightVsDACList(std::string dacName, std::vector<uint8_t> dacValues, std::string switchName, std::vector<uint8_t> switchValues, uint16_t flags, uint16_t nTriggers);
+
+    /** Method to scan a DAC over a list of arbitrary values and measure the
+     *  efficiency
+     *
+     *  Returns a vector containing pairs of DAC values with a pxar::pixel
+     *  vector, one entry per element of "dacValues" and in the same order. The
+     *  value of the pxar::pixel struct is the number of hits in that pixel.
+     *  Efficiency == 1 for nhits == nTriggers
+     *
+     *  If the readout of the DTB is corrupt, a pxar::DataMissingEvent is thrown.
+     *
+     */
+    std::vector< std::pair<uint8_t, std::vector<pixel> > > getEfficiencyVsDACList(std::string dacName, std::vector<uint8_t> dacValues, uint16_t flags, uint16_t nTriggers);
+
+    /** Method to scan a DAC over a list of arbitrary values and measure the
+     *  efficiency, switching a second register along with the list as for
+     *  getPulseheightVsDACList()
+     *
+     *  If the readout of the DTB is corrupt, a pxar::DataMissingEvent is thrown.
+     *
+     */
+    std::vector< std::pair<uint8_t, std::vector<pixel> > > getEfficiencyVsDACList(std::string dacName, std::vector<uint8_t> dacValues, std::string switchName, std::vector<uint8_t> switchValues, uint16_t flags, uint16_t nTriggers);
+
     /** Method to get a map of the pulse height
      *
      *  Returns a vector of pixels, with the value of the pxar::pixel struct being
@@ -628,6 +933,46 @@ namespace pxar {
      */
     std::vector<pixel> getThresholdMap(std::string dacName, uint16_t flags, uint16_t nTriggers);
 
+    /** Method to get maps of the pixel threshold for several efficiency levels at once
+     *
+     *  Returns a vector of pairs containing the requested threshold level and a vector
+     *  of pixels, with the value of the pxar::pixel struct being the threshold value of
+     *  that pixel at the given efficiency level.
+     *
+     *  All threshold levels are extracted from one single DAC scan, i.e. requesting
+     *  e.g. the 10%, 50% and 90% levels to estimate the s-curve width does not require
+     *  three scans. The levels are given in percent of efficiency (1-100), range and
+     *  dacStep parameters behave as for getThresholdMap.
+     *
+     *  If the readout of the DTB is corrupt, a pxar::DataMissingEvent is thrown.
+     *
+     */
+    std::vector< std::pair<uint8_t, std::vector<pixel> > > getThresholdMaps(std::string dacName, uint8_t dacStep, uint8_t dacMin, uint8_t dacMax, std::vector<uint8_t> thresholds, uint16_t flags, uint16_t nTriggers);
+
+    /** Method to scan a DAC and read back a ROC slow readback register for every
+     *  DAC setting
+     *
+     *  Returns a vector of pairs containing the DAC setting and a vector of readback
+     *  values (lowest byte of the last complete readback word), one for every ROC
+     *  found in the readout chain.
+     *
+     *  The "readback" register of all ROCs is set to the requested value, and the
+     *  full DAC range is scanned within one single DAQ session, i.e. without restarting
+     *  the DAQ and without re-programming the mask and trim state of the DUT for every
+     *  DAC setting. After the scan the DAC is reset to its original value.
+     *
+     *  If no readback value could be decoded for a ROC, READBACK_MISSING is stored
+     *  and a warning is issued.
+     */
+    std::vector< std::pair<uint8_t, std::vector<uint16_t> > > getReadbackVsDAC(std::string dacName, uint8_t dacMin, uint8_t dacMax, uint8_t readback);
+
+    /** Method to scan a DAC and read back a ROC slow readback register for every
+     *  DAC setting, with a configurable DAC step size
+     *
+     *  Behaves as getReadbackVsDAC above, only every dacStep'th DAC value is set.
+     */
+    std::vector< std::pair<uint8_t, std::vector<uint16_t> > > getReadbackVsDAC(std::string dacName, uint8_t dacStep, uint8_t dacMin, uint8_t dacMax, uint8_t readback);
+
     /** Enable or disable the external clock source of the DTB.
      *  This function will return "false" if no external clock is present,
      *  clock is then left on internal.
@@ -734,6 +1079,26 @@ namespace pxar {
      */
     uint16_t daqTriggerLoop(uint16_t period = 1000);
 
+    /** Function to fire the previously defined pattern command list
+     *  continuously with a trigger rate regulated by the DTB buffer fill.
+     *
+     *  The loop is started with "period" clock cycles, which is also the
+     *  shortest period ever used. Each time the buffer is read out (e.g. via
+     *  daqGetEventBuffer()) the period is adjusted such that the buffer is
+     *  filled to "fillTarget" percent at readout. If the buffer fills up
+     *  faster than expected in between, daqStatus() slows the triggers down.
+     *  The trigger loop is never halted, reading out the buffer in regular
+     *  intervals yields the highest sustainable trigger rate.
+     *  The function returns the triggering period actually used after cross-check
+     *  with the pattern generator cycle length.
+     */
+    uint16_t daqTriggerLoopRegulated(uint16_t period = 1000, uint8_t fillTarget = 50);
+
+    /** Function to return the current period of the trigger loop in clock
+     *  cycles, as adjusted by the regulated trigger loop.
+     */
+    uint16_t daqTriggerLoopPeriod() { return _loop_period; };
+
     /** Function to halt the pattern generator loop which has been started
      *  using daqTriggerLoop(). This stops triggering the devices.
      */
@@ -775,6 +1140,22 @@ namespace pxar {
      */
     std::vector<Event> daqGetEventBuffer();
 
+    /** Function to return the full currently available event buffer from the 
+     *  testboard RAM in the compact pxar::packedEvent format. This requires
+     *  half the memory per pixel hit compared to daqGetEventBuffer() and is
+     *  intended for buffered high-rate data taking. Pixel values are stored
+     *  with integer precision, no variance is provided. The decoded pixel hits
+     *  are packed as they come out of the decoder, no intermediate
+     *  pxar::Event objects are allocated.
+     *
+     *  This function can throw a pxar::DataDecodingError exception in case severe
+     *  problems were encountered during the readout.
+     *
+     *  If no events are available the function will throw a pxar::DataNoEvent
+     *  exception. Catching this allows constant polling for new events.
+     */
+    std::vector<packedEvent> daqGetPackedEventBuffer();
+
     /** Function to return the full currently available ROC slow readback value
      *  buffer. The data is stored until a new DAQ session or test is called and
      *  can be fetched once (deleted at read time). The return vector contains
@@ -782,6 +1163,31 @@ namespace pxar {
      */
     std::vector<std::vector<uint16_t> > daqGetReadback();
 
+    /** Function to publish all DAQ data into a POSIX shared memory ring
+     *  buffer (pxar::eventRing) named "name", consisting of "nslots" slots
+     *  of "slotsize" bytes each.
+     *
+     *  From then on every pxar::Event, pxar::rawEvent or raw data block read
+     *  out through the daqGet* functions is also copied to the ring, the
+     *  decoded pixels in the pxar::packedPixel format. Any number of local
+     *  processes can attach read-only using pxar::eventRingReader. The DAQ
+     *  never waits for them, readers falling behind by more than "nslots"
+     *  records lose data. Returns false if the ring could not be created.
+     */
+    bool daqPublish(std::string name = "/pxar", uint32_t nslots = 8192, uint32_t slotsize = 2048);
+
+    /** Function to stop publishing DAQ data and remove the shared memory ring
+     */
+    void daqPublishStop();
+
+    /** Function to configure the memory and threads of the DAQ readout
+     *  chain, see pxar::daqConfig. The USB reader settings take effect
+     *  immediately, the decoder pinning with the next daqStart(). Settings
+     *  not supported by the platform or USB driver are skipped with a
+     *  warning, in which case false is returned.
+     */
+    bool daqSetConfig(const daqConfig & config);
+
     /** Function that returns a class object of the type pxar::statistics
      *  containing all collected error statistics from the last (non-raw)
      *  DAQ readout or API test call. Statistics can be fetched once and
@@ -854,6 +1260,16 @@ namespace pxar {
      */
     std::vector<pixel> repackThresholdMapData (std::vector<Event*> data, uint8_t dacStep, uint8_t dacMin, uint8_t dacMax, uint8_t thresholdlevel, uint16_t nTriggers, uint16_t flags);
 
+    /** Repacks map data from (possibly) several ROCs into one vector of pixels
+     *  per requested threshold level. The DAC scan data is only repacked once.
+     */
+    std::vector< std::pair<uint8_t, std::vector<pixel> > > repackThresholdMapsData (std::vector<Event*> data, uint8_t dacStep, uint8_t dacMin, uint8_t dacMax, std::vector<uint8_t> thresholdlevels, uint16_t nTriggers, uint16_t flags);
+
+    /** Extracts the threshold value of each pixel from already repacked DAC scan
+     *  data at the given efficiency level. The input data is left untouched.
+     */
+    std::vector<pixel> findThresholds (const std::vector< std::pair<uint8_t, std::vector<pixel> > > & packed_dac, uint8_t dacMin, uint8_t dacMax, uint8_t thresholdlevel, uint16_t nTriggers, uint16_t flags);
+
     /** Repacks DAC scan data into pairs of DAC values with fired pxar::pixel vectors.
      */
     std::vector< std::pair<uint8_t, std::vector<pixel> > > repackDacScanData (std::vector<Event*> data, uint8_t dacStep, uint8_t dacMin, uint8_t dacMax, uint16_t nTriggers, uint16_t flags, bool efficiency);
@@ -867,6 +1283,27 @@ namespace pxar {
      */
     std::vector< std::pair<uint8_t, std::pair<uint8_t, std::vector<pixel> > > > repackDacDacScanData (std::vector<Event*> data, uint8_t dac1step, uint8_t dac1min, uint8_t dac1max, uint8_t dac2step, uint8_t dac2min, uint8_t dac2max, uint16_t nTriggers, uint16_t flags, bool efficiency);
 
+    /** repacks (3D) DAC-DAC-DAC scan data into pairs of DAC values with
+     *  vectors of the fired pixels.
+     */
+    std::vector< std::pair<uint8_t, std::pair<uint8_t, std::pair<uint8_t, std::vector<pixel> > > > > repackDacDacDacScanData (std::vector<Event*> data, uint8_t dac1step, uint8_t dac1min, uint8_t dac1max, uint8_t dac2step, uint8_t dac2min, uint8_t dac2max, uint8_t dac3step, uint8_t dac3min, uint8_t dac3max, uint16_t nTriggers, bool efficiency);
+
+    /** Common part of the DAC-DAC-DAC scans: verifies the ranges, runs the
+     *  scan and resets the scanned DACs to their configured values.
+     */
+    std::vector< std::pair<uint8_t, std::pair<uint8_t, std::pair<uint8_t, std::vector<pixel> > > > > runDacDacDacScan(std::string dac1name, uint8_t dac1step, uint8_t dac1min, uint8_t dac1max, std::string dac2name, uint8_t dac2step, uint8_t dac2min, uint8_t dac2max, std::string dac3name, uint8_t dac3step, uint8_t dac3min, uint8_t dac3max, uint16_t flags, uint16_t nTriggers, bool efficiency);
+
+    /** Common part of the DAC list scans: verifies the registers and values,
+     *  runs the scan and resets the scanned registers to their configured
+     *  values. An empty "switchName" disables the switched register.
+     */
+    std::vector< std::pair<uint8_t, std::vector<pixel> > > runDacListScan(std::string dacName, std::vector<uint8_t> dacValues, std::string switchName, std::vector<uint8_t> switchValues, uint16_t flags, uint16_t nTriggers, bool efficiency);
+
+    /** Helper function for the current vs. DAC scans, selecting the analog
+     *  or digital supply current
+     */
+    std::vector< std::pair<uint8_t, double> > getCurrentVsDAC(const dacHandle & dac, uint8_t dacStep, uint8_t dacMin, uint8_t dacMax, uint8_t rocID, double tolerance, bool analog);
+
     /** Helper function for conversion from string to register value
      *
      *  Type tells it whether it is a DTB, TBM or ROC register to look for.
@@ -876,10 +1313,27 @@ namespace pxar {
      */
     bool verifyRegister(std::string name, uint8_t &id, uint8_t &value, uint8_t type);
 
+    /** Range check of a value for a resolved register handle, behaves as
+     *  verifyRegister() above and rejects invalid handles
+     */
+    bool verifyRegister(const registerHandle & reg, uint8_t &value);
+
     /** Helper function for conversion from device type string to code
      */
     uint8_t stringToDeviceCode(std::string name);
 
+    /** Helper function to only program the differences between the current
+     *  DUT configuration and the last programmed device state. Returns false
+     *  if the DUT layout changed and a full programming cycle is required.
+     */
+    bool updateDUT();
+
+    /** Helper functions to keep the last programmed device state in sync
+     *  with registers written directly to ROC "rocId" / TBM "tbmId"
+     */
+    void updateRocState(size_t rocId, uint8_t dacRegister, uint8_t dacValue);
+    void updateTbmState(size_t tbmId, uint8_t tbmRegister, uint8_t regValue);
+
     /** Routine to loop over all ROCs/pixels and update the NIOS cache of trim
      *  and mask bits with the current test configuration. This cache is used
      *  for the trimming done on the test trigger loops unless FLAG_FORCE_UNMASKED
@@ -948,6 +1402,11 @@ namespace pxar {
      */
     uint32_t getPatternGeneratorDelaySum(std::vector<std::pair<uint16_t,uint8_t> > &pg_setup);
 
+    /** Helper function to adjust the period of a regulated trigger loop from
+     *  the DTB buffer fill, called before reading out the buffer
+     */
+    void regulateTriggerLoop();
+
     /** Status of the DAQ
      */
     bool _daq_running;
@@ -958,6 +1417,27 @@ namespace pxar {
 
     /** Warned the user about not initializing the DUT */
     bool _daq_startstop_warning;
+
+    /** Trigger loop period regulated by the buffer fill, see daqTriggerLoopRegulated()
+     */
+    bool _loop_regulated;
+
+    /** Current and minimum trigger loop period in clock cycles
+     */
+    uint16_t _loop_period;
+    uint16_t _loop_period_min;
+
+    /** Target DTB buffer fill at readout in percent
+     */
+    uint8_t _loop_fill_target;
+
+    /** Trigger loop has already been slowed down since the last readout
+     */
+    bool _loop_backoff;
+
+    /** Shared memory ring all DAQ data is published to, see daqPublish()
+     */
+    eventRing * _event_ring;
     
   }; // class pxarCore
 
@@ -973,7 +1453,7 @@ namespace pxar {
 
     /** Default DUT constructor
      */
-    dut() : _initialized(false), _programmed(false), roc(), tbm(), sig_delays(),
+    dut() : _initialized(false), _programmed(false), _roc_state(), _tbm_state(), _hubid_state(0), roc(), tbm(), sig_delays(),
       va(0), vd(0), ia(0), id(0), pg_setup(), pg_sum(0) {}
 
     // GET functions to read information
@@ -1081,6 +1561,7 @@ namespace pxar {
     /** Function to read the current value from a DAC on ROC rocId
      */
     uint8_t getDAC(size_t rocId, std::string dacName);
+    uint8_t getDAC(size_t rocId, const dacHandle & dac);
 
     /** Function to read current values from all DAC on ROC rocId
      */
@@ -1169,6 +1650,19 @@ namespace pxar {
      */
     bool _programmed;
 
+    /** Last ROC configurations successfully programmed into the devices,
+     *  used to only send changed registers when reprogramming
+     */
+    std::vector< rocConfig > _roc_state;
+
+    /** Last TBM configurations successfully programmed into the devices
+     */
+    std::vector< tbmConfig > _tbm_state;
+
+    /** Last global hub ID successfully programmed into the testboard
+     */
+    uint8_t _hubid_state;
+
     /** Function returning for every column if it includes an enabled pixel
      *  for a specific ROC selected by its I2C address:
      */
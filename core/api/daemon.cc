@@ -0,0 +1,827 @@
+/**
+ * pxar daemon and client implementation
+ */
+
+#include "daemon.h"
+#include "api.h"
+#include "exceptions.h"
+#include "log.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <set>
+#include <sstream>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+// Clients which do not read their replies are dropped above this backlog:
+#define DAEMON_MAX_OUTPUT (256*1024*1024)
+
+using namespace pxar;
+
+static const char * daemonHelp[] = {
+  "help                              this list",
+  "ping                              check the connection",
+  "hello <name>                      name this client in the daemon status",
+  "status                            clients, DAQ owner and queue length",
+  "version                           pxar version of the daemon",
+  "shutdown                          stop the daemon",
+  "nrocs                             number of enabled ROCs",
+  "getdac <name> <roc>               DAC value from the DUT configuration",
+  "getdacs <roc>                     all DACs of a ROC as <name> <value>",
+  "gettbmregs <tbm>                  all registers of a TBM core as <name> <value>",
+  "getia | getid | getva | getvd     testboard currents and voltages",
+  "setdac <name> <value> [roc]       set a DAC on one or all ROCs",
+  "settbmreg <name> <value> [tbm]    set a TBM register on one or all TBM cores",
+  "maskallpixels <0|1> [roc]         mask or unmask all pixels",
+  "testallpixels <0|1> [roc]         enable or disable all pixels for testing",
+  "maskpixel <col> <row> <0|1> [roc] mask or unmask one pixel",
+  "testpixel <col> <row> <0|1> [roc] enable or disable one pixel for testing",
+  "trimbits <col> <row> <trim> <roc> set the trim bits of one pixel",
+  "hvon | hvoff | pon | poff         switch HV or DUT power",
+  "efficiencymap <ntrig> [flags]     lines <roc> <col> <row> <hits>",
+  "pulseheightmap <ntrig> [flags]    lines <roc> <col> <row> <pulse height>",
+  "daqstart | daqstop                start or stop a DAQ session owned by this client",
+  "daqstatus                         DAQ status and buffer fill in percent",
+  "daqtrigger [n] [period]           send n triggers",
+  "daqtriggerloop [period]           start the trigger loop",
+  "daqtriggerloophalt                halt the trigger loop",
+  "daqgetevents                      lines <header> <trailer> [<roc> <col> <row> <value>]...",
+  "daqgetbuffer                      raw data words in hex, 32 per line",
+  0
+};
+
+pxarDaemon::pxarDaemon(pxarCore * api, std::string socket) :
+  _api(api),
+  _socket(socket),
+  _listenfd(-1),
+  _running(0),
+  _clients(),
+  _queue(),
+  _daq_owner(-1),
+  _served(0)
+{}
+
+pxarDaemon::~pxarDaemon() {
+
+  for(std::map<int, client>::iterator it = _clients.begin(); it != _clients.end(); ++it) { close(it->first); }
+  _clients.clear();
+  if(_listenfd >= 0) {
+    close(_listenfd);
+    unlink(_socket.c_str());
+  }
+}
+
+bool pxarDaemon::listen() {
+
+  struct sockaddr_un addr;
+  if(_socket.size() >= sizeof(addr.sun_path)) {
+    LOG(logERROR) << "Socket path too long: " << _socket;
+    return false;
+  }
+
+  _listenfd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(_listenfd < 0) {
+    LOG(logERROR) << "Could not create socket: " << std::strerror(errno);
+    return false;
+  }
+
+  // Remove a socket left over by a daemon which did not shut down cleanly:
+  unlink(_socket.c_str());
+
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  std::strncpy(addr.sun_path, _socket.c_str(), sizeof(addr.sun_path) - 1);
+  if(bind(_listenfd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0
+     || ::listen(_listenfd, 16) != 0) {
+    LOG(logERROR) << "Could not listen on " << _socket << ": " << std::strerror(errno);
+    close(_listenfd);
+    _listenfd = -1;
+    return false;
+  }
+  // Only local users of the same group may talk to the DTB:
+  chmod(_socket.c_str(), 0660);
+
+  LOG(logINFO) << "pxar daemon listening on " << _socket;
+  return true;
+}
+
+void pxarDaemon::accept() {
+
+  int fd = ::accept(_listenfd, NULL, NULL);
+  if(fd < 0) return;
+
+  // Replies are sent from the poll loop, never wait for a client:
+  int flags = fcntl(fd, F_GETFL, 0);
+  if(flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+    LOG(logWARNING) << "Could not make client socket non-blocking: " << std::strerror(errno);
+    close(fd);
+    return;
+  }
+
+  std::ostringstream name;
+  name << "client" << fd;
+  _clients[fd].name = name.str();
+  LOG(logINFO) << "Client " << fd << " connected, " << _clients.size() << " clients";
+}
+
+bool pxarDaemon::receive(int fd) {
+
+  char buffer[4096];
+  ssize_t n = read(fd, buffer, sizeof(buffer));
+  if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return true;
+  if(n <= 0) return false;
+
+  client & cl = _clients[fd];
+  cl.input.append(buffer, static_cast<size_t>(n));
+
+  size_t pos;
+  while((pos = cl.input.find('\n')) != std::string::npos) {
+    std::string line = cl.input.substr(0, pos);
+    cl.input.erase(0, pos + 1);
+
+    request req;
+    req.fd = fd;
+    std::istringstream is(line);
+    std::string word;
+    if(!(is >> req.command)) continue;
+    std::transform(req.command.begin(), req.command.end(), req.command.begin(), ::tolower);
+    while(is >> word) { req.args.push_back(word); }
+    _queue.push_back(req);
+  }
+
+  // Do not let a misbehaving client fill up our memory:
+  if(cl.input.size() > 65536) {
+    LOG(logWARNING) << "Client " << cl.name << " sent an overlong request, disconnecting.";
+    return false;
+  }
+  return true;
+}
+
+void pxarDaemon::drop(int fd) {
+
+  std::map<int, client>::iterator cl = _clients.find(fd);
+  if(cl == _clients.end()) return;
+  LOG(logINFO) << "Client " << cl->second.name << " disconnected";
+
+  // Forget everything this client still asked for:
+  for(std::deque<request>::iterator it = _queue.begin(); it != _queue.end();) {
+    if(it->fd == fd) { it = _queue.erase(it); }
+    else { ++it; }
+  }
+
+  // Never leave a DAQ session behind without owner:
+  if(_daq_owner == fd) {
+    LOG(logWARNING) << "DAQ owner " << cl->second.name << " disconnected, stopping DAQ.";
+    _api->daqStop();
+    _daq_owner = -1;
+  }
+
+  close(fd);
+  _clients.erase(cl);
+}
+
+bool pxarDaemon::isDaqCommand(const std::string & command) {
+  return (command.compare(0, 3, "daq") == 0 && command != "daqstatus");
+}
+
+bool pxarDaemon::isReadOnly(const std::string & command) {
+  static const char * readonly[] = {"help", "ping", "hello", "status", "version", "nrocs",
+				    "getdac", "getdacs", "gettbmregs",
+				    "getia", "getid", "getva", "getvd", "daqstatus", 0};
+  for(size_t i = 0; readonly[i] != 0; i++) {
+    if(command == readonly[i]) return true;
+  }
+  return false;
+}
+
+bool pxarDaemon::next(request & req) {
+
+  // Requests of one client are always executed in order, only requests at
+  // the front of a client's queue are candidates. DAQ commands go first:
+  std::set<int> seen;
+  for(std::deque<request>::iterator it = _queue.begin(); it != _queue.end(); ++it) {
+    if(!seen.insert(it->fd).second) continue;
+    if(isDaqCommand(it->command)) {
+      req = *it;
+      _queue.erase(it);
+      return true;
+    }
+  }
+
+  // Requests changing the DUT wait while another client owns the DAQ:
+  seen.clear();
+  for(std::deque<request>::iterator it = _queue.begin(); it != _queue.end(); ++it) {
+    if(!seen.insert(it->fd).second) continue;
+    if(_daq_owner < 0 || it->fd == _daq_owner || isReadOnly(it->command)) {
+      req = *it;
+      _queue.erase(it);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool pxarDaemon::run(volatile sig_atomic_t * stopSignal) {
+
+  if(!listen()) return false;
+
+  // A client going away must not kill the daemon:
+  signal(SIGPIPE, SIG_IGN);
+
+  _running = 1;
+  while(_running) {
+    if(stopSignal && *stopSignal) {
+      LOG(logINFO) << "Signal " << static_cast<int>(*stopSignal) << " caught, shutting down.";
+      break;
+    }
+
+    request req;
+    bool ready = next(req);
+
+    std::vector<struct pollfd> fds;
+    struct pollfd pfd;
+    pfd.fd = _listenfd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    fds.push_back(pfd);
+    for(std::map<int, client>::iterator it = _clients.begin(); it != _clients.end(); ++it) {
+      pfd.fd = it->first;
+      pfd.events = it->second.output.empty() ? POLLIN : (POLLIN | POLLOUT);
+      fds.push_back(pfd);
+    }
+
+    // Only wait for input if there is nothing to do:
+    if(poll(&fds[0], fds.size(), ready ? 0 : 200) > 0) {
+      for(size_t i = 1; i < fds.size(); i++) {
+	bool alive = true;
+	if(fds[i].revents & POLLOUT) { alive = flush(fds[i].fd); }
+	if(alive && (fds[i].revents & (POLLIN | POLLHUP | POLLERR))) { alive = receive(fds[i].fd); }
+	if(!alive) {
+	  if(ready && req.fd == fds[i].fd) ready = false;
+	  drop(fds[i].fd);
+	}
+      }
+      if(fds[0].revents & POLLIN) accept();
+    }
+
+    if(ready) execute(req);
+  }
+
+  if(_daq_owner >= 0) {
+    _api->daqStop();
+    _daq_owner = -1;
+  }
+  // Send what the sockets still accept, e.g. the reply to "shutdown":
+  for(std::map<int, client>::iterator it = _clients.begin(); it != _clients.end(); ++it) {
+    flush(it->first);
+    close(it->first);
+  }
+  _clients.clear();
+  _queue.clear();
+  close(_listenfd);
+  unlink(_socket.c_str());
+  _listenfd = -1;
+  LOG(logINFO) << "pxar daemon stopped after " << _served << " requests.";
+  return true;
+}
+
+void pxarDaemon::send(int fd, const std::string & data) {
+
+  std::map<int, client>::iterator cl = _clients.find(fd);
+  if(cl == _clients.end()) return;
+
+  if(cl->second.output.size() + data.size() > DAEMON_MAX_OUTPUT) {
+    LOG(logWARNING) << "Client " << cl->second.name << " does not read its replies, disconnecting.";
+    drop(fd);
+    return;
+  }
+  cl->second.output.append(data);
+  if(!flush(fd)) drop(fd);
+}
+
+bool pxarDaemon::flush(int fd) {
+
+  std::map<int, client>::iterator cl = _clients.find(fd);
+  if(cl == _clients.end()) return false;
+
+  std::string & output = cl->second.output;
+  size_t sent = 0;
+  while(sent < output.size()) {
+    ssize_t n = ::send(fd, output.data() + sent, output.size() - sent, MSG_NOSIGNAL);
+    if(n < 0 && errno == EINTR) continue;
+    if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+    if(n <= 0) return false;
+    sent += static_cast<size_t>(n);
+  }
+  output.erase(0, sent);
+  return true;
+}
+
+void pxarDaemon::execute(const request & req) {
+
+  std::vector<std::string> reply;
+  bool ok = false;
+  try {
+    ok = dispatch(req, reply);
+  }
+  catch(pxarException & e) {
+    reply.assign(1, e.what());
+  }
+  catch(std::exception & e) {
+    reply.assign(1, e.what());
+  }
+  _served++;
+
+  std::ostringstream out;
+  if(ok) {
+    out << "OK " << reply.size() << "\n";
+    for(std::vector<std::string>::iterator it = reply.begin(); it != reply.end(); ++it) { out << *it << "\n"; }
+  }
+  else {
+    std::string msg = reply.empty() ? "failed" : reply.front();
+    std::replace(msg.begin(), msg.end(), '\n', ' ');
+    out << "ERR " << msg << "\n";
+    LOG(logDEBUGAPI) << "Request \"" << req.command << "\" of " << _clients[req.fd].name << " failed: " << msg;
+  }
+  send(req.fd, out.str());
+}
+
+static bool nargs(const std::vector<std::string> & args, size_t min, size_t max) {
+  return (args.size() >= min && args.size() <= max);
+}
+
+static void formatPixels(std::vector<pixel> pixels, std::vector<std::string> & reply) {
+  for(std::vector<pixel>::iterator px = pixels.begin(); px != pixels.end(); ++px) {
+    std::ostringstream line;
+    line << static_cast<int>(px->roc()) << " " << static_cast<int>(px->column()) << " "
+	 << static_cast<int>(px->row()) << " " << px->value();
+    reply.push_back(line.str());
+  }
+}
+
+bool pxarDaemon::dispatch(const request & req, std::vector<std::string> & reply) {
+
+  const std::string & cmd = req.command;
+  const std::vector<std::string> & a = req.args;
+  std::ostringstream os;
+
+  // Check the number of arguments:
+#define NARGS(min, max) if(!nargs(a, min, max)) { reply.assign(1, "wrong number of arguments for " + cmd); return false; }
+
+  if(cmd == "help") {
+    for(size_t i = 0; daemonHelp[i] != 0; i++) { reply.push_back(daemonHelp[i]); }
+    return true;
+  }
+  if(cmd == "ping") { return true; }
+  if(cmd == "hello") {
+    NARGS(1, 1);
+    _clients[req.fd].name = a[0];
+    return true;
+  }
+  if(cmd == "version") {
+    reply.push_back(_api->getVersion());
+    return true;
+  }
+  if(cmd == "status") {
+    os << "clients " << _clients.size();
+    reply.push_back(os.str());
+    for(std::map<int, client>::iterator it = _clients.begin(); it != _clients.end(); ++it) {
+      reply.push_back("client " + it->second.name + (it->first == req.fd ? " (you)" : ""));
+    }
+    reply.push_back("daqowner " + (_daq_owner < 0 ? std::string("none") : _clients[_daq_owner].name));
+    os.str("");
+    os << "queued " << _queue.size();
+    reply.push_back(os.str());
+    os.str("");
+    os << "served " << _served;
+    reply.push_back(os.str());
+    return true;
+  }
+  if(cmd == "shutdown") {
+    if(_daq_owner >= 0 && _daq_owner != req.fd) {
+      reply.assign(1, "DAQ session owned by " + _clients[_daq_owner].name);
+      return false;
+    }
+    _running = 0;
+    return true;
+  }
+
+  // DUT configuration cached in the daemon:
+  if(cmd == "nrocs") {
+    os << _api->_dut->getNEnabledRocs();
+    reply.push_back(os.str());
+    return true;
+  }
+  if(cmd == "getdac") {
+    NARGS(2, 2);
+    os << static_cast<int>(_api->_dut->getDAC(atoi(a[1].c_str()), a[0]));
+    reply.push_back(os.str());
+    return true;
+  }
+  if(cmd == "getdacs" || cmd == "gettbmregs") {
+    NARGS(1, 1);
+    size_t id = atoi(a[0].c_str());
+    std::vector<std::pair<std::string,uint8_t> > regs = (cmd == "getdacs") ? _api->_dut->getDACs(id) : _api->_dut->getTbmDACs(id);
+    for(std::vector<std::pair<std::string,uint8_t> >::iterator it = regs.begin(); it != regs.end(); ++it) {
+      os.str("");
+      os << it->first << " " << static_cast<int>(it->second);
+      reply.push_back(os.str());
+    }
+    return true;
+  }
+
+  // Testboard:
+  if(cmd == "getia" || cmd == "getid" || cmd == "getva" || cmd == "getvd") {
+    if(cmd == "getia") os << _api->getTBia();
+    else if(cmd == "getid") os << _api->getTBid();
+    else if(cmd == "getva") os << _api->getTBva();
+    else os << _api->getTBvd();
+    reply.push_back(os.str());
+    return true;
+  }
+  if(cmd == "hvon") { _api->HVon(); return true; }
+  if(cmd == "hvoff") { _api->HVoff(); return true; }
+  if(cmd == "pon") { _api->Pon(); return true; }
+  if(cmd == "poff") { _api->Poff(); return true; }
+
+  // DUT programming:
+  if(cmd == "setdac") {
+    NARGS(2, 3);
+    uint8_t value = static_cast<uint8_t>(atoi(a[1].c_str()));
+    if(a.size() == 3) return _api->setDAC(a[0], value, static_cast<uint8_t>(atoi(a[2].c_str())));
+    return _api->setDAC(a[0], value);
+  }
+  if(cmd == "settbmreg") {
+    NARGS(2, 3);
+    uint8_t value = static_cast<uint8_t>(atoi(a[1].c_str()));
+    if(a.size() == 3) return _api->setTbmReg(a[0], value, static_cast<uint8_t>(atoi(a[2].c_str())));
+    return _api->setTbmReg(a[0], value);
+  }
+  if(cmd == "maskallpixels" || cmd == "testallpixels") {
+    NARGS(1, 2);
+    bool flag = (atoi(a[0].c_str()) != 0);
+    if(cmd == "maskallpixels") {
+      if(a.size() == 2) _api->_dut->maskAllPixels(flag, static_cast<uint8_t>(atoi(a[1].c_str())));
+      else _api->_dut->maskAllPixels(flag);
+    }
+    else {
+      if(a.size() == 2) _api->_dut->testAllPixels(flag, static_cast<uint8_t>(atoi(a[1].c_str())));
+      else _api->_dut->testAllPixels(flag);
+    }
+    return true;
+  }
+  if(cmd == "maskpixel" || cmd == "testpixel") {
+    NARGS(3, 4);
+    uint8_t col = static_cast<uint8_t>(atoi(a[0].c_str()));
+    uint8_t row = static_cast<uint8_t>(atoi(a[1].c_str()));
+    bool flag = (atoi(a[2].c_str()) != 0);
+    if(cmd == "maskpixel") {
+      if(a.size() == 4) _api->_dut->maskPixel(col, row, flag, static_cast<uint8_t>(atoi(a[3].c_str())));
+      else _api->_dut->maskPixel(col, row, flag);
+    }
+    else {
+      if(a.size() == 4) _api->_dut->testPixel(col, row, flag, static_cast<uint8_t>(atoi(a[3].c_str())));
+      else _api->_dut->testPixel(col, row, flag);
+    }
+    return true;
+  }
+  if(cmd == "trimbits") {
+    NARGS(4, 4);
+    return _api->_dut->updateTrimBits(static_cast<uint8_t>(atoi(a[0].c_str())), static_cast<uint8_t>(atoi(a[1].c_str())),
+				      static_cast<uint8_t>(atoi(a[2].c_str())), static_cast<uint8_t>(atoi(a[3].c_str())));
+  }
+
+  // Tests:
+  if(cmd == "efficiencymap" || cmd == "pulseheightmap") {
+    NARGS(1, 2);
+    uint16_t ntrig = static_cast<uint16_t>(atoi(a[0].c_str()));
+    uint16_t flags = (a.size() == 2) ? static_cast<uint16_t>(strtol(a[1].c_str(), NULL, 0)) : 0;
+    if(cmd == "efficiencymap") formatPixels(_api->getEfficiencyMap(flags, ntrig), reply);
+    else formatPixels(_api->getPulseheightMap(flags, ntrig), reply);
+    return true;
+  }
+
+  // DAQ, owned by the client that started it:
+  if(cmd == "daqstatus") {
+    uint8_t fill = 0;
+    os << (_api->daqStatus(fill) ? 1 : 0) << " " << static_cast<int>(fill);
+    reply.push_back(os.str());
+    return true;
+  }
+  if(isDaqCommand(cmd) && _daq_owner >= 0 && _daq_owner != req.fd) {
+    reply.assign(1, "DAQ session owned by " + _clients[_daq_owner].name);
+    return false;
+  }
+  if(cmd == "daqstart") {
+    if(!_api->daqStart()) {
+      reply.assign(1, "could not start DAQ");
+      return false;
+    }
+    _daq_owner = req.fd;
+    return true;
+  }
+  if(cmd == "daqstop") {
+    _daq_owner = -1;
+    return _api->daqStop();
+  }
+  if(cmd == "daqtrigger") {
+    NARGS(0, 2);
+    uint32_t ntrig = (a.size() > 0) ? static_cast<uint32_t>(atoi(a[0].c_str())) : 1;
+    uint16_t period = (a.size() > 1) ? static_cast<uint16_t>(atoi(a[1].c_str())) : 0;
+    os << _api->daqTrigger(ntrig, period);
+    reply.push_back(os.str());
+    return true;
+  }
+  if(cmd == "daqtriggerloop") {
+    NARGS(0, 1);
+    uint16_t period = (a.size() > 0) ? static_cast<uint16_t>(atoi(a[0].c_str())) : 1000;
+    os << _api->daqTriggerLoop(period);
+    reply.push_back(os.str());
+    return true;
+  }
+  if(cmd == "daqtriggerloophalt") {
+    _api->daqTriggerLoopHalt();
+    return true;
+  }
+  if(cmd == "daqgetevents") {
+    std::vector<Event> events;
+    try { events = _api->daqGetEventBuffer(); }
+    catch(DataNoEvent &) {}
+    for(std::vector<Event>::iterator evt = events.begin(); evt != events.end(); ++evt) {
+      os.str("");
+      os << evt->header << " " << evt->trailer;
+      for(std::vector<pixel>::iterator px = evt->pixels.begin(); px != evt->pixels.end(); ++px) {
+	os << " " << static_cast<int>(px->roc()) << " " << static_cast<int>(px->column())
+	   << " " << static_cast<int>(px->row()) << " " << px->value();
+      }
+      reply.push_back(os.str());
+    }
+    return true;
+  }
+  if(cmd == "daqgetbuffer") {
+    std::vector<uint16_t> buffer;
+    try { buffer = _api->daqGetBuffer(); }
+    catch(DataNoEvent &) {}
+    os << std::hex;
+    for(size_t i = 0; i < buffer.size(); i++) {
+      os << buffer[i];
+      if(i%32 == 31 || i + 1 == buffer.size()) {
+	reply.push_back(os.str());
+	os.str("");
+      }
+      else { os << " "; }
+    }
+    return true;
+  }
+#undef NARGS
+
+  reply.assign(1, "unknown command " + cmd + ", try help");
+  return false;
+}
+
+pxarClient::pxarClient() : _fd(-1), _input(), _error() {}
+
+pxarClient::~pxarClient() {
+  disconnect();
+}
+
+bool pxarClient::connect(std::string socket, std::string name) {
+
+  disconnect();
+
+  struct sockaddr_un addr;
+  if(socket.size() >= sizeof(addr.sun_path)) {
+    LOG(logERROR) << "Socket path too long: " << socket;
+    return false;
+  }
+
+  _fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if(_fd < 0) {
+    LOG(logERROR) << "Could not create socket: " << std::strerror(errno);
+    return false;
+  }
+
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  std::strncpy(addr.sun_path, socket.c_str(), sizeof(addr.sun_path) - 1);
+  if(::connect(_fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+    LOG(logERROR) << "Could not connect to pxar daemon at " << socket << ": " << std::strerror(errno);
+    close(_fd);
+    _fd = -1;
+    return false;
+  }
+
+  std::vector<std::string> reply;
+  if(!name.empty()) { request("hello " + name, reply); }
+  LOG(logDEBUGAPI) << "Connected to pxar daemon at " << socket;
+  return true;
+}
+
+void pxarClient::disconnect() {
+  if(_fd < 0) return;
+  close(_fd);
+  _fd = -1;
+  _input.clear();
+}
+
+bool pxarClient::readLine(std::string & line) {
+
+  size_t pos;
+  while((pos = _input.find('\n')) == std::string::npos) {
+    char buffer[65536];
+    ssize_t n = read(_fd, buffer, sizeof(buffer));
+    if(n < 0 && errno == EINTR) continue;
+    if(n <= 0) {
+      LOG(logERROR) << "Lost connection to pxar daemon.";
+      disconnect();
+      return false;
+    }
+    _input.append(buffer, static_cast<size_t>(n));
+  }
+  line = _input.substr(0, pos);
+  _input.erase(0, pos + 1);
+  return true;
+}
+
+bool pxarClient::request(std::string command, std::vector<std::string> & reply) {
+
+  reply.clear();
+  if(_fd < 0) {
+    _error = "not connected";
+    return false;
+  }
+
+  command += "\n";
+  size_t sent = 0;
+  while(sent < command.size()) {
+    ssize_t n = ::send(_fd, command.data() + sent, command.size() - sent, MSG_NOSIGNAL);
+    if(n < 0 && errno == EINTR) continue;
+    if(n <= 0) {
+      _error = "lost connection";
+      disconnect();
+      return false;
+    }
+    sent += static_cast<size_t>(n);
+  }
+
+  std::string line;
+  if(!readLine(line)) {
+    _error = "lost connection";
+    return false;
+  }
+  if(line.compare(0, 3, "OK ") != 0) {
+    _error = (line.compare(0, 4, "ERR ") == 0) ? line.substr(4) : line;
+    LOG(logDEBUGAPI) << "pxar daemon: " << _error;
+    return false;
+  }
+
+  size_t nlines = strtoul(line.c_str() + 3, NULL, 10);
+  reply.reserve(nlines);
+  for(size_t i = 0; i < nlines; i++) {
+    if(!readLine(line)) {
+      _error = "lost connection";
+      return false;
+    }
+    reply.push_back(line);
+  }
+  return true;
+}
+
+bool pxarClient::setDAC(std::string dacName, uint8_t dacValue, uint8_t rocId) {
+  std::ostringstream os;
+  os << "setdac " << dacName << " " << static_cast<int>(dacValue) << " " << static_cast<int>(rocId);
+  std::vector<std::string> reply;
+  return request(os.str(), reply);
+}
+
+bool pxarClient::setDAC(std::string dacName, uint8_t dacValue) {
+  std::ostringstream os;
+  os << "setdac " << dacName << " " << static_cast<int>(dacValue);
+  std::vector<std::string> reply;
+  return request(os.str(), reply);
+}
+
+bool pxarClient::getDAC(std::string dacName, uint8_t rocId, uint8_t & dacValue) {
+  std::ostringstream os;
+  os << "getdac " << dacName << " " << static_cast<int>(rocId);
+  std::vector<std::string> reply;
+  if(!request(os.str(), reply) || reply.empty()) return false;
+  dacValue = static_cast<uint8_t>(atoi(reply.front().c_str()));
+  return true;
+}
+
+bool pxarClient::setTbmReg(std::string regName, uint8_t regValue) {
+  std::ostringstream os;
+  os << "settbmreg " << regName << " " << static_cast<int>(regValue);
+  std::vector<std::string> reply;
+  return request(os.str(), reply);
+}
+
+std::vector<pixel> pxarClient::getMap(std::string command) {
+
+  std::vector<pixel> pixels;
+  std::vector<std::string> reply;
+  if(!request(command, reply)) return pixels;
+
+  pixels.reserve(reply.size());
+  for(std::vector<std::string>::iterator it = reply.begin(); it != reply.end(); ++it) {
+    std::istringstream is(*it);
+    int roc, col, row;
+    double value;
+    if(is >> roc >> col >> row >> value) {
+      pixels.push_back(pixel(static_cast<uint8_t>(roc), static_cast<uint8_t>(col), static_cast<uint8_t>(row), value));
+    }
+  }
+  return pixels;
+}
+
+std::vector<pixel> pxarClient::getEfficiencyMap(uint16_t flags, uint16_t nTriggers) {
+  std::ostringstream os;
+  os << "efficiencymap " << nTriggers << " " << flags;
+  return getMap(os.str());
+}
+
+std::vector<pixel> pxarClient::getPulseheightMap(uint16_t flags, uint16_t nTriggers) {
+  std::ostringstream os;
+  os << "pulseheightmap " << nTriggers << " " << flags;
+  return getMap(os.str());
+}
+
+bool pxarClient::daqStart() {
+  std::vector<std::string> reply;
+  return request("daqstart", reply);
+}
+
+bool pxarClient::daqStop() {
+  std::vector<std::string> reply;
+  return request("daqstop", reply);
+}
+
+uint16_t pxarClient::daqTrigger(uint32_t nTrig, uint16_t period) {
+  std::ostringstream os;
+  os << "daqtrigger " << nTrig << " " << period;
+  std::vector<std::string> reply;
+  if(!request(os.str(), reply) || reply.empty()) return 0;
+  return static_cast<uint16_t>(atoi(reply.front().c_str()));
+}
+
+uint16_t pxarClient::daqTriggerLoop(uint16_t period) {
+  std::ostringstream os;
+  os << "daqtriggerloop " << period;
+  std::vector<std::string> reply;
+  if(!request(os.str(), reply) || reply.empty()) return 0;
+  return static_cast<uint16_t>(atoi(reply.front().c_str()));
+}
+
+void pxarClient::daqTriggerLoopHalt() {
+  std::vector<std::string> reply;
+  request("daqtriggerloophalt", reply);
+}
+
+std::vector<Event> pxarClient::daqGetEventBuffer() {
+
+  std::vector<Event> events;
+  std::vector<std::string> reply;
+  if(!request("daqgetevents", reply)) return events;
+
+  events.reserve(reply.size());
+  for(std::vector<std::string>::iterator it = reply.begin(); it != reply.end(); ++it) {
+    std::istringstream is(*it);
+    Event evt;
+    is >> evt.header >> evt.trailer;
+    int roc, col, row;
+    double value;
+    while(is >> roc >> col >> row >> value) {
+      evt.pixels.push_back(pixel(static_cast<uint8_t>(roc), static_cast<uint8_t>(col), static_cast<uint8_t>(row), value));
+    }
+    events.push_back(evt);
+  }
+  return events;
+}
+
+std::vector<uint16_t> pxarClient::daqGetBuffer() {
+
+  std::vector<uint16_t> buffer;
+  std::vector<std::string> reply;
+  if(!request("daqgetbuffer", reply)) return buffer;
+
+  for(std::vector<std::string>::iterator it = reply.begin(); it != reply.end(); ++it) {
+    std::istringstream is(*it);
+    unsigned int word;
+    while(is >> std::hex >> word) { buffer.push_back(static_cast<uint16_t>(word)); }
+  }
+  return buffer;
+}
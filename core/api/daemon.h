@@ -0,0 +1,162 @@
+#ifndef PXAR_DAEMON_H
+#define PXAR_DAEMON_H
+
+/** Declare all classes that need to be included in shared libraries on Windows
+ *  as class DLLEXPORT className
+ */
+#include "pxardllexport.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <signal.h>
+#include "datatypes.h"
+
+namespace pxar {
+
+  class pxarCore;
+
+  /** Default location of the daemon socket
+   */
+  const std::string DAEMON_SOCKET = "/tmp/pxard.sock";
+
+  /** Daemon owning a single pxarCore instance (and with it the DTB) which
+   *  serves any number of local clients over a Unix domain socket.
+   *
+   *  The protocol is line based: a client sends one request per line,
+   *  "<command> [arguments]". The daemon answers with "OK <n>" followed by
+   *  n lines of data, or with a single line "ERR <message>". Send "help"
+   *  for the list of commands.
+   *
+   *  All requests are executed one at a time by the thread calling run(),
+   *  in order of arrival, with DAQ commands taking precedence over all
+   *  others. While a client owns a running DAQ session (daqstart), requests
+   *  of other clients which would change the DUT are held back in the queue
+   *  until the session is stopped; read-only requests are still answered.
+   *  All clients share the DUT configuration held by the daemon, a tool
+   *  connecting does not need to initialize or program the DUT again.
+   */
+  class DLLEXPORT pxarDaemon {
+  public:
+    pxarDaemon(pxarCore * api, std::string socket = DAEMON_SOCKET);
+    ~pxarDaemon();
+
+    /** Serve clients until stop() is called, a client sends "shutdown" or
+     *  "stopSignal" becomes non-zero. A signal handler only has to store the
+     *  signal number there, run() notices it within 200 ms and logs it.
+     *  Returns false if the socket could not be created.
+     */
+    bool run(volatile sig_atomic_t * stopSignal = NULL);
+
+    /** Make run() return after the current request
+     */
+    void stop() { _running = 0; };
+
+  private:
+    struct client {
+      std::string name;
+      std::string input;
+      std::string output;
+    };
+
+    struct request {
+      int fd;
+      std::string command;
+      std::vector<std::string> args;
+    };
+
+    bool listen();
+    void accept();
+    bool receive(int fd);
+    void drop(int fd);
+
+    /** Pick the next request which may be executed now, returns false if
+     *  all queued requests have to wait
+     */
+    bool next(request & req);
+
+    /** Execute a request and send the reply to its client
+     */
+    void execute(const request & req);
+    bool dispatch(const request & req, std::vector<std::string> & reply);
+
+    /** Queue data for a client, it is sent as far as the socket accepts
+     *  it right away and the rest by flush() from the poll loop, a slow
+     *  client never blocks the daemon
+     */
+    void send(int fd, const std::string & data);
+
+    /** Send as much of the queued output of a client as possible without
+     *  blocking, returns false if the client has to be dropped
+     */
+    bool flush(int fd);
+
+    static bool isDaqCommand(const std::string & command);
+    static bool isReadOnly(const std::string & command);
+
+    pxarCore * _api;
+    std::string _socket;
+    int _listenfd;
+    volatile sig_atomic_t _running;
+    std::map<int, client> _clients;
+    std::deque<request> _queue;
+
+    /** Client owning the running DAQ session, -1 if none
+     */
+    int _daq_owner;
+    uint64_t _served;
+  };
+
+  /** Client side of the pxar daemon, a thin wrapper around the line based
+   *  protocol which provides the subset of the pxarCore API served.
+   */
+  class DLLEXPORT pxarClient {
+  public:
+    pxarClient();
+    ~pxarClient();
+
+    /** Connect to the daemon listening on "socket", "name" is shown in the
+     *  daemon status
+     */
+    bool connect(std::string socket = DAEMON_SOCKET, std::string name = "");
+    void disconnect();
+    bool connected() const { return _fd >= 0; };
+
+    /** Send a request line and wait for the reply. The data lines of the
+     *  reply are returned in "reply". Returns false if the daemon answered
+     *  with an error, see lastError().
+     */
+    bool request(std::string command, std::vector<std::string> & reply);
+
+    /** Error message of the last failed request
+     */
+    std::string lastError() const { return _error; };
+
+    bool setDAC(std::string dacName, uint8_t dacValue, uint8_t rocId);
+    bool setDAC(std::string dacName, uint8_t dacValue);
+    bool getDAC(std::string dacName, uint8_t rocId, uint8_t & dacValue);
+    bool setTbmReg(std::string regName, uint8_t regValue);
+    std::vector<pixel> getEfficiencyMap(uint16_t flags, uint16_t nTriggers);
+    std::vector<pixel> getPulseheightMap(uint16_t flags, uint16_t nTriggers);
+
+    bool daqStart();
+    bool daqStop();
+    uint16_t daqTrigger(uint32_t nTrig = 1, uint16_t period = 0);
+    uint16_t daqTriggerLoop(uint16_t period = 1000);
+    void daqTriggerLoopHalt();
+    std::vector<Event> daqGetEventBuffer();
+    std::vector<uint16_t> daqGetBuffer();
+
+  private:
+    bool readLine(std::string & line);
+    std::vector<pixel> getMap(std::string command);
+
+    int _fd;
+    std::string _input;
+    std::string _error;
+  };
+
+} //namespace pxar
+
+#endif /* PXAR_DAEMON_H */
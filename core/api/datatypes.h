@@ -184,6 +184,102 @@ namespace pxar {
     }
   };
 
+  /** Class for storing decoded pixel hits in a compact 4-byte format
+   *
+   *  The ROC id (4 bits), column (6 bits), row (7 bits) and a signed value
+   *  (15 bits) are packed into one 32bit word. No variance is stored, which
+   *  makes this type suited for raw hit data where the variance is always
+   *  zero. Conversion from and to pxar::pixel is lossless for ROC ids up to
+   *  15 and values in the range [-16384,16383], the value is truncated to
+   *  integer precision as in pxar::pixel.
+   */
+  class DLLEXPORT packedPixel {
+  public:
+
+    /** Default constructor, all fields zero
+     */
+  packedPixel() : _data(0) {}
+
+    /** Constructor for packed pixels with address and value initialization.
+     */
+  packedPixel(uint8_t roc_id, uint8_t column, uint8_t row, double value) : _data(0) { pack(roc_id, column, row, value); }
+
+    /** Conversion constructor from a pxar::pixel, the variance is dropped.
+     */
+    explicit packedPixel(pixel px) : _data(0) { pack(px.roc(), px.column(), px.row(), px.value()); }
+
+    /** Conversion to a full pxar::pixel object
+     */
+    pixel unpack() const { return pixel(roc(), column(), row(), value()); }
+
+    /** Getter function to return ROC ID
+     */
+    uint8_t roc() const { return static_cast<uint8_t>((_data >> 28) & 0xf); };
+
+    /** Getter function to return column id
+     */
+    uint8_t column() const { return static_cast<uint8_t>((_data >> 22) & 0x3f); };
+
+    /** Getter function to return row id
+     */
+    uint8_t row() const { return static_cast<uint8_t>((_data >> 15) & 0x7f); };
+
+    /** Member function to get the value stored for this pixel hit
+     */
+    double value() const {
+      // Restore the sign of the 15bit value:
+      int32_t val = static_cast<int32_t>(_data & 0x7fff);
+      if(val & 0x4000) { val -= 0x8000; }
+      return static_cast<double>(val);
+    };
+
+    /** Member function to set the value stored for this pixel hit
+     */
+    void setValue(double val) { pack(roc(), column(), row(), val); };
+
+    /** Return the packed 32bit word
+     */
+    uint32_t raw() const { return _data; };
+
+    /** Overloaded comparison operator
+     */
+    bool operator == (const packedPixel& px) const {
+      return ((_data >> 15) == (px.raw() >> 15));
+    }
+
+    /** Overloaded < operator, sorting by ROC->column->row
+     */
+    bool operator < (const packedPixel& px) const {
+      return ((_data >> 15) < (px.raw() >> 15));
+    }
+
+  private:
+    /** Packed data word: roc[31:28] col[27:22] row[21:15] value[14:0]
+     */
+    uint32_t _data;
+
+    /** Helper to fill all bit fields of the data word
+     */
+    void pack(uint8_t roc_id, uint8_t column, uint8_t row, double value) {
+      int32_t val = static_cast<int32_t>(value);
+      if(val > 16383) { val = 16383; }
+      else if(val < -16384) { val = -16384; }
+      _data = (static_cast<uint32_t>(roc_id & 0xf) << 28)
+	| (static_cast<uint32_t>(column & 0x3f) << 22)
+	| (static_cast<uint32_t>(row & 0x7f) << 15)
+	| (static_cast<uint32_t>(val) & 0x7fff);
+    }
+
+    /** Overloaded ostream operator for simple printing of pixel data
+     */
+    friend std::ostream & operator<<(std::ostream &out, const packedPixel& px) {
+      out << "ROC " << static_cast<int>(px.roc())
+	  << " [" << static_cast<int>(px.column()) << "," << static_cast<int>(px.row()) 
+	  << "," << static_cast<double>(px.value()) << "]";
+      return out;
+    }
+  };
+
   /** Class to store Events containing a header and a std::vector of pixels
    */
   class DLLEXPORT Event {
@@ -304,6 +400,51 @@ namespace pxar {
   };
 
 
+  /** Compact version of pxar::Event storing the pixel hits as pxar::packedPixel
+   *
+   *  Used for buffered high-rate readout where many events have to be held in
+   *  memory. Header and trailer are kept as in pxar::Event and can be evaluated
+   *  after unpacking.
+   */
+  class DLLEXPORT packedEvent {
+  public:
+  packedEvent() : header(0), trailer(0), pixels() {}
+
+    /** Conversion constructor from a pxar::Event, pixel variances are dropped.
+     */
+    explicit packedEvent(const Event & evt) : header(evt.header), trailer(evt.trailer), pixels() {
+      pixels.reserve(evt.pixels.size());
+      for(std::vector<pixel>::const_iterator it = evt.pixels.begin(); it != evt.pixels.end(); ++it) {
+	pixels.push_back(packedPixel(*it));
+      }
+    }
+
+    /** Conversion to a full pxar::Event object
+     */
+    Event unpack() const {
+      Event evt;
+      evt.header = header;
+      evt.trailer = trailer;
+      evt.pixels.reserve(pixels.size());
+      for(std::vector<packedPixel>::const_iterator it = pixels.begin(); it != pixels.end(); ++it) {
+	evt.pixels.push_back(it->unpack());
+      }
+      return evt;
+    }
+
+    /** TBM Header
+     */
+    uint16_t header;
+
+    /** TBM Trailer
+     */
+    uint16_t trailer;
+
+    /** Vector of packed pixel hits
+     */
+    std::vector<packedPixel> pixels;
+  };
+
   /** Class to store raw evet data records containing a list of flags to indicate the 
    *  Event status as well as a vector of uint16_t data records containing the actual
    *  Event data in undecoded raw format.
@@ -348,6 +348,15 @@ uint8_t dut::getDAC(size_t rocId, std::string dacName) {
   return 0x0;
 }
 
+uint8_t dut::getDAC(size_t rocId, const dacHandle & dac) {
+
+  if(status() && rocId < roc.size() && dac.valid()) {
+    return roc[rocId].dacs[dac.id()];
+  }
+  throw InvalidConfig("Could not identify DAC " + dac.name());
+  return 0x0;
+}
+
 std::vector< std::pair<std::string,uint8_t> > dut::getDACs(size_t rocId) {
 
   if(status() && rocId < roc.size()) {
@@ -0,0 +1,400 @@
+/**
+ * pxar shared memory event ring implementation
+ */
+
+#include "eventring.h"
+#include "log.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#ifndef WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace pxar;
+
+// Full memory barrier, orders the slot sequence numbers against the payload:
+static inline void ringBarrier() { __sync_synchronize(); }
+
+static size_t ringSize(uint32_t nslots, uint32_t slotsize) {
+  return sizeof(ringHeader) + static_cast<size_t>(nslots)*slotsize;
+}
+
+static ringSlot * ringGetSlot(const ringHeader * header, uint64_t n) {
+  uint8_t * base = reinterpret_cast<uint8_t*>(const_cast<ringHeader*>(header)) + sizeof(ringHeader);
+  return reinterpret_cast<ringSlot*>(base + (n % header->nslots)*header->slotsize);
+}
+
+bool ringRecord::getEvent(Event & evt) const {
+  if(type != RING_EVENT || payload.size() < 4) return false;
+
+  evt.Clear();
+  std::memcpy(&evt.header, &payload[0], sizeof(uint16_t));
+  std::memcpy(&evt.trailer, &payload[2], sizeof(uint16_t));
+  size_t npix = (payload.size() - 4)/sizeof(uint32_t);
+  evt.pixels.reserve(npix);
+  for(size_t i = 0; i < npix; i++) {
+    uint32_t word;
+    std::memcpy(&word, &payload[4 + i*sizeof(uint32_t)], sizeof(uint32_t));
+    // Same layout as pxar::packedPixel, roc[31:28] col[27:22] row[21:15] value[14:0]:
+    int32_t value = static_cast<int32_t>(word & 0x7fff);
+    if(value & 0x4000) { value -= 0x8000; }
+    evt.pixels.push_back(pixel(static_cast<uint8_t>((word >> 28) & 0xf),
+			       static_cast<uint8_t>((word >> 22) & 0x3f),
+			       static_cast<uint8_t>((word >> 15) & 0x7f),
+			       static_cast<double>(value)));
+  }
+  return true;
+}
+
+bool ringRecord::getRawEvent(rawEvent & evt) const {
+  if(type != RING_RAWEVENT || payload.size() < 4) return false;
+
+  evt.Clear();
+  uint32_t rflags;
+  std::memcpy(&rflags, &payload[0], sizeof(uint32_t));
+  if(rflags & 1) evt.SetStartError();
+  if(rflags & 2) evt.SetEndError();
+  if(rflags & 4) evt.SetOverflow();
+  evt.data.resize((payload.size() - 4)/sizeof(uint16_t));
+  if(!evt.data.empty()) std::memcpy(&evt.data[0], &payload[4], evt.data.size()*sizeof(uint16_t));
+  return true;
+}
+
+bool ringRecord::getRawBlock(std::vector<uint16_t> & block) const {
+  if(type != RING_RAWBLOCK) return false;
+
+  block.resize(payload.size()/sizeof(uint16_t));
+  if(!block.empty()) std::memcpy(&block[0], &payload[0], block.size()*sizeof(uint16_t));
+  return true;
+}
+
+eventRing::eventRing() : _name(), _header(NULL), _size(0) {}
+
+eventRing::~eventRing() {
+  destroy();
+}
+
+#ifndef WIN32
+
+bool eventRing::create(std::string name, uint32_t nslots, uint32_t slotsize) {
+
+  destroy();
+
+  if(name.empty() || name[0] != '/') { name = "/" + name; }
+  if(nslots == 0 || slotsize < sizeof(ringSlot) + 8) {
+    LOG(logERROR) << "Invalid event ring geometry: " << nslots << " slots of " << slotsize << " bytes.";
+    return false;
+  }
+  // Keep the slots 8-byte aligned for the sequence numbers:
+  slotsize = (slotsize + 7) & ~static_cast<uint32_t>(7);
+
+  // Remove a segment left over by a previous writer, readers still attached to it
+  // keep their mapping:
+  shm_unlink(name.c_str());
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if(fd < 0) {
+    LOG(logERROR) << "Could not create shared memory segment " << name << ": " << std::strerror(errno);
+    return false;
+  }
+
+  size_t size = ringSize(nslots, slotsize);
+  if(ftruncate(fd, static_cast<off_t>(size)) != 0) {
+    LOG(logERROR) << "Could not allocate " << size << " bytes of shared memory: " << std::strerror(errno);
+    close(fd);
+    shm_unlink(name.c_str());
+    return false;
+  }
+
+  void * mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(mem == MAP_FAILED) {
+    LOG(logERROR) << "Could not map shared memory segment " << name << ": " << std::strerror(errno);
+    shm_unlink(name.c_str());
+    return false;
+  }
+
+  // The segment is zero-filled, i.e. all slots are marked empty:
+  _header = static_cast<ringHeader*>(mem);
+  _header->version = RING_VERSION;
+  _header->nslots = nslots;
+  _header->slotsize = slotsize;
+  _header->head = 0;
+  // Unique per creation, also for rings re-created within the same microsecond:
+  static uint32_t ncreated = 0;
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  _header->generation = (static_cast<uint64_t>(tv.tv_sec)*1000000 + static_cast<uint64_t>(tv.tv_usec))*1024 + (ncreated++ % 1024);
+  ringBarrier();
+  // Readers check the magic word last:
+  _header->magic = RING_MAGIC;
+  ringBarrier();
+
+  _name = name;
+  _size = size;
+  LOG(logINFO) << "Publishing DAQ data to shared memory ring " << _name << " ("
+	       << nslots << " slots of " << slotsize << " bytes).";
+  return true;
+}
+
+void eventRing::destroy() {
+
+  if(!_header) return;
+
+  // Tell attached readers that this ring is gone:
+  _header->magic = 0;
+  ringBarrier();
+  munmap(_header, _size);
+  shm_unlink(_name.c_str());
+  LOG(logDEBUGAPI) << "Removed shared memory ring " << _name;
+
+  _header = NULL;
+  _size = 0;
+  _name.clear();
+}
+
+#else
+
+bool eventRing::create(std::string, uint32_t, uint32_t) {
+  LOG(logERROR) << "Shared memory event ring not supported on this platform.";
+  return false;
+}
+
+void eventRing::destroy() {}
+
+#endif
+
+uint8_t * eventRing::reserve(uint16_t type, uint16_t flags, uint32_t length) {
+
+  ringSlot * slot = ringGetSlot(_header, _header->head);
+
+  // Invalidate the slot before touching the payload:
+  slot->seq = 0;
+  ringBarrier();
+  slot->type = type;
+  slot->flags = flags;
+  slot->length = length;
+  return reinterpret_cast<uint8_t*>(slot) + sizeof(ringSlot);
+}
+
+void eventRing::commit() {
+
+  uint64_t n = _header->head;
+  ringSlot * slot = ringGetSlot(_header, n);
+  ringBarrier();
+  slot->seq = n + 1;
+  ringBarrier();
+  _header->head = n + 1;
+}
+
+void eventRing::publish(const Event & evt) {
+
+  if(!_header) return;
+
+  uint32_t maxpix = static_cast<uint32_t>((_header->slotsize - sizeof(ringSlot) - 4)/sizeof(uint32_t));
+  uint32_t npix = static_cast<uint32_t>(evt.pixels.size());
+  uint16_t flags = 0;
+  if(npix > maxpix) { npix = maxpix; flags |= RING_TRUNCATED; }
+
+  uint8_t * p = reserve(RING_EVENT, flags, 4 + npix*sizeof(uint32_t));
+  std::memcpy(p, &evt.header, sizeof(uint16_t));
+  std::memcpy(p + 2, &evt.trailer, sizeof(uint16_t));
+  p += 4;
+  for(uint32_t i = 0; i < npix; i++) {
+    uint32_t word = packedPixel(evt.pixels[i]).raw();
+    std::memcpy(p, &word, sizeof(uint32_t));
+    p += sizeof(uint32_t);
+  }
+  commit();
+}
+
+void eventRing::publish(const packedEvent & evt) {
+
+  if(!_header) return;
+
+  uint32_t maxpix = static_cast<uint32_t>((_header->slotsize - sizeof(ringSlot) - 4)/sizeof(uint32_t));
+  uint32_t npix = static_cast<uint32_t>(evt.pixels.size());
+  uint16_t flags = 0;
+  if(npix > maxpix) { npix = maxpix; flags |= RING_TRUNCATED; }
+
+  uint8_t * p = reserve(RING_EVENT, flags, 4 + npix*sizeof(uint32_t));
+  std::memcpy(p, &evt.header, sizeof(uint16_t));
+  std::memcpy(p + 2, &evt.trailer, sizeof(uint16_t));
+  p += 4;
+  for(uint32_t i = 0; i < npix; i++) {
+    uint32_t word = evt.pixels[i].raw();
+    std::memcpy(p, &word, sizeof(uint32_t));
+    p += sizeof(uint32_t);
+  }
+  commit();
+}
+
+void eventRing::publish(rawEvent & evt) {
+
+  if(!_header) return;
+
+  uint32_t maxwords = static_cast<uint32_t>((_header->slotsize - sizeof(ringSlot) - 4)/sizeof(uint16_t));
+  uint32_t nwords = static_cast<uint32_t>(evt.data.size());
+  uint16_t flags = 0;
+  if(nwords > maxwords) { nwords = maxwords; flags |= RING_TRUNCATED; }
+
+  uint32_t rflags = (evt.IsStartError() ? 1 : 0) | (evt.IsEndError() ? 2 : 0) | (evt.IsOverflow() ? 4 : 0);
+  uint8_t * p = reserve(RING_RAWEVENT, flags, 4 + nwords*sizeof(uint16_t));
+  std::memcpy(p, &rflags, sizeof(uint32_t));
+  if(nwords > 0) std::memcpy(p + 4, &evt.data[0], nwords*sizeof(uint16_t));
+  commit();
+}
+
+void eventRing::publish(const std::vector<uint16_t> & block) {
+
+  if(!_header) return;
+
+  size_t maxwords = (_header->slotsize - sizeof(ringSlot))/sizeof(uint16_t);
+  for(size_t offset = 0; offset < block.size(); offset += maxwords) {
+    size_t nwords = std::min(maxwords, block.size() - offset);
+    uint8_t * p = reserve(RING_RAWBLOCK, 0, static_cast<uint32_t>(nwords*sizeof(uint16_t)));
+    std::memcpy(p, &block[offset], nwords*sizeof(uint16_t));
+    commit();
+  }
+}
+
+eventRingReader::eventRingReader() : _name(), _header(NULL), _size(0), _generation(0), _next(0), _lost(0) {}
+
+eventRingReader::~eventRingReader() {
+  detach();
+}
+
+#ifndef WIN32
+
+bool eventRingReader::attach(std::string name, bool fromOldest) {
+
+  detach();
+
+  if(name.empty() || name[0] != '/') { name = "/" + name; }
+  int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if(fd < 0) {
+    LOG(logERROR) << "Could not open shared memory segment " << name << ": " << std::strerror(errno);
+    return false;
+  }
+
+  struct stat st;
+  if(fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(ringHeader)) {
+    LOG(logERROR) << "Shared memory segment " << name << " is not a pxar event ring.";
+    close(fd);
+    return false;
+  }
+
+  void * mem = mmap(NULL, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(mem == MAP_FAILED) {
+    LOG(logERROR) << "Could not map shared memory segment " << name << ": " << std::strerror(errno);
+    return false;
+  }
+
+  const ringHeader * header = static_cast<const ringHeader*>(mem);
+  ringBarrier();
+  if(header->magic != RING_MAGIC || header->version != RING_VERSION
+     || ringSize(header->nslots, header->slotsize) > static_cast<size_t>(st.st_size)) {
+    LOG(logERROR) << "Shared memory segment " << name << " is not a pxar event ring (version " << RING_VERSION << ").";
+    munmap(mem, static_cast<size_t>(st.st_size));
+    return false;
+  }
+
+  _name = name;
+  _header = header;
+  _size = static_cast<size_t>(st.st_size);
+  _generation = header->generation;
+  _next = header->head;
+  if(fromOldest) { _next = (_next > header->nslots) ? _next - header->nslots : 0; }
+  _lost = 0;
+  LOG(logDEBUGAPI) << "Attached to shared memory ring " << _name << " at record " << _next;
+  return true;
+}
+
+void eventRingReader::detach() {
+  if(!_header) return;
+  munmap(const_cast<ringHeader*>(_header), _size);
+  _header = NULL;
+  _size = 0;
+}
+
+bool eventRingReader::stale() const {
+
+  if(!_header) return true;
+  if(_header->magic != RING_MAGIC) return true;
+
+  // The writer might have replaced the segment without us noticing:
+  int fd = shm_open(_name.c_str(), O_RDONLY, 0);
+  if(fd < 0) return true;
+  void * mem = mmap(NULL, sizeof(ringHeader), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(mem == MAP_FAILED) return true;
+  bool stale = (static_cast<const ringHeader*>(mem)->generation != _generation);
+  munmap(mem, sizeof(ringHeader));
+  return stale;
+}
+
+#else
+
+bool eventRingReader::attach(std::string, bool) {
+  LOG(logERROR) << "Shared memory event ring not supported on this platform.";
+  return false;
+}
+
+void eventRingReader::detach() {}
+
+bool eventRingReader::stale() const { return true; }
+
+#endif
+
+bool eventRingReader::next(ringRecord & record) {
+
+  if(!_header) return false;
+
+  while(true) {
+    uint64_t head = _header->head;
+    ringBarrier();
+    if(_next >= head) return false;
+
+    // The writer has overtaken us, skip to the oldest record still available:
+    if(head - _next > _header->nslots) {
+      _lost += head - _header->nslots - _next;
+      _next = head - _header->nslots;
+    }
+
+    const ringSlot * slot = ringGetSlot(_header, _next);
+    uint64_t seq = slot->seq;
+    ringBarrier();
+    if(seq != _next + 1) {
+      // Slot is being rewritten right now, the record is gone:
+      _lost++;
+      _next++;
+      continue;
+    }
+
+    record.seq = _next;
+    record.type = slot->type;
+    record.flags = slot->flags;
+    uint32_t length = slot->length;
+    if(length > _header->slotsize - sizeof(ringSlot)) { length = 0; }
+    record.payload.resize(length);
+    if(length > 0) std::memcpy(&record.payload[0], reinterpret_cast<const uint8_t*>(slot) + sizeof(ringSlot), length);
+
+    // Check that the writer did not touch the slot while copying:
+    ringBarrier();
+    if(slot->seq != seq) {
+      _lost++;
+      _next++;
+      continue;
+    }
+
+    _next++;
+    return true;
+  }
+}
@@ -0,0 +1,193 @@
+#ifndef PXAR_EVENTRING_H
+#define PXAR_EVENTRING_H
+
+/** Declare all classes that need to be included in shared libraries on Windows
+ *  as class DLLEXPORT className
+ */
+#include "pxardllexport.h"
+
+#include <string>
+#include <vector>
+#include "datatypes.h"
+
+namespace pxar {
+
+  /** Record types published to the shared memory event ring
+   */
+  enum ringRecordType {
+    RING_EVENT = 1,    ///< decoded pxar::Event: header, trailer (uint16_t), then pxar::packedPixel words (uint32_t)
+    RING_RAWEVENT = 2, ///< pxar::rawEvent: flags (uint32_t), then raw data words (uint16_t)
+    RING_RAWBLOCK = 3  ///< raw DTB buffer as returned by pxarCore::daqGetBuffer(), uint16_t words
+  };
+
+  /** Record flag: the payload did not fit into one slot and has been truncated.
+   *  Raw blocks are split into several consecutive records instead.
+   */
+  const uint16_t RING_TRUNCATED = 0x1;
+
+  /** Header at the beginning of the shared memory segment
+   *
+   *  The segment consists of this header (64 bytes) followed by "nslots"
+   *  slots of "slotsize" bytes, each starting with a pxar::ringSlot.
+   *  Record number n is stored in slot n % nslots, "head" is the number of
+   *  records published so far. All fields are stored in host byte order.
+   */
+  struct ringHeader {
+    uint32_t magic;           ///< RING_MAGIC
+    uint32_t version;         ///< RING_VERSION
+    uint32_t nslots;          ///< number of slots in the ring
+    uint32_t slotsize;        ///< size of a slot in bytes, including the pxar::ringSlot header
+    volatile uint64_t head;   ///< number of records published, i.e. sequence number of the next record
+    uint64_t generation;      ///< changes whenever the ring is re-created by a writer
+    uint32_t reserved[8];
+  };
+
+  /** Header of each slot, followed by "length" bytes of payload
+   *
+   *  While a record is being written, "seq" is zero. Once complete it holds
+   *  the record number plus one. Readers check "seq" before and after copying
+   *  a record to detect that the writer overtook them (seqlock).
+   */
+  struct ringSlot {
+    volatile uint64_t seq;
+    uint16_t type;
+    uint16_t flags;
+    uint32_t length;
+  };
+
+  const uint32_t RING_MAGIC = 0x47525850; // "PXRG"
+  const uint32_t RING_VERSION = 1;
+
+  /** Record read back from the event ring by a pxar::eventRingReader
+   */
+  class DLLEXPORT ringRecord {
+  public:
+  ringRecord() : seq(0), type(0), flags(0), payload() {}
+
+    /** Decode a RING_EVENT record into a pxar::Event, returns false for other record types
+     */
+    bool getEvent(Event & evt) const;
+
+    /** Decode a RING_RAWEVENT record into a pxar::rawEvent, returns false for other record types
+     */
+    bool getRawEvent(rawEvent & evt) const;
+
+    /** Decode a RING_RAWBLOCK record into the raw data words, returns false for other record types
+     */
+    bool getRawBlock(std::vector<uint16_t> & block) const;
+
+    uint64_t seq;
+    uint16_t type;
+    uint16_t flags;
+    std::vector<uint8_t> payload;
+  };
+
+  /** Writer side of a POSIX shared memory ring buffer for DAQ data
+   *
+   *  There is exactly one writer (the pxarCore instance) which never waits
+   *  for readers: slots are overwritten in a circular manner, readers that
+   *  fall behind by more than the ring size lose records. Publishing an
+   *  event costs one memcpy into the mapped segment and a few memory
+   *  barriers, no locks or system calls are involved.
+   */
+  class DLLEXPORT eventRing {
+  public:
+    eventRing();
+    ~eventRing();
+
+    /** Create (or re-create) the shared memory segment "name" (e.g. "/pxar")
+     *  with "nslots" slots of "slotsize" bytes. Returns false on failure.
+     */
+    bool create(std::string name, uint32_t nslots, uint32_t slotsize);
+
+    /** Unmap and remove the shared memory segment. Attached readers keep
+     *  their mapping but will not see any new records.
+     */
+    void destroy();
+
+    /** Returns true if the ring has been created successfully
+     */
+    bool active() const { return _header != NULL; };
+
+    /** Publish a decoded event, the pixels are stored as pxar::packedPixel
+     */
+    void publish(const Event & evt);
+
+    /** Publish a decoded event record from a pxar::packedEvent
+     */
+    void publish(const packedEvent & evt);
+
+    /** Publish a raw event record
+     */
+    void publish(rawEvent & evt);
+
+    /** Publish a raw data block, split into several records if needed
+     */
+    void publish(const std::vector<uint16_t> & block);
+
+    /** Number of records published since the ring was created
+     */
+    uint64_t published() const { return _header ? _header->head : 0; };
+
+  private:
+    /** Returns a pointer to the payload of the next slot. The slot is
+     *  marked as being written until commit() is called.
+     */
+    uint8_t * reserve(uint16_t type, uint16_t flags, uint32_t length);
+    void commit();
+
+    std::string _name;
+    ringHeader * _header;
+    size_t _size;
+  };
+
+  /** Read-only reader of the shared memory event ring
+   *
+   *  Any number of readers in independent processes can attach to the ring,
+   *  they never modify the segment and do not influence the writer.
+   */
+  class DLLEXPORT eventRingReader {
+  public:
+    eventRingReader();
+    ~eventRingReader();
+
+    /** Attach to the shared memory segment "name". Reading starts with the
+     *  next record published, unless "fromOldest" is set, in which case all
+     *  records still held in the ring are returned first.
+     */
+    bool attach(std::string name, bool fromOldest = false);
+
+    /** Unmap the shared memory segment
+     */
+    void detach();
+
+    /** Returns true if attached to a ring
+     */
+    bool attached() const { return _header != NULL; };
+
+    /** Fetch the next record. Returns false if no new record is available,
+     *  never blocks.
+     */
+    bool next(ringRecord & record);
+
+    /** Number of records lost because the writer overtook this reader
+     */
+    uint64_t lost() const { return _lost; };
+
+    /** Returns true if the writer re-created the ring since attaching;
+     *  the reader has to attach again to see new records.
+     */
+    bool stale() const;
+
+  private:
+    std::string _name;
+    const ringHeader * _header;
+    size_t _size;
+    uint64_t _generation;
+    uint64_t _next;
+    uint64_t _lost;
+  };
+
+} //namespace pxar
+
+#endif /* PXAR_EVENTRING_H */
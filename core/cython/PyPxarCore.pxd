@@ -203,9 +203,14 @@ cdef extern from "api.h" namespace "pxar":
         vector[pair[uint8_t, vector[pixel]]] getThresholdVsDAC(string dac1Name, uint8_t dac1Step, uint8_t dac1Min, uint8_t dac1Max, string dac2Name, uint8_t dac2Step, uint8_t dac2Min, uint8_t dac2Max, uint8_t threshold, uint16_t flags, uint16_t nTriggers) except +
         vector[pair[uint8_t, pair[uint8_t, vector[pixel]]]] getPulseheightVsDACDAC(string dac1name, uint8_t dac1Step, uint8_t dac1min, uint8_t dac1max, string dac2name, uint8_t dac2Step, uint8_t dac2min, uint8_t dac2max, uint16_t flags, uint16_t nTriggers) except +
         vector[pair[uint8_t, pair[uint8_t, vector[pixel]]]] getEfficiencyVsDACDAC(string dac1name, uint8_t dac1Step, uint8_t dac1min, uint8_t dac1max, string dac2name, uint8_t dac2Step, uint8_t dac2min, uint8_t dac2max, uint16_t flags, uint16_t nTriggers) except +
+        vector[pair[uint8_t, pair[uint8_t, pair[uint8_t, vector[pixel]]]]] getPulseheightVsDACDACDAC(string dac1name, uint8_t dac1Step, uint8_t dac1min, uint8_t dac1max, string dac2name, uint8_t dac2Step, uint8_t dac2min, uint8_t dac2max, string dac3name, uint8_t dac3Step, uint8_t dac3min, uint8_t dac3max, uint16_t flags, uint16_t nTriggers) except +
+        vector[pair[uint8_t, pair[uint8_t, pair[uint8_t, vector[pixel]]]]] getEfficiencyVsDACDACDAC(string dac1name, uint8_t dac1Step, uint8_t dac1min, uint8_t dac1max, string dac2name, uint8_t dac2Step, uint8_t dac2min, uint8_t dac2max, string dac3name, uint8_t dac3Step, uint8_t dac3min, uint8_t dac3max, uint16_t flags, uint16_t nTriggers) except +
+        vector[pair[uint8_t, vector[pixel]]] getPulseheightVsDACList(string dacName, vector[uint8_t] dacValues, string switchName, vector[uint8_t] switchValues, uint16_t flags, uint16_t nTriggers) except +
+        vector[pair[uint8_t, vector[pixel]]] getEfficiencyVsDACList(string dacName, vector[uint8_t] dacValues, string switchName, vector[uint8_t] switchValues, uint16_t flags, uint16_t nTriggers) except +
         vector[pixel] getPulseheightMap(uint16_t flags, uint16_t nTriggers) except +
         vector[pixel] getEfficiencyMap(uint16_t flags, uint16_t nTriggers) except +
         vector[pixel] getThresholdMap(string dacName, uint8_t dacStep, uint8_t dacMin, uint8_t dacMax, uint8_t threshold, uint16_t flags, uint16_t nTriggers) except +
+        vector[pair[uint8_t, vector[pixel]]] getThresholdMaps(string dacName, uint8_t dacStep, uint8_t dacMin, uint8_t dacMax, vector[uint8_t] thresholds, uint16_t flags, uint16_t nTriggers) except +
         int32_t getReadbackValue(string parameterName) except +
         bool setExternalClock(bool enable) except +
         void setClockStretch(uint8_t src, uint16_t delay, uint16_t width) except +
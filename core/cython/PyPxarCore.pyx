@@ -492,6 +492,68 @@ cdef class PyPxarCore:
             dac_steps.append(pixels)
         return numpy.array(dac_steps)
 
+    def getEfficiencyVsDACDACDAC(self, string dac1name, uint8_t dac1step, uint8_t dac1min, uint8_t dac1max, string dac2name, uint8_t dac2step, uint8_t dac2min, uint8_t dac2max, string dac3name, uint8_t dac3step, uint8_t dac3min, uint8_t dac3max, uint16_t flags = 0, uint32_t nTriggers=16):
+        cdef vector[pair[uint8_t, pair[uint8_t, pair[uint8_t, vector[pixel]]]]] r
+        r = self.thisptr.getEfficiencyVsDACDACDAC(dac1name, dac1step, dac1min, dac1max, dac2name, dac2step, dac2min, dac2max, dac3name, dac3step, dac3min, dac3max, flags, nTriggers)
+        # Return the linearized matrix with all pixels, DAC3 running fastest:
+        dac_steps = list()
+        for d in xrange(r.size()):
+            pixels = list()
+            for pix in xrange(r[d].second.second.second.size()):
+                p = r[d].second.second.second[pix]
+                px = Pixel()
+                px.fill(p)
+                pixels.append(px)
+            dac_steps.append(pixels)
+        return numpy.array(dac_steps)
+
+    def getPulseheightVsDACDACDAC(self, string dac1name, uint8_t dac1step, uint8_t dac1min, uint8_t dac1max, string dac2name, uint8_t dac2step, uint8_t dac2min, uint8_t dac2max, string dac3name, uint8_t dac3step, uint8_t dac3min, uint8_t dac3max, uint16_t flags = 0, uint32_t nTriggers=16):
+        cdef vector[pair[uint8_t, pair[uint8_t, pair[uint8_t, vector[pixel]]]]] r
+        r = self.thisptr.getPulseheightVsDACDACDAC(dac1name, dac1step, dac1min, dac1max, dac2name, dac2step, dac2min, dac2max, dac3name, dac3step, dac3min, dac3max, flags, nTriggers)
+        # Return the linearized matrix with all pixels, DAC3 running fastest:
+        dac_steps = list()
+        for d in xrange(r.size()):
+            pixels = list()
+            for pix in xrange(r[d].second.second.second.size()):
+                p = r[d].second.second.second[pix]
+                px = Pixel()
+                px.fill(p)
+                pixels.append(px)
+            dac_steps.append(pixels)
+        return numpy.array(dac_steps)
+
+    def getEfficiencyVsDACList(self, string dacName, dacValues, string switchName = "", switchValues = [], uint16_t flags = 0, uint32_t nTriggers=16):
+        cdef vector[pair[uint8_t, vector[pixel]]] r
+        cdef vector[uint8_t] dacs = dacValues
+        cdef vector[uint8_t] switches = switchValues
+        r = self.thisptr.getEfficiencyVsDACList(dacName, dacs, switchName, switches, flags, nTriggers)
+        dac_steps = list()
+        for d in xrange(r.size()):
+            pixels = list()
+            for pix in range(r[d].second.size()):
+                p = r[d].second[pix]
+                px = Pixel()
+                px.fill(p)
+                pixels.append(px)
+            dac_steps.append(pixels)
+        return numpy.array(dac_steps)
+
+    def getPulseheightVsDACList(self, string dacName, dacValues, string switchName = "", switchValues = [], uint16_t flags = 0, uint32_t nTriggers=16):
+        cdef vector[pair[uint8_t, vector[pixel]]] r
+        cdef vector[uint8_t] dacs = dacValues
+        cdef vector[uint8_t] switches = switchValues
+        r = self.thisptr.getPulseheightVsDACList(dacName, dacs, switchName, switches, flags, nTriggers)
+        dac_steps = list()
+        for d in xrange(r.size()):
+            pixels = list()
+            for pix in range(r[d].second.size()):
+                p = r[d].second[pix]
+                px = Pixel()
+                px.fill(p)
+                pixels.append(px)
+            dac_steps.append(pixels)
+        return numpy.array(dac_steps)
+
     def getPulseheightMap(self, int flags, int nTriggers):
         cdef vector[pixel] r
         r = self.thisptr.getPulseheightMap(flags, nTriggers)
@@ -522,6 +584,24 @@ cdef class PyPxarCore:
             pixels.append(px)
         return pixels
 
+    def getThresholdMaps(self, string dacName, uint8_t dacStep, uint8_t dacMin, uint8_t dacMax, thresholds, int flags, int nTriggers):
+        cdef vector[uint8_t] levels
+        cdef vector[pair[uint8_t, vector[pixel]]] r
+        for t in thresholds:
+            levels.push_back(t)
+        r = self.thisptr.getThresholdMaps(dacName, dacStep, dacMin, dacMax, levels, flags, nTriggers)
+        # Return one list of pixels per threshold level:
+        maps = dict()
+        for l in xrange(r.size()):
+            pixels = list()
+            for pix in xrange(r[l].second.size()):
+                p = r[l].second[pix]
+                px = Pixel()
+                px.fill(p)
+                pixels.append(px)
+            maps[r[l].first] = pixels
+        return maps
+
     def setExternalClock(self, bool enable):
         return self.thisptr.setExternalClock(enable)
 
@@ -2,10 +2,142 @@
 #include "datatypes.h"
 #include "log.h"
 #include "constants.h"
+#include "generator.h"
 #include <stdlib.h>
+#include <cmath>
 
 namespace pxar {
-  
+
+  // Look up a DAC, falling back to the default of the DUT configuration if it has never been programmed:
+  static double getDAC(std::map<uint8_t,uint8_t> &dacs, uint8_t reg, uint8_t defaultValue) {
+    std::map<uint8_t,uint8_t>::iterator dac = dacs.find(reg);
+    if(dac == dacs.end()) return defaultValue;
+    return dac->second;
+  }
+
+  dutModel::dutModel() : _seed(1), _state(1), _dead(0.005), _unbonded(0.01), _pixels(), _trims() {
+
+    if(getenv("PXAR_EMULATOR_DEAD")) { _dead = atof(getenv("PXAR_EMULATOR_DEAD")); }
+    if(getenv("PXAR_EMULATOR_UNBONDED")) { _unbonded = atof(getenv("PXAR_EMULATOR_UNBONDED")); }
+    seed(getenv("PXAR_EMULATOR_SEED") ? static_cast<uint32_t>(strtoul(getenv("PXAR_EMULATOR_SEED"), NULL, 0)) : 1);
+  }
+
+  void dutModel::seed(uint32_t seed) {
+    LOG(logDEBUGRPC) << "Emulated DUT seed " << seed << ", dead fraction " << _dead << ", unbonded fraction " << _unbonded;
+    _seed = seed;
+    // The state of xorshift must never be zero:
+    _state = (static_cast<uint64_t>(seed) << 32) ^ 0x9e3779b97f4a7c15ULL;
+    _pixels.clear();
+  }
+
+  void dutModel::setDeadFraction(double fraction) {
+    _dead = fraction;
+    _pixels.clear();
+  }
+
+  void dutModel::setUnbondedFraction(double fraction) {
+    _unbonded = fraction;
+    _pixels.clear();
+  }
+
+  double dutModel::uniform(uint64_t &state) {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return ((state * 2685821657736338717ULL) >> 11) * (1.0/9007199254740992.0);
+  }
+
+  double dutModel::gauss(uint64_t &state) {
+    // Box-Muller, the first uniform number must not be zero:
+    double u1 = uniform(state);
+    while(u1 <= 0) u1 = uniform(state);
+    double u2 = uniform(state);
+    return sqrt(-2*log(u1))*cos(2*M_PI*u2);
+  }
+
+  std::vector<dutModel::pixelProperties> & dutModel::properties(uint8_t roc) {
+
+    std::map<uint8_t, std::vector<pixelProperties> >::iterator it = _pixels.find(roc);
+    if(it != _pixels.end()) return it->second;
+
+    // Every ROC gets its own random sequence, so its pixels do not depend on
+    // the order in which the ROCs are first used:
+    uint64_t state = ((static_cast<uint64_t>(_seed) << 32) | roc) ^ 0x9e3779b97f4a7c15ULL;
+    for(size_t i = 0; i < 16; i++) uniform(state);
+
+    // ROC to ROC variation of the mean threshold:
+    double rocThreshold = 45 + 5*gauss(state);
+
+    std::vector<pixelProperties> & pixels = _pixels[roc];
+    pixels.resize(ROC_NUMCOLS*ROC_NUMROWS);
+    for(std::vector<pixelProperties>::iterator px = pixels.begin(); px != pixels.end(); ++px) {
+      px->threshold = rocThreshold + 4*gauss(state);
+      px->trimgain = 1 + 0.1*gauss(state);
+      px->noise = fabs(2 + 0.3*gauss(state));
+      px->gain = 1 + 0.1*gauss(state);
+      px->pedestal = 40 + 8*gauss(state);
+      px->dead = (uniform(state) < _dead);
+      px->unbonded = (uniform(state) < _unbonded);
+    }
+    return pixels;
+  }
+
+  std::vector<uint8_t> & dutModel::trims(uint8_t roc) {
+    std::vector<uint8_t> & trim = _trims[roc];
+    // Until programmed, all pixels are untrimmed and enabled:
+    if(trim.empty()) trim.assign(ROC_NUMCOLS*ROC_NUMROWS, 15);
+    return trim;
+  }
+
+  void dutModel::setTrims(uint8_t roc, std::vector<uint8_t> &trimvalues) {
+    std::vector<uint8_t> & trim = trims(roc);
+    for(size_t i = 0; i < trim.size() && i < trimvalues.size(); i++) { trim.at(i) = trimvalues.at(i); }
+  }
+
+  double dutModel::threshold(uint8_t roc, size_t col, size_t row, std::map<uint8_t,uint8_t> &dacs) {
+
+    pixelProperties & px = properties(roc).at(col*ROC_NUMROWS + row);
+    uint8_t trim = trims(roc).at(col*ROC_NUMROWS + row);
+    if(trim > 15) trim = 15;
+
+    // A higher comparator threshold DAC lowers the threshold by about 0.6 Vcal per unit:
+    double thr = px.threshold - 0.6*(getDAC(dacs, ROC_DAC_VthrComp, 85) - 85);
+    // Trim bits below 15 lower the threshold, scaled by Vtrim:
+    thr -= 0.15*px.trimgain*getDAC(dacs, ROC_DAC_Vtrim, 0)*(15 - trim)/15.;
+    return thr;
+  }
+
+  bool dutModel::pulse(uint8_t roc, size_t col, size_t row, std::map<uint8_t,uint8_t> &dacs, uint32_t flags, uint16_t &ph) {
+
+    pixelProperties & px = properties(roc).at(col*ROC_NUMROWS + row);
+
+    // Masked and dead pixels never answer, pixels without bump bond do not see the sensor pad:
+    if(trims(roc).at(col*ROC_NUMROWS + row) > 15 || px.dead) return false;
+    if(px.unbonded && (flags&FLAG_CALS) != 0) return false;
+
+    // Injected charge in low range Vcal units, the high range is a factor 7 larger:
+    double charge = getDAC(dacs, ROC_DAC_Vcal, 200);
+    if((static_cast<uint8_t>(getDAC(dacs, ROC_DAC_CtrlReg, 0)) & 0x04) != 0) charge *= 7;
+
+    // Gaussian noise smears the charge seen by the comparator:
+    double overdrive = charge + px.noise*gauss(_state) - threshold(roc, col, row, dacs);
+    if(overdrive < 0) return false;
+
+    // The hit has to arrive in time, small signals come late (timewalk):
+    double late = 30*exp(-overdrive/30);
+    double caldel = getDAC(dacs, ROC_DAC_CalDel, 96);
+    if(caldel < 50 + late || caldel > 140 + late) return false;
+
+    // Pulse height shifted by PHOffset and saturating, PHScale sets the gain:
+    double adc = px.pedestal + 0.6*(getDAC(dacs, ROC_DAC_VoffsetRO, 170) - 170)
+      + 230*(1 - exp(-px.gain*charge*getDAC(dacs, ROC_DAC_VIbias_DAC, 130)/(130.*200.)))
+      + gauss(_state);
+    if(adc < 0) adc = 0;
+    if(adc > 255) adc = 255;
+    ph = static_cast<uint16_t>(adc + 0.5);
+    return true;
+  }
+
   pxar::pixel getNoiseHit(uint8_t rocid, size_t i, size_t j) {
 
     // Generate a slightly random pulse height between 80 and 100:
@@ -22,13 +154,10 @@ namespace pxar {
     return px;
   }
 
-  pxar::pixel getTriggeredHit(uint8_t rocid, size_t col, size_t row, uint32_t flags) {
+  pxar::pixel getTriggeredHit(uint8_t rocid, size_t col, size_t row, uint32_t flags, uint16_t pulseheight) {
 
     pixel px;
 
-    // Generate a slightly random pulse height between 90 and 100:
-    uint16_t pulseheight = rand() % 2 + 90;
-
     // Introduce some address encoding issues:
     if((flags&FLAG_CHECK_ORDER) != 0 && col == 0 && row == 1) { px = pixel(rocid,col,row+1,pulseheight); } // PX 0,1 answers as PX 0,2
     else if((flags&FLAG_CHECK_ORDER) != 0 && col == 0 && row == 6) { px = pixel(rocid,col,row+1,pulseheight); } // PX 0,6 answers as PX 0,7
@@ -36,22 +165,6 @@ namespace pxar {
 
     return px;
   }
-  
-  bool isInTornadoRegion(size_t dac1min, size_t dac1max, size_t dac1, size_t dac2min, size_t dac2max, size_t dac2) {
-
-    size_t epsilon = 5;
-    double tornadowidth = 40;
-    double ymax = dac2max / (1 + exp(0.05*((dac1max-dac1min+1)/2 - tornadowidth - dac1))) + dac2min;
-    double ymin = dac2max / (1 + exp(0.05*((dac1max-dac1min+1)/2 + tornadowidth - dac1))) + dac2min;
-    if(dac2 < ymax && dac2 > ymin) {
-      size_t dymax = ymax - dac2;
-      size_t dymin = dac2 - ymin;
-      if(dymax < epsilon) return (rand()%(epsilon-dymax) == 0);
-      else if(dymin < epsilon) return (rand()%(epsilon-dymin) == 0);
-      else return true;
-    }
-    else return false;
-  }
 
   void fillEvent(pxar::Event * evt, uint8_t rocid, size_t col, size_t row, uint32_t flags) {
 
@@ -71,35 +184,42 @@ namespace pxar {
 
   void fillRawData(uint32_t event, std::vector<uint16_t> &data, uint8_t tbm, uint8_t nroc, bool empty, bool noise, size_t col, size_t row, uint32_t flags) {
 
+    std::vector<std::vector<pxar::pixel> > hits(nroc);
+
+    // For every ROC configured, add one hit:
+    for(size_t roc = 0; roc < nroc; roc++) {
+      if(empty) continue;
+
+      // Generate a slightly random pulse height between 90 and 100:
+      if(noise) hits.at(roc).push_back(getNoiseHit(roc,col,row));
+      else hits.at(roc).push_back(getTriggeredHit(roc,col,row,flags,rand()%2 + 90));
+
+      // If the full chip is unmasked, add some noise hits:
+      if((flags&FLAG_FORCE_UNMASKED) != 0 && (rand()%4) == 0) { hits.at(roc).push_back(getNoiseHit(roc,col,row)); }
+    }
+
+    fillRawData(event, data, tbm, hits);
+  }
+
+  void fillRawData(uint32_t event, std::vector<uint16_t> &data, uint8_t tbm, std::vector<std::vector<pxar::pixel> > &hits) {
+
     size_t pos = data.size();
-    
+
     // Add a TBM header if necessary:
     if(tbm != TBM_NONE) {
       data.push_back(0xa000 | (event%256 & 0x00ff));
       data.push_back(0x8007);
     }
 
-    // For every ROC configured, add one noise hit:
-    for(size_t roc = 0; roc < nroc; roc++) {
+    for(std::vector<std::vector<pxar::pixel> >::iterator roc = hits.begin(); roc != hits.end(); ++roc) {
       // Add a ROC header:
       if(tbm != TBM_NONE) data.push_back(0x47f8);
       else data.push_back(0x07f8);
 
-      if(!empty) {
-	// Add pixel hit:
-	pxar::pixel px;
-	if(noise) px = getNoiseHit(roc,col,row);
-	else px = getTriggeredHit(roc,col,row,flags);
-      
-	data.push_back(0x2000 | ((px.encode() >> 12) & 0x0fff));
-	data.push_back(0x1000 | (px.encode() & 0x0fff));
-
-	// If the full chip is unmasked, add some noise hits:
-	if((flags&FLAG_FORCE_UNMASKED) != 0 && (rand()%4) == 0) {
-	  px = getNoiseHit(roc,col,row);
-	  data.push_back(0x2000 | ((px.encode() >> 12) & 0x0fff));
-	  data.push_back(0x1000 | (px.encode() & 0x0fff));
-	}
+      // Add the pixel hits:
+      for(std::vector<pxar::pixel>::iterator px = roc->begin(); px != roc->end(); ++px) {
+	data.push_back(0x2000 | ((px->encode() >> 12) & 0x0fff));
+	data.push_back(0x1000 | (px->encode() & 0x0fff));
       }
     }
 
@@ -114,4 +234,16 @@ namespace pxar {
       data.at(data.size()-1) = 0x4000 | (data.back() & 0x8fff);
     }
   }
+
+  double getAnalogCurrent(std::map<uint8_t,uint8_t> &dacs) {
+    // Analog current rises linearly with Vana and saturates at high settings:
+    double ia = 2.0 + 0.22*dacs[ROC_DAC_Vana];
+    if(ia > 45.0) ia = 45.0;
+    return ia;
+  }
+
+  double getDigitalCurrent(std::map<uint8_t,uint8_t> &dacs) {
+    // Digital current mostly depends on the Vdig setting:
+    return 20.0 + 0.5*dacs[ROC_DAC_Vdig];
+  }
 }
@@ -27,15 +27,85 @@ typedef unsigned char uint8_t;
 #include "api.h"
 #include "datatypes.h"
 #include <stdlib.h>
+#include <map>
 
 namespace pxar {
+
+  /** Per-pixel model of the emulated DUT
+   *
+   *  Every pixel gets a threshold, a response to its trim bits, a noise level,
+   *  a gain and a pulse height pedestal, and may be dead or have no bump
+   *  bond. All properties are derived from a seed, so the same seed always
+   *  produces the same DUT. The seed and the fractions of dead and unbonded
+   *  pixels are read from the environment variables PXAR_EMULATOR_SEED,
+   *  PXAR_EMULATOR_DEAD and PXAR_EMULATOR_UNBONDED if set.
+   *
+   *  The response to a calibrate signal depends on the DACs VthrComp, Vtrim,
+   *  Vcal (and its range in CtrlReg), CalDel, PHOffset and PHScale.
+   */
+  class dutModel {
+  public:
+    dutModel();
+
+    /** Re-seed the model, this re-generates all pixel properties
+     */
+    void seed(uint32_t seed);
+    void setDeadFraction(double fraction);
+    void setUnbondedFraction(double fraction);
+
+    /** Trim bits of a full ROC as used by the test loops, ordered by
+     *  column*ROC_NUMROWS + row. Values above 15 mask the pixel.
+     */
+    void setTrims(uint8_t roc, std::vector<uint8_t> &trims);
+
+    /** Threshold of a pixel in units of (low range) Vcal for the given DAC settings
+     */
+    double threshold(uint8_t roc, size_t col, size_t row, std::map<uint8_t,uint8_t> &dacs);
+
+    /** Send one calibrate signal to a pixel. Returns true if the pixel
+     *  responds, its pulse height is returned in "ph".
+     */
+    bool pulse(uint8_t roc, size_t col, size_t row, std::map<uint8_t,uint8_t> &dacs, uint32_t flags, uint16_t &ph);
+
+  private:
+    struct pixelProperties {
+      double threshold; // at VthrComp 85 and untrimmed, in Vcal units
+      double trimgain;  // relative response to the trim bits
+      double noise;     // in Vcal units
+      double gain;      // relative pulse height gain
+      double pedestal;  // pulse height pedestal at PHOffset 170
+      bool dead;
+      bool unbonded;
+    };
+
+    std::vector<pixelProperties> & properties(uint8_t roc);
+    std::vector<uint8_t> & trims(uint8_t roc);
+
+    /** Reproducible random numbers (xorshift64*)
+     */
+    double uniform(uint64_t &state);
+    double gauss(uint64_t &state);
+
+    uint32_t _seed;
+    uint64_t _state;
+    double _dead;
+    double _unbonded;
+    std::map<uint8_t, std::vector<pixelProperties> > _pixels;
+    std::map<uint8_t, std::vector<uint8_t> > _trims;
+  };
   
   pxar::pixel getNoiseHit(uint8_t rocid, size_t i, size_t j);
-  pxar::pixel getTriggeredHit(uint8_t rocid, size_t col, size_t row, uint32_t flags);
+  pxar::pixel getTriggeredHit(uint8_t rocid, size_t col, size_t row, uint32_t flags, uint16_t pulseheight);
   
-  bool isInTornadoRegion(size_t dac1min, size_t dac1max, size_t dac1, size_t dac2min, size_t dac2max, size_t dac2);
   void fillEvent(pxar::Event * evt, uint8_t rocid, size_t col, size_t row, uint32_t flags);
   void fillRawData(uint32_t event, std::vector<uint16_t> &data, uint8_t tbm, uint8_t nrocs, bool empty, bool noise, size_t col, size_t row, uint32_t flags = 0);
+
+  /** Encode one event with the given hits of each ROC read out via this channel */
+  void fillRawData(uint32_t event, std::vector<uint16_t> &data, uint8_t tbm, std::vector<std::vector<pxar::pixel> > &hits);
+
+  /** Simple model of the supply currents of one ROC depending on its DACs, in mA */
+  double getAnalogCurrent(std::map<uint8_t,uint8_t> &dacs);
+  double getDigitalCurrent(std::map<uint8_t,uint8_t> &dacs);
   
 }
 
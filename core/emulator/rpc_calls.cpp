@@ -195,12 +195,24 @@ uint16_t CTestboard::_GetVA() {
 
 uint16_t CTestboard::_GetID() {
   LOG(pxar::logDEBUGRPC) << "called.";
-  return id;
+  double target = 0;
+  for(std::map<uint8_t, std::map<uint8_t,uint8_t> >::iterator it = roc_dacs.begin(); it != roc_dacs.end(); ++it) {
+    target += pxar::getDigitalCurrent(it->second);
+  }
+  // The supply settles exponentially, halving the distance with every reading:
+  id_reading += (target - id_reading)/2;
+  return static_cast<uint16_t>(id_reading*10 + 0.5);
 }
 
 uint16_t CTestboard::_GetIA() {
   LOG(pxar::logDEBUGRPC) << "called.";
-  return ia;
+  double target = 0;
+  for(std::map<uint8_t, std::map<uint8_t,uint8_t> >::iterator it = roc_dacs.begin(); it != roc_dacs.end(); ++it) {
+    target += pxar::getAnalogCurrent(it->second);
+  }
+  // The supply settles exponentially, halving the distance with every reading:
+  ia_reading += (target - ia_reading)/2;
+  return static_cast<uint16_t>(ia_reading*10 + 0.5);
 }
 
 uint16_t CTestboard::_GetVD_Reg() {
@@ -437,14 +449,16 @@ void CTestboard::roc_I2cAddr(uint8_t i2c) {
   LOG(pxar::logDEBUGRPC) << "called.";
   std::vector<uint8_t>::iterator thisroc = std::find(roci2c.begin(),roci2c.end(),i2c);
   if(thisroc == roci2c.end()) roci2c.push_back(i2c);
+  roc_addr = i2c;
 }
 
 void CTestboard::roc_ClrCal() {
   LOG(pxar::logDEBUGRPC) << "called.";
 }
 
-void CTestboard::roc_SetDAC(uint8_t, uint8_t) {
+void CTestboard::roc_SetDAC(uint8_t reg, uint8_t value) {
   LOG(pxar::logDEBUGRPC) << "called.";
+  roc_dacs[roc_addr][reg] = value;
 }
 
 void CTestboard::roc_Pix(uint8_t, uint8_t, uint8_t) {
@@ -532,28 +546,53 @@ bool CTestboard::SetI2CAddresses(std::vector<uint8_t> &rpc_par1) {
   return true;
 }
 
-// FIXME here we could implement masked pixels
-bool CTestboard::SetTrimValues(uint8_t, std::vector<uint8_t> &) {
+// The test loops trim and unmask the pixels from this storage, values above 15 mark masked pixels:
+bool CTestboard::SetTrimValues(uint8_t roci2c, std::vector<uint8_t> &trimvalues) {
   LOG(pxar::logDEBUGRPC) << "called.";
+  model.setTrims(roci2c, trimvalues);
   return true;
 }
 
+void CTestboard::fillCalibrate(uint32_t event, std::vector<uint8_t> &rocs, size_t channels, size_t col, size_t row, uint16_t flags) {
+
+  // Distribute the ROCs evenly:
+  size_t roc_per_ch = rocs.size()/channels;
+
+  for(size_t ch = 0; ch < channels; ch++) {
+    std::vector<std::vector<pxar::pixel> > hits(roc_per_ch);
+    for(size_t roc = 0; roc < roc_per_ch; roc++) {
+      uint8_t i2c = rocs.at(ch*roc_per_ch + roc);
+
+      // Ask the pixel model whether and how this pixel responds:
+      uint16_t pulseheight = 0;
+      if(model.pulse(i2c, col, row, roc_dacs[i2c], flags, pulseheight)) {
+	hits.at(roc).push_back(getTriggeredHit(roc, col, row, flags, pulseheight));
+      }
+
+      // If the full chip is unmasked, add some noise hits:
+      if((flags&FLAG_FORCE_UNMASKED) != 0 && (rand()%4) == 0) { hits.at(roc).push_back(getNoiseHit(roc, col, row)); }
+    }
+    fillRawData(event, daq_buffer.at(ch), tbmtype, hits);
+  }
+}
+
+void CTestboard::setLoopDAC(std::vector<uint8_t> &rocs, uint8_t reg, size_t value) {
+  for(std::vector<uint8_t>::iterator roc = rocs.begin(); roc != rocs.end(); ++roc) {
+    roc_dacs[*roc][reg] = static_cast<uint8_t>(value);
+  }
+}
+
 bool CTestboard::LoopMultiRocAllPixelsCalibrate(std::vector<uint8_t> &roci2cs, uint16_t nTriggers, uint16_t flags) {
   LOG(pxar::logDEBUGRPC) << "called.";
 
   // Check how many open DAQ channels we have:
   size_t channels = std::count(daq_status.begin(), daq_status.end(), true);
-  // Distribute the ROCs evenly:
-  size_t roc_per_ch = roci2cs.size()/channels;
 
   uint32_t event = 0;
   for(size_t i = 0; i < ROC_NUMCOLS; i++) {
     for(size_t j = 0; j < ROC_NUMROWS; j++) {
       for(size_t k = 0; k < nTriggers; k++) {
-	for(size_t ch = 0; ch < channels; ch++) {
-	  fillRawData(event,daq_buffer.at(ch),tbmtype,roc_per_ch,false,false,i,j,flags);
-	}
-	event++;
+	fillCalibrate(event++, roci2cs, channels, i, j, flags);
       }
     }
   }
@@ -566,29 +605,24 @@ bool CTestboard::LoopMultiRocOnePixelCalibrate(std::vector<uint8_t> &roci2cs, ui
 
   // Check how many open DAQ channels we have:
   size_t channels = std::count(daq_status.begin(), daq_status.end(), true);
-  // Distribute the ROCs evenly:
-  size_t roc_per_ch = roci2cs.size()/channels;
 
   uint32_t event = 0;
   for(size_t k = 0; k < nTriggers; k++) {
-    for(size_t ch = 0; ch < channels; ch++) {
-      fillRawData(event,daq_buffer.at(ch),tbmtype,roc_per_ch,false,false,column,row,flags);
-    }
-    event++;
+    fillCalibrate(event++, roci2cs, channels, column, row, flags);
   }
   
   return 1;
 }
 
-bool CTestboard::LoopSingleRocAllPixelsCalibrate(uint8_t, uint16_t nTriggers, uint16_t flags) {
+bool CTestboard::LoopSingleRocAllPixelsCalibrate(uint8_t roci2c, uint16_t nTriggers, uint16_t flags) {
   LOG(pxar::logDEBUGRPC) << "called.";
-  
+
+  std::vector<uint8_t> rocs(1, roci2c);
   uint32_t event = 0;
   for(size_t i = 0; i < ROC_NUMCOLS; i++) {
     for(size_t j = 0; j < ROC_NUMROWS; j++) {
       for(size_t k = 0; k < nTriggers; k++) {
-	fillRawData(event,daq_buffer.at(0),tbmtype,1,false,false,i,j,flags);
-	event++;
+	fillCalibrate(event++, rocs, 1, i, j, flags);
       }
     }
   }
@@ -596,13 +630,13 @@ bool CTestboard::LoopSingleRocAllPixelsCalibrate(uint8_t, uint16_t nTriggers, ui
   return 1;
 }
 
-bool CTestboard::LoopSingleRocOnePixelCalibrate(uint8_t, uint8_t column, uint8_t row, uint16_t nTriggers, uint16_t flags) {
+bool CTestboard::LoopSingleRocOnePixelCalibrate(uint8_t roci2c, uint8_t column, uint8_t row, uint16_t nTriggers, uint16_t flags) {
   LOG(pxar::logDEBUGRPC) << "called.";
 
+  std::vector<uint8_t> rocs(1, roci2c);
   uint32_t event = 0;
   for(size_t k = 0; k < nTriggers; k++) {
-    fillRawData(event,daq_buffer.at(0),tbmtype,1,false,false,column,row,flags);
-    event++;
+    fillCalibrate(event++, rocs, 1, column, row, flags);
   }
   
   return 1;
@@ -612,34 +646,28 @@ bool CTestboard::LoopMultiRocAllPixelsDacScan(std::vector<uint8_t> &roci2cs, uin
   return LoopMultiRocAllPixelsDacScan(roci2cs, nTriggers, flags, dacreg, 1, dacmin, dacmax);
 }
 
-bool CTestboard::LoopMultiRocAllPixelsDacScan(std::vector<uint8_t> &roci2cs, uint16_t nTriggers, uint16_t flags, uint8_t, uint8_t dacstep, uint8_t dacmin, uint8_t dacmax) {
+bool CTestboard::LoopMultiRocAllPixelsDacScan(std::vector<uint8_t> &roci2cs, uint16_t nTriggers, uint16_t flags, uint8_t dacreg, uint8_t dacstep, uint8_t dacmin, uint8_t dacmax) {
   LOG(pxar::logDEBUGRPC) << "called.";
 
   // Check how many open DAQ channels we have:
   size_t channels = std::count(daq_status.begin(), daq_status.end(), true);
-  // Distribute the ROCs evenly:
-  size_t roc_per_ch = roci2cs.size()/channels;
 
-  uint8_t dachalf = static_cast<uint8_t>(dacmax-dacmin)/2;
+  // The scanned DAC is restored after the loop:
+  std::map<uint8_t, std::map<uint8_t,uint8_t> > dacs = roc_dacs;
   uint32_t event = 0;
 
   for(size_t i = 0; i < ROC_NUMCOLS; i++) {
     for(size_t j = 0; j < ROC_NUMROWS; j++) {
-      for(size_t dac = 0; dac < static_cast<size_t>(dacmax-dacmin+1); dac += dacstep) {
+      for(size_t dac = dacmin; dac <= dacmax; dac += dacstep) {
+	setLoopDAC(roci2cs, dacreg, dac);
 	for(size_t k = 0; k < nTriggers; k++) {
-	  for(size_t ch = 0; ch < channels; ch++) {
-	    // Mimic some edge at 50% of the DAC range:
-	    if(((flags&FLAG_RISING_EDGE) && dac > dachalf) || (!(flags&FLAG_RISING_EDGE) && dac < dachalf)) {
-	      fillRawData(event,daq_buffer.at(ch),tbmtype,roc_per_ch,false,false,i,j,flags);
-	    }
-	    else { fillRawData(event,daq_buffer.at(ch),tbmtype,roc_per_ch,true, false,i,j,flags); }
-	  }
-	  event++;
+	  fillCalibrate(event++, roci2cs, channels, i, j, flags);
 	}
       }
     }
   }
   
+  roc_dacs = dacs;
   return 1;
 }
 
@@ -647,30 +675,24 @@ bool CTestboard::LoopMultiRocOnePixelDacScan(std::vector<uint8_t> &roci2cs, uint
   return LoopMultiRocOnePixelDacScan(roci2cs, column, row, nTriggers, flags, dacreg, 1, dacmin, dacmax);
 }
 
-bool CTestboard::LoopMultiRocOnePixelDacScan(std::vector<uint8_t> &roci2cs, uint8_t column, uint8_t row, uint16_t nTriggers, uint16_t flags, uint8_t, uint8_t dacstep, uint8_t dacmin, uint8_t dacmax) {
+bool CTestboard::LoopMultiRocOnePixelDacScan(std::vector<uint8_t> &roci2cs, uint8_t column, uint8_t row, uint16_t nTriggers, uint16_t flags, uint8_t dacreg, uint8_t dacstep, uint8_t dacmin, uint8_t dacmax) {
   LOG(pxar::logDEBUGRPC) << "called.";
   
   // Check how many open DAQ channels we have:
   size_t channels = std::count(daq_status.begin(), daq_status.end(), true);
-  // Distribute the ROCs evenly:
-  size_t roc_per_ch = roci2cs.size()/channels;
 
-  uint8_t dachalf = static_cast<uint8_t>(dacmax-dacmin)/2;
+  // The scanned DAC is restored after the loop:
+  std::map<uint8_t, std::map<uint8_t,uint8_t> > dacs = roc_dacs;
   uint32_t event = 0;
 
-  for(size_t dac = 0; dac < static_cast<size_t>(dacmax-dacmin+1); dac += dacstep) {
+  for(size_t dac = dacmin; dac <= dacmax; dac += dacstep) {
+    setLoopDAC(roci2cs, dacreg, dac);
     for(size_t k = 0; k < nTriggers; k++) {
-      for(size_t ch = 0; ch < channels; ch++) {
-	// Mimic some edge at 50% of the DAC range:
-	if(((flags&FLAG_RISING_EDGE) && dac > dachalf) || (!(flags&FLAG_RISING_EDGE) && dac < dachalf)) {
-	  fillRawData(event,daq_buffer.at(ch),tbmtype,roc_per_ch,false,false,column,row,flags);
-	}
-	else { fillRawData(event,daq_buffer.at(ch),tbmtype,roc_per_ch,true, false,column,row,flags); }
-      }
-      event++;
+      fillCalibrate(event++, roci2cs, channels, column, row, flags);
     }
   }
   
+  roc_dacs = dacs;
   return 1;
 }
 
@@ -678,27 +700,26 @@ bool CTestboard::LoopSingleRocAllPixelsDacScan(uint8_t roci2c, uint16_t nTrigger
   return LoopSingleRocAllPixelsDacScan(roci2c, nTriggers, flags, dacreg, 1, dacmin, dacmax);
 }
 
-bool CTestboard::LoopSingleRocAllPixelsDacScan(uint8_t, uint16_t nTriggers, uint16_t flags, uint8_t, uint8_t dacstep, uint8_t dacmin, uint8_t dacmax) {
+bool CTestboard::LoopSingleRocAllPixelsDacScan(uint8_t roci2c, uint16_t nTriggers, uint16_t flags, uint8_t dacreg, uint8_t dacstep, uint8_t dacmin, uint8_t dacmax) {
   LOG(pxar::logDEBUGRPC) << "called.";
 
-  uint8_t dachalf = static_cast<uint8_t>(dacmax-dacmin)/2;
+  std::vector<uint8_t> rocs(1, roci2c);
+  // The scanned DAC is restored after the loop:
+  std::map<uint8_t, std::map<uint8_t,uint8_t> > dacs = roc_dacs;
   uint32_t event = 0;
 
   for(size_t i = 0; i < ROC_NUMCOLS; i++) {
     for(size_t j = 0; j < ROC_NUMROWS; j++) {
-      for(size_t dac = 0; dac < static_cast<size_t>(dacmax-dacmin+1); dac += dacstep) {
+      for(size_t dac = dacmin; dac <= dacmax; dac += dacstep) {
+	setLoopDAC(rocs, dacreg, dac);
 	for(size_t k = 0; k < nTriggers; k++) {
-	  // Mimic some edge at 50% of the DAC range:
-	  if(((flags&FLAG_RISING_EDGE) && dac > dachalf) || (!(flags&FLAG_RISING_EDGE) && dac < dachalf)) {
-	    fillRawData(event,daq_buffer.at(0),tbmtype,1,false,false,i,j,flags);
-	  }
-	  else { fillRawData(event,daq_buffer.at(0),tbmtype,1,true, false,i,j,flags); }
-	  event++;
+	  fillCalibrate(event++, rocs, 1, i, j, flags);
 	}
       }
     }
   }
   
+  roc_dacs = dacs;
   return 1;
 }
 
@@ -706,23 +727,22 @@ bool CTestboard::LoopSingleRocOnePixelDacScan(uint8_t roci2c, uint8_t column, ui
   return LoopSingleRocOnePixelDacScan(roci2c, column, row, nTriggers, flags, dacreg, 1, dacmin, dacmax);
 }
 
-bool CTestboard::LoopSingleRocOnePixelDacScan(uint8_t, uint8_t column, uint8_t row, uint16_t nTriggers, uint16_t flags, uint8_t, uint8_t dacstep, uint8_t dacmin, uint8_t dacmax) {
+bool CTestboard::LoopSingleRocOnePixelDacScan(uint8_t roci2c, uint8_t column, uint8_t row, uint16_t nTriggers, uint16_t flags, uint8_t dacreg, uint8_t dacstep, uint8_t dacmin, uint8_t dacmax) {
   LOG(pxar::logDEBUGRPC) << "called.";
   
-  uint8_t dachalf = static_cast<uint8_t>(dacmax-dacmin)/2;
+  std::vector<uint8_t> rocs(1, roci2c);
+  // The scanned DAC is restored after the loop:
+  std::map<uint8_t, std::map<uint8_t,uint8_t> > dacs = roc_dacs;
   uint32_t event = 0;
 
-  for(size_t dac = 0; dac < static_cast<size_t>(dacmax-dacmin+1); dac += dacstep) {
+  for(size_t dac = dacmin; dac <= dacmax; dac += dacstep) {
+    setLoopDAC(rocs, dacreg, dac);
     for(size_t k = 0; k < nTriggers; k++) {
-      // Mimic some edge at 50% of the DAC range:
-      if(((flags&FLAG_RISING_EDGE) && dac > dachalf) || (!(flags&FLAG_RISING_EDGE) && dac < dachalf)) {
-	fillRawData(event,daq_buffer.at(0),tbmtype,1,false,false,column,row,flags);
-      }
-      else { fillRawData(event,daq_buffer.at(0),tbmtype,1,true, false,column,row,flags); }
+      fillCalibrate(event++, rocs, 1, column, row, flags);
     }
-    event++;
   }
   
+  roc_dacs = dacs;
   return 1;
 }
 
@@ -730,35 +750,31 @@ bool CTestboard::LoopMultiRocAllPixelsDacDacScan(std::vector<uint8_t> &roci2cs,
   return LoopMultiRocAllPixelsDacDacScan(roci2cs, nTriggers, flags, dac1reg, 1, dac1min, dac1max, dac2reg, 1, dac2min, dac2max);
 }
 
-bool CTestboard::LoopMultiRocAllPixelsDacDacScan(std::vector<uint8_t> &roci2cs, uint16_t nTriggers, uint16_t flags, uint8_t, uint8_t dac1step, uint8_t dac1min, uint8_t dac1max, uint8_t, uint8_t dac2step, uint8_t dac2min, uint8_t dac2max) {
+bool CTestboard::LoopMultiRocAllPixelsDacDacScan(std::vector<uint8_t> &roci2cs, uint16_t nTriggers, uint16_t flags, uint8_t dac1reg, uint8_t dac1step, uint8_t dac1min, uint8_t dac1max, uint8_t dac2reg, uint8_t dac2step, uint8_t dac2min, uint8_t dac2max) {
   LOG(pxar::logDEBUGRPC) << "called.";
 
   // Check how many open DAQ channels we have:
   size_t channels = std::count(daq_status.begin(), daq_status.end(), true);
-  // Distribute the ROCs evenly:
-  size_t roc_per_ch = roci2cs.size()/channels;
 
+  // The scanned DACs are restored after the loop:
+  std::map<uint8_t, std::map<uint8_t,uint8_t> > dacs = roc_dacs;
   uint32_t event = 0;
 
   for(size_t i = 0; i < ROC_NUMCOLS; i++) {
     for(size_t j = 0; j < ROC_NUMROWS; j++) {
-      for(size_t dac1 = 0; dac1 < static_cast<size_t>(dac1max-dac1min+1); dac1 += dac1step) {
-	for(size_t dac2 = 0; dac2 < static_cast<size_t>(dac2max-dac2min+1); dac2 += dac2step) {
+      for(size_t dac1 = dac1min; dac1 <= dac1max; dac1 += dac1step) {
+	setLoopDAC(roci2cs, dac1reg, dac1);
+	for(size_t dac2 = dac2min; dac2 <= dac2max; dac2 += dac2step) {
+	  setLoopDAC(roci2cs, dac2reg, dac2);
 	  for(size_t k = 0; k < nTriggers; k++) {
-	    for(size_t ch = 0; ch < channels; ch++) {
-	      // Mimic some working band of the two DACs:
-	      if(isInTornadoRegion(dac1min, dac1max, dac1, dac2min, dac2max, dac2)) {
-		fillRawData(event,daq_buffer.at(ch),tbmtype,roc_per_ch,false,false,i,j,flags);
-	      }
-	      else { fillRawData(event,daq_buffer.at(ch),tbmtype,roc_per_ch,true, false,i,j,flags); }
-	    }
-	    event++;
+	    fillCalibrate(event++, roci2cs, channels, i, j, flags);
 	  }
 	}
       }
     }
   }
   
+  roc_dacs = dacs;
   return 1;
 }
 
@@ -766,31 +782,27 @@ bool CTestboard::LoopMultiRocOnePixelDacDacScan(std::vector<uint8_t> &roci2cs, u
   return LoopMultiRocOnePixelDacDacScan(roci2cs, column, row, nTriggers, flags, dac1reg, 1, dac1min, dac1max, dac2reg, 1, dac2min, dac2max);
 }
 
-bool CTestboard::LoopMultiRocOnePixelDacDacScan(std::vector<uint8_t> &roci2cs, uint8_t column, uint8_t row, uint16_t nTriggers, uint16_t flags, uint8_t, uint8_t dac1step, uint8_t dac1min, uint8_t dac1max, uint8_t, uint8_t dac2step, uint8_t dac2min, uint8_t dac2max) {
+bool CTestboard::LoopMultiRocOnePixelDacDacScan(std::vector<uint8_t> &roci2cs, uint8_t column, uint8_t row, uint16_t nTriggers, uint16_t flags, uint8_t dac1reg, uint8_t dac1step, uint8_t dac1min, uint8_t dac1max, uint8_t dac2reg, uint8_t dac2step, uint8_t dac2min, uint8_t dac2max) {
   LOG(pxar::logDEBUGRPC) << "called.";
 
   // Check how many open DAQ channels we have:
   size_t channels = std::count(daq_status.begin(), daq_status.end(), true);
-  // Distribute the ROCs evenly:
-  size_t roc_per_ch = roci2cs.size()/channels;
 
+  // The scanned DACs are restored after the loop:
+  std::map<uint8_t, std::map<uint8_t,uint8_t> > dacs = roc_dacs;
   uint32_t event = 0;
 
-  for(size_t dac1 = 0; dac1 < static_cast<size_t>(dac1max-dac1min+1); dac1 += dac1step) {
-    for(size_t dac2 = 0; dac2 < static_cast<size_t>(dac2max-dac2min+1); dac2 += dac2step) {
+  for(size_t dac1 = dac1min; dac1 <= dac1max; dac1 += dac1step) {
+    setLoopDAC(roci2cs, dac1reg, dac1);
+    for(size_t dac2 = dac2min; dac2 <= dac2max; dac2 += dac2step) {
+      setLoopDAC(roci2cs, dac2reg, dac2);
       for(size_t k = 0; k < nTriggers; k++) {
-	for(size_t ch = 0; ch < channels; ch++) {
-	  // Mimic some working band of the two DACs:
-	  if(isInTornadoRegion(dac1min, dac1max, dac1, dac2min, dac2max, dac2)) {
-	    fillRawData(event,daq_buffer.at(ch),tbmtype,roc_per_ch,false,false,column,row,flags);
-	  }
-	  else { fillRawData(event,daq_buffer.at(ch),tbmtype,roc_per_ch,true, false,column,row,flags); }
-	}
-	event++;
+	fillCalibrate(event++, roci2cs, channels, column, row, flags);
       }
     }
   }
   
+  roc_dacs = dacs;
   return 1;
 }
 
@@ -798,28 +810,29 @@ bool CTestboard::LoopSingleRocAllPixelsDacDacScan(uint8_t roci2c, uint16_t nTrig
   return LoopSingleRocAllPixelsDacDacScan(roci2c, nTriggers, flags, dac1reg, 1, dac1min, dac1max, dac2reg, 1, dac2min, dac2max);
 }
 
-bool CTestboard::LoopSingleRocAllPixelsDacDacScan(uint8_t, uint16_t nTriggers, uint16_t flags, uint8_t, uint8_t dac1step, uint8_t dac1min, uint8_t dac1max, uint8_t, uint8_t dac2step, uint8_t dac2min, uint8_t dac2max) {
+bool CTestboard::LoopSingleRocAllPixelsDacDacScan(uint8_t roci2c, uint16_t nTriggers, uint16_t flags, uint8_t dac1reg, uint8_t dac1step, uint8_t dac1min, uint8_t dac1max, uint8_t dac2reg, uint8_t dac2step, uint8_t dac2min, uint8_t dac2max) {
   LOG(pxar::logDEBUGRPC) << "called.";
 
+  std::vector<uint8_t> rocs(1, roci2c);
+  // The scanned DACs are restored after the loop:
+  std::map<uint8_t, std::map<uint8_t,uint8_t> > dacs = roc_dacs;
   uint32_t event = 0;
 
   for(size_t i = 0; i < ROC_NUMCOLS; i++) {
     for(size_t j = 0; j < ROC_NUMROWS; j++) {
-      for(size_t dac1 = 0; dac1 < static_cast<size_t>(dac1max-dac1min+1); dac1 += dac1step) {
-	for(size_t dac2 = 0; dac2 < static_cast<size_t>(dac2max-dac2min+1); dac2 += dac2step) {
+      for(size_t dac1 = dac1min; dac1 <= dac1max; dac1 += dac1step) {
+	setLoopDAC(rocs, dac1reg, dac1);
+	for(size_t dac2 = dac2min; dac2 <= dac2max; dac2 += dac2step) {
+	  setLoopDAC(rocs, dac2reg, dac2);
 	  for(size_t k = 0; k < nTriggers; k++) {
-	    // Mimic some working band of the two DACs:
-	    if(isInTornadoRegion(dac1min, dac1max, dac1, dac2min, dac2max, dac2)) {
-	      fillRawData(event,daq_buffer.at(0),tbmtype,1,false,false,i,j,flags);
-	    }
-	    else { fillRawData(event,daq_buffer.at(0),tbmtype,1,true, false,i,j,flags); }
+	    fillCalibrate(event++, rocs, 1, i, j, flags);
 	  }
-	  event++;
 	}
       }
     }
   }
   
+  roc_dacs = dacs;
   return 1;
 }
 
@@ -827,24 +840,25 @@ bool CTestboard::LoopSingleRocOnePixelDacDacScan(uint8_t roci2c, uint8_t column,
   return LoopSingleRocOnePixelDacDacScan(roci2c, column, row, nTriggers, flags, dac1reg, 1, dac1min, dac1max, dac2reg, 1, dac2min, dac2max);
 }
 
-bool CTestboard::LoopSingleRocOnePixelDacDacScan(uint8_t, uint8_t column, uint8_t row, uint16_t nTriggers, uint16_t flags, uint8_t, uint8_t dac1step, uint8_t dac1min, uint8_t dac1max, uint8_t, uint8_t dac2step, uint8_t dac2min, uint8_t dac2max) {
+bool CTestboard::LoopSingleRocOnePixelDacDacScan(uint8_t roci2c, uint8_t column, uint8_t row, uint16_t nTriggers, uint16_t flags, uint8_t dac1reg, uint8_t dac1step, uint8_t dac1min, uint8_t dac1max, uint8_t dac2reg, uint8_t dac2step, uint8_t dac2min, uint8_t dac2max) {
   LOG(pxar::logDEBUGRPC) << "called.";
 
+  std::vector<uint8_t> rocs(1, roci2c);
+  // The scanned DACs are restored after the loop:
+  std::map<uint8_t, std::map<uint8_t,uint8_t> > dacs = roc_dacs;
   uint32_t event = 0;
 
-  for(size_t dac1 = 0; dac1 < static_cast<size_t>(dac1max-dac1min+1); dac1 += dac1step) {
-    for(size_t dac2 = 0; dac2 < static_cast<size_t>(dac2max-dac2min+1); dac2 += dac2step) {
+  for(size_t dac1 = dac1min; dac1 <= dac1max; dac1 += dac1step) {
+    setLoopDAC(rocs, dac1reg, dac1);
+    for(size_t dac2 = dac2min; dac2 <= dac2max; dac2 += dac2step) {
+      setLoopDAC(rocs, dac2reg, dac2);
       for(size_t k = 0; k < nTriggers; k++) {
-	// Mimic some working band of the two DACs:
-	if(isInTornadoRegion(dac1min, dac1max, dac1, dac2min, dac2max, dac2)) {
-	  fillRawData(event,daq_buffer.at(0),tbmtype,1,false,false,column,row,flags);
-	}
-	else { fillRawData(event,daq_buffer.at(0),tbmtype,1,true, false,column,row,flags); }
+	fillCalibrate(event++, rocs, 1, column, row, flags);
       }
-      event++;
     }
   }
   
+  roc_dacs = dacs;
   return 1;
 }
 
@@ -1,7 +1,9 @@
 #pragma once
 #include <vector>
+#include <map>
 #include "log.h"
 #include "constants.h"
+#include "generator.h"
 
 class CRpcError {
  public:
@@ -21,18 +23,33 @@ class CTestboard {
   uint16_t vd, va, id, ia;
   size_t nrocs_loops;
   std::vector<uint8_t> roci2c;
+
+  // Current model: DAC settings of all ROCs and settling supply readings
+  uint8_t roc_addr;
+  std::map<uint8_t, std::map<uint8_t,uint8_t> > roc_dacs;
+  double ia_reading, id_reading;
   uint8_t tbmtype;
   uint16_t trigger;
 
+  // Per-pixel model of the DUT answering calibrate signals
+  pxar::dutModel model;
+
   uint32_t eventcounter;
   
   std::vector<std::vector<uint16_t> > daq_buffer; // Data buffers
   std::vector<bool> daq_status; // Channel status
   std::vector<size_t> daq_event; // Event counters
+
+  // Fill one calibrate event of pixel col,row on the ROCs "rocs" into all open DAQ channels:
+  void fillCalibrate(uint32_t event, std::vector<uint8_t> &rocs, size_t channels, size_t col, size_t row, uint16_t flags);
+  // Set a DAC on all ROCs taking part in a loop:
+  void setLoopDAC(std::vector<uint8_t> &rocs, uint8_t reg, size_t value);
   
  public:
  CTestboard() : vd(0), va(0), id(0), ia(0),
-    nrocs_loops(0), roci2c(), tbmtype(TBM_NONE),trigger(TRG_SEL_PG_DIR),
+    nrocs_loops(0), roci2c(),
+    roc_addr(0), roc_dacs(), ia_reading(0), id_reading(0),
+    tbmtype(TBM_NONE),trigger(TRG_SEL_PG_DIR), model(),
     eventcounter(0),
     daq_buffer(), daq_status(), daq_event()
   {
@@ -71,6 +88,9 @@ class CTestboard {
 
   void ClearInterface() {}
 
+  // No USB reader thread to configure:
+  bool SetReaderConfig(int cpu, bool hugePages, bool lockMemory) { return (cpu < 0 && !hugePages && !lockMemory); }
+
 
   uint32_t GetInterfaceListSize() { return 1; }
 
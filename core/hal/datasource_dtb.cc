@@ -5,6 +5,10 @@
 #include "exceptions.h"
 #include "rpc_calls.h"
 
+#ifndef WIN32
+#include <sys/mman.h>
+#endif
+
 namespace pxar {
 
   uint16_t dtbSource::FillBuffer() {
@@ -32,4 +36,29 @@ namespace pxar {
     return lastSample = buffer[pos++];
   }
 
+  bool dtbSource::Reserve(bool lock) {
+    Release();
+    buffer.reserve(DTB_SOURCE_BLOCK_SIZE);
+    if(!lock) return true;
+
+#ifndef WIN32
+    // Touch the full block once so all pages exist before locking them:
+    buffer.resize(DTB_SOURCE_BLOCK_SIZE);
+    if(mlock(&buffer[0], DTB_SOURCE_BLOCK_SIZE*sizeof(uint16_t)) == 0) { locked = &buffer[0]; }
+    buffer.clear();
+#endif
+    if(!locked) {
+      LOG(logWARNING) << "Channel " << static_cast<int>(channel) << ": could not lock DAQ buffer in memory.";
+    }
+    return (locked != NULL);
+  }
+
+  void dtbSource::Release() {
+    if(!locked) return;
+#ifndef WIN32
+    munlock(locked, DTB_SOURCE_BLOCK_SIZE*sizeof(uint16_t));
+#endif
+    locked = NULL;
+  }
+
 }
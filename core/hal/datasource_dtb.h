@@ -19,6 +19,7 @@ namespace pxar {
     uint32_t dtbRemainingSize;
     uint8_t  dtbState;
     bool connected;
+    uint16_t * locked;
     uint8_t envelopetype;
     uint8_t devicetype;
 
@@ -59,14 +60,21 @@ namespace pxar {
     }
   public:
   dtbSource(CTestboard * src, uint8_t daqchannel, uint8_t tokenChainLength, uint8_t offset, uint8_t tbmtype, uint8_t roctype, bool endlessStream)
-    : stopAtEmptyData(endlessStream), tb(src), channel(daqchannel), chainlength(tokenChainLength), chainlengthOffset(offset), connected(true), envelopetype(tbmtype), devicetype(roctype), lastSample(0x4000), pos(0) {}
-  dtbSource() : connected(false) {}
+    : stopAtEmptyData(endlessStream), tb(src), channel(daqchannel), chainlength(tokenChainLength), chainlengthOffset(offset), connected(true), locked(NULL), envelopetype(tbmtype), devicetype(roctype), lastSample(0x4000), pos(0) {}
+  dtbSource() : connected(false), locked(NULL) {}
     bool isConnected() { return connected; }
 
     // --- control and status
     uint8_t  GetState() { return dtbState; }
     uint32_t GetRemainingSize() { return dtbRemainingSize; }
     void Stop() { stopAtEmptyData = true; }
+
+    // --- buffer memory
+    // Allocate the data buffer for a full DTB block up front, optionally
+    // locked in RAM. Returns false if the buffer could not be locked.
+    bool Reserve(bool lock);
+    // Unlock the data buffer again before the source is replaced:
+    void Release();
   };
 
 }
@@ -6,6 +6,7 @@
 #include "constants.h"
 #include <fstream>
 #include <algorithm>
+#include <cmath>
 
 using namespace pxar;
 
@@ -25,6 +26,9 @@ hal::hal(std::string name) :
   m_notokenpass(),
   m_daqstatus(),
   _currentTrgSrc(TRG_SEL_PG_DIR),
+  m_lockmemory(false),
+  m_decodercpu(-1),
+  m_cpumask(),
   m_src(),
   m_splitter(),
   m_decoder()
@@ -494,6 +498,44 @@ double hal::getTBvd() {
   return (_testboard->_GetVD()/1000.0);
 }
 
+std::vector<std::pair<uint8_t,double> > hal::rocCurrentVsDac(uint8_t roci2c, uint8_t dacReg, uint8_t dacStep, uint8_t dacMin, uint8_t dacMax, bool analog, double tolerance, uint16_t nStable, uint16_t maxSamples, uint16_t sampleDelay) {
+
+  std::vector<std::pair<uint8_t,double> > result;
+  if(dacStep == 0) { dacStep = 1; }
+
+  LOG(logDEBUGHAL) << "ROC@I2C " << static_cast<int>(roci2c) << ": sampling "
+		   << (analog ? "analog" : "digital") << " current vs DAC" << static_cast<int>(dacReg)
+		   << " from " << static_cast<int>(dacMin) << " to " << static_cast<int>(dacMax);
+
+  size_t unsettled = 0;
+  for(size_t dac = dacMin; dac <= dacMax; dac += dacStep) {
+    rocSetDAC(roci2c,dacReg,static_cast<uint8_t>(dac));
+
+    // Sample the current until it does not change anymore:
+    double current = (analog ? getTBia() : getTBid());
+    uint16_t stable = 0, samples = 1;
+    while(stable < nStable && samples < maxSamples) {
+      _testboard->uDelay(sampleDelay);
+      double sample = (analog ? getTBia() : getTBid());
+      samples++;
+      if(std::abs(sample - current) <= tolerance) { stable++; }
+      else { stable = 0; }
+      current = sample;
+    }
+
+    if(stable < nStable) { unsettled++; }
+    LOG(logDEBUGHAL) << "DAC" << static_cast<int>(dacReg) << " = " << dac << ": I = " << current
+		     << "A after " << samples << " samples" << (stable < nStable ? " (not settled)" : "");
+    result.push_back(std::make_pair(static_cast<uint8_t>(dac),current));
+  }
+
+  if(unsettled > 0) {
+    LOG(logWARNING) << "Current did not settle within " << maxSamples << " samples for "
+		    << unsettled << " DAC settings.";
+  }
+  return result;
+}
+
 
 void hal::setTBia(double IA) {
   // Set the VA analog current limit in A:
@@ -526,28 +568,38 @@ void hal::setHubId(uint8_t hubid) {
 
 bool hal::rocSetDACs(uint8_t roci2c, std::map< uint8_t, uint8_t > dacPairs) {
 
-  // Make sure we are writing to the correct ROC by setting the I2C address:
-  _testboard->roc_I2cAddr(roci2c);
+  std::map< uint8_t, std::map< uint8_t, uint8_t > > rocDacPairs;
+  rocDacPairs[roci2c] = dacPairs;
+  return rocSetDACs(rocDacPairs);
+}
+
+bool hal::rocSetDACs(std::map< uint8_t, std::map< uint8_t, uint8_t > > rocDacPairs) {
 
   // Check if WBC has been updated:
   bool is_wbc = false;
 
-  // Check if one of the DACs to be set is RangeTemp and shift it to the end:
-  std::map<uint8_t,uint8_t>::iterator rangetemp = dacPairs.end();
+  for(std::map< uint8_t, std::map< uint8_t, uint8_t > >::iterator roc = rocDacPairs.begin(); roc != rocDacPairs.end(); ++roc) {
 
-  // Iterate over all DAC id/value pairs and set the DAC
-  for(std::map< uint8_t,uint8_t >::iterator it = dacPairs.begin(); it != dacPairs.end(); ++it) {
-    if(it->first == ROC_DAC_RangeTemp) { rangetemp = it; continue; }
+    // Make sure we are writing to the correct ROC by setting the I2C address:
+    _testboard->roc_I2cAddr(roc->first);
 
-    LOG(logDEBUGHAL) << "Set DAC" << static_cast<int>(it->first) << " to " << static_cast<int>(it->second);
-    _testboard->roc_SetDAC(it->first,it->second);
-    if(it->first == ROC_DAC_WBC) { is_wbc = true; }
-  }
+    // Check if one of the DACs to be set is RangeTemp and shift it to the end:
+    std::map<uint8_t,uint8_t>::iterator rangetemp = roc->second.end();
+
+    // Iterate over all DAC id/value pairs and set the DAC
+    for(std::map< uint8_t,uint8_t >::iterator it = roc->second.begin(); it != roc->second.end(); ++it) {
+      if(it->first == ROC_DAC_RangeTemp) { rangetemp = it; continue; }
+
+      LOG(logDEBUGHAL) << "Set DAC" << static_cast<int>(it->first) << " to " << static_cast<int>(it->second);
+      _testboard->roc_SetDAC(it->first,it->second);
+      if(it->first == ROC_DAC_WBC) { is_wbc = true; }
+    }
 
-  // Check if RangeTemp has been omitted and set it now - this allows to read its value via lastDAC:
-  if(rangetemp != dacPairs.end()) {
-    LOG(logDEBUGHAL) << "Set DAC" << static_cast<int>(rangetemp->first) << " to " << static_cast<int>(rangetemp->second);
-    _testboard->roc_SetDAC(rangetemp->first,rangetemp->second);
+    // Check if RangeTemp has been omitted and set it now - this allows to read its value via lastDAC:
+    if(rangetemp != roc->second.end()) {
+      LOG(logDEBUGHAL) << "Set DAC" << static_cast<int>(rangetemp->first) << " to " << static_cast<int>(rangetemp->second);
+      _testboard->roc_SetDAC(rangetemp->first,rangetemp->second);
+    }
   }
 
   // Make sure to issue a ROC Reset after WBC has been programmed:
@@ -580,6 +632,28 @@ bool hal::rocSetDAC(uint8_t roci2c, uint8_t dacId, uint8_t dacValue) {
   return true;
 }
 
+bool hal::rocSetDAC(std::vector<uint8_t> roci2c, uint8_t dacId, uint8_t dacValue) {
+
+  LOG(logDEBUGHAL) << "ROC@I2C " << listVector(roci2c)
+		   << ": Set DAC" << static_cast<int>(dacId) << " to " << static_cast<int>(dacValue);
+
+  // Queue the register write for every ROC, the I2C address is switched in between:
+  for(std::vector<uint8_t>::iterator roc = roci2c.begin(); roc != roci2c.end(); ++roc) {
+    _testboard->roc_I2cAddr(*roc);
+    _testboard->roc_SetDAC(dacId,dacValue);
+  }
+
+  // Send all queued commands to the testboard at once:
+  _testboard->Flush();
+
+  // Make sure to issue one ROC Reset after the DAC WBC has been programmed on all ROCs:
+  if(dacId == ROC_DAC_WBC) {
+    LOG(logDEBUGHAL) << "WBC has been programmed - sending a ROC Reset command.";
+    daqTriggerSingleSignal(TRG_SEND_RSR);
+  }
+  return true;
+}
+
 bool hal::tbmSetRegs(uint8_t hubid, uint8_t core, std::map< uint8_t, uint8_t > regPairs) {
 
   // Iterate over all register id/value pairs and set them
@@ -1556,6 +1630,263 @@ std::vector<Event*> hal::SingleRocOnePixelDacDacScan(uint8_t roci2c, uint8_t col
   return data;
 }
 
+std::vector<Event*> hal::MultiRocAllPixelsDacDacDacScan(std::vector<uint8_t> roci2cs, std::vector<int32_t> parameter) {
+  return DacDacDacScan(roci2cs, true, true, 0, 0, parameter);
+}
+
+std::vector<Event*> hal::MultiRocOnePixelDacDacDacScan(std::vector<uint8_t> roci2cs, uint8_t column, uint8_t row, std::vector<int32_t> parameter) {
+  return DacDacDacScan(roci2cs, true, false, column, row, parameter);
+}
+
+std::vector<Event*> hal::SingleRocAllPixelsDacDacDacScan(uint8_t roci2c, std::vector<int32_t> parameter) {
+  return DacDacDacScan(std::vector<uint8_t>(1, roci2c), false, true, 0, 0, parameter);
+}
+
+std::vector<Event*> hal::SingleRocOnePixelDacDacDacScan(uint8_t roci2c, uint8_t column, uint8_t row, std::vector<int32_t> parameter) {
+  return DacDacDacScan(std::vector<uint8_t>(1, roci2c), false, false, column, row, parameter);
+}
+
+std::vector<Event*> hal::DacDacDacScan(std::vector<uint8_t> roci2cs, bool multiroc, bool allpixels, uint8_t column, uint8_t row, std::vector<int32_t> parameter) {
+
+  uint8_t dac1reg = static_cast<uint8_t>(parameter.at(0));
+  uint8_t dac1min = static_cast<uint8_t>(parameter.at(1));
+  uint8_t dac1max = static_cast<uint8_t>(parameter.at(2));
+  uint8_t dac2reg = static_cast<uint8_t>(parameter.at(3));
+  uint8_t dac2min = static_cast<uint8_t>(parameter.at(4));
+  uint8_t dac2max = static_cast<uint8_t>(parameter.at(5));
+  uint16_t flags = static_cast<uint16_t>(parameter.at(6));
+  uint16_t nTriggers = static_cast<uint16_t>(parameter.at(7));
+  uint8_t dac1step = static_cast<uint8_t>(parameter.at(8));
+  uint8_t dac2step = static_cast<uint8_t>(parameter.at(9));
+  uint8_t dac3reg = static_cast<uint8_t>(parameter.at(10));
+  uint8_t dac3min = static_cast<uint8_t>(parameter.at(11));
+  uint8_t dac3max = static_cast<uint8_t>(parameter.at(12));
+  uint8_t dac3step = static_cast<uint8_t>(parameter.at(13));
+
+  // One block of Events per pixel and DAC1 value, holding all DAC2 and DAC3 values and triggers:
+  size_t block = static_cast<size_t>((dac2max-dac2min)/dac2step+1)*static_cast<size_t>((dac3max-dac3min)/dac3step+1)*nTriggers;
+  size_t npixels = (allpixels ? ROC_NUMROWS*ROC_NUMCOLS : 1);
+  int expected = static_cast<size_t>((dac1max-dac1min)/dac1step+1)*block*npixels;
+
+  LOG(logDEBUGHAL) << "Called " << (multiroc ? "MultiRoc" : "SingleRoc") << (allpixels ? "AllPixels" : "OnePixel")
+		   << "DacDacDacScan with flags " << listFlags(flags) << ", running " << nTriggers << " triggers.";
+  if(allpixels) { LOG(logDEBUGHAL) << "Function will take care of all pixels on " << roci2cs.size() << " ROCs with the I2C addresses:"; }
+  else {
+    LOG(logDEBUGHAL) << "Function will take care of pixel " << static_cast<int>(column) << ","
+		     << static_cast<int>(row) << " on "
+		     << roci2cs.size() << " ROCs with the I2C addresses:";
+  }
+  LOG(logDEBUGHAL) << listVector(roci2cs);
+  LOG(logDEBUGHAL) << "Scanning DAC " << static_cast<int>(dac1reg)
+		   << " from " << static_cast<int>(dac1min)
+		   << " to " << static_cast<int>(dac1max)
+		   << " (step size " << static_cast<int>(dac1step) << ")"
+		   << " vs. DAC " << static_cast<int>(dac2reg)
+		   << " from " << static_cast<int>(dac2min)
+		   << " to " << static_cast<int>(dac2max)
+		   << " (step size " << static_cast<int>(dac2step) << ")"
+		   << " vs. DAC " << static_cast<int>(dac3reg)
+		   << " from " << static_cast<int>(dac3min)
+		   << " to " << static_cast<int>(dac3max)
+		   << " (step size " << static_cast<int>(dac3step) << ")";
+  LOG(logDEBUGHAL) << "Expecting " << expected << " events.";
+  estimateDataVolume(expected, roci2cs.size());
+
+  // Prepare for data acquisition, the session is kept open for all DAC1 steps:
+  daqStart(deser160phase);
+  timer t;
+
+  // Data read for every DAC1 step, ordered by pixel, DAC2 and DAC3:
+  std::vector< std::vector<Event*> > steps;
+  bool aborted = false;
+  for(size_t dac1 = dac1min; dac1 <= dac1max && !aborted; dac1 += dac1step) {
+    rocSetDAC(roci2cs, dac1reg, static_cast<uint8_t>(dac1));
+    steps.push_back(std::vector<Event*>());
+
+    // Call the RPC command containing the trigger loop:
+    bool done = false;
+    while(!done) {
+      if(multiroc && allpixels) {
+	done = _testboard->LoopMultiRocAllPixelsDacDacScan(roci2cs, nTriggers, flags, dac2reg, dac2step, dac2min, dac2max, dac3reg, dac3step, dac3min, dac3max);
+      }
+      else if(multiroc) {
+	done = _testboard->LoopMultiRocOnePixelDacDacScan(roci2cs, column, row, nTriggers, flags, dac2reg, dac2step, dac2min, dac2max, dac3reg, dac3step, dac3min, dac3max);
+      }
+      else if(allpixels) {
+	done = _testboard->LoopSingleRocAllPixelsDacDacScan(roci2cs.front(), nTriggers, flags, dac2reg, dac2step, dac2min, dac2max, dac3reg, dac3step, dac3min, dac3max);
+      }
+      else {
+	done = _testboard->LoopSingleRocOnePixelDacDacScan(roci2cs.front(), column, row, nTriggers, flags, dac2reg, dac2step, dac2min, dac2max, dac3reg, dac3step, dac3min, dac3max);
+      }
+      LOG(logDEBUGHAL) << "Loop for DAC1 = " << dac1 << " " << (done ? "finished" : "interrupted") << " (" << t << "ms), reading " << daqBufferStatus() << " words...";
+
+      try {
+	std::vector<Event*> tmpdata = daqAllEvents();
+	LOG(logDEBUGHAL) << tmpdata.size() << " events read (" << t << "ms).";
+	steps.back().insert(steps.back().end(),tmpdata.begin(),tmpdata.end());
+      }
+      catch(const DataDecodingError &) {
+	LOG(logCRITICAL) << "Error in DAQ. Aborting test.";
+	aborted = true;
+	break;
+      }
+    }
+  }
+
+  // Clear & reset the DAQ buffer on the testboard.
+  daqStop();
+  daqClear();
+
+  // check for errors in readout (i.e. missing events), every DAC1 step has to be complete:
+  int missing = expected;
+  bool complete = true;
+  for(std::vector< std::vector<Event*> >::iterator step = steps.begin(); step != steps.end(); ++step) {
+    missing -= step->size();
+    if(step->size() != block*npixels) complete = false;
+  }
+  LOG(logDEBUGHAL) << "Loop done after " << t << "ms. Readout size: " << (expected - missing) << " events.";
+
+  if(missing != 0 || !complete) {
+    LOG(logCRITICAL) << "Incomplete DAQ data readout! Missing " << missing << " Events.";
+    // serious runtime issue as data is invalid and cannot be recovered at this point:
+    for(std::vector< std::vector<Event*> >::iterator step = steps.begin(); step != steps.end(); ++step) {
+      for(std::vector<Event*>::iterator evtit = step->begin(); evtit != step->end(); evtit++) { delete *evtit; }
+    }
+    throw DataMissingEvent("Incomplete DAQ data readout in function "+std::string(__func__),missing);
+  }
+
+  // Interleave the DAC1 steps to have all DAC combinations of one pixel in a row:
+  std::vector<Event*> data;
+  data.reserve(expected);
+  for(size_t px = 0; px < npixels; px++) {
+    for(std::vector< std::vector<Event*> >::iterator step = steps.begin(); step != steps.end(); ++step) {
+      data.insert(data.end(), step->begin() + px*block, step->begin() + (px+1)*block);
+    }
+  }
+
+  return data;
+}
+
+std::vector<Event*> hal::MultiRocAllPixelsDacListScan(std::vector<uint8_t> roci2cs, std::vector<int32_t> parameter) {
+  return DacListScan(roci2cs, true, true, 0, 0, parameter);
+}
+
+std::vector<Event*> hal::MultiRocOnePixelDacListScan(std::vector<uint8_t> roci2cs, uint8_t column, uint8_t row, std::vector<int32_t> parameter) {
+  return DacListScan(roci2cs, true, false, column, row, parameter);
+}
+
+std::vector<Event*> hal::SingleRocAllPixelsDacListScan(uint8_t roci2c, std::vector<int32_t> parameter) {
+  return DacListScan(std::vector<uint8_t>(1, roci2c), false, true, 0, 0, parameter);
+}
+
+std::vector<Event*> hal::SingleRocOnePixelDacListScan(uint8_t roci2c, uint8_t column, uint8_t row, std::vector<int32_t> parameter) {
+  return DacListScan(std::vector<uint8_t>(1, roci2c), false, false, column, row, parameter);
+}
+
+std::vector<Event*> hal::DacListScan(std::vector<uint8_t> roci2cs, bool multiroc, bool allpixels, uint8_t column, uint8_t row, std::vector<int32_t> parameter) {
+
+  uint8_t dacreg = static_cast<uint8_t>(parameter.at(0));
+  int32_t switchreg = parameter.at(1);
+  uint16_t flags = static_cast<uint16_t>(parameter.at(2));
+  uint16_t nTriggers = static_cast<uint16_t>(parameter.at(3));
+
+  // The list of DAC values, each with the value of the switched register:
+  size_t nsteps = (parameter.size() - 4)/2;
+  std::vector<uint8_t> dacvalues, switchvalues;
+  for(size_t i = 0; i < nsteps; i++) {
+    dacvalues.push_back(static_cast<uint8_t>(parameter.at(4 + 2*i)));
+    switchvalues.push_back(static_cast<uint8_t>(parameter.at(5 + 2*i)));
+  }
+
+  // One block of Events per pixel and list entry:
+  size_t npixels = (allpixels ? ROC_NUMROWS*ROC_NUMCOLS : 1);
+  int expected = nsteps*nTriggers*npixels;
+
+  LOG(logDEBUGHAL) << "Called " << (multiroc ? "MultiRoc" : "SingleRoc") << (allpixels ? "AllPixels" : "OnePixel")
+		   << "DacListScan with flags " << listFlags(flags) << ", running " << nTriggers << " triggers.";
+  if(allpixels) { LOG(logDEBUGHAL) << "Function will take care of all pixels on " << roci2cs.size() << " ROCs with the I2C addresses:"; }
+  else {
+    LOG(logDEBUGHAL) << "Function will take care of pixel " << static_cast<int>(column) << ","
+		     << static_cast<int>(row) << " on "
+		     << roci2cs.size() << " ROCs with the I2C addresses:";
+  }
+  LOG(logDEBUGHAL) << listVector(roci2cs);
+  LOG(logDEBUGHAL) << "Scanning DAC " << static_cast<int>(dacreg) << " over the values " << listVector(dacvalues);
+  if(switchreg >= 0) { LOG(logDEBUGHAL) << "with DAC " << switchreg << " set to " << listVector(switchvalues); }
+  LOG(logDEBUGHAL) << "Expecting " << expected << " events.";
+  estimateDataVolume(expected, roci2cs.size());
+
+  // Prepare for data acquisition, the session is kept open for all list entries:
+  daqStart(deser160phase);
+  timer t;
+
+  // Data read for every list entry, ordered by pixel:
+  std::vector< std::vector<Event*> > steps;
+  bool aborted = false;
+  for(size_t step = 0; step < nsteps && !aborted; step++) {
+    // Only reprogram the switched register when its value changes:
+    if(switchreg >= 0 && (step == 0 || switchvalues.at(step) != switchvalues.at(step-1))) {
+      rocSetDAC(roci2cs, static_cast<uint8_t>(switchreg), switchvalues.at(step));
+    }
+    rocSetDAC(roci2cs, dacreg, dacvalues.at(step));
+    steps.push_back(std::vector<Event*>());
+
+    // Call the RPC command containing the trigger loop:
+    bool done = false;
+    while(!done) {
+      if(multiroc && allpixels) { done = _testboard->LoopMultiRocAllPixelsCalibrate(roci2cs, nTriggers, flags); }
+      else if(multiroc) { done = _testboard->LoopMultiRocOnePixelCalibrate(roci2cs, column, row, nTriggers, flags); }
+      else if(allpixels) { done = _testboard->LoopSingleRocAllPixelsCalibrate(roci2cs.front(), nTriggers, flags); }
+      else { done = _testboard->LoopSingleRocOnePixelCalibrate(roci2cs.front(), column, row, nTriggers, flags); }
+      LOG(logDEBUGHAL) << "Loop for entry " << step << " " << (done ? "finished" : "interrupted") << " (" << t << "ms), reading " << daqBufferStatus() << " words...";
+
+      try {
+	std::vector<Event*> tmpdata = daqAllEvents();
+	LOG(logDEBUGHAL) << tmpdata.size() << " events read (" << t << "ms).";
+	steps.back().insert(steps.back().end(),tmpdata.begin(),tmpdata.end());
+      }
+      catch(const DataDecodingError &) {
+	LOG(logCRITICAL) << "Error in DAQ. Aborting test.";
+	aborted = true;
+	break;
+      }
+    }
+  }
+
+  // Clear & reset the DAQ buffer on the testboard.
+  daqStop();
+  daqClear();
+
+  // check for errors in readout (i.e. missing events), every list entry has to be complete:
+  int missing = expected;
+  bool complete = true;
+  for(std::vector< std::vector<Event*> >::iterator step = steps.begin(); step != steps.end(); ++step) {
+    missing -= step->size();
+    if(step->size() != nTriggers*npixels) complete = false;
+  }
+  LOG(logDEBUGHAL) << "Loop done after " << t << "ms. Readout size: " << (expected - missing) << " events.";
+
+  if(missing != 0 || !complete) {
+    LOG(logCRITICAL) << "Incomplete DAQ data readout! Missing " << missing << " Events.";
+    // serious runtime issue as data is invalid and cannot be recovered at this point:
+    for(std::vector< std::vector<Event*> >::iterator step = steps.begin(); step != steps.end(); ++step) {
+      for(std::vector<Event*>::iterator evtit = step->begin(); evtit != step->end(); evtit++) { delete *evtit; }
+    }
+    throw DataMissingEvent("Incomplete DAQ data readout in function "+std::string(__func__),missing);
+  }
+
+  // Interleave the list entries as a DAC scan would deliver them, all entries of one pixel in a row:
+  std::vector<Event*> data;
+  data.reserve(expected);
+  for(size_t px = 0; px < npixels; px++) {
+    for(std::vector< std::vector<Event*> >::iterator step = steps.begin(); step != steps.end(); ++step) {
+      data.insert(data.end(), step->begin() + px*nTriggers, step->begin() + (px+1)*nTriggers);
+    }
+  }
+
+  return data;
+}
+
 // Testboard power switches:
 
 void hal::HVon() {
@@ -1585,6 +1916,7 @@ void hal::Pon() {
   m_roctype = ROC_NONE;
   m_roccount = 0;
   m_tokenchains.clear();
+  m_notokenpass.clear();
 
   // Wait a little and let the power switch do its job:
   mDelay(300);
@@ -1671,10 +2003,54 @@ void hal::SigSetLVDS(){
 }
 
 
+bool hal::daqSetConfig(bool hugePages, bool lockMemory, int readerCpu, int decoderCpu) {
+
+  bool ok = _testboard->SetReaderConfig(readerCpu, hugePages, lockMemory);
+  if(!ok) { LOG(logWARNING) << "USB reader settings not fully supported by this testboard interface."; }
+
+  m_lockmemory = lockMemory;
+  m_decodercpu = decoderCpu;
+
+  // A running session already pinned the DAQ thread, move it right away. The
+  // affinity saved by daqStart stays the one restored by daqClear:
+  if(!m_cpumask.empty()) {
+    if(decoderCpu < 0) {
+      restoreThreadAffinity(m_cpumask);
+      m_cpumask.clear();
+      LOG(logDEBUGHAL) << "DAQ thread unpinned.";
+    }
+    else {
+      std::vector<int> previous;
+      if(pinThread(decoderCpu, previous)) { LOG(logDEBUGHAL) << "DAQ thread moved to CPU " << decoderCpu; }
+      else {
+	LOG(logWARNING) << "Cannot pin the DAQ thread to CPU " << decoderCpu << ", keeping the current pinning until daqClear.";
+	m_decodercpu = -1;
+	ok = false;
+      }
+    }
+  }
+  // Check the decoder core right away instead of failing silently at daqStart:
+  else if(decoderCpu >= 0) {
+    std::vector<int> previous;
+    if(!pinThread(decoderCpu, previous)) {
+      LOG(logWARNING) << "Cannot pin the DAQ thread to CPU " << decoderCpu << ".";
+      m_decodercpu = -1;
+      ok = false;
+    }
+    else { restoreThreadAffinity(previous); }
+  }
+  return ok;
+}
 
 void hal::daqStart(uint8_t deser160phase, uint32_t buffersize) {
 
   LOG(logDEBUGHAL) << "Starting new DAQ session.";
+
+  // Pin the thread running the DAQ until the session data is cleared again:
+  if(m_decodercpu >= 0 && m_cpumask.empty()) {
+    if(pinThread(m_decodercpu, m_cpumask)) { LOG(logDEBUGHAL) << "DAQ thread pinned to CPU " << m_decodercpu; }
+    else { m_cpumask.clear(); }
+  }
   for(uint8_t channel = 0; channel < DTB_DAQ_CHANNELS; channel++) { m_daqstatus.push_back(false); }
 
   // Clear all decoder instances:
@@ -1702,7 +2078,9 @@ void hal::daqStart(uint8_t deser160phase, uint32_t buffersize) {
 		     << (m_notokenpass.at(i) ? 0 : static_cast<int>(m_tokenchains.at(i)))
 		     << " offset " << static_cast<int>(rocid_offset) << " buffer " << allocated_buffer;
     // Initialize the data source, set tokenchain length to zero of no token pass is expected:
+    m_src.at(i).Release();
     m_src.at(i) = dtbSource(_testboard,i,(m_notokenpass.at(i) ? 0 : m_tokenchains.at(i)),rocid_offset,m_tbmtype,m_roctype,true);
+    m_src.at(i).Reserve(m_lockmemory);
     m_src.at(i) >> m_splitter.at(i);
     _testboard->uDelay(100);
     // Increment the ROC id offset by the amount of ROCs expected:
@@ -1838,6 +2216,52 @@ std::vector<Event*> hal::daqAllEvents() {
   return evt;
 }
 
+std::vector<packedEvent> hal::daqAllPackedEvents() {
+
+  std::vector<packedEvent> evt;
+  
+  // Prepare channel flags:
+  std::vector<bool> done_ch;
+  for(size_t i = 0; i < m_src.size(); i++) { done_ch.push_back(false); }
+
+  while(1) {
+    // Pack the next Event from each of the pipes. The decoder hands out its
+    // internal Event, so no intermediate Event is allocated per trigger:
+    packedEvent current_Event;
+    for(size_t ch = 0; ch < m_src.size(); ch++) {
+      if(m_src.at(ch).isConnected()) {
+	dataSink<Event*> Eventpump;
+	m_splitter.at(ch) >> m_decoder.at(ch) >> Eventpump;
+
+	// Add all pixel hits from this channel, like operator+= for pxar::Event:
+	try {
+	  Event * chEvent = Eventpump.Get();
+	  for(std::vector<pixel>::const_iterator px = chEvent->pixels.begin(); px != chEvent->pixels.end(); ++px) {
+	    current_Event.pixels.push_back(packedPixel(*px));
+	  }
+	}
+	catch (dsBufferEmpty &) {
+	  LOG(logDEBUGHAL) << "Finished readout Channel " << ch << ".";
+	  done_ch.at(ch) = true;
+	}
+	catch (dataPipeException &e) { LOG(logERROR) << e.what(); return evt; }
+      }
+      else { done_ch.at(ch) = true; }
+    }
+      
+    // If all readout is finished, return:
+    std::vector<bool>::iterator fin = std::find(done_ch.begin(), done_ch.end(), false);
+    if(fin == done_ch.end()) {
+      LOG(logDEBUGHAL) << "Drained all DAQ channels.";
+      break;
+    }
+    else { evt.push_back(current_Event); }
+  }
+  
+  if(evt.empty()) throw DataNoEvent("No event available");
+  return evt;
+}
+
 rawEvent* hal::daqRawEvent() {
 
   rawEvent* current_Event = new rawEvent();
@@ -2032,7 +2456,16 @@ void hal::daqStop() {
 void hal::daqClear() {
 
   // Disconnect the data pipes from the DTB:
-  for(size_t ch = 0; ch < m_src.size(); ch++) { m_src.at(ch) = dtbSource(); }
+  for(size_t ch = 0; ch < m_src.size(); ch++) {
+    m_src.at(ch).Release();
+    m_src.at(ch) = dtbSource();
+  }
+
+  // The data of the session is gone, let the DAQ thread run on all its previous cores again:
+  if(!m_cpumask.empty()) {
+    restoreThreadAffinity(m_cpumask);
+    m_cpumask.clear();
+  }
 
   // Running Daq_Close() to delete all data and free allocated RAM:
   LOG(logDEBUGHAL) << "Closing DAQ session, deleting data buffers.";
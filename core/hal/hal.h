@@ -108,11 +108,23 @@ namespace pxar {
      */
     bool rocSetDAC(uint8_t roci2c, uint8_t dacId, uint8_t dacValue);
 
+    /** Set a DAC to the same value on all ROCs with the I2C addresses provided.
+     *  All register writes are queued and sent to the testboard with one single
+     *  flush, a ROC Reset after programming WBC is only sent once.
+     */
+    bool rocSetDAC(std::vector<uint8_t> roci2c, uint8_t dacId, uint8_t dacValue);
+
     /** Set all DACs on a specific ROC with I2C address roci2c
      *  DACs are provided as map of uint8_t,uint8_t pairs  with DAC Id and DAC value.
      */
     bool rocSetDACs(uint8_t roci2c, std::map< uint8_t, uint8_t > dacPairs);
 
+    /** Set DACs on several ROCs, provided as map of ROC I2C address to map of
+     *  DAC Id and DAC value. All register writes are sent to the testboard with
+     *  one single flush, a ROC Reset after programming WBC is only sent once.
+     */
+    bool rocSetDACs(std::map< uint8_t, std::map< uint8_t, uint8_t > > rocDacPairs);
+
     /** Set a register on a specific TBM at hubid
      */
     bool tbmSetReg(uint8_t hubid, uint8_t regId, uint8_t regValue);
@@ -161,6 +173,14 @@ namespace pxar {
      */
     double getTBvd();
 
+    /** Scan a DAC of the given ROC and sample the testboard analog (or digital)
+     *  current for every DAC setting. After changing the DAC the current is
+     *  sampled every sampleDelay microseconds until nStable consecutive samples
+     *  agree within the given tolerance (in A), or maxSamples samples are taken.
+     *  Returns pairs of DAC value and the last sampled current in A.
+     */
+    std::vector<std::pair<uint8_t,double> > rocCurrentVsDac(uint8_t roci2c, uint8_t dacReg, uint8_t dacStep, uint8_t dacMin, uint8_t dacMax, bool analog, double tolerance, uint16_t nStable, uint16_t maxSamples, uint16_t sampleDelay);
+
 
     // Testboard probe channel commands:
     /** Selects "signal" as output for the DTB probe channel D1 (digital) 
@@ -289,8 +309,71 @@ namespace pxar {
      */
     std::vector<Event*> SingleRocOnePixelDacDacScan(uint8_t roci2c, uint8_t column, uint8_t row, std::vector<int32_t> parameter);
 
+    /** Function to scan three given DAC ranges for all pixels on multiple ROCs, selected via their I2C address
+     *  The outermost DAC is stepped by the HAL, the inner two are scanned by the DacDac trigger loop
+     *  on the testboard, all within one DAQ session. Events are returned ordered by pixel, then by DAC1,
+     *  DAC2 and DAC3.
+     *  Public flags contain possibility to route the calibrate pulse via the sensor (FLAG_CALS) and
+     *  possibility for cross-talk measurement (FLAG_XTALK)
+     */
+    std::vector<Event*> MultiRocAllPixelsDacDacDacScan(std::vector<uint8_t> roci2cs, std::vector<int32_t> parameter);
+
+    /** Function to scan three given DAC ranges for all pixels on one ROC
+     *  Public flags contain possibility to route the calibrate pulse via the sensor (FLAG_CALS) and
+     *  possibility for cross-talk measurement (FLAG_XTALK)
+     */
+    std::vector<Event*> SingleRocAllPixelsDacDacDacScan(uint8_t roci2c, std::vector<int32_t> parameter);
+
+    /** Function to scan three given DAC ranges for a pixel on multiple ROCs, selected via their I2C address
+     *  Public flags contain possibility to route the calibrate pulse via the sensor (FLAG_CALS) and
+     *  possibility for cross-talk measurement (FLAG_XTALK)
+     */
+    std::vector<Event*> MultiRocOnePixelDacDacDacScan(std::vector<uint8_t> roci2cs, uint8_t column, uint8_t row, std::vector<int32_t> parameter);
+
+    /** Function to scan three given DAC ranges for a pixel on one ROC
+     *  Public flags contain possibility to route the calibrate pulse via the sensor (FLAG_CALS) and
+     *  possibility for cross-talk measurement (FLAG_XTALK)
+     */
+    std::vector<Event*> SingleRocOnePixelDacDacDacScan(uint8_t roci2c, uint8_t column, uint8_t row, std::vector<int32_t> parameter);
+
+    /** Function to scan a DAC over a list of arbitrary values for all pixels on multiple ROCs, selected
+     *  via their I2C address. A second register can be switched along with the list, it is only
+     *  reprogrammed when its value changes. All values are scanned within one DAQ session, the events
+     *  are returned ordered by pixel and then by list entry.
+     *  Public flags contain possibility to route the calibrate pulse via the sensor (FLAG_CALS) and
+     *  possibility for cross-talk measurement (FLAG_XTALK)
+     */
+    std::vector<Event*> MultiRocAllPixelsDacListScan(std::vector<uint8_t> roci2cs, std::vector<int32_t> parameter);
+
+    /** Function to scan a DAC over a list of arbitrary values for all pixels on one ROC
+     *  Public flags contain possibility to route the calibrate pulse via the sensor (FLAG_CALS) and
+     *  possibility for cross-talk measurement (FLAG_XTALK)
+     */
+    std::vector<Event*> SingleRocAllPixelsDacListScan(uint8_t roci2c, std::vector<int32_t> parameter);
+
+    /** Function to scan a DAC over a list of arbitrary values for a pixel on multiple ROCs, selected
+     *  via their I2C address
+     *  Public flags contain possibility to route the calibrate pulse via the sensor (FLAG_CALS) and
+     *  possibility for cross-talk measurement (FLAG_XTALK)
+     */
+    std::vector<Event*> MultiRocOnePixelDacListScan(std::vector<uint8_t> roci2cs, uint8_t column, uint8_t row, std::vector<int32_t> parameter);
+
+    /** Function to scan a DAC over a list of arbitrary values for a pixel on one ROC
+     *  Public flags contain possibility to route the calibrate pulse via the sensor (FLAG_CALS) and
+     *  possibility for cross-talk measurement (FLAG_XTALK)
+     */
+    std::vector<Event*> SingleRocOnePixelDacListScan(uint8_t roci2c, uint8_t column, uint8_t row, std::vector<int32_t> parameter);
+
 
     // DAQ functions:
+    /** Configure the memory and threads of the readout chain: USB reader
+     *  ring buffer in huge pages and/or locked in RAM, USB reader thread and
+     *  DAQ (decoder) thread pinned to the given CPU cores, -1 for no pinning.
+     *  A DAQ thread already pinned by a running session is moved immediately.
+     *  Returns false if any of the settings could not be applied.
+     */
+    bool daqSetConfig(bool hugePages, bool lockMemory, int readerCpu, int decoderCpu);
+
     /** Starting a new data acquisition session
      */
     void daqStart(uint8_t deser160phase, uint32_t buffersize = DTB_SOURCE_BUFFER_SIZE);
@@ -348,6 +431,11 @@ namespace pxar {
      */
     std::vector<Event*> daqAllEvents();
 
+    /** Read all remaining decoded Events from the FIFO buffer, packing the
+     *  pixel hits of all channels directly into pxar::packedEvent records
+     */
+    std::vector<packedEvent> daqAllPackedEvents();
+
     /** Return the current decoding statistics for all channels:
      */
     statistics daqStatistics();
@@ -401,6 +489,20 @@ namespace pxar {
 
   private:
 
+    /** Common implementation of the DacDacDac scans: steps DAC1 and runs the
+     *  matching DacDac trigger loop on the testboard for every step without
+     *  restarting the DAQ in between. The events are reordered such that all
+     *  DAC combinations of one pixel follow each other.
+     */
+    std::vector<Event*> DacDacDacScan(std::vector<uint8_t> roci2cs, bool multiroc, bool allpixels, uint8_t column, uint8_t row, std::vector<int32_t> parameter);
+
+    /** Common implementation of the DAC list scans: programs every list entry
+     *  and runs the calibrate trigger loop on the testboard without
+     *  restarting the DAQ in between. The events are reordered as delivered
+     *  by a regular DAC scan.
+     */
+    std::vector<Event*> DacListScan(std::vector<uint8_t> roci2cs, bool multiroc, bool allpixels, uint8_t column, uint8_t row, std::vector<int32_t> parameter);
+
     /** Private instance of the testboard RPC interface, routes all
      *  hardware access:
      */
@@ -432,6 +534,12 @@ namespace pxar {
 
     uint16_t _currentTrgSrc;
 
+    // DAQ memory and thread settings, see daqSetConfig():
+    bool m_lockmemory;
+    int m_decodercpu;
+    // CPU cores the DAQ thread was allowed to run on before pinning it:
+    std::vector<int> m_cpumask;
+
     /** Print the info block with software and firmware versions,
      *  MAC and USB ids etc. read from the connected testboard
      */
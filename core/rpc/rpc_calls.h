@@ -126,6 +126,15 @@ public:
 	  rpc_io = &RpcIoNull;
 	}
 
+	// Pin the USB reader thread and configure its ring buffer memory,
+	// returns false if a setting is not supported by the selected interface:
+	bool SetReaderConfig(int cpu, bool hugePages, bool lockMemory) {
+#ifdef INTERFACE_USB
+	  if(usb != NULL && rpc_io == usb) return usb->SetReaderConfig(cpu, hugePages, lockMemory);
+#endif /* INTERFACE_USB */
+	  return (cpu < 0 && !hugePages && !lockMemory);
+	}
+
 	bool EnumFirst(CRpcIo* io, unsigned int &nDevices) { return io->EnumFirst(nDevices); }
 	bool EnumNext(CRpcIo* io, string &name) {
 	  char s[64];
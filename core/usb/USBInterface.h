@@ -92,6 +92,11 @@ public:
   bool Show();
   void SetTimeout(unsigned int timeout);
 
+  // Pin the USB reader thread to CPU core "cpu" (-1: all cores) and back
+  // its ring buffer with huge pages / lock it in RAM. Returns false if not
+  // supported by the USB library or the platform.
+  bool SetReaderConfig(int cpu, bool hugePages, bool lockMemory);
+
 
   // read methods
 
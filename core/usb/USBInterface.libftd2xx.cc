@@ -357,6 +357,13 @@ void CUSB::SetTimeout(unsigned int timeout)
   FT_SetTimeouts(ftHandle,m_timeout,m_timeout);
 }
 
+bool CUSB::SetReaderConfig(int cpu, bool hugePages, bool lockMemory)
+{
+  // The D2XX driver reads the device in its own threads and buffers,
+  // neither can be configured from here:
+  return (cpu < 0 && !hugePages && !lockMemory);
+}
+
 void CUSB::Read_String(char *s, uint16_t maxlength)
 {
 	char ch = 0;
@@ -15,6 +15,10 @@
 // needed for threaded readout of FTDI
 #include <pthread.h> 
 #include <semaphore.h>
+#include <sys/mman.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
 
 static struct ftdi_context ftdic;
 
@@ -22,9 +26,19 @@ static struct ftdi_context ftdic;
 #define BUFSIZE 0x200000
 static pthread_t readerthread;
 static sem_t buf_data, buf_space;
-static unsigned char read_buffer[BUFSIZE];
+// aligned to its size so it can be backed by a single huge page:
+static unsigned char read_buffer[BUFSIZE] __attribute__((aligned(BUFSIZE)));
 static int32_t head, tail; // read buffer is used as ring buffer
 
+// reader thread CPU core (-1: all cores) and read buffer memory settings
+static int reader_cpu = -1;
+#ifdef __linux__
+// affinity inherited by the reader thread (e.g. from taskset), restored when unpinning
+static cpu_set_t reader_default_cpus;
+static bool reader_pinned = false;
+#endif
+static bool read_buffer_huge = false, read_buffer_locked = false;
+
 // cleanup is threaded to include a timeout on the calls to the device that sometimes hang
 pthread_mutex_t cleanup_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_t usbclose_thread, usbdeinit_thread;
@@ -79,6 +93,25 @@ static void *reader (void *arg) {
     return NULL;
 }
 
+static bool pin_reader () {
+#ifdef __linux__
+  if (reader_cpu < 0) {
+    if (!reader_pinned) return true;
+    if (pthread_setaffinity_np(readerthread, sizeof(reader_default_cpus), &reader_default_cpus) != 0) return false;
+    reader_pinned = false;
+    return true;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(reader_cpu, &set);
+  if (pthread_setaffinity_np(readerthread, sizeof(set), &set) != 0) return false;
+  reader_pinned = true;
+  return true;
+#else
+  return (reader_cpu < 0);
+#endif
+}
+
 static void *usbclose (void *arg) {
   // on some circumstances, the ftdi_usb_close() call hangs;
   // this is a workaround to implement a timeout
@@ -370,6 +403,15 @@ bool CUSB::Open(char serialNumber[])
   sem_init (&buf_data, 0, 0);
   sem_init (&buf_space, 0, BUFSIZE);
   pthread_create (&readerthread, NULL, reader, &ftdic);
+#ifdef __linux__
+  reader_pinned = false;
+  if (pthread_getaffinity_np(readerthread, sizeof(reader_default_cpus), &reader_default_cpus) != 0) {
+    sched_getaffinity(0, sizeof(reader_default_cpus), &reader_default_cpus);
+  }
+#endif
+  if (reader_cpu >= 0 && !pin_reader()) {
+    LOG(logWARNING) << "Could not pin USB reader thread to CPU " << reader_cpu;
+  }
 
   return true;
 }
@@ -530,6 +572,38 @@ void CUSB::SetTimeout(unsigned int timeout)
   m_timeout = timeout;
 }
 
+bool CUSB::SetReaderConfig(int cpu, bool hugePages, bool lockMemory)
+{
+  bool ok = true;
+
+  reader_cpu = cpu;
+  if (isUSB_open && !pin_reader()) {
+    LOG(logWARNING) << "Could not pin USB reader thread to CPU " << cpu;
+    ok = false;
+  }
+
+#ifdef MADV_HUGEPAGE
+  if (hugePages != read_buffer_huge) {
+    if (madvise(read_buffer, BUFSIZE, hugePages ? MADV_HUGEPAGE : MADV_NOHUGEPAGE) == 0) read_buffer_huge = hugePages;
+  }
+#endif
+  if (hugePages && !read_buffer_huge) {
+    LOG(logWARNING) << "Huge pages not available for the USB read buffer";
+    ok = false;
+  }
+
+  if (lockMemory != read_buffer_locked) {
+    if (lockMemory) read_buffer_locked = (mlock(read_buffer, BUFSIZE) == 0);
+    else read_buffer_locked = (munlock(read_buffer, BUFSIZE) != 0);
+  }
+  if (lockMemory && !read_buffer_locked) {
+    LOG(logWARNING) << "Could not lock the USB read buffer in memory";
+    ok = false;
+  }
+
+  return ok;
+}
+
 //----------------------------------------------------------------------
 void CUSB::Read_String(char *s, uint16_t maxlength)
 {
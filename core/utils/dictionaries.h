@@ -66,18 +66,21 @@ namespace pxar {
       return &instance;
     }
 
-    // Return the register id for the name in question:
+    // Return the register id for the name in question, unknown names and
+    // registers of another type return the type:
     inline uint8_t getRegister(std::string name, uint8_t type) {
-      if(_registers.find(name)->second._type == type) {
-	return _registers.find(name)->second._id;
+      std::map<std::string, dacConfig>::iterator iter = _registers.find(name);
+      if(iter != _registers.end() && iter->second._type == type) {
+	return iter->second._id;
       }
       else { return type;}
     }
 
     // Return the register size for the register in question:
     inline uint8_t getSize(std::string name, uint8_t type) {
-	if(_registers.find(name)->second._type == type) {
-	  return _registers.find(name)->second._size;
+	std::map<std::string, dacConfig>::iterator iter = _registers.find(name);
+	if(iter != _registers.end() && iter->second._type == type) {
+	  return iter->second._size;
 	}
 	else { return type;}
     }
@@ -25,6 +25,10 @@ typedef unsigned char uint8_t;
 #include <unistd.h>
 #endif // WIN32
 
+#ifdef __linux__
+#include <sched.h>
+#endif // __linux__
+
 #include "api.h"
 
 #include <algorithm>
@@ -46,6 +50,40 @@ namespace pxar {
 #endif
   }
 
+  /** Pin the calling thread to the CPU core "cpu"
+   *  The cores the thread was allowed to run on before are returned in
+   *  "previous" and can be restored with restoreThreadAffinity().
+   *  Only supported on Linux, returns false on other platforms.
+   */
+  bool inline pinThread(int cpu, std::vector<int> & previous) {
+#ifdef __linux__
+    cpu_set_t set;
+    if(cpu < 0 || cpu >= CPU_SETSIZE) return false;
+    if(sched_getaffinity(0, sizeof(set), &set) != 0) return false;
+    previous.clear();
+    for(int i = 0; i < CPU_SETSIZE; i++) { if(CPU_ISSET(i, &set)) previous.push_back(i); }
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return (sched_setaffinity(0, sizeof(set), &set) == 0);
+#else
+    return false;
+#endif
+  }
+
+  /** Allow the calling thread to run on the CPU cores "cpus" again,
+   *  see pinThread()
+   */
+  bool inline restoreThreadAffinity(const std::vector<int> & cpus) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for(std::vector<int>::const_iterator cpu = cpus.begin(); cpu != cpus.end(); ++cpu) { CPU_SET(*cpu, &set); }
+    return (sched_setaffinity(0, sizeof(set), &set) == 0);
+#else
+    return false;
+#endif
+  }
+
   /** Helper class to search vectors of pixelConfig, rocConfig and tbmConfig for 'enable' bit
    */
   class configEnableSet
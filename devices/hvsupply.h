@@ -28,11 +28,36 @@ typedef unsigned char uint8_t;
 
 namespace pxar {
 
+  class HVSupply;
+
+  /** Handle to a voltage and current reading requested asynchronously
+   *  via HVSupply::getVoltsAmpsAsync(). The reading is taken by the serial
+   *  worker thread, the caller only blocks when fetching the result.
+   */
+  class DLLEXPORT HVReading {
+    friend class HVSupply;
+    HVSupply *supply;
+    std::vector<RS232Future> replies;
+
+  public:
+    HVReading() : supply(NULL), replies() {}
+
+    /** Returns true if the reading has been taken, never blocks
+     */
+    bool ready();
+
+    /** Waits for the reading and returns voltage (V) and current (A).
+     *  Returns false if the device did not answer.
+     */
+    bool get(double &volts, double &amps);
+  };
+
   /** pxar interface class for HV Power Supply devices
    *
    *  Correct implementation for your device has to be chosen at compile time.
    */
   class DLLEXPORT HVSupply {
+    friend class HVReading;
     RS232Conn serial;
     
   /** Private variables related to keeping track of IV sweeps*/
@@ -87,6 +112,12 @@ namespace pxar {
      */
     void getVoltsAmps(double &volts, double &amps);
 
+    /** Requests voltage and current readings without blocking the caller, e.g.
+     *  for monitoring the HV during data taking. The result is fetched from
+     *  the returned pxar::HVReading.
+     */
+    HVReading getVoltsAmpsAsync();
+
     /** Enables compliance mode and sets the current limit (to be given in uA,
      *  micro Ampere)
      */
@@ -110,9 +141,35 @@ namespace pxar {
     /** Consume a reading from the IV curve in progress. Returns true if sweep was aborted
      */
     bool sweepRead(double &voltSet, double &voltRead, double &amps);
+
+  private:
+    /** Decodes the device answers to the queries sent by getVoltsAmpsAsync()
+     */
+    void parseVoltsAmps(const std::vector<std::string> &answers, double &volts, double &amps);
   
   }; // class hvsupply
 
+  inline bool HVReading::ready() {
+    for(std::vector<RS232Future>::iterator it = replies.begin(); it != replies.end(); ++it) {
+      // A request that could not be queued counts as answered, get() fails:
+      if(it->valid() && !it->ready()) return false;
+    }
+    return !replies.empty();
+  }
+
+  inline bool HVReading::get(double &volts, double &amps) {
+    volts = amps = 0;
+    if(!supply || replies.empty()) return false;
+    std::vector<std::string> answers;
+    for(std::vector<RS232Future>::iterator it = replies.begin(); it != replies.end(); ++it) {
+      std::string answer;
+      if(!it->get(answer)) return false;
+      answers.push_back(answer);
+    }
+    supply->parseVoltsAmps(answers, volts, amps);
+    return true;
+  }
+
 
   /** to_string
    *  Converts stringstream compatable objects to their string representation
@@ -81,6 +81,7 @@ HVSupply::HVSupply(const string &portName, double timeout) {
   serial.setFlowControl(false);
   serial.setParity(false);       //Uses no parity bit
   serial.setRemoveEcho(true);
+  serial.setWriteDelay(.02);     //Give the device time to process each command
   bool portIsOpen = serial.openPort();
 
   if(!portIsOpen) {
@@ -181,6 +182,21 @@ void HVSupply::getVoltsAmps(double &volts, double &amps){
   amps = getAmps();
 }
 
+HVReading HVSupply::getVoltsAmpsAsync(){
+  HVReading reading;
+  reading.supply = this;
+  reading.replies.push_back(serial.writeReadBackAsync("U1"));
+  reading.replies.push_back(serial.writeReadBackAsync("I1"));
+  return reading;
+}
+
+void HVSupply::parseVoltsAmps(const vector<string> &answers, double &volts, double &amps){
+  volts = amps = 0;
+  if(answers.size() < 2) return;
+  volts = outToDouble(answers[0]);
+  amps = outToDouble(answers[1]);
+}
+
 
 // Enables Compliance mode and sets the current limit (to be given in uA, micro Ampere)
 bool HVSupply::setMicroampsLimit(double microamps) {
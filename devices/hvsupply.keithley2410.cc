@@ -33,6 +33,7 @@ HVSupply::HVSupply(const string &portname, double timeout)
   serial.setParity(true);       //Uses odd parity bit
   serial.setRemoveEcho(false);  //Keithley2410 does not echo input
   serial.setTimeout(timeout);
+  serial.setWriteDelay(.02);     //Give the Keithley time to process each command
 
   bool portIsOpen = serial.openPort();
   if (!portIsOpen) {
@@ -119,7 +120,23 @@ void HVSupply::getVoltsAmps(double &volts, double &amps)
 {
   string answer;
   serial.writeReadBack(":READ?", answer);
-  sscanf(answer.c_str(), "%le,%le", &volts, &amps);
+  vector<string> answers(1, answer);
+  parseVoltsAmps(answers, volts, amps);
+}
+
+HVReading HVSupply::getVoltsAmpsAsync()
+{
+  HVReading reading;
+  reading.supply = this;
+  reading.replies.push_back(serial.writeReadBackAsync(":READ?"));
+  return reading;
+}
+
+void HVSupply::parseVoltsAmps(const vector<string> &answers, double &volts, double &amps)
+{
+  volts = amps = 0;
+  if(answers.size() < 1) return;
+  sscanf(answers[0].c_str(), "%le,%le", &volts, &amps);
 }
 
 double HVSupply::getVolts()
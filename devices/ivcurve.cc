@@ -0,0 +1,230 @@
+/**
+ * pxar IV curve measurement engine
+ */
+
+#include "ivcurve.h"
+#include "hvsupply.h"
+#include "log.h"
+
+#include <sys/time.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <cmath>
+
+using namespace pxar;
+using namespace std;
+
+// Current changes below this absolute value are always considered settled [A]:
+#define IV_ABS_TOLERANCE 1E-11
+
+static double now() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec*1E-6;
+}
+
+// ----------------------------------------------------------------------
+bool HVSupplySource::hvOn() { return supply.hvOn(); }
+
+bool HVSupplySource::hvOff() { return supply.hvOff(); }
+
+bool HVSupplySource::setVolts(double volts) { return supply.setVolts(volts); }
+
+void HVSupplySource::getVoltsAmps(double &volts, double &amps) {
+  HVReading reading = supply.getVoltsAmpsAsync();
+  while(idle && !reading.ready()) {
+    idle(idleData);
+    usleep(10000);
+  }
+  if(!reading.get(volts, amps)) {
+    LOG(logWARNING) << "HV supply did not answer";
+  }
+}
+
+bool HVSupplySource::isTripped() { return supply.isTripped(); }
+
+// ----------------------------------------------------------------------
+SimulatedIVSource::SimulatedIVSource(double leakage, double breakdown, double slope,
+				     double tau, double noise, double compliance) :
+  leakage(leakage), breakdown(breakdown), slope(slope), tau(tau), noise(noise),
+  compliance(compliance), volts(0), lastVolts(0), tChange(now()), on(false), tripped(false) {}
+
+double SimulatedIVSource::target(double v) const {
+  double u = fabs(v);
+  double amps = leakage*u;
+  if(u > breakdown) amps += leakage*breakdown*(exp(slope*(u - breakdown)) - 1);
+  return (v < 0) ? -amps : amps;
+}
+
+bool SimulatedIVSource::hvOn() {
+  on = true;
+  tripped = false;
+  tChange = now();
+  return true;
+}
+
+bool SimulatedIVSource::hvOff() {
+  on = false;
+  return true;
+}
+
+bool SimulatedIVSource::setVolts(double v) {
+  lastVolts = volts;
+  volts = v;
+  tChange = now();
+  return true;
+}
+
+void SimulatedIVSource::getVoltsAmps(double &v, double &amps) {
+  if(!on || tripped) {
+    v = amps = 0;
+    return;
+  }
+  // Charging spike after the last voltage change, decaying exponentially:
+  double spike = 0.5*fabs(target(volts) - target(lastVolts))*exp(-(now() - tChange)/tau);
+  double base = target(volts);
+  amps = base + ((base < 0) ? -spike : spike);
+  amps *= 1 + noise*(2.0*rand()/RAND_MAX - 1);
+  v = volts;
+
+  if(fabs(amps) > compliance) {
+    LOG(logWARNING) << "Simulated HV supply tripped at " << volts << " V";
+    tripped = true;
+    amps = (amps < 0) ? -compliance : compliance;
+  }
+}
+
+bool SimulatedIVSource::isTripped() {
+  return tripped;
+}
+
+// ----------------------------------------------------------------------
+IVEngine::IVEngine(IVSource &source) :
+  fSource(source), fTolerance(0.01), fSampleInterval(0.1), fMaxSettleTime(10),
+  fMinStep(0), fCompliance(0), fComplianceMargin(0.9), fCallback(NULL), fCallbackData(NULL),
+  fAborted(false), fAbortReason("") {}
+
+IVPoint IVEngine::measure(double volts, double tStart) {
+
+  IVPoint point;
+  point.voltSet = volts;
+  point.settled = false;
+
+  fSource.setVolts(volts);
+  double tSet = now();
+  fSource.getVoltsAmps(point.voltRead, point.amps);
+  point.samples = 1;
+
+  // Sample until two consecutive changes are within the tolerance:
+  int stable = 0;
+  while(now() - tSet < fMaxSettleTime) {
+    if(fSampleInterval > 0) usleep(static_cast<useconds_t>(1E6*fSampleInterval));
+    double voltRead, amps;
+    fSource.getVoltsAmps(voltRead, amps);
+    point.samples++;
+
+    double change = fabs(amps - point.amps);
+    if(change <= fTolerance*fabs(amps) || change < IV_ABS_TOLERANCE) stable++;
+    else stable = 0;
+    point.voltRead = voltRead;
+    point.amps = amps;
+
+    if(stable >= 2) {
+      point.settled = true;
+      break;
+    }
+    if(fSource.isTripped()) break;
+  }
+  point.time = now() - tStart;
+
+  LOG(logDEBUG) << "IV point " << volts << " V: " << point.amps << " A after "
+		<< point.samples << " samples" << (point.settled ? "" : " (not settled)");
+  return point;
+}
+
+double IVEngine::predict(const vector<IVPoint> &points, double volts) const {
+
+  if(points.empty()) return 0;
+  const IVPoint &last = points.back();
+  if(points.size() < 2) return fabs(last.amps);
+  const IVPoint &prev = points[points.size()-2];
+
+  // Extrapolate exponentially from the last two points:
+  double i1 = fabs(prev.amps), i2 = fabs(last.amps);
+  double u1 = fabs(prev.voltSet), u2 = fabs(last.voltSet);
+  if(i1 <= 0 || i2 <= i1 || u2 == u1) return i2;
+  double k = log(i2/i1)/(u2 - u1);
+  return i2*exp(k*(fabs(volts) - u2));
+}
+
+vector<IVPoint> IVEngine::run(double voltStart, double voltStop, double voltStep) {
+
+  vector<IVPoint> points;
+  fAborted = false;
+  fAbortReason = "";
+
+  double nominal = fabs(voltStep);
+  if(nominal <= 0) {
+    LOG(logERROR) << "IV step size must not be zero.";
+    fAborted = true;
+    fAbortReason = "invalid step size";
+    return points;
+  }
+  double minStep = (fMinStep > 0) ? fMinStep : nominal/8;
+  double direction = (voltStop < voltStart) ? -1 : 1;
+  double step = nominal;
+  double volts = voltStart;
+  double tStart = now();
+
+  fSource.setVolts(voltStart);
+  fSource.hvOn();
+
+  while(true) {
+    IVPoint point = measure(volts, tStart);
+    points.push_back(point);
+
+    if(fCallback && !fCallback(point, fCallbackData)) {
+      fAborted = true;
+      fAbortReason = "stopped";
+      break;
+    }
+    if(fSource.isTripped()) {
+      fAborted = true;
+      fAbortReason = "supply tripped";
+      break;
+    }
+    if(fabs(volts - voltStop) < 1E-6) break;
+
+    // Refine the step where the current rises steeply, relax it in flat regions:
+    if(points.size() >= 2) {
+      // Ratio of the current increase relative to an ohmic increase:
+      const IVPoint &prev = points[points.size()-2];
+      double ratio = 1;
+      if(fabs(prev.amps) > 0 && fabs(prev.voltSet) > 0 && fabs(point.voltSet) > 0) {
+	ratio = (fabs(point.amps)/fabs(prev.amps))/(fabs(point.voltSet)/fabs(prev.voltSet));
+      }
+      if(ratio > 1.5) step = max(step/2, minStep);
+      else if(ratio < 1.1) step = min(step*2, nominal);
+    }
+
+    // Stop before the next step is expected to exceed the compliance:
+    double next = volts + direction*step;
+    if(direction*(next - voltStop) > 0) next = voltStop;
+    if(fCompliance > 0) {
+      while(predict(points, next) > fComplianceMargin*fCompliance && step > minStep) {
+	step = max(step/2, minStep);
+	next = volts + direction*step;
+      }
+      if(predict(points, next) > fComplianceMargin*fCompliance) {
+	LOG(logWARNING) << "IV curve predicted to reach compliance at " << next << " V, stopping.";
+	fAborted = true;
+	fAbortReason = "compliance predicted";
+	break;
+      }
+    }
+    volts = next;
+  }
+
+  fSource.hvOff();
+  return points;
+}
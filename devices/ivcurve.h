@@ -0,0 +1,153 @@
+/**
+ * pxar IV curve measurement engine
+ * adaptive settling, step refinement and compliance prediction
+ */
+
+#ifndef PXAR_IVCURVE_H
+#define PXAR_IVCURVE_H
+
+/** Declare all classes that need to be included in shared libraries on Windows 
+ *  as class DLLEXPORT className
+ */
+#include "pxardllexport.h"
+
+#include <string>
+#include <vector>
+
+namespace pxar {
+
+  class HVSupply;
+
+  /** Interface of a voltage source with current readback used by the IV engine
+   */
+  class DLLEXPORT IVSource {
+  public:
+    virtual ~IVSource() {}
+    virtual bool hvOn() = 0;
+    virtual bool hvOff() = 0;
+    virtual bool setVolts(double volts) = 0;
+    virtual void getVoltsAmps(double &volts, double &amps) = 0;
+    virtual bool isTripped() = 0;
+  };
+
+  /** IV source driving a real HV power supply
+   *
+   *  Readings are requested asynchronously, the idle callback is called
+   *  while waiting for the device to answer (e.g. to keep a GUI responsive).
+   */
+  class DLLEXPORT HVSupplySource : public IVSource {
+  public:
+    typedef void (*IdleCallback)(void *data);
+  private:
+    HVSupply &supply;
+    IdleCallback idle;
+    void *idleData;
+  public:
+    HVSupplySource(HVSupply &supply) : supply(supply), idle(NULL), idleData(NULL) {}
+    void setIdleCallback(IdleCallback callback, void *data) { idle = callback; idleData = data; }
+    bool hvOn();
+    bool hvOff();
+    bool setVolts(double volts);
+    void getVoltsAmps(double &volts, double &amps);
+    bool isTripped();
+  };
+
+  /** Simulated sensor on a HV supply, for testing without hardware
+   *
+   *  The leakage current rises linearly with the bias voltage and breaks
+   *  down exponentially above the breakdown voltage. After every voltage
+   *  change the current shows a charging spike decaying with the given time
+   *  constant, plus relative noise. The supply trips above the compliance.
+   */
+  class DLLEXPORT SimulatedIVSource : public IVSource {
+    double leakage;      // [A/V]
+    double breakdown;    // [V]
+    double slope;        // [1/V] exponential rise above breakdown
+    double tau;          // [s] settling time constant
+    double noise;        // relative noise
+    double compliance;   // [A]
+    double volts;
+    double lastVolts;
+    double tChange;
+    bool on;
+    bool tripped;
+    double target(double v) const;
+  public:
+    SimulatedIVSource(double leakage = 1E-9, double breakdown = 400, double slope = 0.05,
+		      double tau = 0.2, double noise = 0.002, double compliance = 1E-4);
+    bool hvOn();
+    bool hvOff();
+    bool setVolts(double volts);
+    void getVoltsAmps(double &volts, double &amps);
+    bool isTripped();
+  };
+
+  /** One point of an IV curve
+   */
+  struct DLLEXPORT IVPoint {
+    double voltSet;   // [V]
+    double voltRead;  // [V]
+    double amps;      // [A]
+    double time;      // [s] since start of the measurement
+    int samples;      // number of current samples taken
+    bool settled;     // false if the current did not settle in time
+  };
+
+  /** IV curve measurement engine
+   *
+   *  At every voltage step the current is sampled continuously until the
+   *  relative change between consecutive samples stays below the tolerance
+   *  (or the maximum settling time is reached). Where the current rises
+   *  steeply the step size is reduced, down to the minimum step, and grows
+   *  back to the nominal step in flat regions. The current of the next step
+   *  is extrapolated from the last points, the sweep stops before the
+   *  source would reach the compliance.
+   */
+  class DLLEXPORT IVEngine {
+  public:
+    /** Callback for every measured point, return false to abort the sweep
+     */
+    typedef bool (*Callback)(const IVPoint &point, void *data);
+
+    IVEngine(IVSource &source);
+
+    void setTolerance(double relative) { fTolerance = relative; }
+    void setSampleInterval(double seconds) { fSampleInterval = seconds; }
+    void setMaxSettleTime(double seconds) { fMaxSettleTime = seconds; }
+    void setMinStep(double volts) { fMinStep = volts; }
+    void setCompliance(double amps) { fCompliance = amps; }
+    void setComplianceMargin(double fraction) { fComplianceMargin = fraction; }
+    void setCallback(Callback callback, void *data) { fCallback = callback; fCallbackData = data; }
+
+    /** Measures the IV curve from voltStart to voltStop with the nominal step size
+     */
+    std::vector<IVPoint> run(double voltStart, double voltStop, double voltStep);
+
+    /** Returns true if the last sweep did not reach voltStop
+     */
+    bool aborted() const { return fAborted; }
+
+    /** Reason for aborting the last sweep
+     */
+    const std::string &abortReason() const { return fAbortReason; }
+
+  private:
+    IVPoint measure(double volts, double tStart);
+    double predict(const std::vector<IVPoint> &points, double volts) const;
+
+    IVSource &fSource;
+    double fTolerance;
+    double fSampleInterval;
+    double fMaxSettleTime;
+    double fMinStep;
+    double fCompliance;
+    double fComplianceMargin;
+    Callback fCallback;
+    void *fCallbackData;
+    bool fAborted;
+    std::string fAbortReason;
+  };
+
+} //namespace pxar
+
+#endif /* PXAR_IVCURVE_H */
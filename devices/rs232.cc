@@ -39,11 +39,14 @@
 #include <sys/ioctl.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <limits.h>
 
 #include <cstdio>
+#include <cstring>
 
 #include <ctime>
 
@@ -51,21 +54,128 @@ using namespace pxar;
 using namespace std;
 
 #define NULL_FD -1
+#define READ_CHUNK 256
 //#define DEBUG_RS232
 
+static double now(){
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec*1E-6;
+}
+
+// ----------------------------------------------------------------------
+RS232Reply::RS232Reply() : refs(1), done(false), ok(false), data(){
+  pthread_mutex_init(&mutex, NULL);
+  pthread_cond_init(&cond, NULL);
+}
+
+RS232Reply::~RS232Reply(){
+  pthread_cond_destroy(&cond);
+  pthread_mutex_destroy(&mutex);
+}
+
+void RS232Reply::ref(){
+  pthread_mutex_lock(&mutex);
+  refs++;
+  pthread_mutex_unlock(&mutex);
+}
+
+void RS232Reply::unref(){
+  pthread_mutex_lock(&mutex);
+  bool last = (--refs == 0);
+  pthread_mutex_unlock(&mutex);
+  if(last) delete this;
+}
+
+void RS232Reply::set(bool ok, const string &data){
+  pthread_mutex_lock(&mutex);
+  this->ok = ok;
+  this->data = data;
+  done = true;
+  pthread_cond_broadcast(&cond);
+  pthread_mutex_unlock(&mutex);
+}
+
+// ----------------------------------------------------------------------
+RS232Future::RS232Future() : reply(NULL){}
+
+RS232Future::RS232Future(RS232Reply *reply) : reply(reply){}
+
+RS232Future::RS232Future(const RS232Future &other) : reply(other.reply){
+  if(reply) reply->ref();
+}
+
+RS232Future &RS232Future::operator=(const RS232Future &other){
+  if(other.reply) other.reply->ref();
+  if(reply) reply->unref();
+  reply = other.reply;
+  return *this;
+}
+
+RS232Future::~RS232Future(){
+  if(reply) reply->unref();
+}
+
+bool RS232Future::valid() const{
+  return (reply != NULL);
+}
+
+bool RS232Future::ready(){
+  if(!reply) return false;
+  pthread_mutex_lock(&reply->mutex);
+  bool done = reply->done;
+  pthread_mutex_unlock(&reply->mutex);
+  return done;
+}
+
+bool RS232Future::get(string &data){
+  if(!reply) return false;
+  pthread_mutex_lock(&reply->mutex);
+  while(!reply->done) pthread_cond_wait(&reply->cond, &reply->mutex);
+  data = reply->data;
+  bool ok = reply->ok;
+  pthread_mutex_unlock(&reply->mutex);
+  return ok;
+}
+
+bool RS232Future::wait(){
+  string data;
+  return get(data);
+}
+
+// ----------------------------------------------------------------------
 RS232Conn::RS232Conn(){
   portName = "";
   baudRate = 0;
+  flowControl = false;
+  parity = false;
+  removeEcho = false;
   timeout = 1;
+  writeDelay = 0;
   port = NULL_FD;
   terminator = "\r\n";
   readSuffix = "";
+  timedOut = false;
+  workerRunning = false;
+  workerStop = false;
+
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+  pthread_mutex_init(&ioMutex, &attr);
+  pthread_mutexattr_destroy(&attr);
+  pthread_mutex_init(&queueMutex, NULL);
+  pthread_cond_init(&queueCond, NULL);
 }
 
 RS232Conn::~RS232Conn(){
   if(port != NULL_FD){
     closePort();
   }
+  stopWorker();
+  pthread_cond_destroy(&queueCond);
+  pthread_mutex_destroy(&queueMutex);
+  pthread_mutex_destroy(&ioMutex);
 }
 
 void RS232Conn::setPortName(const string &portName){
@@ -116,6 +226,10 @@ void RS232Conn::setTimeout(double timeout){
   this->timeout = timeout;
 }
 
+void RS232Conn::setWriteDelay(double delay){
+  this->writeDelay = delay;
+}
+
 bool RS232Conn::openPort(){
   if(port != NULL_FD){
     LOG(logCRITICAL) << "[RS232] CCannot Open Port.\"" << portName << "\"Port already Open ";
@@ -202,46 +316,51 @@ bool RS232Conn::openPort(){
     return false;
   }
   
+  // Ports without modem control lines (e.g. pseudo terminals) cannot set DTR/RTS:
   int status = 0;
   rsError = ioctl(port, TIOCMGET, &status);
   if(rsError == -1){
-    closePort();
-    LOG(logCRITICAL) << "[RS232] unable to get portstatus";
-    return false;
+    LOG(logWARNING) << "[RS232] unable to get portstatus, not setting DTR/RTS";
   }
-
-  status |= TIOCM_DTR;    /* turn on DTR */
-  status |= TIOCM_RTS;    /* turn on RTS */
-
-  rsError = ioctl(port, TIOCMSET, &status);
-  if(rsError == -1){
-    closePort();
-    LOG(logCRITICAL) << "[RS232] unable to set portstatus";
-    return false;
+  else {
+    status |= TIOCM_DTR;    /* turn on DTR */
+    status |= TIOCM_RTS;    /* turn on RTS */
+
+    rsError = ioctl(port, TIOCMSET, &status);
+    if(rsError == -1){
+      closePort();
+      LOG(logCRITICAL) << "[RS232] unable to set portstatus";
+      return false;
+    }
   }
 
   tcflush(port, TCIOFLUSH); //drop any old data on port
+  inBuffer.clear();
 
   return true;
 }
 
 void RS232Conn::closePort(){
   if(port == NULL_FD) return;
-  int status;
-  if(ioctl(port, TIOCMGET, &status) == -1){
-    LOG(logCRITICAL) << "[RS232] Unable to get portstatus";
-  }
+  // Finish all pending asynchronous requests first:
+  stopWorker();
 
-  status &= ~TIOCM_DTR;    /* turn off DTR */
-  status &= ~TIOCM_RTS;    /* turn off RTS */
+  pthread_mutex_lock(&ioMutex);
+  int status;
+  if(ioctl(port, TIOCMGET, &status) == 0){
+    status &= ~TIOCM_DTR;    /* turn off DTR */
+    status &= ~TIOCM_RTS;    /* turn off RTS */
 
-  if(ioctl(port, TIOCMSET, &status) == -1){
-    LOG(logCRITICAL) << "[RS232] Unable to set portstatus";
+    if(ioctl(port, TIOCMSET, &status) == -1){
+      LOG(logCRITICAL) << "[RS232] Unable to set portstatus";
+    }
   }
 
   tcsetattr(port, TCSANOW, &oldPortSettings);
   close(port);
   port = NULL_FD;
+  inBuffer.clear();
+  pthread_mutex_unlock(&ioMutex);
 }
 
 
@@ -260,30 +379,51 @@ int RS232Conn::writeBuf(const char *buf, int len){
 
 void RS232Conn::writeData(const string &data)
 {
+  pthread_mutex_lock(&ioMutex);
   LOG(logDEBUG) << "[RS232] Sending Data : \""<<data<<"\"";
   unsigned int bytesWritten = 0;
   string dataTerm = data + terminator;
   bytesWritten += writeBuf(dataTerm.c_str(), dataTerm.size());
-  usleep(1E6*.02);
+  // Wait until the data has been transmitted, then give the device time to process it:
+  if(port != NULL_FD) tcdrain(port);
+  if(writeDelay > 0) usleep(1E6*writeDelay);
   if(removeEcho) {
     readEcho(data);
   }
   if(bytesWritten != (dataTerm.size())){
     LOG(logWARNING) << "[RS232] Missing Data on Write";
   }
+  pthread_mutex_unlock(&ioMutex);
 }
 
-int RS232Conn::pollPort(char &buf){
+int RS232Conn::fillBuffer(double timeLeft){
   if(port == NULL_FD){
     LOG(logCRITICAL) << "[RS232] Cannot poll non-open port!";
     return -1;
   }
-  int status = read(port, &buf, 1);
-  if(buf >= 0x11 && buf <= 0x14){
-    return 0; //Filter out XON-XOFF Characters that
-              //somehow make it to this point.
+
+  // Wait for data to arrive on the port, without spinning:
+  struct pollfd pfd;
+  pfd.fd = port;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+  int timeoutMs = static_cast<int>(timeLeft*1E3);
+  if(timeoutMs < 0) timeoutMs = 0;
+  int status = poll(&pfd, 1, timeoutMs);
+  if(status <= 0) return status;
+
+  char buf[READ_CHUNK];
+  status = read(port, buf, READ_CHUNK);
+  if(status <= 0) return status;
+
+  int received = 0;
+  for(int i = 0; i < status; i++){
+    if(buf[i] >= 0x11 && buf[i] <= 0x14) continue; //Filter out XON-XOFF Characters that
+                                                   //somehow make it to this point.
+    inBuffer.append(1,buf[i]);
+    received++;
   }
-  return status;
+  return received;
 }
 
 int RS232Conn::readStatus(const string &data){
@@ -292,10 +432,11 @@ int RS232Conn::readStatus(const string &data){
   unsigned int termSize = terminator.size();
   
   if(suffixSize > 0){ //suffix is ignored if it is unset. i.e. if readSuffix==""
-    if(dataSize > suffixSize && data.substr(dataSize-suffixSize,suffixSize) == readSuffix)
+    if(dataSize >= suffixSize && data.substr(dataSize-suffixSize,suffixSize) == readSuffix)
       return MATCH_SUFFIX; //Indicates a match on the readSuffix
   }
-  if(dataSize > termSize && data.substr(dataSize-termSize,termSize) == terminator){
+  // An empty line is a valid answer, e.g. devices acknowledging a command:
+  if(dataSize >= termSize && data.substr(dataSize-termSize,termSize) == terminator){
     return MATCH_TERMINATOR; //Indicates a match on the line terminator
   } else{
     return CONTINUE; //Indicates no match no terminator or readSuffix
@@ -303,29 +444,37 @@ int RS232Conn::readStatus(const string &data){
 }
 
 bool RS232Conn::readData(string &data){
+  pthread_mutex_lock(&ioMutex);
   data.clear();
   unsigned int dataSize = 0;
-  time_t tStart;
-  time_t tCurr;
-  tStart = time(NULL);
+  double tLast = now();
   
-  int readingStatus;
-  do{
-    char buf;
-    int status = pollPort(buf);
-    if(status == 1) {
-      data.append(1,buf);
+  int readingStatus = CONTINUE;
+  while(true){
+    // Consume buffered data until the end of a packet is found:
+    while(dataSize < inBuffer.size()){
       dataSize++;
-      tStart = time(NULL);
+      readingStatus = readStatus(inBuffer.substr(0,dataSize));
+      if(readingStatus != CONTINUE) break;
     }
-    tCurr = time(NULL);
-    if (difftime(tCurr,tStart) > timeout){
+    if(readingStatus != CONTINUE) break;
+
+    // Nothing complete yet, wait for more data:
+    double timeLeft = timeout - (now() - tLast);
+    if(timeLeft <= 0){
       LOG(logCRITICAL) << "[RS232] Serial Timeout";
       readingStatus = TIMEOUT;
       break;
     }
-    readingStatus = readStatus(data);
-  } while(readingStatus == CONTINUE);
+    int status = fillBuffer(timeLeft);
+    if(status < 0) {
+      readingStatus = TIMEOUT;
+      break;
+    }
+    if(status > 0) tLast = now();
+  }
+  data = inBuffer.substr(0,dataSize);
+  inBuffer.erase(0,dataSize);
   
   bool endLine;
   if(readingStatus == MATCH_SUFFIX){
@@ -337,7 +486,9 @@ bool RS232Conn::readData(string &data){
   }else{ //TIMEOUT
     endLine = false; 
   }
+  timedOut = (readingStatus == TIMEOUT);
   LOG(logDEBUG) << "[RS232] Received Data : \""<<data<<"\"";
+  pthread_mutex_unlock(&ioMutex);
   return endLine;
 }
 
@@ -355,7 +506,103 @@ bool RS232Conn::readEcho(const string &data){
 }
 
 void RS232Conn::writeReadBack(const string &dataOut, string &dataIn){
+  pthread_mutex_lock(&ioMutex);
   writeData(dataOut);
   readData(dataIn);
+  pthread_mutex_unlock(&ioMutex);
+}
+
+bool RS232Conn::startWorker(){
+  pthread_mutex_lock(&queueMutex);
+  if(workerRunning){
+    pthread_mutex_unlock(&queueMutex);
+    return true;
+  }
+  workerStop = false;
+  if(pthread_create(&worker, NULL, &RS232Conn::workerLoop, this) != 0){
+    pthread_mutex_unlock(&queueMutex);
+    LOG(logCRITICAL) << "[RS232] Unable to start worker thread";
+    return false;
+  }
+  workerRunning = true;
+  pthread_mutex_unlock(&queueMutex);
+  LOG(logDEBUG) << "[RS232] Started worker thread";
+  return true;
+}
+
+void RS232Conn::stopWorker(){
+  pthread_mutex_lock(&queueMutex);
+  if(!workerRunning){
+    pthread_mutex_unlock(&queueMutex);
+    return;
+  }
+  workerStop = true;
+  pthread_cond_broadcast(&queueCond);
+  pthread_mutex_unlock(&queueMutex);
+
+  // The worker finishes all queued requests before terminating:
+  pthread_join(worker, NULL);
+  workerRunning = false;
+  LOG(logDEBUG) << "[RS232] Stopped worker thread";
+}
+
+RS232Future RS232Conn::enqueue(const string &data, bool readBack){
+  if(!startWorker()) return RS232Future();
+
+  Request request;
+  request.data = data;
+  request.readBack = readBack;
+  request.reply = new RS232Reply();
+  // One reference for the queue, one for the returned handle:
+  request.reply->ref();
+
+  pthread_mutex_lock(&queueMutex);
+  queue.push_back(request);
+  pthread_cond_signal(&queueCond);
+  pthread_mutex_unlock(&queueMutex);
+  return RS232Future(request.reply);
+}
+
+RS232Future RS232Conn::writeDataAsync(const string &data){
+  return enqueue(data, false);
+}
+
+RS232Future RS232Conn::writeReadBackAsync(const string &dataOut){
+  return enqueue(dataOut, true);
+}
+
+void *RS232Conn::workerLoop(void *conn){
+  RS232Conn *self = static_cast<RS232Conn*>(conn);
+
+  while(true){
+    pthread_mutex_lock(&self->queueMutex);
+    while(self->queue.empty() && !self->workerStop){
+      pthread_cond_wait(&self->queueCond, &self->queueMutex);
+    }
+    if(self->queue.empty()){
+      pthread_mutex_unlock(&self->queueMutex);
+      break;
+    }
+    Request request = self->queue.front();
+    self->queue.pop_front();
+    pthread_mutex_unlock(&self->queueMutex);
+
+    // Execute the full exchange while holding the port:
+    pthread_mutex_lock(&self->ioMutex);
+    string answer;
+    bool ok = (self->port != NULL_FD);
+    if(ok){
+      self->writeData(request.data);
+      if(request.readBack){
+        self->readData(answer);
+        ok = !self->timedOut;
+      }
+    }
+    pthread_mutex_unlock(&self->ioMutex);
+
+    request.reply->set(ok, answer);
+    request.reply->unref();
+  }
+  return NULL;
 }
 
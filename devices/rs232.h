@@ -37,7 +37,54 @@
 #define rs232_H
 
 #include <termios.h>
+#include <pthread.h>
 #include <string>
+#include <deque>
+
+/** Shared state of one queued RS232 request, filled by the worker thread
+ *  and read through RS232Future handles (reference counted).
+ */
+class RS232Reply{
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  int refs;
+  bool done;
+  bool ok;
+  std::string data;
+
+  friend class RS232Conn;
+  friend class RS232Future;
+
+  RS232Reply();
+  ~RS232Reply();
+  void ref();
+  void unref();
+  void set(bool ok, const std::string &data);
+};
+
+/** Handle to the result of an asynchronous RS232 request. Copies refer to
+ *  the same request.
+ */
+class RS232Future{
+  RS232Reply *reply;
+
+  friend class RS232Conn;
+  explicit RS232Future(RS232Reply *reply);
+
+  public:
+    RS232Future();
+    RS232Future(const RS232Future &other);
+    RS232Future &operator=(const RS232Future &other);
+    ~RS232Future();
+
+    //true if this handle refers to a request
+    bool valid() const;
+    //true if the request has been processed, never blocks
+    bool ready();
+    //blocks until the request has been processed, returns false on timeout or error
+    bool get(std::string &data);
+    bool wait();
+};
 
 class RS232Conn{
     
@@ -48,6 +95,12 @@ class RS232Conn{
         TIMEOUT
     };
 
+    struct Request{
+        std::string data;
+        bool readBack;
+        RS232Reply *reply;
+    };
+
     std::string portName;           //Name of port, eg. /dev/ttyUSB0
     std::string readSuffix;         //Suffix stripped from read data, also signals end of read, to ignore, set to ""
     std::string terminator;         //Indicates the end of a read packet. Normally "\r\n"
@@ -58,10 +111,23 @@ class RS232Conn{
     struct termios oldPortSettings; //backup port settings
     bool removeEcho;                //Set true if device echos back input
     double timeout;                 //Read Timeout in seconds
+    double writeDelay;              //Pause after each write in seconds, none by default, set by drivers of slow devices
+    std::string inBuffer;           //Received data not yet consumed by readData
+    bool timedOut;                  //Set if the last readData ran into the timeout
+
+    pthread_mutex_t ioMutex;        //Serializes complete write/read exchanges on the port
+    pthread_mutex_t queueMutex;     //Protects the request queue
+    pthread_cond_t queueCond;
+    std::deque<Request> queue;      //Requests to be processed by the worker thread
+    pthread_t worker;
+    bool workerRunning;
+    bool workerStop;
     
-    int pollPort(char &buf);
+    int fillBuffer(double timeLeft);
     int writeBuf(const char *buf, int len);
     int readStatus(const std::string &data);
+    RS232Future enqueue(const std::string &data, bool readBack);
+    static void *workerLoop(void *conn);
     
   public:
     RS232Conn();
@@ -78,11 +144,19 @@ class RS232Conn{
     void setTerminator(const std::string &term);
     void setRemoveEcho(bool removeEcho);
     void setTimeout(double timeout);
+    void setWriteDelay(double delay);
     
     void writeData(const std::string &data);
     bool readEcho(const std::string &data);
     //returns true if this read reached the end of an input line(ie did not match on readSuffix)
     bool readData(std::string &data);
     void writeReadBack(const std::string &dataOut, std::string &dataIn);
+
+    //start/stop the background worker processing asynchronous requests
+    bool startWorker();
+    void stopWorker();
+    //queue a write (and read back) to be executed by the worker, returns immediately
+    RS232Future writeDataAsync(const std::string &data);
+    RS232Future writeReadBackAsync(const std::string &dataOut);
 };
 #endif
@@ -0,0 +1,195 @@
+/**
+ * Exercise the RS232 transport and the HV supply driver against
+ * RS232FakeInstrument, no hardware needed.
+ *
+ * Returns 0 if all checks pass, the number of failed checks otherwise.
+ */
+
+#include "rs232.h"
+#include "rs232fake.h"
+#include "hvsupply.h"
+#include "exceptions.h"
+#include "helper.h"
+#include "log.h"
+
+#include <sys/time.h>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <iostream>
+
+using namespace pxar;
+using namespace std;
+
+static int failures = 0;
+
+static double now(){
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec*1E-6;
+}
+
+static void check(bool ok, const string &what){
+  if(ok) {
+    LOG(logINFO) << "[rs232check] ok:     " << what;
+  }
+  else {
+    LOG(logERROR) << "[rs232check] FAILED: " << what;
+    failures++;
+  }
+}
+
+static bool openFake(RS232FakeInstrument &fake, RS232Conn &serial, double timeout){
+  if(!fake.start()) return false;
+  serial.setPortName(fake.portName());
+  serial.setBaudRate(9600);
+  serial.setTimeout(timeout);
+  return serial.openPort();
+}
+
+// ----------------------------------------------------------------------
+static void checkTransport(){
+  RS232FakeInstrument fake;
+  RS232Conn serial;
+  // Answers longer than one read() of the transport:
+  string longAnswer;
+  for(int i = 0; i < 1000; i++) longAnswer += static_cast<char>('A' + i%26);
+  fake.setAnswer("LONG?", longAnswer);
+  fake.setAnswer("PART?", "a\rb\nc");
+  fake.setAnswer("TWO?", "first\r\nsecond");
+  fake.setAnswer("EMPTY?", "");
+  fake.setAnswer("SLOW?", "slow");
+
+  if(!openFake(fake, serial, 0.3)){
+    check(false, "open the serial port on the pseudo terminal");
+    return;
+  }
+
+  string answer;
+  serial.writeReadBack("LONG?", answer);
+  check(answer == longAnswer, "multi-byte read of a 1000 byte answer");
+
+  serial.writeReadBack("PART?", answer);
+  check(answer == "a\rb\nc", "partial terminators do not end the answer");
+
+  serial.writeReadBack("TWO?", answer);
+  string second;
+  bool endLine = serial.readData(second);
+  check(answer == "first" && second == "second" && endLine, "two lines received in one burst are split at the terminator");
+
+  serial.writeReadBack("EMPTY?", answer);
+  check(answer.empty(), "an empty line is an answer of its own");
+
+  double tStart = now();
+  serial.writeData("SILENT");
+  endLine = serial.readData(answer);
+  double elapsed = now() - tStart;
+  check(!endLine && answer.empty(), "read without answer returns no data");
+  check(elapsed > 0.25 && elapsed < 1.5, "read without answer times out after the configured 0.3 s");
+
+  // Synchronous commands are not paced unless a driver asks for it:
+  tStart = now();
+  for(int i = 0; i < 10; i++) serial.writeData("NOP");
+  check(now() - tStart < 0.15, "no pause after writes by default");
+  serial.setWriteDelay(.02);
+  tStart = now();
+  for(int i = 0; i < 5; i++) serial.writeData("NOP");
+  check(now() - tStart >= 0.1, "the write delay set by a driver is applied");
+  serial.setWriteDelay(0);
+
+  // Asynchronous requests are answered in order without blocking the caller:
+  fake.setResponseDelay(0.1);
+  RS232Future slow = serial.writeReadBackAsync("SLOW?");
+  RS232Future part = serial.writeReadBackAsync("PART?");
+  check(slow.valid() && !slow.ready(), "asynchronous request returns before the answer arrived");
+  string slowAnswer, partAnswer;
+  check(slow.get(slowAnswer) && slowAnswer == "slow", "asynchronous answer");
+  check(part.get(partAnswer) && partAnswer == "a\rb\nc", "queued asynchronous answer");
+  fake.setResponseDelay(0);
+
+  RS232Future silent = serial.writeReadBackAsync("SILENT");
+  check(!silent.get(answer), "asynchronous request without answer reports the timeout");
+
+  serial.closePort();
+  fake.stop();
+}
+
+// ----------------------------------------------------------------------
+static void checkHVSupply(){
+  RS232FakeInstrument fake;
+#if defined(HVSUPPLY_ISEG)
+  // Every command is echoed and acknowledged with an empty line unless it is a query:
+  fake.setEcho(true);
+  fake.setDefaultAnswer("");
+  fake.setAnswer("S1", "S1=L2H");
+  fake.setAnswer("G1", "S1=ON");
+  fake.setAnswer("U1", "-01000-01");
+  fake.setAnswer("I1", "02000-09");
+  const char *queries[] = {"U1", "I1"};
+#elif defined(HVSUPPLY_KEITHLEY2410)
+  fake.setAnswer(":READ?", "-1.000000E+02,2.000000E-06");
+  fake.setAnswer(":OUTP:STAT?", "0");
+  const char *queries[] = {":READ?"};
+#else
+  LOG(logINFO) << "[rs232check] no fake answers for this HV supply, skipping the driver checks";
+  return;
+#endif
+
+  if(!fake.start()){
+    check(false, "start the fake HV supply");
+    return;
+  }
+
+  try {
+    HVSupply hv(fake.portName(), 1.0);
+    fake.setResponseDelay(0.2);
+    HVReading reading = hv.getVoltsAmpsAsync();
+    check(!reading.ready(), "HV reading is taken in the background");
+    int idle = 0;
+    while(!reading.ready()) { mDelay(10); idle++; }
+    check(idle > 0, "caller keeps running while the HV supply answers");
+    double volts(0), amps(0);
+    check(reading.get(volts, amps), "HV reading is answered");
+    check(fabs(volts + 100.) < 1E-6 && fabs(amps - 2E-6) < 1E-12, "HV reading decodes -100 V, 2 uA");
+    fake.setResponseDelay(0);
+
+    vector<string> commands = fake.commands();
+    unsigned int found = 0;
+    for(unsigned int i = 0; i < sizeof(queries)/sizeof(queries[0]); i++) {
+      for(unsigned int j = 0; j < commands.size(); j++) {
+        if(commands[j] == queries[i]) { found++; break; }
+      }
+    }
+    check(found == sizeof(queries)/sizeof(queries[0]), "HV supply sent the voltage and current queries");
+  }
+  catch(const pxar::pxarException &e) {
+    check(false, string("HV supply driver: ") + e.what());
+  }
+  fake.stop();
+}
+
+// ----------------------------------------------------------------------
+int main(int argc, char* argv[]) {
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i],"-v") && i+1 < argc) {
+      Log::ReportingLevel() = Log::FromString(argv[++i]);
+    }
+    else {
+      std::cout << "Usage: " << argv[0] << " [-v verbosity]" << std::endl;
+      return 0;
+    }
+  }
+
+  checkTransport();
+  checkHVSupply();
+
+  if(failures) {
+    LOG(logERROR) << "[rs232check] " << failures << " check(s) failed";
+  }
+  else {
+    LOG(logINFO) << "[rs232check] all checks passed";
+  }
+  return failures;
+}
@@ -0,0 +1,168 @@
+/**
+ * Fake RS232 instrument on a pseudo terminal
+ */
+
+#include "rs232fake.h"
+#include "log.h"
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+
+#include <cstdlib>
+#include <cstdio>
+
+using namespace pxar;
+using namespace std;
+
+#define NULL_FD -1
+
+RS232FakeInstrument::RS232FakeInstrument(const string &terminator) :
+  master(NULL_FD), slave(NULL_FD), slaveName(""), terminator(terminator),
+  echo(false), responseDelay(0), answers(), answerAll(false), defaultAnswer(""),
+  received(), inBuffer(),
+  running(false), stopRequest(false){
+  pthread_mutex_init(&mutex, NULL);
+}
+
+RS232FakeInstrument::~RS232FakeInstrument(){
+  stop();
+  pthread_mutex_destroy(&mutex);
+}
+
+bool RS232FakeInstrument::start(){
+  if(running) return true;
+
+  master = posix_openpt(O_RDWR | O_NOCTTY);
+  if(master == -1 || grantpt(master) != 0 || unlockpt(master) != 0){
+    LOG(logCRITICAL) << "[RS232Fake] unable to open pseudo terminal";
+    if(master != -1) close(master);
+    master = NULL_FD;
+    return false;
+  }
+  slaveName = ptsname(master);
+
+  // Keep the slave side open and raw until the client configures it:
+  slave = open(slaveName.c_str(), O_RDWR | O_NOCTTY);
+  if(slave != -1){
+    struct termios settings;
+    if(tcgetattr(slave, &settings) == 0){
+      cfmakeraw(&settings);
+      tcsetattr(slave, TCSANOW, &settings);
+    }
+  }
+
+  stopRequest = false;
+  if(pthread_create(&thread, NULL, &RS232FakeInstrument::loop, this) != 0){
+    LOG(logCRITICAL) << "[RS232Fake] unable to start instrument thread";
+    stop();
+    return false;
+  }
+  running = true;
+  LOG(logDEBUG) << "[RS232Fake] Fake instrument listening on " << slaveName;
+  return true;
+}
+
+void RS232FakeInstrument::stop(){
+  if(running){
+    pthread_mutex_lock(&mutex);
+    stopRequest = true;
+    pthread_mutex_unlock(&mutex);
+    pthread_join(thread, NULL);
+    running = false;
+  }
+  if(slave != NULL_FD) close(slave);
+  if(master != NULL_FD) close(master);
+  slave = master = NULL_FD;
+}
+
+const string &RS232FakeInstrument::portName() const{
+  return slaveName;
+}
+
+void RS232FakeInstrument::setAnswer(const string &command, const string &answer){
+  pthread_mutex_lock(&mutex);
+  answers[command] = answer;
+  pthread_mutex_unlock(&mutex);
+}
+
+void RS232FakeInstrument::setDefaultAnswer(const string &answer){
+  pthread_mutex_lock(&mutex);
+  answerAll = true;
+  defaultAnswer = answer;
+  pthread_mutex_unlock(&mutex);
+}
+
+void RS232FakeInstrument::setEcho(bool echo){
+  this->echo = echo;
+}
+
+void RS232FakeInstrument::setResponseDelay(double seconds){
+  responseDelay = seconds;
+}
+
+vector<string> RS232FakeInstrument::commands(){
+  pthread_mutex_lock(&mutex);
+  vector<string> commands = received;
+  pthread_mutex_unlock(&mutex);
+  return commands;
+}
+
+void RS232FakeInstrument::writeLine(const string &line){
+  string data = line + terminator;
+  size_t written = 0;
+  while(written < data.size()){
+    ssize_t status = write(master, data.c_str() + written, data.size() - written);
+    if(status <= 0) break;
+    written += status;
+  }
+}
+
+void RS232FakeInstrument::handleCommand(const string &command){
+  LOG(logDEBUG) << "[RS232Fake] Received : \"" << command << "\"";
+
+  pthread_mutex_lock(&mutex);
+  received.push_back(command);
+  map<string,string>::iterator it = answers.find(command);
+  bool answer = (it != answers.end()) || answerAll;
+  string reply = (it != answers.end()) ? it->second : defaultAnswer;
+  pthread_mutex_unlock(&mutex);
+
+  if(echo) writeLine(command);
+  if(answer){
+    if(responseDelay > 0) usleep(1E6*responseDelay);
+    writeLine(reply);
+  }
+}
+
+void *RS232FakeInstrument::loop(void *instrument){
+  RS232FakeInstrument *self = static_cast<RS232FakeInstrument*>(instrument);
+
+  while(true){
+    pthread_mutex_lock(&self->mutex);
+    bool stop = self->stopRequest;
+    pthread_mutex_unlock(&self->mutex);
+    if(stop) break;
+
+    struct pollfd pfd;
+    pfd.fd = self->master;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if(poll(&pfd, 1, 50) <= 0 || !(pfd.revents & POLLIN)) continue;
+
+    char buf[256];
+    ssize_t status = read(self->master, buf, sizeof(buf));
+    if(status <= 0) continue;
+    self->inBuffer.append(buf, status);
+
+    // Split the input into complete commands:
+    size_t pos;
+    while((pos = self->inBuffer.find(self->terminator)) != string::npos){
+      string command = self->inBuffer.substr(0, pos);
+      self->inBuffer.erase(0, pos + self->terminator.size());
+      self->handleCommand(command);
+    }
+  }
+  return NULL;
+}
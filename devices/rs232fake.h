@@ -0,0 +1,63 @@
+/**
+ * Fake RS232 instrument on a pseudo terminal
+ * to test the serial transport and HV supply drivers without hardware
+ */
+
+#ifndef rs232fake_H
+#define rs232fake_H
+
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <map>
+
+/** Fake serial instrument
+ *
+ *  Opens a pseudo terminal pair and answers commands received on it from a
+ *  table of canned responses. The name of the terminal (portName()) can be
+ *  handed to RS232Conn::setPortName() like a real serial port.
+ */
+class RS232FakeInstrument{
+    int master;                     //pty master file descriptor
+    int slave;                      //kept open to avoid hangups when the client closes
+    std::string slaveName;          //Name of the pty slave, eg. /dev/pts/3
+    std::string terminator;         //Line terminator of commands and answers
+    bool echo;                      //Echo every command back before answering
+    double responseDelay;           //Delay before answering in seconds
+    std::map<std::string,std::string> answers;
+    bool answerAll;                 //Answer commands without an entry of their own with defaultAnswer
+    std::string defaultAnswer;
+    std::vector<std::string> received;
+    std::string inBuffer;
+
+    pthread_mutex_t mutex;
+    pthread_t thread;
+    bool running;
+    bool stopRequest;
+
+    void handleCommand(const std::string &command);
+    void writeLine(const std::string &line);
+    static void *loop(void *instrument);
+
+  public:
+    RS232FakeInstrument(const std::string &terminator = "\r\n");
+    ~RS232FakeInstrument();
+
+    //open the pseudo terminal and start answering, returns false on error
+    bool start();
+    void stop();
+
+    //name of the port to connect to
+    const std::string &portName() const;
+
+    //answer to send whenever the given command is received, commands without answer are only recorded
+    void setAnswer(const std::string &command, const std::string &answer);
+    //answer to send for all commands without an answer of their own, eg. the empty lines of devices echoing their input
+    void setDefaultAnswer(const std::string &answer);
+    void setEcho(bool echo);
+    void setResponseDelay(double seconds);
+
+    //all commands received so far
+    std::vector<std::string> commands();
+};
+#endif
@@ -450,6 +450,7 @@ void PixGui::powerOff() {
 void PixGui::hvOn() {
   if (fApi) {
     fHV = true;
+    fPixSetup->setHvOn(true);
     fbtnHV->ChangeBackground(fGreen);
     fbtnHV->ChangeText("On");
     fApi->HVon(); 
@@ -463,6 +464,7 @@ void PixGui::hvOn() {
 void PixGui::hvOff() {
   if (fApi) {
     fHV = false;
+    fPixSetup->setHvOn(false);
     fbtnHV->ChangeBackground(fRed);
     fbtnHV->ChangeText("Off");
     fApi->HVoff(); 
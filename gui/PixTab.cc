@@ -173,7 +173,7 @@ PixTab::PixTab(PixGui *p, PixTest *test, string tabname) {
   fbDoTest = new TGTextButton(hFrame, " doTest ", B_DOTEST);
   fbDoTest->ChangeOptions(fbDoTest->GetOptions() | kFixedWidth);
   hFrame->AddFrame(fbDoTest, new TGLayoutHints(kLHintsLeft | kLHintsTop, fBorderN, fBorderN, fBorderN, fBorderN));
-  fbDoTest->Connect("Clicked()", "PixTest", test, "doTest()");
+  fbDoTest->Connect("Clicked()", "PixTest", test, "runTest()");
   fbDoTest->SetBackgroundColor(fGui->fDarkSalmon);
   
   // -- create stop Button
@@ -265,7 +265,7 @@ void PixTab::handleButtons(Int_t id) {
     }
 
     case B_DOSTOP: {
-      fTest->runCommand("stop"); 
+      fTest->stopTest(); 
       LOG(logDEBUG) << "stopping...and now what???";
       break;
     }
@@ -307,6 +307,7 @@ void PixTab::handleButtons(Int_t id) {
 void PixTab::buttonClicked() {
   TGButton *btn = (TGButton*)gTQSender;
   LOG(logDEBUG) << "xxxPressed():  " << btn->GetTitle();
+  fTest->touchHists(); 
   fTest->runCommand(btn->GetTitle()); 
 
 } 
@@ -317,6 +318,7 @@ void PixTab::boxChecked() {
   string sTitle = btn->GetTitle();
   LOG(logDEBUG) << "xxxPressed():  " << btn->GetTitle();
   fTest->setParameter(sTitle,string(btn->IsDown()?"1":"0")) ;
+  fTest->setTestParameter(sTitle,string(btn->IsDown()?"1":"0")) ;
 
 }
 
@@ -394,6 +396,7 @@ void PixTab::setParameter() {
 	       << " to value " << svalue;
 
   fTest->setParameter(fParIds[id], svalue); 
+  fTest->setTestParameter(fParIds[id], svalue); 
   updateToolTips();
 } 
 
@@ -51,15 +51,21 @@ int main(int argc, char *argv[]){
     doRunSingleTest(false), 
     doUpdateFlash(false),
     doUpdateRootFile(false),
-    doUseRootLogon(false)
+    doUseRootLogon(false),
+    doUseResultCache(false),
+    doForceRemeasure(false)
     ;
+  double histMemoryBudget(0.);
   for (int i = 0; i < argc; i++){
     if (!strcmp(argv[i],"-h")) {
       cout << "List of arguments:" << endl;
       cout << "-a                    do not do tests, do not recreate rootfile, but read in existing rootfile" << endl;
       cout << "-c filename           read in commands from filename" << endl;
+      cout << "-C                    use the result cache (skip tests whose DUT state and parameters are unchanged)" << endl;
       cout << "-d [--dir] path       directory with config files" << endl;
+      cout << "-F                    force remeasurement, but update the result cache" << endl;
       cout << "-g                    start with GUI" << endl;
+      cout << "-m MB                 keep at most MB of histograms in memory, spill the rest to the rootfile" << endl;
       cout << "-p \"p1=v1[;p2=v2]\"  set parameters for test" << endl;
       cout << "-r rootfilename       set rootfile (and logfile) name" << endl;
       cout << "-t test               run test" << endl;
@@ -69,9 +75,12 @@ int main(int argc, char *argv[]){
       return 0;
     }
     if (!strcmp(argv[i],"-c"))                                {cmdFile    = string(argv[++i]); doRunScript = true;} 
+    if (!strcmp(argv[i],"-C"))                                {doUseResultCache = true;} 
     if (!strcmp(argv[i],"-d") || !strcmp(argv[i], "--dir"))   {dir  = string(argv[++i]); }               
     if (!strcmp(argv[i],"-f"))                                {doUpdateFlash = true; flashFile = string(argv[++i]);} 
+    if (!strcmp(argv[i],"-F"))                                {doUseResultCache = true; doForceRemeasure = true;} 
     if (!strcmp(argv[i],"-g"))                                {doRunGui   = true; } 
+    if (!strcmp(argv[i],"-m"))                                {histMemoryBudget = atof(argv[++i]); } 
     if (!strcmp(argv[i],"-p"))                                {testParameters  = string(argv[++i]); }               
     if (!strcmp(argv[i],"-r"))                                {rootfile  = string(argv[++i]); }               
     if (!strcmp(argv[i],"-t"))                                {doRunSingleTest = true; runtest  = string(argv[++i]); }
@@ -192,6 +201,9 @@ int main(int argc, char *argv[]){
     api->SignalProbe("d1", configParameters->getProbe("d1"));
     api->SignalProbe("d2", configParameters->getProbe("d2"));
 
+    // -- DAQ buffer memory and thread pinning:
+    api->daqSetConfig(configParameters->getDaqConfig());
+
     LOG(logINFO) << "DUT info: ";
     api->_dut->info(); 
   } 
@@ -217,6 +229,9 @@ int main(int argc, char *argv[]){
   PixSetup a(api, ptp, configParameters);  
   a.setUseRootLogon(doUseRootLogon); 
   a.setRootFileUpdate(doUpdateRootFile);
+  a.setUseResultCache(doUseResultCache);
+  a.setForceRemeasure(doForceRemeasure);
+  a.setHistMemoryBudget(histMemoryBudget);
 
   if (doRunGui) {
     runGui(a, argc, argv); 
@@ -242,7 +257,7 @@ int main(int argc, char *argv[]){
       if (subtest.compare("nada")) {
 	t->runCommand(subtest); 
       } else {
-	t->doTest();
+	t->runTest();
       }
       delete t; 
     }
@@ -318,7 +333,7 @@ int main(int argc, char *argv[]){
         	if (subtest.compare("nada")) {
         	  t->runCommand(subtest); 
         	} else {
-        	  t->doTest();
+        	  t->runTest();
         	}
   	     delete t;
         } else {
@@ -1,6 +1,8 @@
 #include <iostream>
 #include <bitset>
 #include <fstream>
+#include <sstream>
+#include <set>
 #include <stdlib.h>     /* atof, atoi */
 
 #include <TKey.h>
@@ -10,7 +12,25 @@
 #include <TMath.h>
 #include <TStyle.h>
 #include <TGMsgBox.h>
+#include <TObjString.h>
+#include <TSpectrum.h>
+#include <TPolyMarker.h>
+#include <TF1.h>
 #include "TVirtualFitter.h"
+#if defined ROOT_MAJOR_VER && ROOT_MAJOR_VER > 5
+#include <TROOT.h>
+#include <HFitInterface.h>
+#include <Fit/Fitter.h>
+#include <Fit/BinData.h>
+#include <Math/WrappedMultiTF1.h>
+#include <Math/Factory.h>
+#include <Math/Minimizer.h>
+#endif
+#if defined(WIN32)
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
 
 #include "PixTest.hh"
 #include "PixUtil.hh"
@@ -24,6 +44,8 @@ using namespace pxar;
 
 ClassImp(PixTest)
 
+list<PixTest*> PixTest::fgResidentTests; 
+
 // ----------------------------------------------------------------------
 PixTest::PixTest(PixSetup *a, string name) {
   //  LOG(logINFO) << "PixTest ctor(PixSetup, string)";
@@ -34,12 +56,15 @@ PixTest::PixTest(PixSetup *a, string name) {
   fTimeStamp      = new TTimeStamp(); 
 
   fProblem        = false; 
+  fStopped        = false; 
+  fSavedDacs = fSavedTrimBits = fSavedTbParameters = false; 
   fOutputFilename = string(""); 
 
   fName = name;
   setToolTips();
   fParameters = a->getPixTestParameters()->getTestParameters(name); 
   fTree = 0; 
+  fSpilled = false; 
 
   fTriStateColors[0] = kRed;
   fTriStateColors[1] = 0;
@@ -71,6 +96,10 @@ PixTest::PixTest(PixSetup *a, string name) {
 PixTest::PixTest() {
   //  LOG(logINFO) << "PixTest ctor()";
   fTree = 0; 
+  fPixSetup = 0; 
+  fSpilled = false; 
+  fStopped = false; 
+  fSavedDacs = fSavedTrimBits = fSavedTbParameters = false; 
   
 }
 
@@ -149,6 +178,13 @@ void PixTest::runCommand(std::string command) {
 }
 
 
+// ----------------------------------------------------------------------
+void PixTest::stopTest() {
+  fStopped = true; 
+  runCommand("stop"); 
+}
+
+
 // ----------------------------------------------------------------------
 void PixTest::resetDirectory() {
   fDirectory = gFile->GetDirectory(fName.c_str()); 
@@ -408,7 +444,7 @@ vector<TH1*> PixTest::thrMaps(string dac, string name, int ntrig, uint16_t flag)
 
 // ----------------------------------------------------------------------
 vector<TH1*> PixTest::thrMaps(string dac, string name, uint8_t daclo, uint8_t dachi, int ntrig, uint16_t flag) {
-  // use at your own risk; pxarCore::getThresholdMap may or may not work as intended
+  // use at your own risk; pxarCore::getThresholdMaps may or may not work as intended
   vector<TH1*> resultMaps; 
 
   if (daclo > dachi) {
@@ -429,17 +465,31 @@ vector<TH1*> PixTest::thrMaps(string dac, string name, uint8_t daclo, uint8_t da
     fHistOptions.insert(make_pair(h1, "colz"));
   }
   
+  // -- the 10% and 90% levels come from the same scan and give the s-curve width
+  vector<TH1*> widthMaps; 
+  for (unsigned int iroc = 0; iroc < rocIds.size(); ++iroc){
+    TH1 *hw = bookTH2D(Form("width_%s_%s_C%d", name.c_str(), dac.c_str(), iroc), 
+		       Form("width_%s_%s_C%d", name.c_str(), dac.c_str(), iroc), 
+		       52, 0., 52., 80, 0., 80.);
+    widthMaps.push_back(hw); 
+    fHistOptions.insert(make_pair(hw, "colz"));
+  }
+
   int ic, ir, iroc, val; 
   LOG(logDEBUG) << "start threshold map for dac = " << dac; 
   
-  std::vector<pixel> results;
+  vector<uint8_t> levels; 
+  levels.push_back(10); 
+  levels.push_back(50); 
+  levels.push_back(90); 
+  vector<pair<uint8_t, vector<pixel> > > results;
   
   int cnt(0); 
   bool done = false;
   while (!done){
     LOG(logDEBUG) << "      attempt #" << cnt;
     try {
-      results = fApi->getThresholdMap(dac, 1, daclo, dachi, FLAGS, ntrig);
+      results = fApi->getThresholdMaps(dac, 1, daclo, dachi, levels, FLAGS, ntrig);
       fNDaqErrors = fApi->getStatistics().errors_pixel();
       done = true; 
     } catch(pxarException &/*e*/) {
@@ -449,16 +499,33 @@ vector<TH1*> PixTest::thrMaps(string dac, string name, uint8_t daclo, uint8_t da
     done = (cnt>5) || done;
   }
 
-  LOG(logDEBUG) << "finished threshold map for dac = " << dac << " results size = " << results.size(); 
-  for (unsigned int ipix = 0; ipix < results.size(); ++ipix) {
-    ic =   results[ipix].column(); 
-    ir =   results[ipix].row(); 
-    iroc = getIdxFromId(results[ipix].roc()); 
-    val =  results[ipix].value();
-    if (rocIds.end() != find(rocIds.begin(), rocIds.end(), results[ipix].roc())) {
-      ((TH2D*)resultMaps[iroc])->Fill(ic, ir, val); 
-    } else {
-      LOG(logDEBUG) << "histogram for ROC " << static_cast<int>(results[ipix].roc()) << " not found"; 
+  if (results.size() != levels.size()) {
+    LOG(logWARNING) << "threshold map for dac = " << dac << " failed"; 
+    results.clear(); 
+  }
+
+  LOG(logDEBUG) << "finished threshold map for dac = " << dac << " results size = " << (results.size() > 1 ? results[1].second.size() : 0); 
+  // -- pixels without a threshold at some level are missing in that level's map:
+  map<int, int> lo; 
+  for (unsigned int ilevel = 0; ilevel < results.size(); ++ilevel) {
+    vector<pixel> &pixels = results[ilevel].second;
+    for (unsigned int ipix = 0; ipix < pixels.size(); ++ipix) {
+      ic =   pixels[ipix].column(); 
+      ir =   pixels[ipix].row(); 
+      val =  pixels[ipix].value();
+      if (rocIds.end() == find(rocIds.begin(), rocIds.end(), pixels[ipix].roc())) {
+	LOG(logDEBUG) << "histogram for ROC " << static_cast<int>(pixels[ipix].roc()) << " not found"; 
+	continue;
+      }
+      iroc = getIdxFromId(pixels[ipix].roc()); 
+      int idx = iroc*4160 + ic*80 + ir; 
+      if (0 == ilevel) {
+	lo[idx] = val; 
+      } else if (1 == ilevel) {
+	((TH2D*)resultMaps[iroc])->Fill(ic, ir, val); 
+      } else if (lo.end() != lo.find(idx)) {
+	((TH2D*)widthMaps[iroc])->Fill(ic, ir, val - lo[idx]); 
+      }
     }
   }
 
@@ -467,6 +534,12 @@ vector<TH1*> PixTest::thrMaps(string dac, string name, uint8_t daclo, uint8_t da
     TH1* d1 = distribution(h2, 256, 0., 256.); 
     resultMaps.push_back(d1); 
   }
+  for (unsigned int i = 0; i < rocIds.size(); ++i){
+    TH2D *h2 = (TH2D*)widthMaps[i];
+    resultMaps.push_back(h2); 
+    TH1* d1 = distribution(h2, 256, 0., 256.); 
+    resultMaps.push_back(d1); 
+  }
   
   copy(resultMaps.begin(), resultMaps.end(), back_inserter(fHistList));
   fDisplayedHist = find(fHistList.begin(), fHistList.end(), h1);
@@ -567,8 +640,8 @@ bool PixTest::setTestParameter(string parname, string value) {
     if (!fParameters[i].first.compare(parname)) {
       fParameters[i].second = value; 
       LOG(logDEBUG) << " setting  " << fParameters[i].first << " to new value " << fParameters[i].second;
+      return true;
     }
-    return true;
   }
   
   return false; 
@@ -588,12 +661,13 @@ void PixTest::dumpParameters() {
 // ----------------------------------------------------------------------
 PixTest::~PixTest() {
   //  LOG(logDEBUG) << "PixTestBase dtor(), writing out histograms";
-  std::list<TH1*>::iterator il; 
+  fgResidentTests.remove(this); 
   fDirectory->cd(); 
-  for (il = fHistList.begin(); il != fHistList.end(); ++il) {
-    //    LOG(logINFO) << "Write out " << (*il)->GetName();
-    (*il)->SetDirectory(fDirectory); 
-    (*il)->Write(); 
+  // -- spilled histograms are on file already, only hand the placeholders back to the directory
+  if (fSpilled) {
+    for (list<TH1*>::iterator il = fHistList.begin(); il != fHistList.end(); ++il) (*il)->SetDirectory(fDirectory); 
+  } else {
+    writeHists(); 
   }
 
   TH1D *h = (TH1D*)gDirectory->Get("ha"); 
@@ -607,6 +681,9 @@ PixTest::~PixTest() {
     h->SetDirectory(fDirectory); 
     h->Write();
   }
+
+  // -- with a memory budget the histograms of finished tests do not stay in memory
+  if (fPixSetup && fPixSetup->histMemoryBudget() > 0.) clearHistList(); 
 }
 
 // ----------------------------------------------------------------------
@@ -631,6 +708,7 @@ void PixTest::hvOn() {
   } else {
     LOG(logDEBUG) << "PixTest::hvOn() api::HVon()";
     fApi->HVon(); 
+    fPixSetup->setHvOn(true); 
   }
 }
 
@@ -642,6 +720,7 @@ void PixTest::hvOff() {
   } else {
     LOG(logDEBUG) << "PixTest::hvOff() api::HVoff()";
     fApi->HVoff(); 
+    fPixSetup->setHvOn(false); 
   }
 }
 
@@ -679,6 +758,275 @@ void PixTest::fullTest() {
 }
 
 
+// ----------------------------------------------------------------------
+void PixTest::runTest() {
+  runCached(false);
+}
+
+// ----------------------------------------------------------------------
+void PixTest::runFullTest() {
+  runCached(true);
+}
+
+// ----------------------------------------------------------------------
+void PixTest::runCached(bool full) {
+  touchHists(); 
+  if (!fPixSetup->useResultCache()) {
+    if (full) {
+      fullTest();
+    } else {
+      doTest();
+    }
+    touchHists(); 
+    return;
+  }
+
+  // -- the key covers everything the result depends on: test, parameters, selected pixels, 
+  //    testboard setup (power, pattern generator, HV), trim target and DUT state (incl. timing)
+  ConfigParameters *cp = fPixSetup->getConfigParameters(); 
+  stringstream key; 
+  key << fName << endl;
+  for (unsigned int i = 0; i < fParameters.size(); ++i) {
+    key << fParameters[i].first << "=" << fParameters[i].second << endl;
+  }
+  for (unsigned int i = 0; i < fPIX.size(); ++i) {
+    key << "pix " << fPIX[i].first << " " << fPIX[i].second << endl;
+  }
+  vector<pair<string, double> > power = cp->getTbPowerSettings(); 
+  for (unsigned int i = 0; i < power.size(); ++i) {
+    key << "power " << power[i].first << " " << power[i].second << endl;
+  }
+  vector<pair<string, uint8_t> > pg = cp->getTbPgSettings(); 
+  for (unsigned int i = 0; i < pg.size(); ++i) {
+    key << "pg " << pg[i].first << " " << static_cast<int>(pg[i].second) << endl;
+  }
+  key << "hv " << fPixSetup->hvIsOn() << endl;
+  key << "trimvcal " << cp->getTrimVcalSufix() << endl;
+  key << dutState();
+
+  // -- 64 bit FNV-1a hash
+  string skey = key.str(); 
+  uint64_t hash(14695981039346656037ULL); 
+  for (unsigned int i = 0; i < skey.size(); ++i) {
+    hash ^= static_cast<unsigned char>(skey[i]);
+    hash *= 1099511628211ULL;
+  }
+
+  string dir = fPixSetup->getConfigParameters()->getDirectory() + "/resultcache";
+  gSystem->mkdir(dir.c_str(), true); 
+  string filename = dir + "/" + fName + Form("-%016llx.root", static_cast<unsigned long long>(hash));
+
+  if (fPixSetup->forceRemeasure()) {
+    LOG(logINFO) << "result cache: forced remeasurement of " << fName;
+  } else if (!gSystem->AccessPathName(filename.c_str()) && readResultCache(filename)) {
+    LOG(logINFO) << "result cache: DUT state and parameters unchanged, results of " << fName 
+		 << " restored from " << filename;
+    touchHists(); 
+    return;
+  }
+
+  fStopped = false; 
+  fSavedDacs = fSavedTrimBits = fSavedTbParameters = false; 
+  if (full) {
+    fullTest();
+  } else {
+    doTest();
+  }
+  if (fStopped) {
+    LOG(logINFO) << "result cache: " << fName << " was stopped, results not cached";
+  } else {
+    writeResultCache(filename); 
+  }
+  touchHists(); 
+}
+
+// ----------------------------------------------------------------------
+string PixTest::dutState() {
+  stringstream state; 
+  vector<uint8_t> rocIds = fApi->_dut->getEnabledRocIDs(); 
+  vector<rocConfig> rocs = fApi->_dut->getEnabledRocs(); 
+  for (unsigned int iroc = 0; iroc < rocIds.size(); ++iroc) {
+    int id = rocIds[iroc];
+    vector<pair<string, uint8_t> > dacs = fApi->_dut->getDACs(id);
+    for (unsigned int idac = 0; idac < dacs.size(); ++idac) {
+      state << "d " << id << " " << dacs[idac].first << " " << static_cast<int>(dacs[idac].second) << endl;
+    }
+    for (unsigned int ipix = 0; ipix < rocs[iroc].pixels.size(); ++ipix) {
+      pixelConfig &pix = rocs[iroc].pixels[ipix]; 
+      state << "p " << id << " " << static_cast<int>(pix.column()) << " " << static_cast<int>(pix.row()) 
+	    << " " << static_cast<int>(pix.trim()) << " " << pix.mask() << " " << pix.enable() << endl;
+    }
+  }
+  for (unsigned int itbm = 0; itbm < fApi->_dut->getNTbms(); ++itbm) {
+    vector<pair<string, uint8_t> > regs = fApi->_dut->getTbmDACs(itbm);
+    for (unsigned int ireg = 0; ireg < regs.size(); ++ireg) {
+      state << "t " << itbm << " " << regs[ireg].first << " " << static_cast<int>(regs[ireg].second) << endl;
+    }
+  }
+  vector<pair<string, uint8_t> > tbpars = fPixSetup->getConfigParameters()->getTbParameters(); 
+  for (unsigned int ipar = 0; ipar < tbpars.size(); ++ipar) {
+    state << "b " << tbpars[ipar].first << " " << static_cast<int>(tbpars[ipar].second) << endl;
+  }
+  return state.str(); 
+}
+
+// ----------------------------------------------------------------------
+void PixTest::setDutState(string state) {
+  // -- lines that are identical to the current state need not be touched
+  set<string> current; 
+  string line; 
+  istringstream is(dutState()); 
+  while (getline(is, line)) current.insert(line); 
+
+  map<uint8_t, map<string, uint8_t> > dacs; 
+  bool pixels(false), delays(false); 
+  istringstream ns(state); 
+  while (getline(ns, line)) {
+    if (current.count(line)) continue; 
+    istringstream il(line); 
+    string type, name; 
+    int id(-1), col(0), row(0), trim(0), mask(0), enable(0), val(0); 
+    il >> type; 
+    if (!type.compare("d")) {
+      il >> id >> name >> val; 
+      dacs[static_cast<uint8_t>(id)][name] = static_cast<uint8_t>(val); 
+    } else if (!type.compare("p")) {
+      il >> id >> col >> row >> trim >> mask >> enable; 
+      fApi->_dut->updateTrimBits(col, row, trim, id); 
+      fApi->_dut->maskPixel(col, row, (mask != 0), id); 
+      fApi->_dut->testPixel(col, row, (enable != 0), id); 
+      pixels = true; 
+    } else if (!type.compare("t")) {
+      il >> id >> name >> val; 
+      fApi->setTbmReg(name, static_cast<uint8_t>(val), id); 
+    } else if (!type.compare("b")) {
+      il >> name >> val; 
+      fPixSetup->getConfigParameters()->setTbParameter(name, static_cast<uint8_t>(val)); 
+      delays = true; 
+    }
+  }
+  if (dacs.size() > 0) fApi->setDACs(dacs); 
+  if (delays) fApi->setTestboardDelays(fPixSetup->getConfigParameters()->getTbParameters()); 
+  // -- the pixel configuration only lives in the DUT model, bring the ROCs in sync with it
+  if (pixels) fApi->programDUT(); 
+}
+
+// ----------------------------------------------------------------------
+bool PixTest::readResultCache(string filename) {
+  TDirectory *pDir = gDirectory; 
+  TFile *f = TFile::Open(filename.c_str()); 
+  if (!f || f->IsZombie()) {
+    LOG(logWARNING) << "result cache: cannot read " << filename;
+    if (f) delete f;
+    pDir->cd(); 
+    return false;
+  }
+
+  TObjString *meta  = (TObjString*)f->Get("pxar_meta"); 
+  TObjString *state = (TObjString*)f->Get("pxar_dutstate"); 
+  if (!meta || !state) {
+    LOG(logWARNING) << "result cache: " << filename << " is incomplete";
+    f->Close(); 
+    delete f; 
+    pDir->cd(); 
+    return false;
+  }
+
+  vector<TH1*> hists; 
+  vector<string> options; 
+  vector<string> saved; 
+  int problem(0), display(-1); 
+  string line; 
+  istringstream is(meta->GetString().Data()); 
+  while (getline(is, line)) {
+    istringstream il(line); 
+    string type, name, option; 
+    il >> type; 
+    if (!type.compare("problem")) {
+      il >> problem; 
+    } else if (!type.compare("display")) {
+      il >> display; 
+    } else if (!type.compare("save")) {
+      il >> name; 
+      saved.push_back(name); 
+    } else if (!type.compare("hist")) {
+      il >> name >> option; 
+      TH1 *h = (TH1*)f->Get(name.c_str()); 
+      if (!h) break; 
+      h = (TH1*)h->Clone(); 
+      h->SetDirectory(fDirectory); 
+      hists.push_back(h); 
+      options.push_back(option); 
+    }
+  }
+  string dutstate = state->GetString().Data(); 
+  f->Close(); 
+  delete f; 
+  pDir->cd(); 
+
+  if (hists.size() == 0) {
+    LOG(logWARNING) << "result cache: no histograms found in " << filename;
+    return false;
+  }
+
+  for (unsigned int i = 0; i < hists.size(); ++i) {
+    fHistList.push_back(hists[i]); 
+    fHistOptions.insert(make_pair(hists[i], options[i])); 
+  }
+  fProblem = (problem != 0); 
+  setDutState(dutstate); 
+
+  // -- files the test wrote are written again, from the restored state
+  for (unsigned int i = 0; i < saved.size(); ++i) {
+    if (!saved[i].compare("dacs")) saveDacs(); 
+    if (!saved[i].compare("trimbits")) saveTrimBits(); 
+    if (!saved[i].compare("tbparameters")) saveTbParameters(); 
+  }
+
+  TH1 *h = (display > -1 && display < static_cast<int>(hists.size())) ? hists[display] : hists.back(); 
+  h->Draw(getHistOption(h).c_str());
+  fDisplayedHist = find(fHistList.begin(), fHistList.end(), h);
+  update(); 
+  return true;
+}
+
+// ----------------------------------------------------------------------
+void PixTest::writeResultCache(string filename) {
+  // -- tests without histograms (e.g. FullTest, which runs other tests) are not cached
+  if (fHistList.size() == 0) return;
+
+  TDirectory *pDir = gDirectory; 
+  TFile *f = TFile::Open(filename.c_str(), "RECREATE"); 
+  if (!f || f->IsZombie()) {
+    LOG(logWARNING) << "result cache: cannot write " << filename;
+    if (f) delete f;
+    pDir->cd(); 
+    return;
+  }
+
+  stringstream meta; 
+  meta << "problem " << (fProblem? 1: 0) << endl;
+  if (fSavedDacs) meta << "save dacs" << endl;
+  if (fSavedTrimBits) meta << "save trimbits" << endl;
+  if (fSavedTbParameters) meta << "save tbparameters" << endl;
+  int ih(0); 
+  for (list<TH1*>::iterator il = fHistList.begin(); il != fHistList.end(); ++il, ++ih) {
+    string name = Form("h%d", ih); 
+    f->WriteTObject(*il, name.c_str()); 
+    if (il == fDisplayedHist) meta << "display " << ih << endl;
+    meta << "hist " << name << " " << getHistOption(*il) << endl;
+  }
+  TObjString smeta(meta.str().c_str()); 
+  f->WriteTObject(&smeta, "pxar_meta"); 
+  TObjString sstate(dutState().c_str()); 
+  f->WriteTObject(&sstate, "pxar_dutstate"); 
+  f->Close(); 
+  delete f; 
+  pDir->cd(); 
+  LOG(logDEBUG) << "result cache: wrote " << ih << " histograms to " << filename;
+}
+
+
 // ----------------------------------------------------------------------
 void PixTest::doAnalysis() {
   //  LOG(logINFO) << "PixTest::doAnalysis()";
@@ -687,6 +1035,7 @@ void PixTest::doAnalysis() {
 
 // ----------------------------------------------------------------------
 TH1* PixTest::nextHist() {
+  touchHists(); 
   if (fHistList.size() == 0) return 0; 
   std::list<TH1*>::iterator itmp = fDisplayedHist;  
   ++itmp;
@@ -702,6 +1051,7 @@ TH1* PixTest::nextHist() {
 
 // ----------------------------------------------------------------------
 TH1* PixTest::previousHist() {
+  touchHists(); 
   if (fHistList.size() == 0) return 0; 
   if (fDisplayedHist == fHistList.begin()) {
     // -- wrap around and point to last histogram in list
@@ -718,6 +1068,7 @@ TH1* PixTest::previousHist() {
 
 // ----------------------------------------------------------------------
 TH1* PixTest::nextHistV() {
+  touchHists(); 
   if (fHistList.size() == 0) return 0; 
   TH1* h0 = (*fDisplayedHist); 
   std::string histName(h0->GetName());
@@ -756,6 +1107,7 @@ TH1* PixTest::nextHistV() {
 
 // ----------------------------------------------------------------------
 TH1* PixTest::previousHistV() {
+  touchHists(); 
   if (fHistList.size() == 0) return 0; 
   TH1* h0 = (*fDisplayedHist); 
   std::string histName(h0->GetName());
@@ -817,6 +1169,110 @@ void PixTest::setTitles(TH1 *h, const char *sx, const char *sy, float size,
   }
 }
 
+// ----------------------------------------------------------------------
+void PixTest::writeHists() {
+  TDirectory *pDir = gDirectory; 
+  fDirectory->cd(); 
+  for (list<TH1*>::iterator il = fHistList.begin(); il != fHistList.end(); ++il) {
+    TH1 *h = (*il); 
+    h->SetDirectory(fDirectory); 
+    // -- replace the key cycle of the previous write of this object, histograms may share their name
+    map<TH1*, short>::iterator ic = fHistKeyCycle.find(h); 
+    if (ic != fHistKeyCycle.end()) fDirectory->Delete(Form("%s;%d", h->GetName(), ic->second)); 
+    h->Write(); 
+    TKey *k = fDirectory->GetKey(h->GetName()); 
+    if (k) fHistKeyCycle[h] = k->GetCycle(); 
+  }
+  pDir->cd(); 
+}
+
+// ----------------------------------------------------------------------
+void PixTest::spillHists() {
+  fgResidentTests.remove(this); 
+  if (fSpilled || fHistList.size() == 0) return;
+
+  double mem = histMemory(); 
+  writeHists(); 
+  int ih(0); 
+  for (list<TH1*>::iterator il = fHistList.begin(); il != fHistList.end(); ++il, ++ih) {
+    TH1 *h = (*il); 
+    // -- tests keep pointers to their histograms: keep the objects, only shrink them to a single bin
+    if (h->GetDimension() == 1) {
+      h->SetBins(1, 0., 1.); 
+    } else if (h->GetDimension() == 2) {
+      h->SetBins(1, 0., 1., 1, 0., 1.); 
+    } else {
+      h->SetBins(1, 0., 1., 1, 0., 1., 1, 0., 1.); 
+    }
+    // -- and take them out of the directory until touchHists()
+    h->SetDirectory(0); 
+  }
+  fSpilled = true; 
+  LOG(logDEBUG) << fName << ": spilled " << ih << " histograms (" << Form("%.1f", mem/1024./1024.) << " MB) to file";
+}
+
+// ----------------------------------------------------------------------
+void PixTest::touchHists() {
+  if (fSpilled) {
+    TDirectory *pDir = gDirectory; 
+    fDirectory->cd(); 
+    for (list<TH1*>::iterator il = fHistList.begin(); il != fHistList.end(); ++il) {
+      TH1 *h = (*il); 
+      // -- read the key cycle written by spillHists(), not just the newest key with this name
+      map<TH1*, short>::iterator ic = fHistKeyCycle.find(h); 
+      TKey *k = (ic != fHistKeyCycle.end()? fDirectory->GetKey(h->GetName(), ic->second): 0); 
+      TH1 *hfile = (k? (TH1*)k->ReadObj(): 0); 
+      if (0 == hfile) {
+	LOG(logWARNING) << fName << ": cannot reload histogram " << h->GetName();
+	h->SetDirectory(fDirectory); 
+	continue;
+      }
+      hfile->Copy(*h); 
+      delete hfile; 
+      h->SetDirectory(fDirectory); 
+    }
+    fSpilled = false; 
+    pDir->cd(); 
+    LOG(logDEBUG) << fName << ": reloaded " << fHistList.size() << " histograms from file";
+  }
+
+  fgResidentTests.remove(this); 
+  fgResidentTests.push_front(this); 
+  enforceHistBudget(); 
+}
+
+// ----------------------------------------------------------------------
+double PixTest::histMemory() {
+  double mem(0.); 
+  for (list<TH1*>::iterator il = fHistList.begin(); il != fHistList.end(); ++il) {
+    TH1 *h = (*il); 
+    double ncells = h->GetNbinsX() + 2.; 
+    if (h->GetDimension() > 1) ncells *= h->GetNbinsY() + 2.; 
+    if (h->GetDimension() > 2) ncells *= h->GetNbinsZ() + 2.; 
+    mem += ncells*sizeof(double); 
+    if (h->GetSumw2N() > 0) mem += ncells*sizeof(double); 
+  }
+  return mem; 
+}
+
+// ----------------------------------------------------------------------
+void PixTest::enforceHistBudget() {
+  if (0 == fPixSetup) return;
+  double budget = fPixSetup->histMemoryBudget()*1024.*1024.; 
+  if (budget <= 0.) return;
+
+  double total(0.); 
+  for (list<PixTest*>::iterator it = fgResidentTests.begin(); it != fgResidentTests.end(); ++it) {
+    total += (*it)->histMemory(); 
+  }
+  // -- never spill the test that is being used right now
+  while (total > budget && fgResidentTests.size() > 1 && fgResidentTests.back() != this) {
+    PixTest *t = fgResidentTests.back(); 
+    total -= t->histMemory(); 
+    t->spillHists(); 
+  }
+}
+
 // ----------------------------------------------------------------------
 void PixTest::clearHistList() {
   for (list<TH1*>::iterator il = fHistList.begin(); il != fHistList.end(); ++il) {
@@ -824,6 +1280,8 @@ void PixTest::clearHistList() {
     delete (*il);
   }
   fHistList.clear();
+  fHistKeyCycle.clear(); 
+  fSpilled = false; 
 }
 
 
@@ -928,6 +1386,21 @@ void PixTest::restoreDacs(bool verbose) {
   fDacCache.clear();
 }
 
+// ----------------------------------------------------------------------
+void PixTest::cacheDut() {
+  fDutCache = fApi->getSnapshot();
+}
+
+// ----------------------------------------------------------------------
+void PixTest::restoreDut(bool force) {
+  if (fDutCache.empty()) {
+    LOG(logWARNING) << "no DUT state cached, nothing to restore";
+    return;
+  }
+  fApi->restoreSnapshot(fDutCache, force);
+  fDutCache = pxar::dutSnapshot();
+}
+
 // ----------------------------------------------------------------------
 void PixTest::cacheTBMDacs(bool verbose) {
   fDacTBMCache.clear();
@@ -1060,7 +1533,8 @@ int PixTest::histCycle(string hname) {
   //   k = (TKey*)fDirectory->FindKey(Form("%s_V%d", hname.c_str(), cnt)); 
   //   cout << k << endl;
   //   if (k) h = (TH1*)k->ReadObj();
-  while (h) {
+  // -- spilled histograms are only found as keys
+  while (h || fDirectory->FindKey(Form("%s_V%d", hname.c_str(), cnt))) {
     ++cnt;
     h = (TH1*)fDirectory->FindObject(Form("%s_V%d", hname.c_str(), cnt));
     //     k = (TKey*)fDirectory->FindKey(Form("%s_V%d", hname.c_str(), cnt)); 
@@ -1707,18 +2181,20 @@ void PixTest::getPhError(std::string /*dac*/, int /*dacmin*/, int /*dacmax*/, in
 // ----------------------------------------------------------------------
 void PixTest::saveDacs() {
   fPixSetup->writeDacParameterFiles();
+  fSavedDacs = true; 
 }
 
 // ----------------------------------------------------------------------
 void PixTest::saveTrimBits() {
   fPixSetup->writeTrimFiles();
-  
+  fSavedTrimBits = true; 
 }
 
 // ----------------------------------------------------------------------
 void PixTest::saveTbParameters() {
   LOG(logDEBUG) << "save Tb parameters"; 
   fPixSetup->getConfigParameters()->writeTbParameterFile();
+  fSavedTbParameters = true; 
 }
 
 // ----------------------------------------------------------------------
@@ -1973,37 +2449,39 @@ void PixTest::maskHotPixels(std::vector<TH2D*> v) {
   int totalPeriod = prepareDaq(TRGFREQ, (uint8_t)500);
   
   timer t;
-  uint8_t perFull;
-  bool daq_loop = true;
+  uint64_t lastReadout(0);
+  uint8_t perFull(0);
     
   fApi->daqStart();
 
-  int finalPeriod = fApi->daqTriggerLoop(totalPeriod);
+  // The trigger rate is regulated to keep up with reading out once a second:
+  int finalPeriod = fApi->daqTriggerLoopRegulated(totalPeriod);
   LOG(logINFO) << "PixTestHighRate::maskHotPixels start TriggerLoop with period " << finalPeriod 
 	       << " and duration " << NSECONDS << " seconds and trigger rate " << TRGFREQ << " kHz";
   
-  while (fApi->daqStatus(perFull) && daq_loop) {
-    if (perFull > 80) {
-      LOG(logINFO) << "Buffer almost full, pausing triggers.";
-      fApi->daqTriggerLoopHalt();
-
-      // fillMap(v):
-      vector<pxar::Event> daqdat;
-      try { daqdat = fApi->daqGetEventBuffer(); }
-      catch(pxar::DataNoEvent &) {}
-      for(std::vector<pxar::Event>::iterator it = daqdat.begin(); it != daqdat.end(); ++it) {
-	for (unsigned int ipix = 0; ipix < it->pixels.size(); ++ipix) {
-	  v[getIdxFromId(it->pixels[ipix].roc())]->Fill(it->pixels[ipix].column(), it->pixels[ipix].row());
-	}
+  while (true) {
+    // daqStatus() also fails if the buffer is about to overflow, read out right away then:
+    perFull = 0;
+    bool ok = fApi->daqStatus(perFull);
+    if (!ok && perFull < 90) break;
+    if (ok) {
+      mDelay(100);
+      if (t.get() - lastReadout < 1000) continue;
+    }
+    lastReadout = t.get();
+
+    // fillMap(v):
+    vector<pxar::Event> daqdat;
+    try { daqdat = fApi->daqGetEventBuffer(); }
+    catch(pxar::DataNoEvent &) {}
+    for(std::vector<pxar::Event>::iterator it = daqdat.begin(); it != daqdat.end(); ++it) {
+      for (unsigned int ipix = 0; ipix < it->pixels.size(); ++ipix) {
+	v[getIdxFromId(it->pixels[ipix].roc())]->Fill(it->pixels[ipix].column(), it->pixels[ipix].row());
       }
-
-      LOG(logINFO) << "Resuming triggers.";
-	  fApi->daqTriggerLoop(finalPeriod);
     }
     
     if (static_cast<int>(t.get()/1000) >= NSECONDS)	{
-      LOG(logINFO) << "Done with hot pixel readout";
-      daq_loop = false;
+      LOG(logINFO) << "Done with hot pixel readout, final trigger period " << fApi->daqTriggerLoopPeriod();
       break;
     }
   }
@@ -2051,6 +2529,135 @@ void PixTest::maskHotPixels(std::vector<TH2D*> v) {
 }
 
 
+// ----------------------------------------------------------------------
+// -- shared state of the worker threads, the jobs are handed out in order
+struct PixJobs {
+  void (*job)(void *, unsigned int);
+  void *arg;
+  unsigned int n, next;
+#if defined ROOT_MAJOR_VER && ROOT_MAJOR_VER > 5 && !defined(WIN32)
+  pthread_mutex_t mutex;
+  vector<pthread_t> threads;
+#endif
+};
+
+#if defined ROOT_MAJOR_VER && ROOT_MAJOR_VER > 5 && !defined(WIN32)
+// -- fits through TH1::Fit() share the static TMinuit instance: only used if Minuit2 is not available
+static pthread_mutex_t pixJobsFitLock = PTHREAD_MUTEX_INITIALIZER;
+static bool pixJobsMinuit2(false);
+
+// ----------------------------------------------------------------------
+static void* pixJobsWorker(void *arg) {
+  PixJobs *jobs = static_cast<PixJobs*>(arg);
+  while (1) {
+    pthread_mutex_lock(&jobs->mutex);
+    unsigned int i = jobs->next++;
+    pthread_mutex_unlock(&jobs->mutex);
+    if (i >= jobs->n) break;
+    jobs->job(jobs->arg, i);
+  }
+  return 0;
+}
+#endif
+
+// ----------------------------------------------------------------------
+PixJobs* PixTest::startJobs(void (*job)(void *arg, unsigned int i), void *arg, unsigned int n) {
+  PixJobs *jobs = new PixJobs;
+  jobs->job = job;
+  jobs->arg = arg;
+  jobs->n = n;
+  jobs->next = 0;
+#if defined ROOT_MAJOR_VER && ROOT_MAJOR_VER > 5 && !defined(WIN32)
+  // -- ROOT 6 protects its global lists (functions, directories) only when asked to
+  static bool threadSafe(false);
+  if (!threadSafe) {
+    ROOT::EnableThreadSafety();
+    // -- load the Minuit2 plugin here, not concurrently in the jobs
+    ROOT::Math::Minimizer *min = ROOT::Math::Factory::CreateMinimizer("Minuit2", "Migrad");
+    pixJobsMinuit2 = (0 != min);
+    delete min;
+    if (!pixJobsMinuit2) LOG(logWARNING) << "Minuit2 not available, fits in jobs are serialized";
+    threadSafe = true;
+  }
+  unsigned int nthreads = static_cast<unsigned int>(sysconf(_SC_NPROCESSORS_ONLN));
+  if (nthreads > n) nthreads = n;
+  pthread_mutex_init(&jobs->mutex, 0);
+  jobs->threads.resize(nthreads);
+  unsigned int nstarted(0);
+  for (unsigned int i = 0; i < nthreads; ++i) {
+    if (0 == pthread_create(&jobs->threads[nstarted], 0, pixJobsWorker, jobs)) ++nstarted;
+  }
+  jobs->threads.resize(nstarted);
+#endif
+  return jobs;
+}
+
+// ----------------------------------------------------------------------
+void PixTest::finishJobs(PixJobs *jobs) {
+#if defined ROOT_MAJOR_VER && ROOT_MAJOR_VER > 5 && !defined(WIN32)
+  // -- help out (or do all the work if no thread could be started)
+  pixJobsWorker(jobs);
+  for (unsigned int i = 0; i < jobs->threads.size(); ++i) pthread_join(jobs->threads[i], 0);
+  pthread_mutex_destroy(&jobs->mutex);
+#else
+  for (unsigned int i = 0; i < jobs->n; ++i) jobs->job(jobs->arg, i);
+#endif
+  delete jobs;
+}
+
+// ----------------------------------------------------------------------
+bool PixTest::fitInJob(TH1 *h, TF1 *f) {
+  bool ok(false); 
+#if defined ROOT_MAJOR_VER && ROOT_MAJOR_VER > 5 && !defined(WIN32)
+  if (pixJobsMinuit2) {
+    ROOT::Fit::DataOptions opt; 
+    ROOT::Fit::BinData data(opt); 
+    ROOT::Fit::FillData(data, h, f); 
+    ROOT::Math::WrappedMultiTF1 wf(*f, f->GetNdim()); 
+    ROOT::Fit::Fitter fitter; 
+    fitter.Config().SetMinimizer("Minuit2", "Migrad"); 
+    fitter.SetFunction(wf, false); 
+    ok = fitter.Fit(data); 
+    if (!fitter.Result().IsEmpty()) f->SetFitResult(fitter.Result()); 
+  } else {
+    pthread_mutex_lock(&pixJobsFitLock);
+    ok = (0 == h->Fit(f, "Q0N")); 
+    pthread_mutex_unlock(&pixJobsFitLock);
+  }
+#else
+  // -- the jobs run serially
+  ok = (0 == h->Fit(f, "Q0N")); 
+#endif
+  f->SetBit(TF1::kNotDraw); 
+  f->SetParent(h); 
+  h->GetListOfFunctions()->Add(f); 
+  return ok; 
+}
+
+// ----------------------------------------------------------------------
+void PixTest::getPeaks(TSpectrum &s, int npeaks, vector<double> &x, vector<double> &y) {
+  x.assign(s.GetPositionX(), s.GetPositionX() + npeaks); 
+  y.assign(s.GetPositionY(), s.GetPositionY() + npeaks); 
+}
+
+// ----------------------------------------------------------------------
+void PixTest::showPeaks(TH1 *h, const vector<double> &x, const vector<double> &y) {
+  // -- what TSpectrum::Search() and TH1::Fit() do without "goff" and "0", except for drawing
+  TIter next(h->GetListOfFunctions()); 
+  TObject *obj(0); 
+  while ((obj = next())) {
+    if (obj->InheritsFrom(TF1::Class())) obj->ResetBit(TF1::kNotDraw); 
+  }
+  if (x.empty()) return;
+  TPolyMarker *pm = new TPolyMarker(static_cast<int>(x.size())); 
+  for (unsigned int i = 0; i < x.size(); ++i) pm->SetPoint(i, x[i], y[i]); 
+  pm->SetMarkerStyle(23);
+  pm->SetMarkerColor(kRed);
+  pm->SetMarkerSize(1.3);
+  h->GetListOfFunctions()->Add(pm); 
+}
+
+
 // ----------------------------------------------------------------------
 bool sortRocHist(const TH1* h1, const TH1* h2) {
   string hname1 = h1->GetName(); 
@@ -50,6 +50,9 @@ typedef struct {
 
 bool sortRocHist(const TH1*, const TH1*); 
 
+struct PixJobs;  // worker threads of PixTest::startJobs()
+class TSpectrum;
+
 ///
 /// PixTest
 /// =======
@@ -82,8 +85,14 @@ public:
   virtual void doTest(); 
   /// function called when FullTest is running; most often this is simply calling doTest()
   virtual void fullTest(); 
+  /// run doTest(), or restore its results from the result cache if DUT state and parameters are unchanged
+  void runTest(); 
+  /// run fullTest(), or restore its results from the result cache if DUT state and parameters are unchanged
+  void runFullTest(); 
   /// allow execution of any button in the test 
   virtual void runCommand(std::string command); 
+  /// stop button: runCommand("stop"), the interrupted results are not stored in the result cache
+  void stopTest(); 
   /// save DACs to file
   void saveDacs(); 
   /// save trim bits to file
@@ -212,6 +221,11 @@ public:
   /// restore all DACs
   void restoreDacs(bool verbose = false); 
 
+  /// checkpoint the full DUT state (DACs, TBM registers, trims, masks, test bits)
+  void cacheDut(); 
+  /// roll back to the checkpointed DUT state, only changed registers are programmed unless forced
+  void restoreDut(bool force = false); 
+
   /// cache all DACs
   void cacheTBMDacs(bool verbose = false);
   /// restore all DACs
@@ -295,6 +309,10 @@ public:
   TH1* nextHistV(); 
   /// allow backward iteration through list of histograms
   TH1* previousHistV();  
+  /// write all histograms to the rootfile and free their bin contents; the objects stay valid and are refilled by touchHists()
+  void spillHists(); 
+  /// reload spilled histograms and mark this test as most recently used for the histogram memory budget
+  void touchHists(); 
   
 
 protected: 
@@ -302,6 +320,27 @@ protected:
   int histCycle(std::string hname);   ///< determine histogram cycle
   void fillMap(TH2D *hmod, TH2D *hroc, int iroc);  ///< provides the coordinate transformation to module map
 
+  void runCached(bool full);  ///< run doTest() or fullTest() through the result cache
+  std::string dutState();  ///< text dump of all ROC DACs, pixel configurations and TBM registers
+  void setDutState(std::string state);  ///< program a state produced by dutState(), only changed values are set
+  bool readResultCache(std::string filename);  ///< restore histograms and DUT state from a result cache file
+  void writeResultCache(std::string filename);  ///< store histograms and DUT state in a result cache file
+  double histMemory();  ///< approximate memory (in bytes) held by the histograms in fHistList
+  void writeHists();  ///< write all histograms of fHistList to fDirectory, replacing their previous key cycle
+  void enforceHistBudget();  ///< spill least recently used tests until the histogram memory budget is met
+
+  /// run job(arg, i) for i = 0 .. n-1 on worker threads; the caller may continue (e.g. with DUT access) until finishJobs()
+  /// with ROOT 5 or on WIN32 the jobs are only run in finishJobs(), serially
+  static PixJobs* startJobs(void (*job)(void *arg, unsigned int i), void *arg, unsigned int n);
+  static void finishJobs(PixJobs *jobs);  ///< wait for (or run) the jobs of startJobs()
+  /// chi2 fit of f to h (full range of h) which can run concurrently in jobs: a Minuit2 fitter of its own instead of the
+  /// shared TMinuit; f is then attached to h (and owned by it) like the copy TH1::Fit(f, "Q0+") would attach
+  static bool fitInJob(TH1 *h, TF1 *f);
+  /// copy the peaks found by TSpectrum::Search() with option "goff", which is safe to run in jobs
+  static void getPeaks(TSpectrum &s, int npeaks, std::vector<double> &x, std::vector<double> &y);
+  /// main thread only: add the peak markers to h and show the fits done with option "0" in jobs
+  static void showPeaks(TH1 *h, const std::vector<double> &x, const std::vector<double> &y);
+
   pxar::pxarCore       *fApi;  ///< pointer to the API
   PixSetup             *fPixSetup;  ///< all necessary stuff in one place
   PixTestParameters    *fTestParameters;  ///< the repository of all test parameters
@@ -320,11 +359,15 @@ protected:
 
   std::vector<std::vector<std::pair<std::string,uint8_t> > >  fDacCache; ///< vector for all ROCs 
   std::vector<std::vector<std::pair<std::string,uint8_t> > >  fDacTBMCache; ///< vector for all TBMs
+  pxar::dutSnapshot     fDutCache; ///< checkpoint of the full DUT state
 
   TDirectory            *fDirectory; ///< where the root histograms will end up
   std::list<TH1*>       fHistList; ///< list of histograms available in PixTab::next and PixTab::previous
   std::map<TH1*, std::string> fHistOptions; ///< options can be stored with each histogram
   std::list<TH1*>::iterator fDisplayedHist;  ///< pointer to the histogram currently displayed
+  bool                  fSpilled; ///< histogram contents are on file only
+  std::map<TH1*, short> fHistKeyCycle; ///< key cycle of the last write of each histogram in fDirectory
+  static std::list<PixTest*> fgResidentTests; //! tests with histograms in memory, most recently used first
 
   std::vector<std::pair<int, int> > fPIX; ///< range of enabled pixels for time-consuming tests
   std::map<int, int>    fId2Idx; ///< map the ROC ID onto the (results vector) index of the ROC
@@ -333,6 +376,8 @@ protected:
   TTimeStamp           *fTimeStamp; 
 
   bool                  fProblem;
+  bool                  fStopped; ///< the stop button was hit during the current run
+  bool                  fSavedDacs, fSavedTrimBits, fSavedTbParameters; ///< files written by the current run, replayed on a cache hit
 
   std::vector<TH2D*>    fXrayMaps; 
 
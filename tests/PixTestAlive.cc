@@ -15,7 +15,7 @@ using namespace pxar;
 ClassImp(PixTestAlive)
 
 // ----------------------------------------------------------------------
-PixTestAlive::PixTestAlive(PixSetup *a, std::string name) : PixTest(a, name), fParNtrig(0), fParVcal(-1) {
+PixTestAlive::PixTestAlive(PixSetup *a, std::string name) : PixTest(a, name), fParNtrig(0), fParVcal(-1), fParCombined(false) {
   PixTest::init();
   init(); 
   LOG(logDEBUG) << "PixTestAlive ctor(PixSetup &a, string, TGTab *)";
@@ -42,6 +42,12 @@ bool PixTestAlive::setParameter(string parName, string sval) {
 	fParVcal = atoi(sval.c_str()); 
 	setToolTips();
       }
+      if (!parName.compare("combined")) {
+	PixUtil::replaceAll(sval, "checkbox(", ""); 
+	PixUtil::replaceAll(sval, ")", ""); 
+	fParCombined = !(atoi(sval.c_str())==0);
+	setToolTips();
+      }
       break;
     }
   }
@@ -68,6 +74,11 @@ void PixTestAlive::runCommand(std::string command) {
     addressDecodingTest(); 
     return;
   }
+
+  if (!command.compare("combinedtest")) {
+    combinedTest(); 
+    return;
+  }
   LOG(logDEBUG) << "did not find command ->" << command << "<-";
 }
 
@@ -89,7 +100,9 @@ void PixTestAlive::init() {
 void PixTestAlive::setToolTips() {
   fTestTip    = string("send Ntrig \"calibrates\" and count how many hits were measured\n")
     + string("the result is a hitmap, not an efficiency map\n")
-    + string("NOTE: VCAL is given in high range!")
+    + string("NOTE: VCAL is given in high range!\n")
+    + string("with 'combined' set, alive, mask and address decoding are derived from one readout:\n")
+    + string("every second pixel (checkerboard) is masked and only tested for its mask")
     ;
   fSummaryTip = string("all ROCs are displayed side-by-side. Note the orientation:\n")
     + string("the canvas bottom corresponds to the narrow module side with the cable")
@@ -119,9 +132,13 @@ void PixTestAlive::doTest() {
   PixTest::update(); 
   bigBanner(Form("PixTestAlive::doTest()"));
 
-  aliveTest();
-  maskTest();
-  addressDecodingTest();
+  if (fParCombined) {
+    combinedTest();
+  } else {
+    aliveTest();
+    maskTest();
+    addressDecodingTest();
+  }
    
   int seconds = t.RealTime(); 
   LOG(logINFO) << "PixTestAlive::doTest() done, duration: " << seconds << " seconds";
@@ -361,3 +378,160 @@ void PixTestAlive::addressDecodingTest() {
   dutCalibrateOff();  
 }
 
+
+// ----------------------------------------------------------------------
+// -- one calibrate loop over all pixels with a checkerboard of masked pixels:
+//    unmasked pixels give the alive and the address decoding result, masked
+//    pixels (including those from the mask file) must not answer at all.
+void PixTestAlive::combinedTest() {
+
+  cacheDacs();
+  fDirectory->cd();
+  PixTest::update(); 
+  string ctrlregstring = getDacsString("ctrlreg"); 
+  banner(Form("PixTestAlive::combinedTest() ntrig = %d, vcal = %d (ctrlreg = %s)", 
+	      static_cast<int>(fParNtrig), static_cast<int>(fParVcal), ctrlregstring.c_str()));
+
+  fApi->setDAC("vcal", fParVcal);
+
+  vector<uint8_t> rocIds = fApi->_dut->getEnabledRocIDs(); 
+
+  fApi->_dut->testAllPixels(true);
+  fApi->_dut->maskAllPixels(false);
+  maskPixels();
+  for (unsigned int iroc = 0; iroc < rocIds.size(); ++iroc) {
+    for (int ic = 0; ic < 52; ++ic) {
+      for (int ir = 0; ir < 80; ++ir) {
+	if (1 == (ic+ir)%2) fApi->_dut->maskPixel(ic, ir, true, rocIds[iroc]); 
+      }
+    }
+  }
+
+  // -- remember which pixels are masked, before the DUT is reset below
+  vector<vector<bool> > masked(rocIds.size(), vector<bool>(52*80, false)); 
+  for (unsigned int iroc = 0; iroc < rocIds.size(); ++iroc) {
+    vector<pixelConfig> pix = fApi->_dut->getMaskedPixels(rocIds[iroc]); 
+    for (unsigned int ipix = 0; ipix < pix.size(); ++ipix) {
+      masked[iroc][pix[ipix].column()*80 + pix[ipix].row()] = true; 
+    }
+  }
+
+  fNDaqErrors = 0; 
+  vector<pixel> results; 
+  int cnt(0); 
+  bool done(false);
+  while (!done) {
+    LOG(logDEBUG) << "      attempt #" << cnt;
+    try {
+      results = fApi->getEfficiencyMap(FLAG_CHECK_ORDER|FLAG_FORCE_MASKED, fParNtrig);
+      fNDaqErrors = fApi->getStatistics().errors_pixel();
+      done = true; 
+    } catch(pxarException &/*e*/) {
+      fNDaqErrors = 666667;
+      ++cnt;
+    }
+    done = (cnt>5) || done;
+  }
+
+  fApi->_dut->testAllPixels(true);
+  fApi->_dut->maskAllPixels(false);
+  maskPixels();
+
+  fDirectory->cd(); 
+  vector<TH2D*> alive, mask, addr; 
+  TH2D *h2(0); 
+  for (unsigned int iroc = 0; iroc < rocIds.size(); ++iroc) {
+    h2 = bookTH2D(Form("PixelAliveCombined_C%d", rocIds[iroc]), Form("PixelAliveCombined_C%d", rocIds[iroc]), 52, 0., 52., 80, 0., 80.);
+    h2->SetMinimum(0.); 
+    fHistOptions.insert(make_pair(h2, "colz")); 
+    alive.push_back(h2); 
+
+    h2 = bookTH2D(Form("MaskTestCombined_C%d", rocIds[iroc]), Form("MaskTestCombined_C%d", rocIds[iroc]), 52, 0., 52., 80, 0., 80.);
+    fHistOptions.insert(make_pair(h2, "coltristate")); 
+    mask.push_back(h2); 
+
+    h2 = bookTH2D(Form("AddressDecodingTestCombined_C%d", rocIds[iroc]), Form("AddressDecodingTestCombined_C%d", rocIds[iroc]), 52, 0., 52., 80, 0., 80.);
+    fHistOptions.insert(make_pair(h2, "coltristate")); 
+    addr.push_back(h2); 
+  }
+
+  // -- masked pixels are good unless they answer, unmasked pixels are not tested for their mask
+  for (unsigned int iroc = 0; iroc < rocIds.size(); ++iroc) {
+    alive[iroc]->SetDirectory(fDirectory); 
+    setTitles(alive[iroc], "col", "row"); 
+    mask[iroc]->SetDirectory(fDirectory); 
+    mask[iroc]->SetMinimum(-1.);
+    mask[iroc]->SetMaximum(1.);
+    setTitles(mask[iroc], "col", "row"); 
+    addr[iroc]->SetDirectory(fDirectory); 
+    addr[iroc]->SetMinimum(-1.);
+    addr[iroc]->SetMaximum(1.);
+    setTitles(addr[iroc], "col", "row"); 
+    for (int ic = 0; ic < 52; ++ic) {
+      for (int ir = 0; ir < 80; ++ir) {
+	if (masked[iroc][ic*80 + ir]) mask[iroc]->SetBinContent(ic+1, ir+1, 1); 
+      }
+    }
+  }
+
+  // -- hits with a negative value were read out at an address other than the pulsed one
+  int idx(-1); 
+  for (unsigned int i = 0; i < results.size(); ++i) {
+    if (rocIds.end() == find(rocIds.begin(), rocIds.end(), results[i].roc())) {
+      LOG(logDEBUG) << "histogram for ROC " << (int)results[i].roc() << " not found"; 
+      continue;
+    }
+    idx = getIdxFromId(results[i].roc());
+    int ic = results[i].column(); 
+    int ir = results[i].row(); 
+    if (results[i].value() < 0) {
+      LOG(logDEBUG) << " read col/row = " << ic << "/" << ir << " address decoding error";
+      addr[idx]->SetBinContent(ic+1, ir+1, -1);
+    } else if (masked[idx][ic*80 + ir]) {
+      mask[idx]->SetBinContent(ic+1, ir+1, -1);
+    } else {
+      alive[idx]->Fill(ic, ir, static_cast<float>(results[i].value())); 
+      if (addr[idx]->GetBinContent(ic+1, ir+1) > -0.5) addr[idx]->SetBinContent(ic+1, ir+1, 1);
+    }
+  }
+
+  vector<int> deadPixel(rocIds.size(), 0), maskPixel(rocIds.size(), 0), addrPixel(rocIds.size(), 0); 
+  for (unsigned int iroc = 0; iroc < rocIds.size(); ++iroc) {
+    for (int ic = 0; ic < 52; ++ic) {
+      for (int ir = 0; ir < 80; ++ir) {
+	if (mask[iroc]->GetBinContent(ic+1, ir+1) < -0.5) ++maskPixel[iroc];
+	if (addr[iroc]->GetBinContent(ic+1, ir+1) < -0.5) ++addrPixel[iroc];
+	if (masked[iroc][ic*80 + ir]) continue;
+	if (alive[iroc]->GetBinContent(ic+1, ir+1) < 1) ++deadPixel[iroc];
+      }
+    }
+  }
+
+  copy(addr.begin(), addr.end(), back_inserter(fHistList));
+  copy(mask.begin(), mask.end(), back_inserter(fHistList));
+  copy(alive.begin(), alive.end(), back_inserter(fHistList));
+  
+  TH2D *h = (TH2D*)(fHistList.back());
+  if (h) {
+    gStyle->SetPalette(1);
+    h->Draw(getHistOption(h).c_str());
+    fDisplayedHist = find(fHistList.begin(), fHistList.end(), h);
+    PixTest::update(); 
+  }
+
+  restoreDacs();
+
+  // -- summary printout
+  string deadPixelString, maskPixelString, addrPixelString; 
+  for (unsigned int i = 0; i < rocIds.size(); ++i) {
+    deadPixelString += Form(" %4d", deadPixel[i]); 
+    maskPixelString += Form(" %4d", maskPixel[i]); 
+    addrPixelString += Form(" %4d", addrPixel[i]); 
+  }
+  LOG(logINFO) << "PixTestAlive::combinedTest() done" 
+	       << (fNDaqErrors>0? Form(" with %d decoding errors", static_cast<int>(fNDaqErrors)):"");
+  LOG(logINFO) << "number of dead pixels (per ROC, unmasked pixels only): " << deadPixelString;
+  LOG(logINFO) << "number of mask-defect pixels (per ROC): " << maskPixelString;
+  LOG(logINFO) << "number of address-decoding pixels (per ROC): " << addrPixelString;
+  dutCalibrateOff();  
+}
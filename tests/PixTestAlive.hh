@@ -17,6 +17,7 @@ public:
   void aliveTest();
   void maskTest();
   void addressDecodingTest();
+  void combinedTest();
 
   void doTest(); 
 
@@ -24,6 +25,7 @@ private:
 
   uint16_t fParNtrig; 
   int      fParVcal; 
+  bool     fParCombined; 
 
   ClassDef(PixTestAlive, 1)
 
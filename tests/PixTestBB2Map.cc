@@ -528,12 +528,15 @@ void PixTestBB2Map::setVana() {
   vector<uint8_t> vanaStart;
   vector<double> rocIana;
 
+  // -- resolve the DAC once, it is written many times in the tuning loop below
+  dacHandle vanaDac = fApi->dac("vana");
+
   // -- cache setting and switch off all(!) ROCs
   int nRocs = fApi->_dut->getNRocs(); 
   for (int iroc = 0; iroc < nRocs; ++iroc) {
-    vanaStart.push_back(fApi->_dut->getDAC(iroc, "vana"));
+    vanaStart.push_back(fApi->_dut->getDAC(iroc, vanaDac));
     rocIana.push_back(0.); 
-    fApi->setDAC("vana", 0, iroc);
+    fApi->setDAC(vanaDac, 0, iroc);
   }
   
   double i016 = fApi->getTBia()*1E3;
@@ -562,7 +565,7 @@ void PixTestBB2Map::setVana() {
       continue;
     }
     int vana = vanaStart[roc];
-    fApi->setDAC("vana", vana, roc); // start value
+    fApi->setDAC(vanaDac, vana, roc); // start value
 
     double ia = fApi->getTBia()*1E3; // [mA], just to be sure to flush usb
     sw.Start(kTRUE); // reset
@@ -594,7 +597,7 @@ void PixTestBB2Map::setVana() {
 	}
       }
 
-      fApi->setDAC("vana", vana, roc);
+      fApi->setDAC(vanaDac, vana, roc);
       iter++;
 
       sw.Start(kTRUE); // reset
@@ -614,7 +617,7 @@ void PixTestBB2Map::setVana() {
 
     rocIana[roc] = ia-i015; // more or less identical for all ROCS?!
     vanaStart[roc] = vana; // remember best
-    fApi->setDAC( "vana", 0, roc ); // switch off for next ROC
+    fApi->setDAC( vanaDac, 0, roc ); // switch off for next ROC
 
   } // rocs
 
@@ -636,7 +639,7 @@ void PixTestBB2Map::setVana() {
   restoreDacs();
   for (int roc = 0; roc < nRocs; ++roc) {
     // -- reset all ROCs to optimum or cached value
-    fApi->setDAC( "vana", vanaStart[roc], roc );
+    fApi->setDAC( vanaDac, vanaStart[roc], roc );
     LOG(logDEBUG) << "ROC " << setw(2) << roc << " Vana " << setw(3) << int(vanaStart[roc]);
     // -- histogramming only for those ROCs that were selected
     if (!selectedRoc(roc)) continue;
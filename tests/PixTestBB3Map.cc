@@ -21,6 +21,21 @@ double NSIGMA = 5;
 
 ClassImp(PixTestBB3Map)
 
+// -- analysis of one ROC, run on a worker thread: only touches the histograms of its own ROC
+struct bb3RocJob {
+  TH1  *thrmap;
+  TH1D *distEven, *distOdd, *rescaledDist;
+  TH2D *rescaledMap;
+  int nPeaksEven, nPeaksOdd, cutEven, cutOdd, nBadBumps;
+  double meanEven, sigmaEven, meanOdd, sigmaOdd;
+  vector<double> peakXEven, peakYEven, peakXOdd, peakYOdd;
+};
+
+struct bb3Jobs {
+  PixTestBB3Map *test;
+  vector<bb3RocJob> rocs;
+};
+
 //------------------------------------------------------------------------------
 PixTestBB3Map::PixTestBB3Map(PixSetup *a, std::string name): PixTest(a, name),
   fParNtrig(-1), fParVcalS(200), fDumpAll(-1), fDumpProblematic(-1) {
@@ -127,163 +142,63 @@ void PixTestBB3Map::doTest() {
   // generate a TH1 s-curve wrt VthrComp for each pixel
   vector<TH1*>  thrmapsCals = scurveMaps("VthrComp", "calSMap", fParNtrig, 0, 149, 30, result, 1, flag);
  
-  // create vectors of plots to hold the rescaled thresholds
-  vector<TH2D*>  rescaledThrmaps;
-  vector<TH1D*>  rescaledThrdists;
-
-  // create vector of pairs of 1D distributions (for odd/even columns)
-  vector<pair<TH1D*,TH1D*> > dlist;
-
-
+  // -- book all histograms here, the per-ROC analysis then runs on worker threads
+  //    while the DUT is restored
+  bb3Jobs jobs;
+  jobs.test = this;
+  jobs.rocs.resize(thrmapsCals.size());
   for (unsigned int i = 0; i < thrmapsCals.size(); ++i) {
-
-    // initialize 1D plots
-    TH1D* hEven = bookTH1D(Form("dist_thr_calSMap_VthrComp_EvenCol_C%d", i), 
-			   Form("VthrComp threshold distribution (even col.) (C%d)", i),
+    bb3RocJob &roc = jobs.rocs[i];
+    roc.thrmap = thrmapsCals[i];
+    // 1D distributions of the VthrComp threshold, one for even and one for odd columns
+    roc.distEven = bookTH1D(Form("dist_thr_calSMap_VthrComp_EvenCol_C%d", i), 
+			    Form("VthrComp threshold distribution (even col.) (C%d)", i),
+			    256, 0., 256.);
+    roc.distOdd = bookTH1D(Form("dist_thr_calSMap_VthrComp_OddCol_C%d", i), 
+			   Form("VthrComp threshold distribution (odd col.) (C%d)", i),
 			   256, 0., 256.);
-    TH1D* hOdd = bookTH1D(Form("dist_thr_calSMap_VthrComp_OddCol_C%d", i), 
-			  Form("VthrComp threshold distribution (odd col.) (C%d)", i),
-			  256, 0., 256.);
-    TH1D* hRescaled = bookTH1D(Form("dist_rescaledThr_C%d", i), 
-			   Form("(thr-mean)/sigma (C%d)", i),
-			   100, -10., 10.);
-    rescaledThrdists.push_back(hRescaled);
-
-    // initialize 2D rescaled threshold plots
-    TH2D* rescaledPlot = bookTH2D(Form("rescaledThr_C%d", i),
-				  Form("(thr-mean)/sigma (C%d)", i),
-				  52, 0., 52., 80, 0., 80.);
-    rescaledThrmaps.push_back(rescaledPlot);
-
-    // -- relabel negative thresholds as 255 and create distribution list
-    // a negative threshold implies that the fit failed to converge
-    for (int ix = 0; ix < thrmapsCals[i]->GetNbinsX(); ++ix) {
-      for (int iy = 0; iy < thrmapsCals[i]->GetNbinsY(); ++iy) {
-	if (thrmapsCals[i]->GetBinContent(ix+1, iy+1) < 0) thrmapsCals[i]->SetBinContent(ix+1, iy+1, 255.);
-      }
-    }
-    // make a 1D distributions of the VthrComp threshold for each ROC
-    // (one for odd columns, one for even columns)
-    for (int ix = 0; ix < thrmapsCals[i]->GetNbinsX(); ++ix) {
-      for (int iy = 0; iy < thrmapsCals[i]->GetNbinsY(); ++iy) {
-	if (ix % 2 == 0) // even column
-	  hEven->Fill(thrmapsCals[i]->GetBinContent(ix+1, iy+1));
-	else // odd column
-	  hOdd->Fill(thrmapsCals[i]->GetBinContent(ix+1, iy+1));
-      }
-    }
-
-    dlist.push_back(std::make_pair(hEven,hOdd));
-    fHistList.push_back(hEven);
-    fHistList.push_back(hOdd);
+    roc.rescaledDist = bookTH1D(Form("dist_rescaledThr_C%d", i), 
+				Form("(thr-mean)/sigma (C%d)", i),
+				100, -10., 10.);
+    // 2D rescaled threshold plot
+    roc.rescaledMap = bookTH2D(Form("rescaledThr_C%d", i),
+			       Form("(thr-mean)/sigma (C%d)", i),
+			       52, 0., 52., 80, 0., 80.);
   }
 
+  PixJobs *pj = startJobs(analyzeRoc, &jobs, jobs.rocs.size());
   restoreDacs();
+  dutCalibrateOff();
+  finishJobs(pj);
 
   string bbString("");
-  int nBadBumps(0);
-  int nPeaksEven(0), nPeaksOdd(0);
-  TSpectrum s;
-  TH1D* distEven(0);
-  TH1D* distOdd(0);
-  TF1* fitEven(0);
-  TF1* fitOdd(0);
-
-  // loop over the 1D distribution pairs (one for each ROC)
-  for (unsigned int i = 0; i < dlist.size(); ++i) {
-    distEven = (TH1D*)dlist[i].first;
-    distOdd = (TH1D*)dlist[i].second;
-    // search for peaks in the distribution
-    // sigma = 5, threshold = 50%
-    // peaks below threshold*max_peak_height are discarded
-    // "nobackground" means it doesn't try to subtract a background
-    //   from the distribution
-    nPeaksEven = s.Search(distEven, 5, "nobackground", 0.5);
-    nPeaksOdd = s.Search(distOdd, 5, "nobackground", 0.5);
-
-    // use fitPeaks algorithm to get the fitted gaussian of good bumps
-    fitEven = fitPeaks(distEven, s, nPeaksEven);
-    double meanEven = fitEven->GetParameter(1);
-    double sigmaEven = fabs(fitEven->GetParameter(2));
-    fitOdd = fitPeaks(distOdd, s, nPeaksOdd);
-    double meanOdd = fitOdd->GetParameter(1);
-    double sigmaOdd = fabs(fitOdd->GetParameter(2));
-
-    int cutEven = static_cast<int>(meanEven + NSIGMA*sigmaEven) + 1;
-    int cutOdd = static_cast<int>(meanOdd + NSIGMA*sigmaOdd) + 1;
-
-    LOG(logDEBUG) << "found " << nPeaksEven << " peaks in " << distEven->GetName();
-    LOG(logDEBUG) << "  best peak: mean = " << meanEven << ", RMS = " << sigmaEven;
-    LOG(logDEBUG) << "    cut value = " << cutEven;
-
-    LOG(logDEBUG) << "found " << nPeaksOdd << " peaks in " << distOdd->GetName();
-    LOG(logDEBUG) << "  best peak: mean = " << meanOdd << ", RMS = " << sigmaOdd;
-    LOG(logDEBUG) << "    cut value = " << cutOdd;
-
-    // draw an arrow on the plot to denote cutEven
-    TArrow *paEven = new TArrow(cutEven, 0.5*distEven->GetMaximum(), cutEven, 0., 0.06, "|>");
-    paEven->SetArrowSize(0.1);
-    paEven->SetAngle(40);
-    paEven->SetLineWidth(2);
-    distEven->GetListOfFunctions()->Add(paEven);
-
-    // draw an arrow on the plot to denote cutOdd
-    TArrow *paOdd = new TArrow(cutOdd, 0.5*distOdd->GetMaximum(), cutOdd, 0., 0.06, "|>");
-    paOdd->SetArrowSize(0.1);
-    paOdd->SetAngle(40);
-    paOdd->SetLineWidth(2);
-    distOdd->GetListOfFunctions()->Add(paOdd);
-
-    // fill plots with (thr-mean)/sigma (things above NSIGMA are called bad)
-    for (int ix = 1; ix <= thrmapsCals[i]->GetNbinsX(); ++ix) {
-      for (int iy = 1; iy <= thrmapsCals[i]->GetNbinsY(); ++iy) {
-	double content = thrmapsCals[i]->GetBinContent(ix, iy);
-	double rescaledThr = 0;
-	if (ix % 2 == 1) // even column
-	  rescaledThr = (content-meanEven)/sigmaEven;
-	else // odd column
-	  rescaledThr = (content-meanOdd)/sigmaOdd;
-
-	// fill 1D plot, put under/overflow entries into first/last bin
-	if (rescaledThr < rescaledThrdists[i]->GetXaxis()->GetXmax()-0.01){
-	  if (rescaledThr > rescaledThrdists[i]->GetXaxis()->GetXmin()){
-	    rescaledThrdists[i]->Fill(rescaledThr);
-	  }
-	  else {
-	    rescaledThrdists[i]->Fill(rescaledThrdists[i]->GetXaxis()->GetXmin());
-	  }
-	}
-	else {
-	    rescaledThrdists[i]->Fill(rescaledThrdists[i]->GetXaxis()->GetXmax()-0.01);
-	}
-	  
-
-	rescaledThrmaps[i]->Fill(ix-1,iy-1,rescaledThr);
-      }
-    }
-    rescaledThrmaps[i]->SetMinimum(-5.);
-    rescaledThrmaps[i]->SetMaximum(5);
-    fHistList.push_back(rescaledThrmaps[i]);
-    fHistOptions.insert(make_pair(rescaledThrmaps[i], "colz"));
-
+  for (unsigned int i = 0; i < jobs.rocs.size(); ++i) {
+    bb3RocJob &roc = jobs.rocs[i];
+    showPeaks(roc.distEven, roc.peakXEven, roc.peakYEven);
+    showPeaks(roc.distOdd, roc.peakXOdd, roc.peakYOdd);
+    fHistList.push_back(roc.distEven);
+    fHistList.push_back(roc.distOdd);
+  }
+  for (unsigned int i = 0; i < jobs.rocs.size(); ++i) {
+    bb3RocJob &roc = jobs.rocs[i];
+    LOG(logDEBUG) << "found " << roc.nPeaksEven << " peaks in " << roc.distEven->GetName();
+    LOG(logDEBUG) << "  best peak: mean = " << roc.meanEven << ", RMS = " << roc.sigmaEven;
+    LOG(logDEBUG) << "    cut value = " << roc.cutEven;
 
-    // draw an arrow on the plot to denote cutDead
-    TArrow *pa = new TArrow(NSIGMA, 0.5*rescaledThrdists[i]->GetMaximum(), NSIGMA, 0., 0.06, "|>");
-    pa->SetArrowSize(0.1);
-    pa->SetAngle(40);
-    pa->SetLineWidth(2);
-    rescaledThrdists[i]->GetListOfFunctions()->Add(pa);
-    fHistList.push_back(rescaledThrdists[i]);
+    LOG(logDEBUG) << "found " << roc.nPeaksOdd << " peaks in " << roc.distOdd->GetName();
+    LOG(logDEBUG) << "  best peak: mean = " << roc.meanOdd << ", RMS = " << roc.sigmaOdd;
+    LOG(logDEBUG) << "    cut value = " << roc.cutOdd;
 
-    // bad bumps are those above NSIGMA*sigma above the mean
-    nBadBumps = static_cast<int>(rescaledThrdists[i]->Integral(rescaledThrdists[i]->FindBin(NSIGMA), 
-							       rescaledThrdists[i]->GetNbinsX()+1));
-    bbString += Form(" %4d", nBadBumps);
+    fHistList.push_back(roc.rescaledMap);
+    fHistOptions.insert(make_pair(roc.rescaledMap, "colz"));
+    fHistList.push_back(roc.rescaledDist);
 
+    bbString += Form(" %4d", roc.nBadBumps);
   }
-  if (rescaledThrdists[15]) {
-    rescaledThrdists[15]->Draw();
-    fDisplayedHist = find(fHistList.begin(), fHistList.end(), rescaledThrdists[15]);
+  if (jobs.rocs.size() > 0) {
+    TH1D *h = jobs.rocs.back().rescaledDist;
+    h->Draw();
+    fDisplayedHist = find(fHistList.begin(), fHistList.end(), h);
   }
   PixTest::update();
 
@@ -292,11 +207,110 @@ void PixTestBB3Map::doTest() {
 	       << (fNDaqErrors>0? Form(" with %d decoding errors: ", static_cast<int>(fNDaqErrors)):"")
 	       << ", duration: " << seconds << " seconds";
   LOG(logINFO) << "number of dead bumps (per ROC): " << bbString;
-  dutCalibrateOff();
 
 }
 
 
+// ----------------------------------------------------------------------
+void PixTestBB3Map::analyzeRoc(void *arg, unsigned int i) {
+  bb3Jobs *jobs = static_cast<bb3Jobs*>(arg);
+  bb3RocJob &roc = jobs->rocs[i];
+  TH1 *thr = roc.thrmap;
+
+  // -- relabel negative thresholds as 255 and create distribution list
+  // a negative threshold implies that the fit failed to converge
+  for (int ix = 0; ix < thr->GetNbinsX(); ++ix) {
+    for (int iy = 0; iy < thr->GetNbinsY(); ++iy) {
+      if (thr->GetBinContent(ix+1, iy+1) < 0) thr->SetBinContent(ix+1, iy+1, 255.);
+    }
+  }
+  for (int ix = 0; ix < thr->GetNbinsX(); ++ix) {
+    for (int iy = 0; iy < thr->GetNbinsY(); ++iy) {
+      if (ix % 2 == 0) // even column
+	roc.distEven->Fill(thr->GetBinContent(ix+1, iy+1));
+      else // odd column
+	roc.distOdd->Fill(thr->GetBinContent(ix+1, iy+1));
+    }
+  }
+
+  // search for peaks in the distribution
+  // sigma = 5, threshold = 50%
+  // peaks below threshold*max_peak_height are discarded
+  // "nobackground" means it doesn't try to subtract a background
+  //   from the distribution
+  // "goff" means no markers are added and nothing is drawn (not thread safe)
+  TSpectrum s;
+  roc.nPeaksEven = s.Search(roc.distEven, 5, "nobackground goff", 0.5);
+  getPeaks(s, roc.nPeaksEven, roc.peakXEven, roc.peakYEven);
+  // use fitPeaks algorithm to get the fitted gaussian of good bumps
+  TF1 *fitEven = jobs->test->fitPeaks(roc.distEven, s, roc.nPeaksEven);
+  roc.nPeaksOdd = s.Search(roc.distOdd, 5, "nobackground goff", 0.5);
+  getPeaks(s, roc.nPeaksOdd, roc.peakXOdd, roc.peakYOdd);
+  TF1 *fitOdd = jobs->test->fitPeaks(roc.distOdd, s, roc.nPeaksOdd);
+  roc.meanEven = fitEven->GetParameter(1);
+  roc.sigmaEven = fabs(fitEven->GetParameter(2));
+  roc.meanOdd = fitOdd->GetParameter(1);
+  roc.sigmaOdd = fabs(fitOdd->GetParameter(2));
+
+  roc.cutEven = static_cast<int>(roc.meanEven + NSIGMA*roc.sigmaEven) + 1;
+  roc.cutOdd = static_cast<int>(roc.meanOdd + NSIGMA*roc.sigmaOdd) + 1;
+
+  // draw an arrow on the plot to denote cutEven
+  TArrow *paEven = new TArrow(roc.cutEven, 0.5*roc.distEven->GetMaximum(), roc.cutEven, 0., 0.06, "|>");
+  paEven->SetArrowSize(0.1);
+  paEven->SetAngle(40);
+  paEven->SetLineWidth(2);
+  roc.distEven->GetListOfFunctions()->Add(paEven);
+
+  // draw an arrow on the plot to denote cutOdd
+  TArrow *paOdd = new TArrow(roc.cutOdd, 0.5*roc.distOdd->GetMaximum(), roc.cutOdd, 0., 0.06, "|>");
+  paOdd->SetArrowSize(0.1);
+  paOdd->SetAngle(40);
+  paOdd->SetLineWidth(2);
+  roc.distOdd->GetListOfFunctions()->Add(paOdd);
+
+  // fill plots with (thr-mean)/sigma (things above NSIGMA are called bad)
+  TH1D *dist = roc.rescaledDist;
+  for (int ix = 1; ix <= thr->GetNbinsX(); ++ix) {
+    for (int iy = 1; iy <= thr->GetNbinsY(); ++iy) {
+      double content = thr->GetBinContent(ix, iy);
+      double rescaledThr = 0;
+      if (ix % 2 == 1) // even column
+	rescaledThr = (content-roc.meanEven)/roc.sigmaEven;
+      else // odd column
+	rescaledThr = (content-roc.meanOdd)/roc.sigmaOdd;
+
+      // fill 1D plot, put under/overflow entries into first/last bin
+      if (rescaledThr < dist->GetXaxis()->GetXmax()-0.01){
+	if (rescaledThr > dist->GetXaxis()->GetXmin()){
+	  dist->Fill(rescaledThr);
+	}
+	else {
+	  dist->Fill(dist->GetXaxis()->GetXmin());
+	}
+      }
+      else {
+	dist->Fill(dist->GetXaxis()->GetXmax()-0.01);
+      }
+
+      roc.rescaledMap->Fill(ix-1,iy-1,rescaledThr);
+    }
+  }
+  roc.rescaledMap->SetMinimum(-5.);
+  roc.rescaledMap->SetMaximum(5);
+
+  // draw an arrow on the plot to denote cutDead
+  TArrow *pa = new TArrow(NSIGMA, 0.5*dist->GetMaximum(), NSIGMA, 0., 0.06, "|>");
+  pa->SetArrowSize(0.1);
+  pa->SetAngle(40);
+  pa->SetLineWidth(2);
+  dist->GetListOfFunctions()->Add(pa);
+
+  // bad bumps are those above NSIGMA*sigma above the mean
+  roc.nBadBumps = static_cast<int>(dist->Integral(dist->FindBin(NSIGMA), dist->GetNbinsX()+1));
+}
+
+
 
 // ----------------------------------------------------------------------
 TF1* PixTestBB3Map::fitPeaks(TH1D *h, TSpectrum &s, int npeaks) {
@@ -325,7 +339,10 @@ TF1* PixTestBB3Map::fitPeaks(TH1D *h, TSpectrum &s, int npeaks) {
     if (xp < 10) {
       continue;
     }
-    string name = Form("gauss_%d", p);
+    // function names have to be unique, the ROCs are fitted concurrently
+    stringstream sname;
+    sname << h->GetName() << "_gauss_" << p;
+    string name = sname.str();
     // fit a gaussian to the peak
     // (using pixels within +-25 DAC of peak)
     f = new TF1(name.c_str(), "gaus(0)", xp-25., xp+25.);
@@ -335,8 +352,8 @@ TF1* PixTestBB3Map::fitPeaks(TH1D *h, TSpectrum &s, int npeaks) {
     // use xp as guess of mean of fit
     // use 2 as guess for width of fit
     f->SetParameters(yp, xp, 2.);
-    h->Fit(f, "Q+");
-    double height = h->GetFunction(name.c_str())->GetParameter(0);
+    fitInJob(h, f);
+    double height = f->GetParameter(0);
     // save the parameters of the highest peak
     if (height > bestHeight) {
       bestHeight = height;
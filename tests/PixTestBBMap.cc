@@ -19,6 +19,19 @@ using namespace pxar;
 
 ClassImp(PixTestBBMap)
 
+// -- analysis of one ROC, run on a worker thread: only touches the histograms of its own ROC
+struct bbRocJob {
+  TH1 *thrmap;
+  TH1D *dist;
+  int nPeaks, cutDead, bbprob;
+  vector<double> peakX, peakY;
+};
+
+struct bbJobs {
+  PixTestBBMap *test;
+  vector<bbRocJob> rocs;
+};
+
 //------------------------------------------------------------------------------
 PixTestBBMap::PixTestBBMap(PixSetup *a, std::string name): PixTest(a, name), 
   fParNtrig(-1), fParVcalS(200), fDumpAll(-1), fDumpProblematic(-1) {
@@ -124,44 +137,30 @@ void PixTestBBMap::doTest() {
   fNDaqErrors = 0; 
   vector<TH1*>  thrmapsCals = scurveMaps("VthrComp", "calSMap", fParNtrig, 0, 149, 30, result, 1, flag);
 
-  // -- relabel negative thresholds as 255 and create distribution list
-  vector<TH1D*> dlist; 
+  // -- book the distributions here, they are filled and fitted on worker threads while the DUT is restored
+  bbJobs jobs;
+  jobs.test = this;
+  jobs.rocs.resize(thrmapsCals.size());
   TH1D *h(0);
   for (unsigned int i = 0; i < thrmapsCals.size(); ++i) {
-    for (int ix = 0; ix < thrmapsCals[i]->GetNbinsX(); ++ix) {
-      for (int iy = 0; iy < thrmapsCals[i]->GetNbinsY(); ++iy) {
-	if (thrmapsCals[i]->GetBinContent(ix+1, iy+1) < 0) thrmapsCals[i]->SetBinContent(ix+1, iy+1, 255.);
-      }
-    }
-    h = distribution((TH2D*)thrmapsCals[i], 256, 0., 256.);
-
-    dlist.push_back(h); 
+    h = new TH1D(Form("dist_%s", thrmapsCals[i]->GetName()), Form("dist_%s", thrmapsCals[i]->GetName()), 256, 0., 256.); 
+    jobs.rocs[i].thrmap = thrmapsCals[i]; 
+    jobs.rocs[i].dist = h; 
     fHistList.push_back(h); 
   }
 
+  PixJobs *pj = startJobs(analyzeRoc, &jobs, jobs.rocs.size());
   restoreDacs();
+  dutCalibrateOff();
+  finishJobs(pj);
 
   // -- summary printout
   string bbString(""), bbCuts(""); 
-  int bbprob(0); 
-  int nPeaks(0), cutDead(0); 
-  TSpectrum s; 
-  for (unsigned int i = 0; i < dlist.size(); ++i) {
-    h = (TH1D*)dlist[i];
-    nPeaks = s.Search(h, 5, "", 0.01); 
-    LOG(logDEBUG) << "found " << nPeaks << " peaks in " << h->GetName();
-    cutDead = fitPeaks(h, s, nPeaks); 
-
-    bbprob = static_cast<int>(h->Integral(cutDead, h->FindBin(255)));
-    bbString += Form(" %4d", bbprob); 
-    bbCuts   += Form(" %4d", cutDead); 
-
-    TArrow *pa = new TArrow(cutDead, 0.5*h->GetMaximum(), cutDead, 0., 0.06, "|>"); 
-    pa->SetArrowSize(0.1);
-    pa->SetAngle(40);
-    pa->SetLineWidth(2);
-    h->GetListOfFunctions()->Add(pa); 
-
+  for (unsigned int i = 0; i < jobs.rocs.size(); ++i) {
+    showPeaks(jobs.rocs[i].dist, jobs.rocs[i].peakX, jobs.rocs[i].peakY); 
+    LOG(logDEBUG) << "found " << jobs.rocs[i].nPeaks << " peaks in " << jobs.rocs[i].dist->GetName();
+    bbString += Form(" %4d", jobs.rocs[i].bbprob); 
+    bbCuts   += Form(" %4d", jobs.rocs[i].cutDead); 
   }
 
   if (h) {
@@ -176,11 +175,39 @@ void PixTestBBMap::doTest() {
 	       << ", duration: " << seconds << " seconds";
   LOG(logINFO) << "number of dead bumps (per ROC): " << bbString;
   LOG(logINFO) << "separation cut       (per ROC): " << bbCuts;
-  dutCalibrateOff();
 
 }
 
 
+// ----------------------------------------------------------------------
+void PixTestBBMap::analyzeRoc(void *arg, unsigned int i) {
+  bbJobs *jobs = static_cast<bbJobs*>(arg);
+  bbRocJob &roc = jobs->rocs[i];
+  TH1 *thr = roc.thrmap;
+  TH1D *h = roc.dist;
+
+  // -- relabel negative thresholds as 255 and fill the distribution
+  for (int ix = 0; ix < thr->GetNbinsX(); ++ix) {
+    for (int iy = 0; iy < thr->GetNbinsY(); ++iy) {
+      if (thr->GetBinContent(ix+1, iy+1) < 0) thr->SetBinContent(ix+1, iy+1, 255.);
+      h->Fill(thr->GetBinContent(ix+1, iy+1)); 
+    }
+  }
+
+  TSpectrum s; 
+  roc.nPeaks = s.Search(h, 5, "goff", 0.01); 
+  getPeaks(s, roc.nPeaks, roc.peakX, roc.peakY); 
+  roc.cutDead = jobs->test->fitPeaks(h, s, roc.nPeaks); 
+  roc.bbprob = static_cast<int>(h->Integral(roc.cutDead, h->FindBin(255)));
+
+  TArrow *pa = new TArrow(roc.cutDead, 0.5*h->GetMaximum(), roc.cutDead, 0., 0.06, "|>"); 
+  pa->SetArrowSize(0.1);
+  pa->SetAngle(40);
+  pa->SetLineWidth(2);
+  h->GetListOfFunctions()->Add(pa); 
+}
+
+
 
 // ----------------------------------------------------------------------
 int PixTestBBMap::fitPeaks(TH1D *h, TSpectrum &s, int npeaks) {
@@ -205,15 +232,19 @@ int PixTestBBMap::fitPeaks(TH1D *h, TSpectrum &s, int npeaks) {
     if (xp < 15) {
       continue;
     }
-    name = Form("gauss_%d", p); 
+    // function names have to be unique, the ROCs are fitted concurrently
+    stringstream sname;
+    sname << h->GetName() << "_gauss_" << p;
+    name = sname.str(); 
     f = new TF1(name.c_str(), "gaus(0)", 0., 256.);
     int bin = h->GetXaxis()->FindBin(xp);
     double yp = h->GetBinContent(bin);
     f->SetParameters(yp, xp, 2.);
-    h->Fit(f, "Q+"); 
+    // -- f is kept with h
+    fitInJob(h, f); 
     ++fittedPeaks;
-    peak = h->GetFunction(name.c_str())->GetParameter(1); 
-    sigma = h->GetFunction(name.c_str())->GetParameter(2); 
+    peak = f->GetParameter(1); 
+    sigma = f->GetParameter(2); 
     if (0 == p) {
       lcuts[0] = peak + 3*sigma; 
       if (h->Integral(h->FindBin(peak + 10.*sigma), 250) > 10.) {
@@ -225,7 +256,6 @@ int PixTestBBMap::fitPeaks(TH1D *h, TSpectrum &s, int npeaks) {
       lcuts[1] = peak - 3*sigma; 
       lcuts[2] = peak - sigma; 
     }
-    delete f;
   }
   
   int startbin = (int)(0.5*(lcuts[0] + lcuts[1])); 
@@ -17,6 +17,8 @@ public:
 
   void doTest(); 
   int  fitPeaks(TH1D *h, TSpectrum &s, int npeaks);
+  /// bump bonding analysis of one ROC, run concurrently for all ROCs
+  static void analyzeRoc(void *jobs, unsigned int i);
 
 private:
   int          fParNtrig; 
@@ -17,6 +17,7 @@
 #include <fstream>
 #include <algorithm>
 #include <bitset>
+#include <sys/stat.h>
 
 // #define DEBUG
 
@@ -72,13 +73,7 @@ void PixTestCmd::bookHist(string name)
 PixTestCmd::~PixTestCmd()
 {
   LOG(logDEBUG) << "PixTestCmd dtor";
-  std::list<TH1*>::iterator il;
-  fDirectory->cd();
-  for( il = fHistList.begin(); il != fHistList.end(); ++il ) {
-    LOG(logINFO) << "Write out " << (*il)->GetName();
-    (*il)->SetDirectory(fDirectory);
-    (*il)->Write();
-  }
+  // the histograms are written out by PixTest::~PixTest()
   
   // dump the history file for future use
   ofstream fout(".history");
@@ -795,6 +790,13 @@ string Keyword::str(){
 /******************  execution / processing **************************/
 
 
+Block::~Block(){
+    for (unsigned int i=0; i<stmts.size(); i++){
+        delete stmts[i];
+    }
+}
+
+
 bool Block::exec(CmdProc * proc, Target & target){
     bool success=true;
     for (unsigned int i=0; i<stmts.size(); i++){
@@ -911,6 +913,16 @@ const char * const CmdProc::fDAC_names[CmdProc::fnDAC_names] =
 int CmdProc::fGetBufMethod = 1;
 int CmdProc::fPrerun=0;
 bool CmdProc::fFW35=false;
+map<string, CmdScript *> CmdProc::fScripts;
+
+
+CmdScript::~CmdScript(){
+    for (unsigned int i=0; i<plan.size(); i++){
+        for (unsigned int j=0; j<plan[i].size(); j++){
+            delete plan[i][j];
+        }
+    }
+}
 
 
 void CmdProc::init()
@@ -934,6 +946,7 @@ void CmdProc::init()
     fSeq = 7;  // pg sequence bits
     fPeriod = 0;
     fPgRunning = false;
+    fBatchDacs = true;
     macros["start"] = getWords("[roc * mask; roc * cald; reset tbm; seq 14]");
     macros["startroc"] = getWords("[mask; seq 15; arm 20 20; tct 106; vcal 200; adc]");
     macros["tbmonly"] = getWords("[reset tbm; tbm disable triggers; seq 10; adc]");
@@ -973,6 +986,7 @@ CmdProc::CmdProc(CmdProc * p)
     fSeq = p->fSeq;
     fPeriod = p->fPeriod;
     fPgRunning = p->fPgRunning;
+    fBatchDacs = p->fBatchDacs;
     fTCT = p->fTCT;
     fTRC = p->fTRC;
     fTTK = p->fTTK;
@@ -984,6 +998,81 @@ CmdProc::CmdProc(CmdProc * p)
 }
 
 CmdProc::~CmdProc(){
+    flushDACs();
+    for( map<string, vector<Statement *> >::iterator it=fPlans.begin();
+        it!=fPlans.end(); it++){
+        for( unsigned int i=0; i<it->second.size(); i++){ delete it->second[i]; }
+    }
+}
+
+/**************** batched roc register writes *************************/
+
+
+void CmdProc::setDAC(string name, uint8_t value, uint8_t rocId){
+    /* queue a roc register write, or write immediately when not batching.
+     * tb and tbm register names are refused, they must not reach the rocs */
+    if (fBatchDacs){
+        if (!dac(name).valid()){
+            out << "not a roc register: " << name << "\n";
+            return;
+        }
+        fPendingDacs[rocId][name] = value;
+    }else{
+        fApi->setDAC(dac(name), value, rocId);
+    }
+}
+
+
+uint8_t CmdProc::getDAC(string name, uint8_t rocId){
+    /* current register value, including writes that are still queued */
+    map<uint8_t, map<string, uint8_t> >::iterator roc = fPendingDacs.find(rocId);
+    if (roc != fPendingDacs.end()){
+        map<string, uint8_t>::iterator dac = roc->second.find(name);
+        if (dac != roc->second.end()) return dac->second;
+    }
+    return fApi->_dut->getDAC(rocId, dac(name));
+}
+
+
+const pxar::dacHandle & CmdProc::dac(string name){
+    /* resolve a roc register name, the handle is kept for the next access */
+    map<string, pxar::dacHandle>::iterator it = fDacHandles.find(name);
+    if (it != fDacHandles.end()) return it->second;
+    return fDacHandles[name] = fApi->dac(name);
+}
+
+
+const pxar::tbmRegHandle & CmdProc::tbmReg(string name){
+    /* resolve a tbm register name, the handle is kept for the next access */
+    map<string, pxar::tbmRegHandle>::iterator it = fTbmRegHandles.find(name);
+    if (it != fTbmRegHandles.end()) return it->second;
+    return fTbmRegHandles[name] = fApi->tbmReg(name);
+}
+
+
+bool CmdProc::isRegisterWrite(Keyword kw, Target target, bool forceTarget){
+    /* true for roc commands that do nothing but write registers,
+     * these can be queued, anything else flushes the queue first.
+     * commands explicitly addressed to the tb or a tbm never qualify,
+     * even if they share a keyword with a roc command */
+    if (forceTarget && (target.name != "roc")) return false;
+    int value;
+    for(unsigned int i=0; i<fnDAC_names; i++){
+        if (kw.match(fDAC_names[i], value)) return true;
+    }
+    return kw.match("vcal", value, "hi") || kw.match("vcal", value, "lo")
+        || kw.match("hirange") || kw.match("lorange")
+        || kw.match("disable") || kw.match("enable");
+}
+
+
+bool CmdProc::flushDACs(){
+    /* send all queued roc register writes with one transfer */
+    if (fPendingDacs.empty()) return true;
+    bool ok = fApi->setDACs(fPendingDacs);
+    fPendingDacs.clear();
+    if (!ok){ out << "failed to set dacs\n"; }
+    return ok;
 }
 
 /**************** implement some hardware functionalities *************/
@@ -1000,7 +1089,7 @@ int CmdProc::tbmset(int address, int  value){
    
     uint8_t idx = (address & 0x0F) >> 1;  
     const char* apinames[] = {"base0", "base2", "base4","invalid","base8","basea","basec","basee"};
-    fApi->setTbmReg( apinames[ idx], value, core );
+    fApi->setTbmReg( tbmReg(apinames[ idx]), value, core );
 
     return 0; // nonzero values for errors
 }
@@ -1052,7 +1141,7 @@ int CmdProc::tbmset(string name, uint8_t cores, int value, uint8_t valueMask){
                         out << " from 0x" << hex << (int) regs[i].second;
                         out << " to 0x" << hex << (int) update << "\n";
                     }
-                    fApi->setTbmReg( name, update, core );
+                    fApi->setTbmReg( tbmReg(name), update, core );
                     err=0;
                 }
             }
@@ -2777,23 +2866,23 @@ int CmdProc::roc( Keyword kw, int rocId){
     vector<int> col, row;
     int value;
     for(unsigned int i=0; i<fnDAC_names; i++){
-        if (kw.match(fDAC_names[i],value)){ fApi->setDAC(kw.keyword,value, rocId );  return 0 ;  }
+        if (kw.match(fDAC_names[i],value)){ setDAC(kw.keyword,value, rocId );  return 0 ;  }
     }
     if (kw.match("vcal",value,"hi")){
-        fApi->setDAC(kw.keyword,value, rocId );
-        fApi->setDAC("ctrlreg", (fApi->_dut->getDAC(rocId, "ctrlreg"))|4, rocId);
+        setDAC(kw.keyword,value, rocId );
+        setDAC("ctrlreg", (getDAC("ctrlreg", rocId))|4, rocId);
         return 0 ;
     }
     if (kw.match("vcal",value,"lo")){
-        fApi->setDAC(kw.keyword,value, rocId );
-        fApi->setDAC("ctrlreg", (fApi->_dut->getDAC(rocId, "ctrlreg"))&0xfb, rocId);
+        setDAC(kw.keyword,value, rocId );
+        setDAC("ctrlreg", (getDAC("ctrlreg", rocId))&0xfb, rocId);
         return 0 ;
     }
         
-    if (kw.match("hirange")) {fApi->setDAC("ctrlreg", (fApi->_dut->getDAC(rocId, "ctrlreg"))|4, rocId);return 0 ;}
-    if (kw.match("lorange")) {fApi->setDAC("ctrlreg", (fApi->_dut->getDAC(rocId, "ctrlreg"))&0xfb, rocId);return 0 ;}
-    if (kw.match("disable") ) {fApi->setDAC("ctrlreg", (fApi->_dut->getDAC(rocId, "ctrlreg"))|2, rocId);return 0 ;}
-    if (kw.match("enable")) {fApi->setDAC("ctrlreg", (fApi->_dut->getDAC(rocId, "ctrlreg"))&0xfd, rocId);return 0 ;}
+    if (kw.match("hirange")) {setDAC("ctrlreg", (getDAC("ctrlreg", rocId))|4, rocId);return 0 ;}
+    if (kw.match("lorange")) {setDAC("ctrlreg", (getDAC("ctrlreg", rocId))&0xfb, rocId);return 0 ;}
+    if (kw.match("disable") ) {setDAC("ctrlreg", (getDAC("ctrlreg", rocId))|2, rocId);return 0 ;}
+    if (kw.match("enable")) {setDAC("ctrlreg", (getDAC("ctrlreg", rocId))&0xfd, rocId);return 0 ;}
     if (kw.match("mask")   ) { fApi->_dut->maskAllPixels(true, rocId); fPixelConfigNeeded = true; return 0 ;}
     if (kw.match("cald")   ) {fApi->SetCalibrateBits(false); fApi->_dut->testAllPixels(false, rocId); fPixelConfigNeeded = true; return 0 ;}
     //if (kw.match("cald")   ) { fApi->_dut->testAllPixels(false, rocId); fPixelConfigNeeded = true; return 0 ;}
@@ -2918,6 +3007,11 @@ bool CmdProc::process(Keyword keyword, Target target, bool forceTarget){
         Arg::varvalue = target.value();
     }
     
+    // keep the order of execution, pending register writes go first
+    if (!(fBatchDacs && isRegisterWrite(keyword, target, forceTarget))){
+        if (!flushDACs()) return false;
+    }
+    
     if (keyword.match("info")){
         fApi->_dut->info();
         return true;
@@ -2951,25 +3045,7 @@ bool CmdProc::process(Keyword keyword, Target target, bool forceTarget){
     string filename;
     
     if (keyword.match("exec", filename)){
-        
-        // execute a file with a new command processor
-        CmdProc * p = new CmdProc( this );
-        ifstream inputFile( filename.c_str());
-        if ( inputFile.is_open()) {
-            string line;
-            while( getline( inputFile, line ) ){
-				if(fEchoExecs) out << ">" << line << "\n"; 
-                p->exec(line);  
-                out << p->out.str();
-            }
-            delete p;
-            return true;
-            
-        }  else {
-            
-            out << " Unable to open file ";;
-            return false;
-        }
+        return (execScript(filename)==0);
     }
     
     if (keyword.match("verbose")){ verbose=true; return true;}
@@ -2981,6 +3057,8 @@ bool CmdProc::process(Keyword keyword, Target target, bool forceTarget){
     string message;
     if ( keyword.match("echo","on")){ fEchoExecs = true; return true;}
     if ( keyword.match("echo","off")){ fEchoExecs = false; return true;}
+    if ( keyword.match("batch","on")){ fBatchDacs = true; return true;}
+    if ( keyword.match("batch","off")){ fBatchDacs = false; return true;}
    
     if ( keyword.match("echo","roc")){ out << "roc " << target.value() << "\n"; return true;}
     if ( keyword.match("echo","%")){ out << "%" << target.value() << "\n"; return true;}
@@ -3081,8 +3159,10 @@ bool CmdProc::process(Keyword keyword, Target target, bool forceTarget){
 
 
 /* driver */
-int CmdProc::exec(std::string s){
-    out.str("");
+int CmdProc::compile(std::string s, vector<Statement *> & stmts){
+    /* parse a line into statements, macros are expanded (and defined)
+     * at this point, the statements can be executed repeatedly */
+    stmts.clear();
 
     //  skip empty lines and comments
     if( (s.size()==0) || (s[0]=='#') || (s[0]=='-') ) return 0;
@@ -3102,23 +3182,31 @@ int CmdProc::exec(std::string s){
 
     int j=0;
     //parse
-    vector < Statement *> stmts;
     while( (!words.empty()) && (j++ < 2000)){
         Statement * c = new Statement; 
         bool stat=  c->parse( words );
         if( stat ){
             stmts.push_back( c );
+        }else{
+            delete c;
         }
         if (!words.empty()) {
             if (words.front()==";") {
                 words.pop_front();
             }else{
                 out << "expected ';' instead of '" << words.front() << "'";
+                for( unsigned int i=0; i<stmts.size(); i++){ delete stmts[i]; }
+                stmts.clear();
                 return 1;
             }
         }
     }
+    return 0;
+}
 
+
+int CmdProc::run(vector<Statement *> & stmts){
+    /* execute compiled statements */
     bool ok = true;
     for( unsigned int i=0; i<stmts.size(); i++){
         redirected = redirected | stmts[i]->redirected;
@@ -3133,6 +3221,105 @@ int CmdProc::exec(std::string s){
 }
 
 
+int CmdProc::execScript(string filename){
+    /* execute a file with a new command processor, the file is compiled
+     * once and re-used as long as neither the file nor the macros change */
+    struct stat fileStatus;
+    if (stat(filename.c_str(), &fileStatus) != 0){
+        out << " Unable to open file ";
+        return 1;
+    }
 
+    CmdProc * p = new CmdProc( this );
+    CmdScript * script = NULL;
+    bool cached = false;
+    map<string, CmdScript *>::iterator it = fScripts.find(filename);
+    if ( (it != fScripts.end()) && (it->second->mtime == fileStatus.st_mtime)
+        && (it->second->macrosBefore == macros) ){
+        script = it->second;
+        p->macros = script->macrosAfter;
+        cached = true;
+    }else{
+        ifstream inputFile( filename.c_str());
+        if ( !inputFile.is_open()) {
+            out << " Unable to open file ";
+            delete p;
+            return 1;
+        }
+        script = new CmdScript();
+        script->mtime = fileStatus.st_mtime;
+        script->macrosBefore = macros;
+        bool ok = true;
+        string line;
+        while( getline( inputFile, line ) ){
+            vector<Statement *> stmts;
+            p->out.str("");
+            if (p->compile(line, stmts) > 0){
+                out << p->out.str() << "\n";
+                ok = false;
+            }
+            script->lines.push_back(line);
+            script->plan.push_back(stmts);
+        }
+        script->macrosAfter = p->macros;
+
+        // only keep scripts without errors, so that errors are reported each time
+        if (ok){
+            if (it != fScripts.end()) delete it->second;
+            fScripts[filename] = script;
+            cached = true;
+        }
+    }
+
+    for(unsigned int i=0; i<script->lines.size(); i++){
+        if(fEchoExecs) out << ">" << script->lines[i] << "\n"; 
+        p->out.str("");
+        p->run(script->plan[i]);
+        out << p->out.str();
+    }
+    p->out.str("");
+    bool flushed = p->flushDACs();
+    out << p->out.str();
+    delete p;
+    if (!cached) delete script;
+    return flushed ? 0 : 1;
+}
 
 
+int CmdProc::exec(std::string s){
+    out.str("");
+
+    //  skip empty lines and comments
+    if( (s.size()==0) || (s[0]=='#') || (s[0]=='-') ) return 0;
+
+    // re-use the statements if this line has been compiled before
+    vector<Statement *> stmts;
+    bool cached = false;
+    map<string, vector<Statement *> >::iterator it = fPlans.find(s);
+    if (it != fPlans.end()){
+        stmts = it->second;
+        cached = true;
+    }else{
+        map<string, deque <string> > macrosBefore = macros;
+        int stat = compile(s, stmts);
+        if (stat > 0) return stat;
+        if (macros == macrosBefore){
+            fPlans[s] = stmts;
+            cached = true;
+        }else{
+            // macros are expanded when compiling, forget everything compiled so far
+            for( it=fPlans.begin(); it!=fPlans.end(); it++){
+                for( unsigned int i=0; i<it->second.size(); i++){ delete it->second[i]; }
+            }
+            fPlans.clear();
+        }
+    }
+
+    int stat = run(stmts);
+    if (!flushDACs()) stat = 2;
+
+    if (!cached){
+        for( unsigned int i=0; i<stmts.size(); i++){ delete stmts[i]; }
+    }
+    return stat;
+}
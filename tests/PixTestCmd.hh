@@ -247,6 +247,7 @@ class Block{
   vector<Statement *> stmts;
  public:
   Block(){ stmts.clear();}
+  ~Block();
   bool parse(Token &);
   bool exec(CmdProc *, Target &);
 };
@@ -286,6 +287,19 @@ class DRecord{
     }
 };
 
+class CmdScript{
+    // a command file compiled into statements, re-used as long as
+    // neither the file nor the macros it was compiled with change
+    public:
+    time_t mtime;
+    map<string, deque <string> > macrosBefore;
+    map<string, deque <string> > macrosAfter;
+    vector<string> lines;
+    vector< vector<Statement *> > plan;
+    CmdScript():mtime(0){};
+    ~CmdScript();
+};
+
 class CmdProc {
 
  
@@ -300,6 +314,9 @@ class CmdProc {
   
   int exec(string s);
   int exec(const char* p){ return exec(string(p));}
+  int compile(string s, vector<Statement *> & stmts);
+  int run(vector<Statement *> & stmts);
+  int execScript(string filename);
 
   bool process(Keyword, Target, bool );
   bool setDefaultTarget( Target t){ defaultTarget=t; return true; }
@@ -343,6 +360,22 @@ class CmdProc {
   bool fEchoExecs;  // echo command from executed files
   Target defaultTarget;
   map<string, deque <string> > macros;
+  map<string, vector<Statement *> > fPlans;  // compiled command lines
+  static map<string, CmdScript *> fScripts;  // compiled command files
+  
+  // roc register writes are collected and sent with one transfer
+  bool fBatchDacs;
+  map<uint8_t, map<string, uint8_t> > fPendingDacs;
+  void setDAC(string name, uint8_t value, uint8_t rocId);
+  uint8_t getDAC(string name, uint8_t rocId);
+  bool isRegisterWrite(Keyword kw, Target target, bool forceTarget);
+  bool flushDACs();
+
+  // register names are resolved once, repeated writes skip the dictionary lookup
+  map<string, pxar::dacHandle> fDacHandles;
+  map<string, pxar::tbmRegHandle> fTbmRegHandles;
+  const pxar::dacHandle & dac(string name);
+  const pxar::tbmRegHandle & tbmReg(string name);
   
   
   int tbmset(int address, int value);
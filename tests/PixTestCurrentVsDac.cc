@@ -91,13 +91,7 @@ void PixTestCurrentVsDac::bookHist(string name) // general booking routine
 PixTestCurrentVsDac::~PixTestCurrentVsDac()
 {
   LOG(logDEBUG) << "PixTestCurrentVsDac dtor";
-  std::list<TH1*>::iterator il;
-  fDirectory->cd();
-  for( il = fHistList.begin(); il != fHistList.end(); ++il) {
-    LOG(logDEBUG) << "Write out " << (*il)->GetName();
-    (*il)->SetDirectory(fDirectory);
-    (*il)->Write();
-  }
+  // the histograms are written out by PixTest::~PixTest()
 }
 
 // ----------------------------------------------------------------------
@@ -113,6 +107,9 @@ void PixTestCurrentVsDac::doTest() {
 
   TH1D *hia(0);
   TH1D *hid(0);
+
+  // -- resolve the DAC once for all ROCs
+  dacHandle dac = fApi->dac(fParDAC);
   
   for( uint32_t roc = 0; roc < fPixSetup->getConfigParameters()->getNrocs(); ++roc ) {
     
@@ -123,19 +120,20 @@ void PixTestCurrentVsDac::doTest() {
       
       // remember DAC
       
-      uint8_t dacval = fApi->_dut->getDAC( roc, fParDAC );
+      uint8_t dacval = fApi->_dut->getDAC( roc, dac );
       
-      // loop over DAC
-      int dacmax = fApi->getDACRange(fParDAC);
-      for( int idac = 0; idac <= dacmax; ++idac ) {
-	
-	fApi->setDAC( fParDAC, idac, roc );
-	// delay
-	hia->SetBinContent( idac+1, fApi->getTBia()*1E3 );
-	hid->SetBinContent( idac+1, fApi->getTBid()*1E3 );
+      // scan DAC, the currents are sampled until they have settled
+      int dacmax = fApi->getDACRange(dac);
+      vector<pair<uint8_t, double> > ia = fApi->getTBiaVsDAC( dac, 1, 0, dacmax, roc );
+      for( unsigned int i = 0; i < ia.size(); ++i ) {
+	hia->SetBinContent( ia[i].first+1, ia[i].second*1E3 );
+      }
+      vector<pair<uint8_t, double> > id = fApi->getTBidVsDAC( dac, 1, 0, dacmax, roc );
+      for( unsigned int i = 0; i < id.size(); ++i ) {
+	hid->SetBinContent( id[i].first+1, id[i].second*1E3 );
       }
       
-      fApi->setDAC( fParDAC, dacval, roc ); // restore
+      fApi->setDAC( dac, dacval, roc ); // restore
     }
     else {
       LOG(logINFO) << "XX did not find "
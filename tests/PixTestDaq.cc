@@ -336,45 +336,35 @@ void PixTestDaq::doDaqRun() {
 
   } else {  //Use seconds
 
-	//Start trigger loop + buffer fill management:
-	int finalPeriod = fApi->daqTriggerLoop(totalPeriod);
+	//Start trigger loop, the trigger rate is regulated to keep up with reading out once a second:
+	int finalPeriod = fApi->daqTriggerLoopRegulated(totalPeriod);
 	LOG(logINFO) << "PixTestDaq:: start TriggerLoop with period " << finalPeriod << " and duration " << fParSeconds << " seconds";
 	
-	  //To control the buffer filling
-	uint8_t perFull;
-	uint64_t diff = 0, timepaused = 0, timeff = 0;
 	timer t;
-	bool TotalTime = false;
-
-	while (fDaq_loop){    //Check every n seconds if buffer is full less then 80%
-	  while (fApi->daqStatus(perFull) && perFull < 80 && fDaq_loop) {     //Pause and drain the buffer if almost full.
-		  timeff = t.get() - timepaused;
-		  if (timeff / 1000 >= fParSeconds) {
-			  fDaq_loop = false;
-			  TotalTime = true;
-			  break;
-		  }
-		  LOG(logDEBUG) << "buffer not full, at " << (int)perFull << "%";
-		  gSystem->ProcessEvents();
+	uint64_t lastReadout = 0;
+	uint8_t perFull = 0;
+
+	while (fDaq_loop) {
+	  //daqStatus() also fails if the buffer is about to overflow, read out right away then:
+	  perFull = 0;
+	  bool ok = fApi->daqStatus(perFull);
+	  if (!ok && perFull < 90) break;
+	  gSystem->ProcessEvents();
+	  if (ok) mDelay(100);
+	  if (t.get() / 1000 >= fParSeconds) {
+		  LOG(logINFO) << "PixTestDaq:: total time reached - DAQ stopped.";
+		  break;
 	  }
-	  if (fDaq_loop){
-		  LOG(logINFO) << "Elapsed time: " << timeff / 1000 << " seconds.";
-		  LOG(logINFO) << "Buffer almost full, pausing triggers.";
-		  fApi->daqTriggerLoopHalt();
-		  diff = t.get();
-		  ProcessData(0);
-		  diff = t.get() - diff;
-		  timepaused += diff;
-		  LOG(logDEBUG) << "Readout time: " << timepaused / 1000 << " seconds.";
-		  LOG(logINFO) << "Resuming triggers for " << fParSeconds - (timeff/1000) << " seconds.";
-		  fApi->daqTriggerLoop(finalPeriod);
-	  }
-	  else {
-		  if (TotalTime) { LOG(logINFO) << "PixTestDaq:: total time reached - DAQ stopped."; }
-		  fApi->daqStop();
+	  if (!ok || t.get() - lastReadout >= 1000) {
+		  lastReadout = t.get();
+		  LOG(logDEBUG) << "Elapsed time: " << lastReadout / 1000 << " seconds, trigger period "
+				<< fApi->daqTriggerLoopPeriod() << " clk.";
 		  ProcessData(0);
 	  }
 	}
+	fDaq_loop = false;
+	fApi->daqStop();
+	ProcessData(0);
   }
   //::::::::::::::::::::::::::::::
   //DAQ - THE END.
@@ -105,7 +105,7 @@ void PixTestFullTest::doTest() {
       fPixSetup->getConfigParameters()->setTrimVcalSuffix(trimvcal, true); 
     }
 
-    t->fullTest(); 
+    t->runFullTest(); 
 
     delete t; 
   }
@@ -234,54 +234,39 @@ void PixTestGainPedestal::measure() {
   fApi->_dut->maskAllPixels(false);
   maskPixels();
 
-  // -- first low range 
-  fApi->setDAC("ctrlreg", 0);
-
-  vector<pair<uint8_t, vector<pixel> > > rresult, lresult, hresult; 
+  // -- low and high range points in one scan, ctrlreg is switched in between
+  vector<uint8_t> vcals, ctrlregs; 
   for (unsigned int i = 0; i < fLpoints.size(); ++i) {
-    LOG(logINFO) << "scanning low vcal = " << fLpoints[i];
-    int cnt(0); 
-    bool done = false;
-    while (!done){
-      try {
-	rresult = fApi->getPulseheightVsDAC("vcal", fLpoints[i], fLpoints[i], FLAGS, fParNtrig);
-	copy(rresult.begin(), rresult.end(), back_inserter(lresult)); 
-	done = true; // got our data successfully
-      }
-      catch(pxar::DataMissingEvent &e){
-	LOG(logCRITICAL) << "problem with readout: "<< e.what() << " missing " << e.numberMissing << " events"; 
-	++cnt;
-	if (e.numberMissing > 10) done = true; 
-      } catch(pxarException &e) {
-	LOG(logCRITICAL) << "pXar execption: "<< e.what(); 
-	++cnt;
-      }
-      done = (cnt>2) || done;
-    }
+    vcals.push_back(fLpoints[i]); 
+    ctrlregs.push_back(0); 
   }
-
-  // -- and high range
-  fApi->setDAC("ctrlreg", 4);
   for (unsigned int i = 0; i < fHpoints.size(); ++i) {
-    LOG(logINFO) << "scanning high vcal = " << fHpoints[i] << " (= " << 7*fHpoints[i] << " in low range)";
-    int cnt(0); 
-    bool done = false;
-    while (!done){
-      try {
-	rresult = fApi->getPulseheightVsDAC("vcal", fHpoints[i], fHpoints[i], FLAGS, fParNtrig);
-	copy(rresult.begin(), rresult.end(), back_inserter(hresult)); 
-	done = true; // got our data successfully
-      }
-      catch(pxar::DataMissingEvent &e){
-	LOG(logCRITICAL) << "problem with readout: "<< e.what() << " missing " << e.numberMissing << " events"; 
-	++cnt;
-	if (e.numberMissing > 10) done = true; 
-      } catch(pxarException &e) {
-	LOG(logCRITICAL) << "pXar execption: "<< e.what(); 
-	++cnt;
+    vcals.push_back(fHpoints[i]); 
+    ctrlregs.push_back(4); 
+  }
+  LOG(logINFO) << "scanning low vcal = " << fLpoints.size() << " points, high vcal = " << fHpoints.size() << " points";
+
+  vector<pair<uint8_t, vector<pixel> > > rresult, lresult, hresult; 
+  int cnt(0); 
+  bool done = false;
+  while (!done){
+    try {
+      rresult = fApi->getPulseheightVsDACList("vcal", vcals, "ctrlreg", ctrlregs, FLAGS, fParNtrig);
+      if (rresult.size() == vcals.size()) {
+	copy(rresult.begin(), rresult.begin() + fLpoints.size(), back_inserter(lresult)); 
+	copy(rresult.begin() + fLpoints.size(), rresult.end(), back_inserter(hresult)); 
       }
-      done = (cnt>2) || done;
+      done = true; // got our data successfully
+    }
+    catch(pxar::DataMissingEvent &e){
+      LOG(logCRITICAL) << "problem with readout: "<< e.what() << " missing " << e.numberMissing << " events"; 
+      ++cnt;
+      if (e.numberMissing > 10) done = true; 
+    } catch(pxarException &e) {
+      LOG(logCRITICAL) << "pXar execption: "<< e.what(); 
+      ++cnt;
     }
+    done = (cnt>2) || done;
   }
 
   for (unsigned int i = 0; i < lresult.size(); ++i) {
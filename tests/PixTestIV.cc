@@ -13,6 +13,7 @@
 #include "helper.h"
 #ifdef BUILD_HV
 #include "hvsupply.h"
+#include "ivcurve.h"
 #endif
 
 using namespace pxar;
@@ -20,12 +21,51 @@ using namespace std;
 
 ClassImp(PixTestIV)
 
+#ifdef BUILD_HV
+// Bookkeeping shared with the IV engine callback:
+struct IVCallbackData {
+  TH1D *h1;
+  vector<double> *voltageMeasurements;
+  vector<double> *currentMeasurements;
+  vector<TTimeStamp> *timeStamps;
+  bool *stop;
+};
+
+// ----------------------------------------------------------------------
+static bool ivCallback(const IVPoint &point, void *data) {
+  IVCallbackData *d = static_cast<IVCallbackData*>(data);
+  d->voltageMeasurements->push_back(point.voltRead);
+  d->currentMeasurements->push_back(point.amps);
+  // Refined steps may share a bin, the latest reading is shown:
+  d->h1->SetBinContent(d->h1->FindBin(-point.voltSet), -point.amps*1E6);
+
+  TTimeStamp ts;
+  ts.Set();
+  d->timeStamps->push_back(ts);
+
+  LOG(logINFO) << Form("V = %4f (meas: %+7.2f) I = %4.2e uA (%d samples%s) %s",
+                       point.voltSet, point.voltRead, point.amps*1E6, point.samples,
+                       point.settled ? "" : ", not settled", ts.AsString("c"));
+
+  d->h1->Draw("p");
+  if(gPad) gPad->Modified();
+  if(gPad) gPad->Update();
+  gSystem->ProcessEvents();
+  return !(*d->stop);
+}
+
+static void ivIdle(void * /*data*/) {
+  gSystem->ProcessEvents();
+}
+#endif
+
 // ----------------------------------------------------------------------
 PixTestIV::PixTestIV(PixSetup *a, string name) : PixTest(a, name), 
                                                  fParVoltageStart(0),
                                                  fParVoltageStop(150), 
                                                  fParVoltageStep(5), 
                                                  fParDelay(1), 
+                                                 fParTolerance(0.01),
                                                  fParCompliance(100),
                                                  fStop(false), 
                                                  fParPort(""){
@@ -58,6 +98,9 @@ bool PixTestIV::setParameter(string parName, string sval) {
       if(!parName.compare("delay(seconds)")) {
         fParDelay = atof(sval.c_str());
       }
+      if(!parName.compare("tolerance")) {
+        fParTolerance = atof(sval.c_str());
+      }
       if(!parName.compare("port")) {
         fParPort = sval;
       }
@@ -121,8 +164,6 @@ void PixTestIV::doTest() {
   vector<double> voltageMeasurements;
   vector<double> currentMeasurements;
   vector<TTimeStamp> timeStamps;
-  double signedStep = (fParVoltageStart < fParVoltageStop) ? fParVoltageStep
-                                                           : -fParVoltageStep;
   PixTest::update();
   if(gPad) gPad->SetLogy(true);
   
@@ -131,31 +172,29 @@ void PixTestIV::doTest() {
   pxar::HVSupply *hv = new pxar::HVSupply(fParPort.c_str(), serialTimeout);
   hv->setMicroampsLimit(fParCompliance);
 
-  hv->sweepStart(-fParVoltageStart,-fParVoltageStop,-signedStep,fParDelay);
-  bool aborted;
-  while(hv->sweepRunning()){
-    double voltSet, voltRead, current;
-    aborted = hv->sweepRead(voltSet, voltRead, current);
-    voltageMeasurements.push_back(voltRead);
-    currentMeasurements.push_back(current);
-    h1->Fill(-voltSet, -current*1E6);
-    
-    TTimeStamp ts;
-    ts.Set();
-    timeStamps.push_back(ts);
-    
-    LOG(logINFO) << Form("V = %4f (meas: %+7.2f) I = %4.2e uA %s", 
-                         voltSet, voltRead, current*1E6, ts.AsString("c"));
-    
-    h1->Draw("p");
-    PixTest::update();
-    gSystem->ProcessEvents();
-    if(fStop) break;
-  }
+  // Sample each step until the current has settled, at most fParDelay seconds,
+  // and stop before the extrapolated current reaches the compliance:
+  HVSupplySource source(*hv);
+  source.setIdleCallback(ivIdle, 0);
+  IVEngine engine(source);
+  engine.setTolerance(fParTolerance);
+  engine.setMaxSettleTime(fParDelay);
+  engine.setCompliance(fParCompliance*1E-6);
+
+  IVCallbackData data;
+  data.h1 = h1;
+  data.voltageMeasurements = &voltageMeasurements;
+  data.currentMeasurements = &currentMeasurements;
+  data.timeStamps = &timeStamps;
+  data.stop = &fStop;
+  engine.setCallback(ivCallback, &data);
+
+  engine.run(-fParVoltageStart, -fParVoltageStop, fParVoltageStep);
   delete hv;
 
+  bool aborted = engine.aborted() && !fStop;
   if(aborted){
-    LOG(logWARNING) << "Sweep Aborted on Compliance!";
+    LOG(logWARNING) << "Sweep aborted: " << engine.abortReason();
   } 
   fHistList.push_back(h1);
   fDisplayedHist = find(fHistList.begin(), fHistList.end(), h1);
@@ -180,6 +219,7 @@ void PixTestIV::writeOutput(vector<double>       &voltageMeasurements,
   OutputFile << "#   Voltage Stop:   " << fParVoltageStop << endl;
   OutputFile << "#   Voltage Step:   " << fParVoltageStep << endl;
   OutputFile << "#   Delay(s):       " << fParDelay << endl;
+  OutputFile << "#   Tolerance:      " << fParTolerance << endl;
   OutputFile << "#   Compliance(uA): " << fParCompliance << endl;
   OutputFile << "#voltage(V)\tcurrent(A)\ttimestamp" << endl;
   
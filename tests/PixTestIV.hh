@@ -27,7 +27,8 @@ private:
   double fParVoltageStart;      //volts
   double fParVoltageStop;       //volts
   double fParVoltageStep;       //volts
-  double fParDelay;             //seconds
+  double fParDelay;             //seconds, maximum settling time per step
+  double fParTolerance;         //relative current change considered settled
   double fParCompliance;        //uA
   bool fStop;
   std::string fParPort; 
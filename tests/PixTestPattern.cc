@@ -497,48 +497,33 @@ void PixTestPattern::PrintEvents(int par1, int par2, string flag, std::vector<TH
 // ----------------------------------------------------------------------
 void PixTestPattern::TriggerLoop(int checkfreq, std::vector<TH2D*> hits, std::vector<TProfile2D*> phmap, std::vector<TH1D*> ph) {
 
-	uint8_t perFull;
 	int nloop = 1;
-	uint64_t diff = 0, timepaused = 0, timeff = 0;
-	bool TotalTime = false;
+	uint64_t timeff = 0;
 	timer t;
 	LOG(logINFO) << "PixTestPattern:: starting TriggerLoop for " << fParSeconds << " seconds";
 
+	//start triggerloop, the trigger rate is regulated to keep up with reading out every checkfreq seconds:
+	fPeriod = fApi->daqTriggerLoopRegulated(fParPeriod);
+	LOG(logINFO) << "PixTestPattern:: TriggerLoop period = " << fPeriod << " clks";
+
 	while (fDaq_loop)
 	{
-		if (nloop > 1){
-			diff = t.get() - diff;
-			timepaused += diff;
-			LOG(logDEBUG) << "PixTestPattern:: readout time " << timepaused / 1000 << " seconds";
-			LOG(logINFO) << "PixTestPattern:: restarting TriggerLoop for " << fParSeconds - (timeff / 1000) << " s";
-		}
-		//start triggerloop:
-		fPeriod = fApi->daqTriggerLoop(fParPeriod);
-		if (nloop == 1) { LOG(logINFO) << "PixTestPattern:: TriggerLoop period = " << fPeriod << " clks"; }
-		
-		//check every checkfreq seconds if buffer is full less then 80%:
-		while (fApi->daqStatus(perFull) && perFull < 80 && fDaq_loop) {
-			mDelay(checkfreq * 1000);
-			timeff = t.get() - timepaused;
-			LOG(logINFO) << "PixTestPattern:: elapsed time " << timeff / 1000 << " seconds";
-			if (timeff / 1000 >= (uint64_t)fParSeconds)       {
-				fDaq_loop = false;
-				TotalTime = true;
-				break;
-			}
-			LOG(logINFO) << "PixTestPattern:: buffer not full, at " << (int)perFull << "%";
+		//check the buffer until the next readout:
+		uint64_t nextReadout = t.get() + checkfreq * 1000;
+		while (fApi->daqStatus() && fDaq_loop && t.get() < nextReadout) {
+			mDelay(100);
 			gSystem->ProcessEvents();
 		}
 
-		if (fDaq_loop) {
-			LOG(logINFO) << "PixTestPattern:: buffer almost full, pausing triggers";
-			fApi->daqTriggerLoopHalt();
-			diff = t.get();
-		}
-		else {
-				if (TotalTime) { LOG(logINFO) << "PixTestPattern:: total time reached - DAQ stopped."; }
-				fApi->daqStop();			
+		timeff = t.get();
+		LOG(logINFO) << "PixTestPattern:: elapsed time " << timeff / 1000 << " seconds, TriggerLoop period = "
+			     << fApi->daqTriggerLoopPeriod() << " clks";
+		if (timeff / 1000 >= (uint64_t)fParSeconds) {
+			LOG(logINFO) << "PixTestPattern:: total time reached - DAQ stopped.";
+			fDaq_loop = false;
 		}
+		if (!fDaq_loop) fApi->daqStop();
+
 		// Get events and Print results on shell/file:
 		PrintEvents(fParSeconds, nloop, "loop", hits, phmap, ph);
 		nloop++;
@@ -92,7 +92,7 @@ void PixTestPhOptimization::doTest() {
   TStopwatch t;
   
   gStyle->SetPalette(1);
-  cacheDacs();
+  cacheDut();
   bigBanner(Form("PixTestPhOptimization::doTest() Ntrig = %d", fParNtrig ));
   fDirectory->cd();
   PixTest::update();
@@ -172,18 +172,18 @@ void PixTestPhOptimization::doTest() {
   LOG(logDEBUG)<<"optimisation done";
   
   //set optimized dacs and save
-  restoreDacs();
+  restoreDut();
   for(unsigned int roc_it = 0; roc_it < rocIds.size(); roc_it++){
     fApi->setDAC("phscale",ps_opt[rocIds[roc_it]], rocIds[roc_it] );
     fApi->setDAC("phoffset",po_opt[rocIds[roc_it]], rocIds[roc_it]);
   }
   saveDacs();
   
-  cacheDacs(); 
+  cacheDut(); 
   //draw figures of merit of optimization
   DrawPhMaps(minVcal, badPixels);
   DrawPhCurves(maxpixels, minpixels, po_opt, ps_opt);
-  restoreDacs();
+  restoreDut();
   
   for (list<TH1*>::iterator il = fHistList.begin(); il != fHistList.end(); ++il) {
     (*il)->Draw(getHistOption(*il).c_str());
@@ -9,6 +9,7 @@
 #include <bitset>
 
 #include "PixTestPretest.hh"
+#include "PixUtil.hh"
 #include "timer.h"
 #include "log.h"
 #include "helper.h"
@@ -25,7 +26,8 @@ PixTest(a, name),
   fParNtrig(-1), 
   fParVcal(200), 
   fParDeltaVthrComp(-50), 
-  fParFracCalDel(0.5) {
+  fParFracCalDel(0.5), 
+  fParConcurrentVana(false) {
   PixTest::init();
   init(); 
 }
@@ -80,6 +82,12 @@ bool PixTestPretest::setParameter(string parName, string sval) {
 	fParFracCalDel = atof(sval.c_str() );
       }
 
+      if (!parName.compare("concurrentvana") ) {
+	PixUtil::replaceAll(sval, "checkbox(", ""); 
+	PixUtil::replaceAll(sval, ")", ""); 
+	fParConcurrentVana = atoi(sval.c_str() );
+      }
+
       if (!parName.compare("pix") || !parName.compare("pix1") ) {
 	s1 = sval.find(",");
 	if (string::npos != s1) {
@@ -220,7 +228,7 @@ void PixTestPretest::runCommand(std::string command) {
 
 // ----------------------------------------------------------------------
 void PixTestPretest::setVana() {
-  cacheDacs();
+  cacheDut();
   fDirectory->cd();
   PixTest::update(); 
   banner(Form("PixTestPretest::setVana() target Ia = %d mA/ROC", fTargetIa)); 
@@ -231,95 +239,88 @@ void PixTestPretest::setVana() {
   vector<uint8_t> vanaStart;
   vector<double> rocIana;
 
-  // -- cache setting and switch off all(!) ROCs
+  // -- resolve the DAC once, it is written many times in the tuning loops below
+  dacHandle vanaDac = fApi->dac("vana");
+
+  // -- concurrent tuning requires the readback calibration of the per-ROC analog current
+  vector<vector<double> > iaCal;
+  bool concurrent = fParConcurrentVana && getIaCalibration(iaCal);
+
+  // -- cache setting and switch off all(!) ROCs for serial tuning
   int nRocs = fApi->_dut->getNRocs(); 
   for (int iroc = 0; iroc < nRocs; ++iroc) {
-    vanaStart.push_back(fApi->_dut->getDAC(iroc, "vana"));
+    vanaStart.push_back(fApi->_dut->getDAC(iroc, vanaDac));
     rocIana.push_back(0.); 
-    fApi->setDAC("vana", 0, iroc);
+    if (!concurrent) fApi->setDAC(vanaDac, 0, iroc);
   }
   
-  double i016 = fApi->getTBia()*1E3;
+  if (concurrent) {
+    setVanaConcurrent(vanaDac, iaCal, vanaStart, rocIana);
+  } else {
+    double i016 = settledIa(vanaDac, 0, 0);
 
-  // FIXME this should not be a stopwatch, but a delay
-  TStopwatch sw;
-  sw.Start(kTRUE); // reset
-  do {
-    sw.Start(kFALSE); // continue
-    i016 = fApi->getTBia()*1E3;
-  } while (sw.RealTime() < 0.1);
+    // subtract one ROC to get the offset from the other Rocs (on average):
+    double i015 = (nRocs-1) * i016 / nRocs; // = 0 for single chip tests
+    LOG(logDEBUG) << "offset current from other " << nRocs-1 << " ROCs is " << i015 << " mA";
 
-  // subtract one ROC to get the offset from the other Rocs (on average):
-  double i015 = (nRocs-1) * i016 / nRocs; // = 0 for single chip tests
-  LOG(logDEBUG) << "offset current from other " << nRocs-1 << " ROCs is " << i015 << " mA";
+    // tune per ROC:
 
-  // tune per ROC:
+    const double extra = 0.1; // [mA] besser zu viel als zu wenig 
+    const double eps = 0.25; // [mA] convergence
+    const double slope = 6; // 255 DACs / 40 mA
 
-  const double extra = 0.1; // [mA] besser zu viel als zu wenig 
-  const double eps = 0.25; // [mA] convergence
-  const double slope = 6; // 255 DACs / 40 mA
+    for (int roc = 0; roc < nRocs; ++roc) {
+      if (!selectedRoc(roc)) {
+	LOG(logDEBUG) << "skipping ROC idx = " << roc << " (not selected) for Vana tuning"; 
+	continue;
+      }
+      int vana = vanaStart[roc];
+      fApi->setDAC(vanaDac, vana, roc); // start value
 
-  for (int roc = 0; roc < nRocs; ++roc) {
-    if (!selectedRoc(roc)) {
-      LOG(logDEBUG) << "skipping ROC idx = " << roc << " (not selected) for Vana tuning"; 
-      continue;
-    }
-    int vana = vanaStart[roc];
-    fApi->setDAC("vana", vana, roc); // start value
+      double ia = settledIa(vanaDac, roc, vana); // [mA]
 
-    double ia = fApi->getTBia()*1E3; // [mA], just to be sure to flush usb
-    sw.Start(kTRUE); // reset
-    do {
-      sw.Start(kFALSE); // continue
-      ia = fApi->getTBia()*1E3; // [mA]
-    } while (sw.RealTime() < 0.1);
+      double diff = fTargetIa + extra - (ia - i015);
 
-    double diff = fTargetIa + extra - (ia - i015);
+      int iter = 0;
+      LOG(logDEBUG) << "ROC " << roc << " iter " << iter
+		   << " Vana " << vana
+		   << " Ia " << ia-i015 << " mA";
 
-    int iter = 0;
-    LOG(logDEBUG) << "ROC " << roc << " iter " << iter
-		 << " Vana " << vana
-		 << " Ia " << ia-i015 << " mA";
+      while (TMath::Abs(diff) > eps && iter < 11 && vana > 0 && vana < 255) {
 
-    while (TMath::Abs(diff) > eps && iter < 11 && vana > 0 && vana < 255) {
+	int stp = static_cast<int>(TMath::Abs(slope*diff));
+	if (stp == 0) stp = 1;
+	if (diff < 0) stp = -stp;
 
-      int stp = static_cast<int>(TMath::Abs(slope*diff));
-      if (stp == 0) stp = 1;
-      if (diff < 0) stp = -stp;
-
-      vana += stp;
+	vana += stp;
 
-      if (vana < 0) {
-	vana = 0;
-      } else {
-	if (vana > 255) {
-	  vana = 255;
+	if (vana < 0) {
+	  vana = 0;
+	} else {
+	  if (vana > 255) {
+	    vana = 255;
+	  }
 	}
-      }
 
-      fApi->setDAC("vana", vana, roc);
-      iter++;
+	fApi->setDAC(vanaDac, vana, roc);
+	iter++;
 
-      sw.Start(kTRUE); // reset
-      do {
-	sw.Start(kFALSE); // continue
-	ia = fApi->getTBia()*1E3; // [mA]
-      }
-      while( sw.RealTime() < 0.1 );
+	ia = settledIa(vanaDac, roc, vana); // [mA]
 
-      diff = fTargetIa + extra - (ia - i015);
+	diff = fTargetIa + extra - (ia - i015);
 
-      LOG(logDEBUG) << "ROC " << setw(2) << roc
-		   << " iter " << setw(2) << iter
-		   << " Vana " << setw(3) << vana
-		   << " Ia " << ia-i015 << " mA";
-    } // iter
+	LOG(logDEBUG) << "ROC " << setw(2) << roc
+		     << " iter " << setw(2) << iter
+		     << " Vana " << setw(3) << vana
+		     << " Ia " << ia-i015 << " mA";
+      } // iter
 
-    rocIana[roc] = ia-i015; // more or less identical for all ROCS?!
-    vanaStart[roc] = vana; // remember best
-    fApi->setDAC( "vana", 0, roc ); // switch off for next ROC
+      rocIana[roc] = ia-i015; // more or less identical for all ROCS?!
+      vanaStart[roc] = vana; // remember best
+      fApi->setDAC( vanaDac, 0, roc ); // switch off for next ROC
 
-  } // rocs
+    } // rocs
+  }
 
   TH1D *hsum = bookTH1D("VanaSettings", "Vana per ROC", nRocs, 0., nRocs);
   setTitles(hsum, "ROC", "Vana [DAC]"); 
@@ -336,10 +337,10 @@ void PixTestPretest::setVana() {
   fHistList.push_back(hcurr);
 
 
-  restoreDacs();
+  restoreDut();
   for (int roc = 0; roc < nRocs; ++roc) {
     // -- reset all ROCs to optimum or cached value
-    fApi->setDAC( "vana", vanaStart[roc], roc );
+    fApi->setDAC( vanaDac, vanaStart[roc], roc );
     LOG(logDEBUG) << "ROC " << setw(2) << roc << " Vana " << setw(3) << int(vanaStart[roc]);
     // -- histogramming only for those ROCs that were selected
     if (!selectedRoc(roc)) continue;
@@ -347,14 +348,7 @@ void PixTestPretest::setVana() {
     hcurr->Fill(roc, rocIana[roc]); 
   }
   
-  double ia16 = fApi->getTBia()*1E3; // [mA]
-
-  sw.Start(kTRUE); // reset
-  do {
-    sw.Start(kFALSE); // continue
-    ia16 = fApi->getTBia()*1E3; // [mA]
-  }
-  while( sw.RealTime() < 0.1 );
+  double ia16 = settledIa(vanaDac, 0, vanaStart[0]); // [mA]
 
 
   hsum->Draw();
@@ -366,6 +360,125 @@ void PixTestPretest::setVana() {
   dutCalibrateOff();
 }
 
+// ----------------------------------------------------------------------
+void PixTestPretest::setVanaConcurrent(const dacHandle &vanaDac, const vector<vector<double> > &cal, vector<uint8_t> &vanaStart, vector<double> &rocIana) {
+  // -- tune all ROCs at once, each ROC converges independently on its own readback Ia
+  const double extra = 0.1; // [mA] besser zu viel als zu wenig 
+  const double eps = 0.25; // [mA] convergence
+  const double slope = 6; // 255 DACs / 40 mA
+
+  int nRocs = fApi->_dut->getNRocs(); 
+  vector<int> vana(nRocs, 0);
+  vector<bool> done(nRocs, false);
+  for (int roc = 0; roc < nRocs; ++roc) {
+    vana[roc] = vanaStart[roc];
+    if (!selectedRoc(roc)) {
+      LOG(logDEBUG) << "skipping ROC idx = " << roc << " (not selected) for Vana tuning"; 
+      done[roc] = true;
+    }
+  }
+
+  for (int iter = 0; iter <= 11; ++iter) {
+    vector<double> ia = readbackIa(cal); // [mA]
+    bool converged(true);
+    for (int roc = 0; roc < nRocs; ++roc) {
+      if (done[roc]) continue;
+      if (roc >= static_cast<int>(ia.size()) || ia[roc] < 0.) {
+	LOG(logWARNING) << "no readback Ia for ROC " << roc << ", stop tuning it";
+	done[roc] = true;
+	continue;
+      }
+
+      rocIana[roc] = ia[roc];
+      double diff = fTargetIa + extra - ia[roc];
+      LOG(logDEBUG) << "ROC " << setw(2) << roc
+		    << " iter " << setw(2) << iter
+		    << " Vana " << setw(3) << vana[roc]
+		    << " Ia " << ia[roc] << " mA";
+
+      if (TMath::Abs(diff) <= eps || iter == 11 || vana[roc] <= 0 || vana[roc] >= 255) {
+	vanaStart[roc] = vana[roc]; // remember best
+	done[roc] = true;
+	continue;
+      }
+
+      int stp = static_cast<int>(TMath::Abs(slope*diff));
+      if (stp == 0) stp = 1;
+      if (diff < 0) stp = -stp;
+
+      vana[roc] += stp;
+      if (vana[roc] < 0) {
+	vana[roc] = 0;
+      } else {
+	if (vana[roc] > 255) {
+	  vana[roc] = 255;
+	}
+      }
+      fApi->setDAC(vanaDac, vana[roc], roc);
+      vanaStart[roc] = vana[roc];
+      converged = false;
+    }
+    if (converged) break;
+  }
+}
+
+// ----------------------------------------------------------------------
+bool PixTestPretest::getIaCalibration(vector<vector<double> > &cal) {
+  // -- readback Ia calibration per ROC: par0rbia, par1rbia, par0tbia, par1tbia, par2tbia
+  vector<vector<pair<string, double> > > rbCal = fPixSetup->getConfigParameters()->getReadbackCal();
+  int nRocs = fApi->_dut->getNRocs(); 
+  cal.clear();
+  for (int roc = 0; roc < nRocs; ++roc) {
+    vector<double> pars(5, 0.);
+    bool ok(false);
+    if (roc < static_cast<int>(rbCal.size())) {
+      for (unsigned int i = 0; i < rbCal[roc].size(); ++i) {
+	if (!rbCal[roc][i].first.compare("par0rbia")) pars[0] = rbCal[roc][i].second;
+	if (!rbCal[roc][i].first.compare("par1rbia")) {pars[1] = rbCal[roc][i].second; ok = true;}
+	if (!rbCal[roc][i].first.compare("par0tbia")) pars[2] = rbCal[roc][i].second;
+	if (!rbCal[roc][i].first.compare("par1tbia")) pars[3] = rbCal[roc][i].second;
+	if (!rbCal[roc][i].first.compare("par2tbia")) pars[4] = rbCal[roc][i].second;
+      }
+    }
+    if (!ok || pars[1] == 0.) {
+      LOG(logWARNING) << "no readback Ia calibration for ROC " << roc << ", using serial Vana tuning";
+      return false;
+    }
+    cal.push_back(pars);
+  }
+  return true;
+}
+
+// ----------------------------------------------------------------------
+vector<double> PixTestPretest::readbackIa(const vector<vector<double> > &cal) {
+  // -- read the analog current of all ROCs at once via the readback mechanism (readback register 12)
+  fApi->setDAC("readback", 12);
+  fApi->daqStart();
+  fApi->daqTrigger(32, 1000);
+  fApi->daqStop();
+  try { fApi->daqGetEventBuffer(); }
+  catch(pxar::DataNoEvent &) {}
+
+  vector<vector<uint16_t> > rb = fApi->daqGetReadback();
+  vector<double> ia(rb.size(), -1.);
+  for (unsigned int roc = 0; roc < rb.size() && roc < cal.size(); ++roc) {
+    if (rb[roc].empty()) continue;
+    double x = rb[roc].back()&0xff; // last readback word
+    const vector<double> &c = cal[roc];
+    // -- same conversion as in PixTestReadback::getCalibratedIa()
+    ia[roc] = x*x*c[4]/c[1]/c[1] + x/c[1]/c[1]*(c[1]*c[3] - 2*c[0]*c[4]) + (c[0]*c[0]*c[4] - c[0]*c[3])/c[1] + c[2];
+  }
+  return ia;
+}
+
+// ----------------------------------------------------------------------
+double PixTestPretest::settledIa(const dacHandle &vanaDac, int roc, int vana) {
+  // -- sample the analog current until it has settled (instead of waiting a fixed time)
+  vector<pair<uint8_t, double> > ia = fApi->getTBiaVsDAC(vanaDac, 1, vana, vana, roc);
+  if (ia.empty()) return fApi->getTBia()*1E3;
+  return ia[0].second*1E3; // [mA]
+}
+
 // ----------------------------------------------------------------------
 void PixTestPretest::setTimings() {
 
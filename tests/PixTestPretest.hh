@@ -25,6 +25,10 @@ public:
   
 
 private:
+  double  settledIa(const pxar::dacHandle &vanaDac, int roc, int vana);
+  bool    getIaCalibration(std::vector<std::vector<double> > &cal);
+  std::vector<double> readbackIa(const std::vector<std::vector<double> > &cal);
+  void    setVanaConcurrent(const pxar::dacHandle &vanaDac, const std::vector<std::vector<double> > &cal, std::vector<uint8_t> &vana, std::vector<double> &rocIana);
 
   int     fTargetIa;
   int     fNoiseWidth;
@@ -33,6 +37,7 @@ private:
   int     fParNtrig;
   int     fParVcal, fParDeltaVthrComp;
   double  fParFracCalDel;
+  bool    fParConcurrentVana;
 
   ClassDef(PixTestPretest, 1)
 
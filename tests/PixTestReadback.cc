@@ -373,32 +373,44 @@ void PixTestReadback::CalibrateIa(){
 
 
 
-  for(int ivana=0; ivana<npoints; ivana++){
-    vana = (uint8_t)ivana*pace;
-    for(unsigned int iroc = 0; iroc < rocIds.size(); iroc++){
-      LOG(logDEBUG)<<"Vana scan for ROC "<<getIdFromIdx(iroc);
-      fApi->setDAC("vana", 0);
-      tbIa = fApi->getTBia()*1E3; // [mA]
-      count=0;
-      do{
-	readback=daqReadback("vana", vana, getIdFromIdx(iroc), fParReadback);
-	LOG(logDEBUG)<<"CalibrateIa: daqReadback attempt #"<<count++<<", ROC "<<iroc<<", vana "<<(int)vana<<", readback "<<(int)readback[getIdFromIdx(iroc)];
-      }  while(readback.size()<1 && count<10);
-      if(10==count){
-	LOG(logINFO)<<"ERROR: no readback data received after "<<count<<" attempts. Aborting readback calibration";
-	return;
+  //readback of Ia for all ROCs and all vana points in one single DAQ session
+  vector<pair<uint8_t, vector<uint16_t> > > rbScan;
+  bool complete = false;
+  count=0;
+  while(!complete && count<10){
+    rbScan = fApi->getReadbackVsDAC("vana", pace, 0, (npoints-1)*pace, fParReadback);
+    LOG(logDEBUG)<<"CalibrateIa: getReadbackVsDAC attempt #"<<count++<<", "<<rbScan.size()<<" points";
+    complete = (rbScan.size() >= static_cast<size_t>(npoints));
+    //every ROC needs a readback value at every vana point
+    for(unsigned int ip = 0; complete && ip < rbScan.size(); ip++){
+      for(unsigned int iroc = 0; complete && iroc < rocIds.size(); iroc++){
+	unsigned int id = getIdFromIdx(iroc);
+	if(id >= rbScan[ip].second.size() || READBACK_MISSING == rbScan[ip].second[id]) complete = false;
       }
-      rbIa[vana][getIdFromIdx(iroc)]=readback[getIdFromIdx(iroc)];
-      fApi->setDAC("vana", vana, getIdFromIdx(iroc));
-      sw.Start(kTRUE); // reset
-      count=0;
-      do {
-	sw.Start(kFALSE); // continue
-	tbIa = fApi->getTBia()*1E3; // [mA]
-      } while (sw.RealTime() < 0.3);
-      hs_rbIa[iroc]->Fill(vana, readback[getIdFromIdx(iroc)]);//should this be corrected as well?
+    }
+  }
+  if(!complete){
+    LOG(logINFO)<<"ERROR: no complete readback data received after "<<count<<" attempts. Aborting readback calibration";
+    return;
+  }
+
+  for(unsigned int iroc = 0; iroc < rocIds.size(); iroc++){
+    LOG(logDEBUG)<<"Vana scan for ROC "<<getIdFromIdx(iroc);
+    //TB current of this ROC alone, the scan waits for the supply to settle after every step
+    fApi->setDAC("vana", 0);
+    vector<pair<uint8_t, double> > iaScan = fApi->getTBiaVsDAC("vana", pace, 0, (npoints-1)*pace, getIdFromIdx(iroc));
+    if(iaScan.size() < static_cast<size_t>(npoints)){
+      LOG(logINFO)<<"ERROR: Ia scan returned "<<iaScan.size()<<" of "<<npoints<<" points for ROC "<<getIdFromIdx(iroc)<<". Aborting readback calibration";
+      return;
+    }
+    for(int ivana=0; ivana<npoints; ivana++){
+      vana = (uint8_t)ivana*pace;
+      uint8_t rb = static_cast<uint8_t>(rbScan[ivana].second[getIdFromIdx(iroc)]);
+      tbIa = iaScan[ivana].second*1E3; // [mA]
+      rbIa[vana][getIdFromIdx(iroc)]=rb;
+      hs_rbIa[iroc]->Fill(vana, rb);//should this be corrected as well?
       hs_tbIa[iroc]->Fill(vana, tbIa-avIoff);//tbIa corrected for offset
-      LOG(logDEBUG)<<"vana "<<(int)vana<<", rbIa "<<(int)readback[getIdFromIdx(iroc)]<<", tbIa "<<(int)(tbIa-avIoff);
+      LOG(logDEBUG)<<"vana "<<(int)vana<<", rbIa "<<(int)rb<<", tbIa "<<(int)(tbIa-avIoff);
     }
   }
 
@@ -1007,6 +1019,8 @@ void PixTestReadback::restorePowerSettings(){
 
 }
 
+// vd and va are testboard supply voltages, not ROC DACs, so CalibrateVd() and CalibrateVa()
+// cannot step them within one pxarCore::getReadbackVsDAC() session and keep using this
 vector<uint8_t> PixTestReadback::daqReadback(string dac, double vana, int8_t parReadback){
 
   PixTest::update();
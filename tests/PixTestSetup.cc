@@ -79,14 +79,7 @@ void PixTestSetup::bookHist(string name)
 PixTestSetup::~PixTestSetup()
 {
   LOG(logDEBUG) << "PixTestSetup dtor";
-  std::list<TH1*>::iterator il;
-  fDirectory->cd();
-  for (il = fHistList.begin(); il != fHistList.end(); ++il) 
-    {
-      LOG(logINFO) << "Write out " << (*il)->GetName();
-      (*il)->SetDirectory(fDirectory);
-      (*il)->Write();
-    }
+  // -- the histograms are written out by PixTest::~PixTest()
 }
 
 //------------------------------------------------------------------------------
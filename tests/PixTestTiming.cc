@@ -86,14 +86,7 @@ void PixTestTiming::bookHist(string name)
 PixTestTiming::~PixTestTiming()
 {
   LOG(logDEBUG) << "PixTestTiming dtor";
-  std::list<TH1*>::iterator il;
-  fDirectory->cd();
-  for (il = fHistList.begin(); il != fHistList.end(); ++il)
-    {
-      LOG(logINFO) << "Write out " << (*il)->GetName();
-      (*il)->SetDirectory(fDirectory);
-      (*il)->Write();
-    }
+  // -- the histograms are written out by PixTest::~PixTest()
 }
 
 // ----------------------------------------------------------------------
@@ -128,7 +121,7 @@ void PixTestTiming::ClkSdaScan() {
   // Start test timer
   timer t;
 
-  cacheDacs();
+  cacheDut();
   fDirectory->cd();
   PixTest::update();
   banner(Form("PixTestTiming::ClkSdaScan()"));
@@ -213,7 +206,8 @@ void PixTestTiming::ClkSdaScan() {
   fHistList.push_back(h1);
   fDisplayedHist = find(fHistList.begin(), fHistList.end(), h1);
   PixTest::update();
-  restoreDacs();
+  // The ROCs were not reachable before a working SDA delay was found, reprogram all DACs:
+  restoreDut(true);
 
   // Print timer value:
   LOG(logINFO) << "Test took " << t << " ms.";
@@ -20,7 +20,8 @@ using namespace pxar;
 ClassImp(PixTestTrim)
 
 // ----------------------------------------------------------------------
-PixTestTrim::PixTestTrim(PixSetup *a, std::string name) : PixTest(a, name), fParVcal(-1), fParNtrig(-1) {
+PixTestTrim::PixTestTrim(PixSetup *a, std::string name) : PixTest(a, name), fParVcal(-1), fParNtrig(-1), 
+  fParVtrimProbe(100), fParDirect(0) {
   PixTest::init();
   init(); 
   //  LOG(logINFO) << "PixTestTrim ctor(PixSetup &a, string, TGTab *)";
@@ -46,6 +47,14 @@ bool PixTestTrim::setParameter(string parName, string sval) {
       if (!parName.compare("vcal")) {
 	fParVcal = atoi(sval.c_str()); 
       }
+      if (!parName.compare("vtrimprobe")) {
+	fParVtrimProbe = atoi(sval.c_str()); 
+      }
+      if (!parName.compare("direct")) {
+	PixUtil::replaceAll(sval, "checkbox(", "");
+	PixUtil::replaceAll(sval, ")", "");
+	fParDirect = atoi(sval.c_str()); 
+      }
       break;
     }
   }
@@ -78,6 +87,10 @@ void PixTestTrim::runCommand(std::string command) {
     trimTest(); 
     return;
   }
+  if (!command.compare("trimdirect")) {
+    trimDirect(); 
+    return;
+  }
   LOG(logDEBUG) << "did not find command ->" << command << "<-";
 }
 
@@ -115,7 +128,11 @@ void PixTestTrim::doTest() {
   bigBanner(Form("PixTestTrim::doTest()"));
 
   fProblem = false; 
-  trimTest(); 
+  if (fParDirect) {
+    trimDirect(); 
+  } else {
+    trimTest(); 
+  }
   if (fProblem) {
     LOG(logINFO) << "PixTestTrim::doTest() aborted because of problem ";
     return;
@@ -163,22 +180,9 @@ void PixTestTrim::trimTest() {
   // -- determine minimal VthrComp 
   int NTRIG(5);
   map<int, int> rocVthrComp;
-  print("VthrComp thr map (minimal VthrComp)"); 
-  vector<TH1*> thr0 = scurveMaps("vthrcomp", "TrimThr0", NTRIG, 0, 159, 20, 7); 
-  PixTest::update(); 
-  if (thr0.size()/3 != rocIds.size()) {
-    LOG(logERROR) << "scurve map size " << thr0.size() << " does not agree with number of enabled ROCs " << rocIds.size();
-    fProblem = true;
-    return;
-  }
-  vector<int> minVthrComp = getMinimumVthrComp(thr0, 10, 2.); 
+  if (!setMinimalVthrComp(rocVthrComp)) return;
   
   TH2D* h2(0); 
-  for (unsigned int iroc = 0; iroc < rocIds.size(); ++iroc) {
-    LOG(logINFO) << "ROC " << static_cast<int>(rocIds[iroc]) << " VthrComp = " << minVthrComp[iroc]; 
-    fApi->setDAC("VthrComp", static_cast<uint8_t>(minVthrComp[iroc]), rocIds[iroc]); 
-    rocVthrComp.insert(make_pair(rocIds[iroc], minVthrComp[iroc])); 
-  }
 
   // -- determine pixel with largest VCAL threshold
   print("Vcal thr map (pixel with maximum Vcal thr)"); 
@@ -394,9 +398,158 @@ void PixTestTrim::trimTest() {
     return;
   }
 
+  trimDone("TrimThrFinal", rocTrim, rocVthrComp); 
+}
+
+
+// ----------------------------------------------------------------------
+bool PixTestTrim::setMinimalVthrComp(map<int, int> &rocVthrComp) {
+  vector<uint8_t> rocIds = fApi->_dut->getEnabledRocIDs(); 
+  int NTRIG(5);
+  print("VthrComp thr map (minimal VthrComp)"); 
+  vector<TH1*> thr0 = scurveMaps("vthrcomp", "TrimThr0", NTRIG, 0, 159, 20, 7); 
+  PixTest::update(); 
+  if (thr0.size()/3 != rocIds.size()) {
+    LOG(logERROR) << "scurve map size " << thr0.size() << " does not agree with number of enabled ROCs " << rocIds.size();
+    fProblem = true;
+    return false;
+  }
+  vector<int> minVthrComp = getMinimumVthrComp(thr0, 10, 2.); 
+  
+  for (unsigned int iroc = 0; iroc < rocIds.size(); ++iroc) {
+    LOG(logINFO) << "ROC " << static_cast<int>(rocIds[iroc]) << " VthrComp = " << minVthrComp[iroc]; 
+    fApi->setDAC("VthrComp", static_cast<uint8_t>(minVthrComp[iroc]), rocIds[iroc]); 
+    rocVthrComp.insert(make_pair(rocIds[iroc], minVthrComp[iroc])); 
+  }
+  return true;
+}
+
+
+// ----------------------------------------------------------------------
+void PixTestTrim::trimDirect() {
+
+  gStyle->SetPalette(1);
+  bool verbose(false);
+  cacheDacs(verbose);
+  fDirectory->cd();
+  PixTest::update(); 
+  banner(Form("PixTestTrim::trimDirect() ntrig = %d, vcal = %d, vtrimprobe = %d", fParNtrig, fParVcal, fParVtrimProbe));
+
+  fApi->_dut->testAllPixels(true);
+  fApi->_dut->maskAllPixels(false);
+  maskPixels();
+
+  vector<uint8_t> rocIds = fApi->_dut->getEnabledRocIDs(); 
+
+  fApi->setDAC("Vtrim", 0);
+  fApi->setDAC("ctrlreg", 0);
+  fApi->setDAC("Vcal", fParVcal);
+
+  setTrimBits(15);  
+
+  // -- determine minimal VthrComp 
+  map<int, int> rocVthrComp;
+  if (!setMinimalVthrComp(rocVthrComp)) return;
+
+  // -- threshold maps at a few global trim settings, each measuring all pixels in parallel
+  fApi->setDAC("Vtrim", fParVtrimProbe);
+  const int NTRIMS(3); 
+  int trims[NTRIMS] = {15, 7, 0}; 
+  int VCALMAX(199); 
+  vector<vector<TH1*> > thr; 
+  for (int it = 0; it < NTRIMS; ++it) {
+    setTrimBits(trims[it]);
+    print(Form("Vcal thr map for trim bits %d, vtrim = %d", trims[it], fParVtrimProbe)); 
+    vector<TH1*> thrt = scurveMaps("vcal", Form("TrimDirectThr%d", trims[it]), fParNtrig, 0, VCALMAX, 20, 1); 
+    PixTest::update(); 
+    if (thrt.size() != rocIds.size()) {
+      LOG(logERROR) << "scurve map size " << thrt.size() << " does not agree with number of enabled ROCs " << rocIds.size();
+      fProblem = true;
+      return;
+    }
+    thr.push_back(thrt); 
+  }
+
+  // -- fit thr = a - b*(15 - trim) for every pixel; the threshold shift per trim step b scales linearly with vtrim
+  map<int, int> rocTrim;
+  for (unsigned int iroc = 0; iroc < rocIds.size(); ++iroc) {
+    vector<double> offset(52*80, -1.), slope(52*80, -1.), scale; 
+    TH2D *hs = bookTH2D(Form("TrimDirectSlope_C%d", rocIds[iroc]), 
+			Form("TrimDirectSlope_C%d (vcal per trim step at vtrim = %d)", rocIds[iroc], fParVtrimProbe), 
+			52, 0., 52., 80, 0., 80.); 
+    fHistList.push_back(hs); 
+    fHistOptions.insert(make_pair(hs, "colz")); 
+
+    for (int ix = 0; ix < 52; ++ix) {
+      for (int iy = 0; iy < 80; ++iy) {
+	double n(0.), sx(0.), sy(0.), sxx(0.), sxy(0.); 
+	for (int it = 0; it < NTRIMS; ++it) {
+	  double y = thr[it][iroc]->GetBinContent(ix+1, iy+1); 
+	  // -- pixels without or beyond the scan range do not constrain the fit
+	  if (y <= 0. || y >= VCALMAX) continue;
+	  double x = 15 - trims[it]; 
+	  n += 1.; sx += x; sy += y; sxx += x*x; sxy += x*y; 
+	}
+	if (n < 2 || n*sxx - sx*sx <= 0.) continue;
+	double b = -(n*sxy - sx*sy)/(n*sxx - sx*sx); 
+	if (b <= 0.) continue;
+	int idx = ix*80 + iy; 
+	slope[idx] = b; 
+	offset[idx] = (sy + b*sx)/n; 
+	hs->SetBinContent(ix+1, iy+1, b); 
+	// -- vtrim scale needed to bring this pixel down to the target with all 15 trim steps
+	if (offset[idx] > fParVcal) scale.push_back((offset[idx] - fParVcal)/(15.*b)); 
+      }
+    }
+
+    // -- choose vtrim such that 99% of the pixels can reach the target
+    int vtrim(fParVtrimProbe); 
+    if (scale.size() > 0) {
+      sort(scale.begin(), scale.end()); 
+      double s = scale[static_cast<size_t>(0.99*(scale.size()-1))]; 
+      vtrim = static_cast<int>(fParVtrimProbe*s + 0.5) + 1; 
+      if (vtrim > 255) vtrim = 255; 
+    }
+    fApi->setDAC("vtrim", vtrim, rocIds[iroc]);
+    rocTrim.insert(make_pair(rocIds[iroc], vtrim)); 
+
+    // -- solve for the trim bits of every pixel
+    int nfail(0); 
+    for (int ix = 0; ix < 52; ++ix) {
+      for (int iy = 0; iy < 80; ++iy) {
+	int idx = ix*80 + iy; 
+	int trim(7); 
+	if (slope[idx] > 0.) {
+	  double b = slope[idx]*vtrim/fParVtrimProbe; 
+	  trim = 15 - static_cast<int>(TMath::Nint((offset[idx] - fParVcal)/b)); 
+	  if (trim < 0) trim = 0; 
+	  if (trim > 15) trim = 15; 
+	} else {
+	  ++nfail; 
+	}
+	fTrimBits[iroc][ix][iy] = trim; 
+      }
+    }
+    LOG(logINFO) << "ROC " << static_cast<int>(rocIds[iroc]) << " vtrim = " << vtrim 
+		 << ", " << nfail << " pixels without threshold vs trim fit";
+  }
+  setTrimBits(); 
+
+  // -- single verification scan
+  trimDone("TrimDirectThrFinal", rocTrim, rocVthrComp); 
+}
+
+
+// ----------------------------------------------------------------------
+void PixTestTrim::trimDone(string name, map<int, int> &rocTrim, map<int, int> &rocVthrComp) {
+
+  vector<uint8_t> rocIds = fApi->_dut->getEnabledRocIDs(); 
+  TH2D *h2(0); 
+  string hname(""); 
+
   // -- create trimMap
   string trimbitsMeanString(""), trimbitsRmsString(""); 
-  for (unsigned int i = 0; i < thr5a.size(); ++i) {
+  for (unsigned int i = 0; i < rocIds.size(); ++i) {
     h2 = bookTH2D(Form("TrimMap_C%d", i), 
 		  Form("TrimMap_C%d", i), 
 		  52, 0., 52., 80, 0., 80.);
@@ -417,8 +570,8 @@ void PixTestTrim::trimTest() {
     fHistList.push_back(d1); 
   }
 
-  print(Form("TrimThrFinal extremal thresholds: %d .. %d", fParVcal-20,  fParVcal+20));
-  vector<TH1*> thrF = scurveMaps("vcal", "TrimThrFinal", fParNtrig, fParVcal-20, fParVcal+20, 20, 9); 
+  print(Form("%s extremal thresholds: %d .. %d", name.c_str(), fParVcal-20,  fParVcal+20));
+  vector<TH1*> thrF = scurveMaps("vcal", name, fParNtrig, fParVcal-20, fParVcal+20, 20, 9); 
   PixTest::update(); 
   string trimMeanString, trimRmsString; 
   for (unsigned int i = 0; i < thrF.size(); ++i) {
@@ -448,7 +601,7 @@ void PixTestTrim::trimTest() {
   saveTrimBits();
   
   // -- summary printout
-  LOG(logINFO) << "PixTestTrim::trimTest() done";
+  LOG(logINFO) << "PixTestTrim " << name << " done";
   LOG(logINFO) << "vtrim:     " << vtrimString; 
   LOG(logINFO) << "vthrcomp:  " << vthrcompString; 
   LOG(logINFO) << "vcal mean: " << trimMeanString; 
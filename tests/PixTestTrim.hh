@@ -16,6 +16,8 @@ public:
   void runCommand(std::string); 
   void trimBitTest();
   void trimTest();
+  /// trim bits solved per pixel from threshold maps at a few global trim settings
+  void trimDirect();
 
   int adjustVtrim(); 
   std::vector<TH1*> trimStep(std::string name, int corrections, std::vector<TH1*> calMapOld, int vcalMin, int vcalMax); 
@@ -24,8 +26,10 @@ public:
   void doTest(); 
 
 private:
+  bool setMinimalVthrComp(std::map<int, int> &rocVthrComp); 
+  void trimDone(std::string name, std::map<int, int> &rocTrim, std::map<int, int> &rocVthrComp); 
 
-  int     fParVcal, fParNtrig; 
+  int     fParVcal, fParNtrig, fParVtrimProbe, fParDirect; 
   std::vector<std::pair<int, int> > fPIX; 
   int fTrimBits[16][52][80]; 
   
@@ -0,0 +1,99 @@
+#include "api.h"
+#include "daemon.h"
+#include "log.h"
+#include "ConfigParameters.hh"
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <stdlib.h>
+#include <signal.h>
+
+// pxar daemon: owns the testboard and the DUT configured from a pxar
+// configuration directory and serves local clients, see pxar::pxarDaemon.
+
+// Only set by the signal handler, the daemon loop checks it and logs:
+volatile sig_atomic_t caught_signal = 0;
+
+void sighandler(int sig) {
+  caught_signal = sig;
+}
+
+int main(int argc, char* argv[]) {
+
+  std::string dir = ".";
+  std::string socket = pxar::DAEMON_SOCKET;
+  std::string verbosity = "INFO";
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i],"-h")) {
+      std::cout << "Help:" << std::endl;
+      std::cout << "-d dir         directory with the pxar configuration, default ." << std::endl;
+      std::cout << "-s socket      path of the daemon socket, default " << pxar::DAEMON_SOCKET << std::endl;
+      std::cout << "-v verbosity   verbosity level, default INFO" << std::endl;
+      return 0;
+    }
+    else if (!strcmp(argv[i],"-d")) {
+      dir = std::string(argv[++i]);
+      continue;
+    }
+    else if (!strcmp(argv[i],"-s")) {
+      socket = std::string(argv[++i]);
+      continue;
+    }
+    else if (!strcmp(argv[i],"-v")) {
+      verbosity = std::string(argv[++i]);
+      continue;
+    }
+    else {
+      std::cout << "Unrecognized command line option " << argv[i] << std::endl;
+    }
+  }
+
+  ConfigParameters *configParameters = ConfigParameters::Singleton();
+  configParameters->setDirectory(dir);
+  std::string cfgFile = configParameters->getDirectory() + std::string("/configParameters.dat");
+  if (!configParameters->readConfigParameterFile(cfgFile)) return 1;
+
+  std::string tbname = "*";
+  if (configParameters->getTbName() != "") tbname = configParameters->getTbName();
+
+  pxar::pxarCore * api = NULL;
+  try {
+    api = new pxar::pxarCore(tbname, verbosity);
+    api->initTestboard(configParameters->getTbSigDelays(),
+		       configParameters->getTbPowerSettings(),
+		       configParameters->getTbPgSettings());
+    if (configParameters->customI2cAddresses()) {
+      api->initDUT(configParameters->getHubId(),
+		   configParameters->getTbmType(), configParameters->getTbmDacs(),
+		   configParameters->getRocType(), configParameters->getRocDacs(),
+		   configParameters->getRocPixelConfig(),
+		   configParameters->getI2cAddresses());
+    } else {
+      api->initDUT(configParameters->getHubId(),
+		   configParameters->getTbmType(), configParameters->getTbmDacs(),
+		   configParameters->getRocType(), configParameters->getRocDacs(),
+		   configParameters->getRocPixelConfig());
+    }
+
+    api->SignalProbe("a1", configParameters->getProbe("a1"));
+    api->SignalProbe("a2", configParameters->getProbe("a2"));
+    api->SignalProbe("d1", configParameters->getProbe("d1"));
+    api->SignalProbe("d2", configParameters->getProbe("d2"));
+    api->daqSetConfig(configParameters->getDaqConfig());
+  }
+  catch (pxar::pxarException &e) {
+    std::cout << "pxar caught an exception: " << e.what() << std::endl;
+    delete api;
+    return -1;
+  }
+
+  pxar::pxarDaemon daemon(api, socket);
+  signal(SIGINT, &sighandler);
+  signal(SIGTERM, &sighandler);
+
+  bool ok = daemon.run(&caught_signal);
+
+  delete api;
+  return ok ? 0 : 1;
+}
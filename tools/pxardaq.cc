@@ -47,7 +47,7 @@ int getspill() {
 int main(int argc, char* argv[]) {
 
   std::cout << argc << " arguments provided." << std::endl;
-  std::string verbosity, filename;
+  std::string verbosity, filename, shmname;
   uint32_t triggers = 0;
   bool testpulses = false;
   bool spills = false;
@@ -65,6 +65,7 @@ int main(int argc, char* argv[]) {
       std::cout << "-sp            lock on accelerator spills" << std::endl;
       std::cout << "-tp            activate test pulses" << std::endl;
       std::cout << "-oos           test OutOfSync problem w/ 100 triggers & 1 token" << std::endl;
+      std::cout << "-shm name      publish DAQ data to shared memory ring (see pxarmon)" << std::endl;
       return 0;
     }
     else if (!strcmp(argv[i],"-f")) {
@@ -93,6 +94,10 @@ int main(int argc, char* argv[]) {
       oos = true;
       continue;
     }
+    else if (!strcmp(argv[i],"-shm")) {
+      shmname = std::string(argv[++i]);
+      continue;
+    }
     else {
       std::cout << "Unrecognized command line option " << argv[i] << std::endl;
     }
@@ -227,6 +232,9 @@ int main(int argc, char* argv[]) {
 
     _api->HVon();
 
+    // Publish all data read out for external monitoring processes:
+    if(!shmname.empty()) { _api->daqPublish(shmname); }
+
     // ##########################################################
     // Do some Raw data acquisition:
     
@@ -0,0 +1,107 @@
+#ifndef WIN32
+#include <unistd.h>
+#endif
+
+#include "eventring.h"
+#include "timer.h"
+#include "helper.h"
+#include "log.h"
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <stdlib.h>
+#include <signal.h>
+
+// Minimal online monitor attaching read-only to the shared memory ring
+// published by pxarCore::daqPublish(), printing rates and hits per ROC.
+
+bool mon_loop = true;
+
+void sighandler(int sig) {
+  std::cout << "Signal " << sig << " caught..." << std::endl;
+  mon_loop = false;
+}
+
+int main(int argc, char* argv[]) {
+
+  std::string name = "/pxar";
+  std::string verbosity = "INFO";
+  uint32_t interval = 1000;
+  bool fromOldest = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i],"-h")) {
+      std::cout << "Help:" << std::endl;
+      std::cout << "-n name        name of the shared memory ring, default /pxar" << std::endl;
+      std::cout << "-i ms          printout interval in milliseconds, default 1000" << std::endl;
+      std::cout << "-a             start with all records still held in the ring" << std::endl;
+      std::cout << "-v verbosity   verbosity level, default INFO" << std::endl;
+      return 0;
+    }
+    else if (!strcmp(argv[i],"-n")) {
+      name = std::string(argv[++i]);
+      continue;
+    }
+    else if (!strcmp(argv[i],"-i")) {
+      interval = atoi(argv[++i]);
+      continue;
+    }
+    else if (!strcmp(argv[i],"-a")) {
+      fromOldest = true;
+      continue;
+    }
+    else if (!strcmp(argv[i],"-v")) {
+      verbosity = std::string(argv[++i]);
+      continue;
+    }
+    else {
+      std::cout << "Unrecognized command line option " << argv[i] << std::endl;
+    }
+  }
+
+  pxar::Log::ReportingLevel() = pxar::Log::FromString(verbosity);
+  signal(SIGINT, &sighandler);
+
+  pxar::eventRingReader reader;
+  pxar::ringRecord record;
+  pxar::Event evt;
+  std::vector<uint32_t> hits(16, 0);
+  uint64_t events = 0, rawevents = 0, rawwords = 0;
+
+  pxar::timer t;
+  while(mon_loop) {
+    if(!reader.attached()) {
+      // Wait for a writer:
+      if(!reader.attach(name, fromOldest)) { pxar::mDelay(1000); continue; }
+      LOG(pxar::logINFO) << "Attached to " << name;
+    }
+
+    if(!reader.next(record)) {
+      // Nothing new, check whether the writer has gone or re-created the ring:
+      if(reader.stale()) { reader.detach(); }
+      else { pxar::mDelay(1); }
+    }
+    else if(record.getEvent(evt)) {
+      events++;
+      for(std::vector<pxar::pixel>::iterator px = evt.pixels.begin(); px != evt.pixels.end(); ++px) {
+	hits.at(px->roc())++;
+      }
+    }
+    else if(record.type == pxar::RING_RAWEVENT) { rawevents++; }
+    else if(record.type == pxar::RING_RAWBLOCK) { rawwords += record.payload.size()/sizeof(uint16_t); }
+
+    if(t.get() < interval) continue;
+    double sec = t.get()/1000.;
+    std::cout << std::fixed << std::setprecision(1)
+	      << "events " << events/sec << "/s, raw events " << rawevents/sec << "/s, raw words " << rawwords/sec
+	      << "/s, lost " << reader.lost() << std::endl << "  hits/ROC:";
+    for(size_t roc = 0; roc < hits.size(); roc++) { std::cout << " " << hits.at(roc); }
+    std::cout << std::endl;
+    events = rawevents = rawwords = 0;
+    hits.assign(hits.size(), 0);
+    t = pxar::timer();
+  }
+
+  return 0;
+}
@@ -80,6 +80,8 @@ void ConfigParameters::initialize() {
   fProbeD1 = "clk";
   fProbeD2 = "ctr";
 
+  fDaqConfig = pxar::daqConfig();
+
   rocZeroAnalogCurrent = 0.0;
   fRocType = "psi46digv21respin";
   fTbmType = ""; 
@@ -197,6 +199,11 @@ bool ConfigParameters::readConfigParameterFile(string file) {
       else if (0 == _name.compare("probeA2")) { fProbeA2 = _value; }
       else if (0 == _name.compare("probeD1")) { fProbeD1 = _value; }
       else if (0 == _name.compare("probeD2")) { fProbeD2 = _value; }
+
+      else if (0 == _name.compare("daqHugePages")) { fDaqConfig.hugePages = (_ivalue>0); }
+      else if (0 == _name.compare("daqLockMemory")) { fDaqConfig.lockMemory = (_ivalue>0); }
+      else if (0 == _name.compare("daqReaderCpu")) { fDaqConfig.readerCpu = _ivalue; }
+      else if (0 == _name.compare("daqDecoderCpu")) { fDaqConfig.decoderCpu = _ivalue; }
      
 
       else { LOG(logINFO) << "Did not understand '" << _name << "'."; }
@@ -819,6 +826,15 @@ bool ConfigParameters::writeConfigParameterFile() {
   fprintf(file, "probeD1 %s\n", fProbeD1.c_str());
   fprintf(file, "probeD2 %s\n", fProbeD2.c_str());
 
+  if (fDaqConfig.hugePages || fDaqConfig.lockMemory || fDaqConfig.readerCpu >= 0 || fDaqConfig.decoderCpu >= 0) {
+    fprintf(file, "\n");
+    fprintf(file, "-- DAQ memory and threads\n\n");
+    fprintf(file, "daqHugePages %i\n", fDaqConfig.hugePages);
+    fprintf(file, "daqLockMemory %i\n", fDaqConfig.lockMemory);
+    fprintf(file, "daqReaderCpu %i\n", fDaqConfig.readerCpu);
+    fprintf(file, "daqDecoderCpu %i\n", fDaqConfig.decoderCpu);
+  }
+
   fclose(file);
   return true;
 }
@@ -145,6 +145,8 @@ public:
   bool   getHvOn() {return fHvOn;}
 
   uint8_t getHubId() {return fHubId;}
+
+  pxar::daqConfig getDaqConfig() {return fDaqConfig;}
   
   static bool bothAreSpaces(char lhs, char rhs);
   void replaceAll(std::string& str, const std::string& from, const std::string& to);
@@ -177,6 +179,7 @@ private:
   std::string fTBName;
   bool fHvOn, fTbmEnable, fTbmEmulator, fKeithleyRemote, fGuiMode;
   std::string fProbeA1,fProbeA2, fProbeD1, fProbeD2;
+  pxar::daqConfig fDaqConfig;
 
   std::string fTBParametersFileName;
   std::string fTrimVcalSuffix;
@@ -18,6 +18,10 @@ PixSetup::PixSetup(pxarCore *a, PixTestParameters *tp, ConfigParameters *cp) {
   fDoAnalysisOnly    = false; 
   fDoUpdateRootFile  = false;
   fGuiActive         = false;
+  fUseResultCache    = false;
+  fForceRemeasure    = false;
+  fHvOn              = cp->getHvOn();
+  fHistMemoryBudget  = 0.;
   init(); 
 }
 
@@ -29,6 +33,10 @@ PixSetup::PixSetup(string verbosity, PixTestParameters *tp, ConfigParameters *cp
   fDoAnalysisOnly    = false; 
   fDoUpdateRootFile  = false;
   fGuiActive         = false;
+  fUseResultCache    = false;
+  fForceRemeasure    = false;
+  fHvOn              = cp->getHvOn();
+  fHistMemoryBudget  = 0.;
   init(); 
 
   vector<vector<pair<string,uint8_t> > >       rocDACs = fConfigParameters->getRocDacs(); 
@@ -59,6 +67,10 @@ PixSetup::PixSetup() {
   fConfigParameters  = 0; 
   fPixMonitor        = 0;
   fDoAnalysisOnly    = false; 
+  fUseResultCache    = false;
+  fForceRemeasure    = false;
+  fHvOn              = false;
+  fHistMemoryBudget  = 0.;
   init(); 
   LOG(logDEBUG) << "PixSetup ctor()";
 }
@@ -31,6 +31,14 @@ public:
   bool               doRootFileUpdate() {return fDoUpdateRootFile;}
   bool               guiActive() {return fGuiActive;}
   void               setGuiActive(bool x) {fGuiActive = x;}
+  bool               useResultCache() {return fUseResultCache;}
+  void               setUseResultCache(bool x) {fUseResultCache = x;}
+  bool               forceRemeasure() {return fForceRemeasure;}
+  void               setForceRemeasure(bool x) {fForceRemeasure = x;}
+  bool               hvIsOn() {return fHvOn;}
+  void               setHvOn(bool x) {fHvOn = x;}
+  double             histMemoryBudget() {return fHistMemoryBudget;}
+  void               setHistMemoryBudget(double x) {fHistMemoryBudget = x;}
 
   void               writeDacParameterFiles();
   void               writeTrimFiles();
@@ -43,6 +51,10 @@ private:
   bool              fDoAnalysisOnly; 
   bool              fUseRootLogon;
   bool              fGuiActive;
+  bool              fUseResultCache;
+  bool              fForceRemeasure;
+  bool              fHvOn;
+  double            fHistMemoryBudget; ///< in MB, 0 means unlimited
 
   pxar::pxarCore    *fApi; 
   PixTestParameters *fPixTestParameters; 